@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Instruction counter of the host benchmarks of the P61 and P73 stacks:
+ * the user space instructions retired by the calling thread, counted with
+ * perf_event_open around the timed loop and reported per frame as the
+ * insnPerFrame counter, which unlike the time does not depend on the load
+ * of the host. Without a hardware counter (no PMU in a VM, or
+ * perf_event_paranoid too high) the benchmark is labelled "no insn counter"
+ * and only timed.
+ */
+#ifndef _PHNXPESE_BENCH_INSNCOUNTER_H_
+#define _PHNXPESE_BENCH_INSNCOUNTER_H_
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+class phNxpEseBench_InsnCounter
+{
+public:
+    phNxpEseBench_InsnCounter() : mFd(-1)
+    {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0x00, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    ~phNxpEseBench_InsnCounter()
+    {
+        if (mFd >= 0)
+            close(mFd);
+    }
+
+    /* Counts from here to the next pause() or report() */
+    void resume()
+    {
+        if (mFd >= 0)
+            ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    void pause()
+    {
+        if (mFd >= 0)
+            ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    /* The instructions counted so far over 'frames', loop overhead included */
+    void report(benchmark::State& state, int64_t frames)
+    {
+        uint64_t count = 0;
+
+        pause();
+        if ((mFd < 0) || (read(mFd, &count, sizeof(count)) != (ssize_t)sizeof(count)))
+        {
+            state.SetLabel("no insn counter");
+            return;
+        }
+        if (frames > 0)
+            state.counters["insnPerFrame"] = (double)count / frames;
+    }
+
+private:
+    int mFd;
+};
+
+#endif /* _PHNXPESE_BENCH_INSNCOUNTER_H_ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * T=1 block handling shared by the P61 and P73 stacks: LRC, PCB decoding,
+ * block encoding and reassembly of chained responses. Each stack builds
+ * this module with its own phEseTypes.h and phEseStatus.h and keeps its
+ * own state machine: the threaded HAL of P61 on top of the TML, the
+ * synchronous protocol of P73 on top of the PAL.
+ */
+#ifndef _PHNXPESE_T1_H_
+#define _PHNXPESE_T1_H_
+
+#include <phEseTypes.h>
+#include <phEseStatus.h>
+
+/* Block: [NAD PCB LEN INF LRC] */
+#define PH_T1_NAD_OFFSET        0x00
+#define PH_T1_PCB_OFFSET        0x01
+#define PH_T1_LEN_OFFSET        0x02
+#define PH_T1_HEADER_LEN        0x03
+#define PH_T1_LRC_LEN           0x01
+#define PH_T1_MAX_INF_LEN       0xFE
+#define PH_T1_MAX_BLOCK_LEN     (PH_T1_HEADER_LEN + PH_T1_MAX_INF_LEN + PH_T1_LRC_LEN)
+
+/* PCB of the blocks sent */
+#define PH_T1_PCB_I(seqNo, more)    ((uint8_t)(((seqNo) << 6) | ((more) ? 0x20 : 0x00)))
+#define PH_T1_PCB_R(seqNo, error)   ((uint8_t)(0x80 | ((seqNo) << 4) | (error)))
+#define PH_T1_PCB_S(code)           ((uint8_t)(0xC0 | (code)))
+
+/* Error of an R-block, bits b2 b1 of its PCB */
+#define PH_T1_R_ACK             0x00
+#define PH_T1_R_PARITY_ERROR    0x01
+#define PH_T1_R_OTHER_ERROR     0x02
+#define PH_T1_R_UNDEFINED       0x03
+
+typedef enum phNxpEseT1_BlockType
+{
+    PH_T1_I_BLOCK,
+    PH_T1_R_BLOCK,
+    PH_T1_S_BLOCK
+} phNxpEseT1_BlockType_t;
+
+/* Decoded PCB */
+typedef struct phNxpEseT1_Pcb
+{
+    uint8_t type;   /* phNxpEseT1_BlockType_t */
+    uint8_t seqNo;  /* N(S) of an I-block, N(R) of an R-block */
+    uint8_t more;   /* M bit of an I-block */
+    uint8_t code;   /* PH_T1_R_* of an R-block, b6..b1 of an S-block */
+} phNxpEseT1_Pcb_t;
+
+/*
+ * Transport of the blocks, provided by each stack: the TML write for P61,
+ * the PAL write for P73.
+ */
+ESESTATUS phNxpEseT1_WriteFrame(uint32_t data_len, const uint8_t *p_data);
+
+uint8_t phNxpEseT1_computeLrc(const uint8_t *p_buff, uint32_t offset, uint32_t length);
+void phNxpEseT1_decodePcb(uint8_t pcb, phNxpEseT1_Pcb_t *p_pcb);
+uint32_t phNxpEseT1_buildBlock(uint8_t *p_frame, uint8_t pcb, const uint8_t *p_inf,
+        uint32_t inf_len);
+ESESTATUS phNxpEseT1_sendBlock(uint8_t pcb, const uint8_t *p_inf, uint32_t inf_len);
+
+ESESTATUS phNxpEseT1_storeRxData(uint32_t data_len, const uint8_t *p_data);
+ESESTATUS phNxpEseT1_getRxData(uint32_t *data_len, uint8_t **pp_data);
+void phNxpEseT1_resetRxData(void);
+
+#endif /* _PHNXPESE_T1_H_ */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * T=1 block handling shared by the P61 and P73 stacks. It has no state but
+ * the reassembly buffer and does not log: the stacks log the blocks in
+ * their own state machines.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <phNxpEseT1.h>
+
+/* First size of the reassembly buffer, a short chained response */
+#define PH_T1_RX_MIN_SIZE       0x200
+
+/* Block type and PCB fields by the three most significant bits of the PCB */
+typedef struct phNxpEseT1_PcbFormat
+{
+    uint8_t type;
+    uint8_t seqShift;   /* N(S) at b7, N(R) at b5 */
+    uint8_t moreMask;   /* M bit, I-blocks only */
+    uint8_t codeMask;   /* R-block error, S-block function */
+} phNxpEseT1_PcbFormat_t;
+
+static const phNxpEseT1_PcbFormat_t gPcbFormats[8] =
+{
+    { PH_T1_I_BLOCK, 6, 0x20, 0x00 }, /* 000x xxxx */
+    { PH_T1_I_BLOCK, 6, 0x20, 0x00 }, /* 001x xxxx */
+    { PH_T1_I_BLOCK, 6, 0x20, 0x00 }, /* 010x xxxx */
+    { PH_T1_I_BLOCK, 6, 0x20, 0x00 }, /* 011x xxxx */
+    { PH_T1_R_BLOCK, 4, 0x00, 0x03 }, /* 100x xxxx */
+    { PH_T1_R_BLOCK, 4, 0x00, 0x03 }, /* 101x xxxx */
+    { PH_T1_S_BLOCK, 8, 0x00, 0x3F }, /* 110x xxxx */
+    { PH_T1_S_BLOCK, 8, 0x00, 0x3F }, /* 111x xxxx */
+};
+
+STATIC uint8_t *gRxBuff = NULL;
+STATIC uint32_t gRxLen = 0;
+STATIC uint32_t gRxSize = 0;
+
+/******************************************************************************
+ * Function         phNxpEseT1_computeLrc
+ *
+ * Description      This function computes the LRC of p_buff from offset up to
+ *                  length excluded, a word at a time
+ *
+ * Returns          The LRC
+ *
+ ******************************************************************************/
+uint8_t phNxpEseT1_computeLrc(const uint8_t *p_buff, uint32_t offset, uint32_t length)
+{
+    const uint8_t *p = p_buff + offset;
+    const uint8_t *p_end = p_buff + length;
+    uint32_t lrc = 0;
+    uint32_t word;
+
+    if (offset >= length)
+        return 0x00;
+    while ((uint32_t)(p_end - p) >= sizeof(word))
+    {
+        memcpy(&word, p, sizeof(word));
+        lrc ^= word;
+        p += sizeof(word);
+    }
+    lrc ^= lrc >> 16;
+    lrc ^= lrc >> 8;
+    while (p < p_end)
+        lrc ^= *p++;
+    return (uint8_t)lrc;
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_decodePcb
+ *
+ * Description      This function decodes the type and the fields of a PCB
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseT1_decodePcb(uint8_t pcb, phNxpEseT1_Pcb_t *p_pcb)
+{
+    const phNxpEseT1_PcbFormat_t *p_format = &gPcbFormats[pcb >> 5];
+
+    p_pcb->type = p_format->type;
+    p_pcb->seqNo = (uint8_t)((pcb >> p_format->seqShift) & 0x01);
+    p_pcb->more = (uint8_t)((pcb & p_format->moreMask) != 0);
+    p_pcb->code = (uint8_t)(pcb & p_format->codeMask);
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_buildBlock
+ *
+ * Description      This function encodes a block with NAD 0 in p_frame, which
+ *                  holds inf_len + PH_T1_HEADER_LEN + PH_T1_LRC_LEN bytes.
+ *                  p_inf may already be in place in p_frame.
+ *
+ * Returns          The length of the block
+ *
+ ******************************************************************************/
+uint32_t phNxpEseT1_buildBlock(uint8_t *p_frame, uint8_t pcb, const uint8_t *p_inf,
+        uint32_t inf_len)
+{
+    uint32_t frame_len = inf_len + PH_T1_HEADER_LEN + PH_T1_LRC_LEN;
+
+    p_frame[PH_T1_NAD_OFFSET] = 0x00;
+    p_frame[PH_T1_PCB_OFFSET] = pcb;
+    p_frame[PH_T1_LEN_OFFSET] = (uint8_t)inf_len;
+    if ((0 != inf_len) && (p_inf != &p_frame[PH_T1_HEADER_LEN]))
+        memcpy(&p_frame[PH_T1_HEADER_LEN], p_inf, inf_len);
+    p_frame[frame_len - 1] = phNxpEseT1_computeLrc(p_frame, 0, frame_len - 1);
+    return frame_len;
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_sendBlock
+ *
+ * Description      This function encodes a block and writes it with the
+ *                  transport of the stack
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseT1_sendBlock(uint8_t pcb, const uint8_t *p_inf, uint32_t inf_len)
+{
+    uint8_t frame[PH_T1_MAX_BLOCK_LEN];
+
+    if (inf_len > PH_T1_MAX_INF_LEN)
+        return ESESTATUS_INVALID_PARAMETER;
+    return phNxpEseT1_WriteFrame(phNxpEseT1_buildBlock(frame, pcb, p_inf, inf_len), frame);
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_storeRxData
+ *
+ * Description      This function appends the INF of a received I-block to the
+ *                  response being reassembled
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseT1_storeRxData(uint32_t data_len, const uint8_t *p_data)
+{
+    uint8_t *p_buff;
+    uint32_t size;
+
+    if ((gRxLen + data_len) > gRxSize)
+    {
+        size = (gRxSize != 0) ? gRxSize : PH_T1_RX_MIN_SIZE;
+        while (size < (gRxLen + data_len))
+            size <<= 1;
+        p_buff = (uint8_t *)realloc(gRxBuff, size);
+        if (NULL == p_buff)
+            return ESESTATUS_NOT_ENOUGH_MEMORY;
+        gRxBuff = p_buff;
+        gRxSize = size;
+    }
+    if (0 != data_len)
+        memcpy(&gRxBuff[gRxLen], p_data, data_len);
+    gRxLen += data_len;
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_getRxData
+ *
+ * Description      This function hands the reassembled response over to the
+ *                  caller, who frees it, and starts the next one empty
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseT1_getRxData(uint32_t *data_len, uint8_t **pp_data)
+{
+    if (0 == gRxLen)
+        return ESESTATUS_FAILED;
+    *pp_data = gRxBuff;
+    *data_len = gRxLen;
+    gRxBuff = NULL;
+    gRxLen = 0;
+    gRxSize = 0;
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEseT1_resetRxData
+ *
+ * Description      This function drops the response being reassembled
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseT1_resetRxData(void)
+{
+    free(gRxBuff);
+    gRxBuff = NULL;
+    gRxLen = 0;
+    gRxSize = 0;
+}
@@ -36,7 +36,8 @@ LOCAL_ARM_MODE := ar
 #LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)
 LOCAL_MODULE_TAGS := optional
 LOCAL_MULTILIB := both
-LOCAL_SRC_FILES := $(call all-c-files-under, .)  $(call all-cpp-files-under, .)
+LOCAL_SRC_FILES := $(filter-out tools/%, $(call all-c-files-under, .)  $(call all-cpp-files-under, .))
+LOCAL_SRC_FILES += ../common/src/phNxpEseT1.c
 
 ANDROID_VER := $(subst ., , $(PLATFORM_VERSION))
 ANDROID_VER := $(word 1, $(ANDROID_VER))
@@ -84,3 +85,119 @@ LOCAL_CFLAGS += -DJCOP_VER_3_2=$(JCOP_VER_3_2)
 LOCAL_CFLAGS += -DJCOP_VER_3_3=$(JCOP_VER_3_3)
 LOCAL_CFLAGS += -DNFC_NXP_ESE_VER=$(JCOP_VER_3_3)
 include $(BUILD_SHARED_LIBRARY)
+
+#### Micro benchmarks of the DAL message queue (Google Benchmark) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_p61_queue_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += -Wall -Wextra -DANDROID
+LOCAL_SRC_FILES := \
+    tml/phDal4Ese_messageQueueLib.c \
+    log/phNxpLog.c \
+    utils/phNxpConfig.cpp \
+    tools/phDal4Ese_QueueBench.cpp
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/common \
+	$(LOCAL_PATH)/log \
+	$(LOCAL_PATH)/tml \
+        $(LOCAL_PATH)/../common/include \
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_NATIVE_BENCHMARK)
+
+#### Frame completion latency of the TML over a simulated SPI (Google Benchmark) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_p61_completion_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += -Wall -Wextra -DANDROID
+LOCAL_CFLAGS += -DJCOP_VER_3_1=1 -DJCOP_VER_3_2=2 -DJCOP_VER_3_3=3 -DNFC_NXP_ESE_VER=3
+LOCAL_SRC_FILES := \
+    tml/phTmlEse.c \
+    tml/phOsalEse_Timer.c \
+    tml/phDal4Ese_messageQueueLib.c \
+    utils/phNxpSpiHal_utils.c \
+    log/phNxpLog.c \
+    utils/phNxpConfig.cpp \
+    tools/phTmlEse_SimSpi.c \
+    tools/phTmlEse_CompletionBench.cpp
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/common \
+	$(LOCAL_PATH)/hal \
+	$(LOCAL_PATH)/log \
+	$(LOCAL_PATH)/tml \
+	$(LOCAL_PATH)/spm \
+        $(LOCAL_PATH)/../common/include \
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_NATIVE_BENCHMARK)
+
+#### Preemption of a normal session by a priority session over a simulated eSE (Google Benchmark) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_p61_prio_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += -Wall -Wextra -DANDROID
+LOCAL_CFLAGS += -DJCOP_VER_3_1=1 -DJCOP_VER_3_2=2 -DJCOP_VER_3_3=3 -DNFC_NXP_ESE_VER=3
+LOCAL_SRC_FILES := \
+    hal/phNxpEseHal.c \
+    hal/phNxpEseHal_Apdu.c \
+    hal/phNxpEseProtocol.c \
+    tml/phTmlEse.c \
+    tml/phOsalEse_Timer.c \
+    tml/phDal4Ese_messageQueueLib.c \
+    utils/phNxpSpiHal_utils.c \
+    log/phNxpLog.c \
+    utils/phNxpConfig.cpp \
+    ../common/src/phNxpEseT1.c \
+    tools/phNxpEseHal_SimCard.c \
+    tools/phNxpEseHal_PrioBench.cpp
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/common \
+	$(LOCAL_PATH)/hal \
+	$(LOCAL_PATH)/log \
+	$(LOCAL_PATH)/tml \
+	$(LOCAL_PATH)/spm \
+        $(LOCAL_PATH)/../common/include \
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_NATIVE_BENCHMARK)
+
+#### Per frame cost of the shared T=1 core in the P61 build (Google Benchmark) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_p61_t1_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += -Wall -Wextra -DANDROID
+LOCAL_SRC_FILES := \
+    ../common/src/phNxpEseT1.c \
+    tools/phNxpEseT1_FrameBench.cpp
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/common \
+        $(LOCAL_PATH)/../common/include \
+
+include $(BUILD_HOST_NATIVE_BENCHMARK)
+
+#### Registration of pending semaphores under contention (Google Benchmark) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_p61_semlist_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS += -Wall -Wextra -DANDROID
+LOCAL_SRC_FILES := \
+    utils/phNxpSpiHal_utils.c \
+    log/phNxpLog.c \
+    utils/phNxpConfig.cpp \
+    tools/phNxpSpiHal_SemListBench.cpp
+LOCAL_C_INCLUDES += \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/common \
+	$(LOCAL_PATH)/log \
+	$(LOCAL_PATH)/tml \
+        $(LOCAL_PATH)/../common/include \
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_NATIVE_BENCHMARK)
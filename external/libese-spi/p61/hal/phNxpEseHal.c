@@ -15,6 +15,8 @@
  */
 
 #include <sys/stat.h>
+#include <time.h>
+#include <errno.h>
 #include <phNxpEseHal.h>
 #include <phTmlEse.h>
 #include <phDal4Ese_messageQueueLib.h>
@@ -34,9 +36,47 @@
 /* SPI HAL Control structure */
 phNxpEseP61_Control_t nxpesehal_ctrl;
 
+/* Priority session preempting a normal session of this process */
+typedef enum
+{
+    PRIO_SESSION_NONE = 0x00,  /* no priority session running over a normal one */
+    PRIO_SESSION_PENDING,      /* priority request waits for the block boundary */
+    PRIO_SESSION_ACTIVE,       /* normal session parked, priority session runs */
+} phNxpEseP61_PrioState_t;
+
+/* State of the normal session kept aside while it is parked. The T=1
+ * sequence numbers belong to the link and the eSE keeps counting them through
+ * the priority session, so they carry over instead of being restored. */
+typedef struct phNxpEseP61_ParkedSession
+{
+    ese_stack_data_callback_t *p_ese_stack_data_cback;
+    unsigned long int wtx_counter_value;
+    uint8_t ifsc;
+    phTmlEse_CompletionMode_t eCompletion;
+} phNxpEseP61_ParkedSession_t;
+
+typedef struct phNxpEseP61_PrioPreempt
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    phNxpEseP61_PrioState_t state;
+    bool_t normalOpen;    /* session opened by phNxpEseP61_open */
+    bool_t closing;       /* phNxpEseP61_close is tearing the session down */
+    bool_t exchange;      /* a T=1 exchange is outstanding on the link */
+    bool_t resumePending; /* priority window ended during a priority exchange */
+    bool_t parkedClose;   /* normal session closed while parked */
+    phNxpEseP61_ParkedSession_t parked;
+    phNxpEseP61_prioStats stats;
+} phNxpEseP61_PrioPreempt_t;
+
+static phNxpEseP61_PrioPreempt_t gPrioPreempt = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+        PRIO_SESSION_NONE, FALSE, FALSE, FALSE, FALSE, FALSE, {NULL, 0, 0, phTmlEse_e_CompleteDeferred},
+        {0, 0, 0, 0, 0}};
+
 /* TML Context */
 extern phTmlEse_Context_t *gpphTmlEse_Context;
 extern void ese_stack_data_callback(ESESTATUS status, phNxpEseP61_data *eventData);
+extern uint8_t PH_SCAL_T1_MAXLEN;
 /**************** local methods used in this file only ************************/
 
 STATIC void phNxpEseP61_write_complete(void *pContext, phTmlEse_TransactInfo_t *pInfo);
@@ -47,6 +87,14 @@ STATIC void phNxpEseP61_WaitForAckCb(uint32_t timerId, void *pContext);
 STATIC void phNxpEseP61_PrioSessionTimer(uint32_t timerId, uint32_t timeout);
 STATIC void phNxpEseP61_PrioSessionTimeout(uint32_t timerId, void *pContext);
 STATIC void phNxpEseP61_internal_write_complete(void *pContext, phTmlEse_TransactInfo_t *pInfo);
+STATIC bool_t phNxpEseP61_DeferReadComplete(phTmlEse_TransactInfo_t *pInfo);
+STATIC void phNxpEseP61_ReadDeferredCb(void *pParams);
+STATIC ESESTATUS phNxpEseP61_TransceiveSession(uint16_t data_len, const uint8_t *p_data,
+        phNxpEseP61_PrioState_t session);
+STATIC ESESTATUS phNxpEseP61_PrioPreempt(ese_stack_data_callback_t *p_data_cback,
+        uint32_t timeOut, bool_t nonBlockingCallback, bool_t *pOpen);
+STATIC void phNxpEseP61_PrioResumeLocked(bool_t stopTimer);
+STATIC uint64_t phNxpEseP61_NowUs(void);
 /******************************************************************************
  * Function         phNxpEseP61_open
  *
@@ -238,6 +286,11 @@ ESESTATUS phNxpEseP61_open( ese_stack_data_callback_t *p_data_cback, phNxpEseP61
         nxpesehal_ctrl.p_ese_stack_data_cback = NULL;
         goto clean_and_return;
     }
+    if (initParams.nonBlockingCallback)
+    {
+        /* Complete frames on the TML threads, skipping the client thread hop */
+        phTmlEse_ConfigCompletion(phTmlEse_e_CompleteInline);
+    }
     if (p_data_cback == NULL)
     {
         NXPLOG_SPIHAL_D("%s p_data_cback is null", __FUNCTION__);
@@ -254,6 +307,14 @@ ESESTATUS phNxpEseP61_open( ese_stack_data_callback_t *p_data_cback, phNxpEseP61
 
     CONCURRENCY_UNLOCK();
 
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    gPrioPreempt.normalOpen = TRUE;
+    gPrioPreempt.state = PRIO_SESSION_NONE;
+    gPrioPreempt.exchange = FALSE;
+    gPrioPreempt.resumePending = FALSE;
+    gPrioPreempt.parkedClose = FALSE;
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
     NXPLOG_SPIHAL_E("wConfigStatus %x", wConfigStatus);
     return wConfigStatus;
 
@@ -297,6 +358,18 @@ ESESTATUS phNxpEseP61_openPrioSession(ese_stack_data_callback_t *p_data_cback,
     SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
     spm_state_t current_spm_state = SPM_STATE_INVALID;
 #endif
+    if(nxpesehal_ctrl.halStatus != ESE_STATUS_CLOSE)
+    {
+        bool_t open = FALSE;
+        wConfigStatus = phNxpEseP61_PrioPreempt(p_data_cback, timeOut,
+                initParams.nonBlockingCallback, &open);
+        if(!open)
+        {
+            return wConfigStatus;
+        }
+        /* The normal session closed meanwhile, open a session of its own */
+        wConfigStatus = ESESTATUS_SUCCESS;
+    }
     memset(&nxpesehal_ctrl, 0x00, sizeof(nxpesehal_ctrl));
     memset(&tOsalConfig, 0x00, sizeof(tOsalConfig));
     memset(&tTmlConfig, 0x00, sizeof(tTmlConfig));
@@ -442,6 +515,11 @@ ESESTATUS phNxpEseP61_openPrioSession(ese_stack_data_callback_t *p_data_cback,
         nxpesehal_ctrl.p_ese_stack_data_cback = NULL;
         goto clean_and_return;
     }
+    if (initParams.nonBlockingCallback)
+    {
+        /* Complete frames on the TML threads, skipping the client thread hop */
+        phTmlEse_ConfigCompletion(phTmlEse_e_CompleteInline);
+    }
     if (p_data_cback == NULL)
     {
         NXPLOG_SPIHAL_D("%s p_data_cback is null", __FUNCTION__);
@@ -495,8 +573,48 @@ ESESTATUS phNxpEseP61_openPrioSession(ese_stack_data_callback_t *p_data_cback,
  *
  ******************************************************************************/
 ESESTATUS phNxpEseP61_Transceive(uint16_t data_len, const uint8_t *p_data)
+{
+    return phNxpEseP61_TransceiveSession(data_len, p_data, PRIO_SESSION_NONE);
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_PrioTransceive
+ *
+ * Description      This function sends an APDU of the priority session. While
+ *                  a normal session is parked phNxpEseP61_Transceive is kept
+ *                  for it, otherwise both are the same.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseP61_PrioTransceive(uint16_t data_len, const uint8_t *p_data)
+{
+    phNxpEseP61_PrioState_t state;
+
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    state = gPrioPreempt.state;
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
+    return phNxpEseP61_TransceiveSession(data_len, p_data,
+            (state == PRIO_SESSION_ACTIVE) ? PRIO_SESSION_ACTIVE : PRIO_SESSION_NONE);
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_TransceiveSession
+ *
+ * Description      This function sends an APDU of the given session. It is
+ *                  refused with ESESTATUS_BUSY when the link belongs to the
+ *                  other session, which also holds the next APDU of a normal
+ *                  session back once a priority request waits for it.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEseP61_TransceiveSession(uint16_t data_len, const uint8_t *p_data,
+        phNxpEseP61_PrioState_t session)
 {
     ESESTATUS status = ESESTATUS_FAILED;
+    phNxpEseP61_PrioState_t prio_state;
 
 #ifdef SPM_INTEGRATED
     if (nxpesehal_ctrl.spm_power_state == FALSE)
@@ -523,7 +641,19 @@ ESESTATUS phNxpEseP61_Transceive(uint16_t data_len, const uint8_t *p_data)
     }
     else
     {
+        pthread_mutex_lock(&gPrioPreempt.lock);
+        if (gPrioPreempt.state != session)
+        {
+            prio_state = gPrioPreempt.state;
+            pthread_mutex_unlock(&gPrioPreempt.lock);
+            NXPLOG_SPIHAL_E(" %s P61 - BUSY with the other session (prio state %d) \n",
+                    __FUNCTION__, prio_state);
+            return ESESTATUS_BUSY;
+        }
+        gPrioPreempt.exchange = TRUE;
         nxpesehal_ctrl.halStatus = ESE_STATUS_BUSY;
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+
         status = phNxpEseP61_ProcessData(data_len, (uint8_t *)p_data);
         nxpesehal_ctrl.cmd_rsp_state = STATE_TRANS_ONGOING;
         NXPLOG_SPIHAL_D("%s state = STATE_TRANS_ONGOING", __FUNCTION__);
@@ -532,6 +662,7 @@ ESESTATUS phNxpEseP61_Transceive(uint16_t data_len, const uint8_t *p_data)
         {
             NXPLOG_SPIHAL_E(" %s phNxpEseP61_ProcessData- Failed \n", __FUNCTION__);
             nxpesehal_ctrl.halStatus = ESE_STATUS_IDLE;
+            phNxpEseP61_ExchangeDone();
         }
 
         NXPLOG_SPIHAL_E(" %s Exit status 0x%x \n", __FUNCTION__, status);
@@ -594,6 +725,18 @@ ESESTATUS phNxpEseP61_close(void)
 #ifdef SPM_INTEGRATED
     SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
 #endif
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    if (gPrioPreempt.state == PRIO_SESSION_ACTIVE)
+    {
+        /* The link belongs to the priority session, close once it is done */
+        gPrioPreempt.parkedClose = TRUE;
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        NXPLOG_SPIHAL_D("%s normal session parked, closing after the priority session", __FUNCTION__);
+        return ESESTATUS_SUCCESS;
+    }
+    gPrioPreempt.closing = TRUE;
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
     CONCURRENCY_LOCK();
 
 #ifdef SPM_INTEGRATED
@@ -639,10 +782,83 @@ ESESTATUS phNxpEseP61_close(void)
 
     phNxpSpiHal_cleanup_monitor();
 
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    gPrioPreempt.closing = FALSE;
+    gPrioPreempt.normalOpen = FALSE;
+    gPrioPreempt.exchange = FALSE;
+    gPrioPreempt.parkedClose = FALSE;
+    pthread_cond_broadcast(&gPrioPreempt.cond);
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
     /* Return success always */
     return status;
 }
 
+/******************************************************************************
+ * Function         phNxpEseP61_closePrioSession
+ *
+ * Description      This function ends the priority session. A normal session
+ *                  it parked is resumed, or closed if its client closed it
+ *                  meanwhile, nothing is left to do once the priority window
+ *                  timed out. Without one it is the same as phNxpEseP61_close.
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseP61_closePrioSession(void)
+{
+    bool_t closeNormal = FALSE;
+    unsigned long int maxWaitMs = 0;
+    struct timespec deadline;
+    int rc = 0;
+
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    if (gPrioPreempt.state != PRIO_SESSION_ACTIVE)
+    {
+        if (gPrioPreempt.normalOpen)
+        {
+            /* The priority window timed out, the normal session runs again */
+            pthread_mutex_unlock(&gPrioPreempt.lock);
+            return ESESTATUS_SUCCESS;
+        }
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        return phNxpEseP61_close();
+    }
+    /* Let the last priority exchange deliver to the priority client */
+    if (!GetNxpNumValue(NAME_NXP_ESE_PRIO_MAX_WAIT_MS, &maxWaitMs, sizeof(maxWaitMs)))
+    {
+        maxWaitMs = 1000;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += maxWaitMs / 1000;
+    deadline.tv_nsec += (maxWaitMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while (gPrioPreempt.exchange && (gPrioPreempt.state == PRIO_SESSION_ACTIVE) && (rc != ETIMEDOUT))
+    {
+        rc = pthread_cond_timedwait(&gPrioPreempt.cond, &gPrioPreempt.lock, &deadline);
+    }
+    if (gPrioPreempt.state == PRIO_SESSION_ACTIVE)
+    {
+        if (gPrioPreempt.exchange)
+        {
+            NXPLOG_SPIHAL_E("%s priority exchange still outstanding, resuming anyway", __FUNCTION__);
+        }
+        closeNormal = gPrioPreempt.parkedClose;
+        phNxpEseP61_PrioResumeLocked(TRUE);
+    }
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
+    if (closeNormal)
+    {
+        phNxpEseP61_close();
+    }
+    return ESESTATUS_SUCCESS;
+}
+
 /******************************************************************************
  * Function         phNxpEseP61_client_thread
  *
@@ -831,6 +1047,23 @@ STATIC void phNxpEseP61_PrioSessionTimeout(uint32_t timerId, void *pContext)
     NXPLOG_SPIHAL_E("%s TIMEOUT !!!", __FUNCTION__);
     UNUSED(timerId);
     UNUSED(pContext);
+
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    if ((gPrioPreempt.state == PRIO_SESSION_ACTIVE) && !gPrioPreempt.parkedClose)
+    {
+        /* End of the priority window, hand the link back to the parked session */
+        if (gPrioPreempt.exchange)
+        {
+            gPrioPreempt.resumePending = TRUE;
+        }
+        else
+        {
+            phNxpEseP61_PrioResumeLocked(FALSE);
+        }
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        return;
+    }
+    pthread_mutex_unlock(&gPrioPreempt.lock);
 #ifdef SPM_INTEGRATED
     status = phNxpEseP61_SPM_ConfigPwr(SPM_POWER_PRIO_DISABLE);
     if(status != ESESTATUS_SUCCESS)
@@ -839,6 +1072,253 @@ STATIC void phNxpEseP61_PrioSessionTimeout(uint32_t timerId, void *pContext)
     }
 #endif
 }
+/******************************************************************************
+ * Function         phNxpEseP61_NowUs
+ *
+ * Description      This function reads the monotonic clock.
+ *
+ * Returns          Time in us.
+ *
+ ******************************************************************************/
+STATIC uint64_t phNxpEseP61_NowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_PrioPreempt
+ *
+ * Description      This function preempts the normal session of this process
+ *                  for a priority session. T=1 only lets the link change
+ *                  hands when the eSE has returned the last block of an
+ *                  exchange, so the next APDU of the normal session is held
+ *                  back and the request waits for the outstanding one to be
+ *                  delivered, at most NXP_ESE_PRIO_MAX_WAIT_MS. The normal
+ *                  session is then parked and the priority one installed on
+ *                  the same TML and client thread.
+ *                  pOpen is set when no normal session was left to preempt,
+ *                  the caller then opens a session of its own.
+ *
+ * Returns          ESESTATUS_SUCCESS once the priority session runs,
+ *                  ESESTATUS_BUSY if the boundary was not reached in time.
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEseP61_PrioPreempt(ese_stack_data_callback_t *p_data_cback,
+        uint32_t timeOut, bool_t nonBlockingCallback, bool_t *pOpen)
+{
+    ESESTATUS status = ESESTATUS_SUCCESS;
+    unsigned long int maxWaitMs = 0;
+    struct timespec deadline;
+    uint64_t startUs = 0, waitUs = 0;
+    int rc = 0;
+#ifdef SPM_INTEGRATED
+    SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
+#endif
+
+    *pOpen = FALSE;
+    if (!GetNxpNumValue(NAME_NXP_ESE_PRIO_MAX_WAIT_MS, &maxWaitMs, sizeof(maxWaitMs)))
+    {
+        maxWaitMs = 1000;
+    }
+
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    if (!gPrioPreempt.normalOpen)
+    {
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        if (nxpesehal_ctrl.halStatus == ESE_STATUS_CLOSE)
+        {
+            *pOpen = TRUE;
+            return ESESTATUS_SUCCESS;
+        }
+        ALOGE(" %s : SPI prio session is already opened...second instance not allowed", __FUNCTION__);
+        return ESESTATUS_BUSY;
+    }
+    if (gPrioPreempt.state != PRIO_SESSION_NONE)
+    {
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        ALOGE(" %s : normal session already preempted...second instance not allowed", __FUNCTION__);
+        return ESESTATUS_BUSY;
+    }
+
+    gPrioPreempt.state = PRIO_SESSION_PENDING;
+    startUs = phNxpEseP61_NowUs();
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += maxWaitMs / 1000;
+    deadline.tv_nsec += (maxWaitMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while ((gPrioPreempt.exchange || gPrioPreempt.closing) && gPrioPreempt.normalOpen
+            && (rc != ETIMEDOUT))
+    {
+        rc = pthread_cond_timedwait(&gPrioPreempt.cond, &gPrioPreempt.lock, &deadline);
+    }
+    waitUs = phNxpEseP61_NowUs() - startUs;
+    gPrioPreempt.stats.totalWaitUs += waitUs;
+    if (waitUs > gPrioPreempt.stats.maxWaitUs)
+    {
+        gPrioPreempt.stats.maxWaitUs = waitUs;
+    }
+
+    if (!gPrioPreempt.normalOpen)
+    {
+        gPrioPreempt.state = PRIO_SESSION_NONE;
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        *pOpen = TRUE;
+        return ESESTATUS_SUCCESS;
+    }
+    if (gPrioPreempt.exchange || gPrioPreempt.closing)
+    {
+        gPrioPreempt.state = PRIO_SESSION_NONE;
+        gPrioPreempt.stats.waitTimeouts++;
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        NXPLOG_SPIHAL_E("%s no block boundary within %lu ms", __FUNCTION__, maxWaitMs);
+        return ESESTATUS_BUSY;
+    }
+
+#ifdef SPM_INTEGRATED
+    wSpmStatus = phNxpEseP61_SPM_ConfigPwr(SPM_POWER_PRIO_ENABLE);
+    if (wSpmStatus != SPMSTATUS_SUCCESS)
+    {
+        NXPLOG_SPIHAL_E("phNxpEseP61_SPM_ConfigPwr: enabling power for spi prio Failed");
+        gPrioPreempt.state = PRIO_SESSION_NONE;
+        pthread_mutex_unlock(&gPrioPreempt.lock);
+        if (wSpmStatus == SPMSTATUS_DEVICE_BUSY)
+        {
+            return ESESTATUS_BUSY;
+        }
+        else if (wSpmStatus == SPMSTATUS_DEVICE_DWNLD_BUSY)
+        {
+            return ESESTATUS_DWNLD_BUSY;
+        }
+        return ESESTATUS_FAILED;
+    }
+#endif
+
+    /* Park the normal session and install the priority one */
+    gPrioPreempt.parked.p_ese_stack_data_cback = nxpesehal_ctrl.p_ese_stack_data_cback;
+    gPrioPreempt.parked.wtx_counter_value = nxpesehal_ctrl.wtx_counter_value;
+    gPrioPreempt.parked.ifsc = PH_SCAL_T1_MAXLEN;
+    gPrioPreempt.parked.eCompletion = gpphTmlEse_Context->eCompletion;
+    phTmlEse_ConfigCompletion(nonBlockingCallback ?
+            phTmlEse_e_CompleteInline : phTmlEse_e_CompleteDeferred);
+    nxpesehal_ctrl.p_ese_stack_data_cback =
+            (p_data_cback == NULL) ? ese_stack_data_callback : p_data_cback;
+    nxpesehal_ctrl.wtx_counter = 0;
+    nxpesehal_ctrl.retry_cnt = 0;
+    nxpesehal_ctrl.recovery_counter = 0;
+    gPrioPreempt.resumePending = FALSE;
+    gPrioPreempt.parkedClose = FALSE;
+    gPrioPreempt.state = PRIO_SESSION_ACTIVE;
+    gPrioPreempt.stats.preemptions++;
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+
+    NXPLOG_SPIHAL_D("%s normal session parked after %llu us", __FUNCTION__,
+            (unsigned long long)waitUs);
+    if (timeOut)
+    {
+        if (nxpesehal_ctrl.timeoutPrioSessionTimerId == 0)
+        {
+            nxpesehal_ctrl.timeoutPrioSessionTimerId = phOsalEse_Timer_Create();
+        }
+        phNxpEseP61_PrioSessionTimer(nxpesehal_ctrl.timeoutPrioSessionTimerId, timeOut);
+    }
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_PrioResumeLocked
+ *
+ * Description      This function ends the priority session and gives the
+ *                  link back to the parked normal session. Called with
+ *                  gPrioPreempt.lock held and no exchange outstanding.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+STATIC void phNxpEseP61_PrioResumeLocked(bool_t stopTimer)
+{
+#ifdef SPM_INTEGRATED
+    SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
+#endif
+
+    if (stopTimer && (nxpesehal_ctrl.timeoutPrioSessionTimerId != 0))
+    {
+        phOsalEse_Timer_Stop(nxpesehal_ctrl.timeoutPrioSessionTimerId);
+    }
+#ifdef SPM_INTEGRATED
+    wSpmStatus = phNxpEseP61_SPM_ConfigPwr(SPM_POWER_PRIO_DISABLE);
+    if (wSpmStatus != SPMSTATUS_SUCCESS)
+    {
+        NXPLOG_SPIHAL_E("%s phNxpEseP61_SPM_ConfigPwr: spi prio disable failed", __FUNCTION__);
+    }
+#endif
+    nxpesehal_ctrl.p_ese_stack_data_cback = gPrioPreempt.parked.p_ese_stack_data_cback;
+    nxpesehal_ctrl.wtx_counter_value = gPrioPreempt.parked.wtx_counter_value;
+    PH_SCAL_T1_MAXLEN = gPrioPreempt.parked.ifsc;
+    phTmlEse_ConfigCompletion(gPrioPreempt.parked.eCompletion);
+    nxpesehal_ctrl.wtx_counter = 0;
+    nxpesehal_ctrl.retry_cnt = 0;
+    nxpesehal_ctrl.recovery_counter = 0;
+    gPrioPreempt.state = PRIO_SESSION_NONE;
+    gPrioPreempt.resumePending = FALSE;
+    gPrioPreempt.parkedClose = FALSE;
+    gPrioPreempt.stats.resumes++;
+    pthread_cond_broadcast(&gPrioPreempt.cond);
+    NXPLOG_SPIHAL_D("%s normal session resumed", __FUNCTION__);
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_ExchangeDone
+ *
+ * Description      This function is called once the response or the failure
+ *                  of an exchange has been delivered, which is the block
+ *                  boundary a waiting priority request preempts at.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseP61_ExchangeDone(void)
+{
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    gPrioPreempt.exchange = FALSE;
+    if ((gPrioPreempt.state == PRIO_SESSION_ACTIVE) && gPrioPreempt.resumePending)
+    {
+        phNxpEseP61_PrioResumeLocked(FALSE);
+    }
+    pthread_cond_broadcast(&gPrioPreempt.cond);
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_getPrioStats
+ *
+ * Description      This function copies out the counters of the priority
+ *                  preemption and optionally clears them.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseP61_getPrioStats(phNxpEseP61_prioStats *pStats, bool_t reset)
+{
+    if (pStats == NULL)
+    {
+        return ESESTATUS_INVALID_PARAMETER;
+    }
+    pthread_mutex_lock(&gPrioPreempt.lock);
+    *pStats = gPrioPreempt.stats;
+    if (reset)
+    {
+        memset(&gPrioPreempt.stats, 0x00, sizeof(gPrioPreempt.stats));
+    }
+    pthread_mutex_unlock(&gPrioPreempt.lock);
+    return ESESTATUS_SUCCESS;
+}
+
 /******************************************************************************
  * Function         phNxpEseP61_read_complete
  *
@@ -858,6 +1338,10 @@ STATIC void phNxpEseP61_read_complete(void *pContext, phTmlEse_TransactInfo_t *p
     UNUSED(pContext);
     ESESTATUS status = ESESTATUS_FAILED;
 
+    if (phNxpEseP61_DeferReadComplete(pInfo))
+    {
+        return;
+    }
     nxpesehal_ctrl.retry_cnt = 0;
     if (pInfo->wStatus == ESESTATUS_SUCCESS)
     {
@@ -905,6 +1389,54 @@ STATIC void phNxpEseP61_read_complete(void *pContext, phTmlEse_TransactInfo_t *p
     return;
 }
 
+/******************************************************************************
+ * Function         phNxpEseP61_DeferReadComplete
+ *
+ * Description      This function moves a read completion which may block from
+ *                  the TML reader thread to the client thread when frames
+ *                  complete inline: the read retry sleeps and a response
+ *                  racing a reset waits for the reset to finish.
+ *
+ * Returns          TRUE if the completion was posted to the client thread.
+ *
+ ******************************************************************************/
+STATIC bool_t phNxpEseP61_DeferReadComplete(phTmlEse_TransactInfo_t *pInfo)
+{
+    static phTmlEse_TransactInfo_t tTransactionInfo;
+    static phLibEse_DeferredCall_t tDeferredInfo;
+    static phLibEse_Message_t tMsg;
+
+    if (pthread_equal(pthread_self(), nxpesehal_ctrl.client_thread) ||
+            ((pInfo->wStatus == ESESTATUS_SUCCESS) &&
+            (nxpesehal_ctrl.cmd_rsp_state != STATE_RESET_BLOCKED)))
+    {
+        return FALSE;
+    }
+    NXPLOG_SPIHAL_D("%s read completion moved to the client thread", __FUNCTION__);
+    tTransactionInfo = *pInfo;
+    tDeferredInfo.pCallback = &phNxpEseP61_ReadDeferredCb;
+    tDeferredInfo.pParameter = &tTransactionInfo;
+    tMsg.eMsgType = PH_LIBESE_DEFERREDCALL_MSG;
+    tMsg.pMsgData = &tDeferredInfo;
+    tMsg.Size = sizeof(tDeferredInfo);
+    phTmlEse_DeferredCall(nxpesehal_ctrl.gDrvCfg.nClientId, &tMsg);
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEseP61_ReadDeferredCb
+ *
+ * Description      This function runs a read completion moved to the client
+ *                  thread by phNxpEseP61_DeferReadComplete.
+ *
+ * Returns          void.
+ *
+ ******************************************************************************/
+STATIC void phNxpEseP61_ReadDeferredCb(void *pParams)
+{
+    phNxpEseP61_read_complete(NULL, (phTmlEse_TransactInfo_t *) pParams);
+}
+
 /******************************************************************************
  * Function         phNxpEseP61_write_timeout_cb
  *
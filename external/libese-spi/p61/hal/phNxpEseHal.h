@@ -113,5 +113,6 @@ typedef struct phNxpEseP61_Control
 ESESTATUS phNxpEseP61_WriteFrame(uint32_t data_len, const uint8_t *p_data);
 ESESTATUS phNxpEseP61_InternalWriteFrame(uint32_t data_len, const uint8_t *p_data);
 ESESTATUS phNxpEseP61_read(void);
+void phNxpEseP61_ExchangeDone(void);
 
 #endif /* _PHNXPSPIHAL_H_ */
@@ -22,8 +22,6 @@
 
 #define SPI_RECOVERY_SUPPORTED 1
 uint8_t PH_SCAL_T1_MAXLEN = 254;
-const uint8_t PH_SCAL_T1_HEADER_LEN = 0x03;
-const uint8_t PH_SCAL_T1_CRC_LEN = 0x01;
 const uint8_t PH_SCAL_T1_PCB_OFFSET = 0x01;
 const uint8_t PH_SCAL_T1_DATA_LEN_OFFSET = 0x02;
 uint8_t recv_chained_frame = 0x00;
@@ -31,15 +29,11 @@ static uint8_t Rframe_send=0;
 static uint8_t CRC_SEQ=0;
 extern phNxpEseP61_Control_t nxpesehal_ctrl;
 STATIC ESESTATUS phNxpEseP61_SendFrame(uint8_t mode,uint32_t data_len, uint8_t *p_data);
-STATIC uint8_t phNxpEseP61_ComputeLRC(unsigned char *p_buff, uint32_t offset,
-        uint32_t length);
 STATIC ESESTATUS phNxpEseP61_ProcessChainedFrame(uint32_t data_len, uint8_t *p_data);
 STATIC ESESTATUS phNxpEseP61_ProcessAck(int32_t data_len, uint8_t *p_data);
 STATIC void phNxpEseP61_SendtoUpper(ESESTATUS status, void *data);
 STATIC ESESTATUS phNxpEseP61_CheckPCB(uint8_t pcb);
-STATIC void phNxpEseP61_DecodePcb(uint8_t pcb, struct PCB_BITS *pcbbits);
-STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t pcb,
-        struct PCB_BITS *pcb_bits);
+STATIC ESESTATUS phNxpEseP61_DecodeStatus(const phNxpEseT1_Pcb_t *p_pcb);
 STATIC ESESTATUS phNxpEseP61_CheckLRC(uint32_t data_len, uint8_t *p_data);
 STATIC ESESTATUS phNxpEseP61_SendRawFrame(uint32_t data_len, uint8_t *p_data);
 STATIC void phNxpEseP61_UnlockAck(ESESTATUS status);
@@ -103,48 +97,26 @@ STATIC ESESTATUS phNxpEseP61_SendFrame(uint8_t mode, uint32_t data_len, uint8_t
     ESESTATUS status = ESESTATUS_FAILED;
     ESESTATUS wstatus = ESESTATUS_FAILED;
     uint32_t frame_len = 0;
-    uint8_t *p_framebuff = NULL;
-    uint8_t pcb_byte = 0;
+    uint8_t *p_framebuff = nxpesehal_ctrl.p_last_frame;
     Rframe_send = 0;
     if (0 == data_len || NULL == p_data)
     {
         NXPLOG_SPIHAL_E("%s Error in buffer/len", __FUNCTION__);
         return status;
     }
-
-    frame_len = (data_len + PH_SCAL_T1_HEADER_LEN + PH_SCAL_T1_CRC_LEN);
-
-    p_framebuff = malloc(frame_len * sizeof(uint8_t));
-    if (NULL == p_framebuff)
+    if (data_len > PH_T1_MAX_INF_LEN)
     {
-        NXPLOG_SPIHAL_E("%s Error allocating memory\n", __FUNCTION__);
-        return ESESTATUS_NOT_ENOUGH_MEMORY;
-    }
-
-    /* frame the packet */
-    p_framebuff[0] = 0x00; /* NAD Byte */
-
-    if (PH_SCAL_T1_CHAINING == mode)
-    {
-        /* make B6 (M) bit high */
-        pcb_byte |= PH_SCAL_T1_CHAINING;
+        NXPLOG_SPIHAL_E("%s Error I frame len %d too large", __FUNCTION__, data_len);
+        return ESESTATUS_INVALID_PARAMETER;
     }
 
     /* Update the send seq no */
     nxpesehal_ctrl.seq_counter = (nxpesehal_ctrl.seq_counter ^ 1);
-    pcb_byte |= (nxpesehal_ctrl.seq_counter << 6);
-
-    /* store the pcb byte */
-    p_framebuff[1] = pcb_byte;
-    /* store I frame length */
-    p_framebuff[2] = data_len;
-    /* store I frame */
-    memcpy(&(p_framebuff[3]), p_data, data_len);
-    p_framebuff[frame_len - 1] = phNxpEseP61_ComputeLRC(p_framebuff, 0,
-            (frame_len - 1));
-    /* store last frame */
+
+    /* frame the packet in place of the last frame, B6 (M) bit high if chained */
+    frame_len = phNxpEseT1_buildBlock(p_framebuff,
+            PH_T1_PCB_I(nxpesehal_ctrl.seq_counter, PH_SCAL_T1_CHAINING == mode), p_data, data_len);
     nxpesehal_ctrl.last_frame_len = frame_len;
-    memcpy(nxpesehal_ctrl.p_last_frame, p_framebuff, frame_len);
 
     status = phNxpEseP61_WriteFrame(frame_len, p_framebuff);
     if (ESESTATUS_SUCCESS != status)
@@ -159,34 +131,24 @@ STATIC ESESTATUS phNxpEseP61_SendFrame(uint8_t mode, uint32_t data_len, uint8_t
             NXPLOG_SPIHAL_E("%s phNxpEseP61_read failed \n", __FUNCTION__);
         }
     }
-    free(p_framebuff);
     return status;
 }
 
 /**
  * \ingroup spi_t1_protocol_implementation
- * \brief This function is used to calculate the LRC (one byte).  \n
- * LRC will be part the epilogue field conveys the error detection code of the block. \n
- * When LRC is used, exclusive-oring of all the bytes of the block from NAD to LRC inclusive shall give '00'. Any other value is invalid.
+ * \brief This function is the transport of the shared T=1 blocks. \n
+ * The blocks are written to the TML like the raw frames.
  *
- * \param[in]       unsigned char*
- * \param[in]       uint32_t
  * \param[in]       uint32_t
+ * \param[in]       const uint8_t*
  *
- * \retval Calculated LRC (uint8_t)
+ * \retval On Success ESESTATUS_SUCCESS else proper error code
  *
 */
 
-STATIC uint8_t phNxpEseP61_ComputeLRC(unsigned char *p_buff, uint32_t offset,
-        uint32_t length)
+ESESTATUS phNxpEseT1_WriteFrame(uint32_t data_len, const uint8_t *p_data)
 {
-    uint32_t LRC = 0, i = 0;
-
-    for (i = offset; i < length; i++)
-    {
-        LRC = LRC ^ p_buff[i];
-    }
-    return (uint8_t) LRC;
+    return phNxpEseP61_InternalWriteFrame(data_len, p_data);
 }
 
 /**
@@ -280,7 +242,7 @@ STATIC ESESTATUS phNxpEseP61_CheckLRC(uint32_t data_len, uint8_t *p_data)
 
     NXPLOG_SPIHAL_D("%s Received CRC   0x%X", __FUNCTION__, recv_crc);
     /* calculate the CRC after excluding CRC  */
-    calc_crc = phNxpEseP61_ComputeLRC(p_data, 0, (data_len -1));
+    calc_crc = phNxpEseT1_computeLrc(p_data, 0, (data_len -1));
 
     NXPLOG_SPIHAL_D("%s Calculated CRC 0x%X", __FUNCTION__, calc_crc);
     if (recv_crc != calc_crc)
@@ -321,22 +283,21 @@ STATIC ESESTATUS phNxpEseP61_CheckLRC(uint32_t data_len, uint8_t *p_data)
  *
 */
 
-STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t pcb,
-        struct PCB_BITS *pcb_bits)
+STATIC ESESTATUS phNxpEseP61_DecodeStatus(const phNxpEseT1_Pcb_t *p_pcb)
 {
     ESESTATUS status = ESESTATUS_SUCCESS;
-    int32_t error_code = (int32_t)(pcb & 0x3F); /*discard upper 2 bits */
+    int32_t error_code = (int32_t)p_pcb->code;
 
-    switch (frame_type)
+    switch (p_pcb->type)
     {
-    case PH_SCAL_I_FRAME:
-        NXPLOG_SPIHAL_D("Recv Seq bit  = 0x%x", pcb_bits->bit7);
+    case PH_T1_I_BLOCK:
+        NXPLOG_SPIHAL_D("Recv Seq bit  = 0x%x", p_pcb->seqNo);
 
-        NXPLOG_SPIHAL_D("More Data bit = 0x%x", pcb_bits->bit6);
-        if (pcb_bits->bit6)
+        NXPLOG_SPIHAL_D("More Data bit = 0x%x", p_pcb->more);
+        if (p_pcb->more)
         {
             NXPLOG_SPIHAL_D("Chained Frame - RECV");
-            recv_chained_frame = 0x00 | pcb_bits->bit7;
+            recv_chained_frame = p_pcb->seqNo;
             status = ESESTATUS_MORE_FRAME;
         } else
         {
@@ -351,24 +312,22 @@ STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t
 #endif
         break;
 
-    case PH_SCAL_R_FRAME:
-        NXPLOG_SPIHAL_D("Don't care  = 0x%x", pcb_bits->bit6);
-        NXPLOG_SPIHAL_D("N(R)  = 0x%x", pcb_bits->bit5);
-        nxpesehal_ctrl.recv_seq_counter = 0;
-        nxpesehal_ctrl.recv_seq_counter |= pcb_bits->bit5;
+    case PH_T1_R_BLOCK:
+        NXPLOG_SPIHAL_D("N(R)  = 0x%x", p_pcb->seqNo);
+        nxpesehal_ctrl.recv_seq_counter = p_pcb->seqNo;
         NXPLOG_SPIHAL_D("nxpesehal_ctrl.recv_seq_counter = 0x%x",nxpesehal_ctrl.recv_seq_counter);
         NXPLOG_SPIHAL_D("nxpesehal_ctrl.seq_counter = 0x%x", nxpesehal_ctrl.seq_counter);
-        if ((pcb_bits->lsb == 0x00) && (pcb_bits->bit2 == 0x00))
+        if (PH_T1_R_ACK == p_pcb->code)
         {
             NXPLOG_SPIHAL_D("%s Received ACK", __FUNCTION__);
             nxpesehal_ctrl.isRFrame = 0;
         }
-        else if ((pcb_bits->lsb == 0x01) && (pcb_bits->bit2 == 0x00))
+        else if (PH_T1_R_PARITY_ERROR == p_pcb->code)
         {
-            NXPLOG_SPIHAL_E(" Error : redundancy code error or a character parity = 0x%x", pcb_bits->lsb);
+            NXPLOG_SPIHAL_E(" Error : redundancy code error or a character parity");
             status = ESESTATUS_PARITY_ERROR;
         }
-        else if ((pcb_bits->lsb == 0x00) && (pcb_bits->bit2 == 0x01))
+        else if (PH_T1_R_OTHER_ERROR == p_pcb->code)
         {
             status = ESESTATUS_CRC_ERROR;
             nxpesehal_ctrl.isRFrame = 0;
@@ -443,7 +402,7 @@ STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t
         else
         {
             NXPLOG_SPIHAL_E("Undefined behaviour");
-            if(pcb_bits->bit2 == 0x01 && Rframe_send != 1)
+            if((p_pcb->code & PH_T1_R_OTHER_ERROR) && Rframe_send != 1)
             {
                 status=ESESTATUS_FRAME_RESEND;
                 NXPLOG_SPIHAL_E("Send the last frame as undefined behaviour with other indicated error");
@@ -469,7 +428,7 @@ STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t
 #endif
         break;
 
-    case PH_SCAL_S_FRAME:
+    case PH_T1_S_BLOCK:
     {
         NXPLOG_SPIHAL_E("%s 0x%x", __FUNCTION__, error_code);
         switch (error_code)
@@ -537,23 +496,6 @@ STATIC ESESTATUS phNxpEseP61_DecodeStatus(PH_SCAL_T1_FRAME_T frame_type, uint8_t
     return status;
 }
 
-/**
- * \ingroup spi_t1_protocol_implementation
- * \brief This function decodes PCB byte in bit-field. \n
- * PCB is used in identifying the frame type.
- *
- * \param[in]       uint8_t
- * \param[in]       struct PCB_BITS*
- *
- * \retval void
- *
-*/
-
-STATIC void phNxpEseP61_DecodePcb(uint8_t pcb, struct PCB_BITS *pcbbits)
-{
-    memcpy(pcbbits, &pcb, sizeof(uint8_t));
-}
-
 /**
  * \ingroup spi_t1_protocol_implementation
  * \brief It used to find out the frame type based on PCB field
@@ -566,9 +508,7 @@ STATIC void phNxpEseP61_DecodePcb(uint8_t pcb, struct PCB_BITS *pcbbits)
 
 STATIC ESESTATUS phNxpEseP61_CheckPCB(uint8_t pcb)
 {
-    ESESTATUS status = ESESTATUS_SUCCESS;
-    PH_SCAL_T1_FRAME_T frame_type;
-    struct PCB_BITS pcb_bits;
+    phNxpEseT1_Pcb_t pcb_fields;
 
     /*An information block (I-block) is used to convey information for use by the application layer.
      *  In addition, it conveys a positive or negative acknowledgment.*/
@@ -587,39 +527,24 @@ STATIC ESESTATUS phNxpEseP61_CheckPCB(uint8_t pcb)
      *
      * R :              1       0
      */
-
-    /*Below function will store MSB in pcb_buff[1] and B7 in pcb_buff[0] */
-    memset(&pcb_bits, 0x00, sizeof(struct PCB_BITS));
     NXPLOG_SPIHAL_D("PCB Byte = 0x%X", pcb);
-    phNxpEseP61_DecodePcb(pcb, &pcb_bits);
+    phNxpEseT1_decodePcb(pcb, &pcb_fields);
 
-    if (0x00 == pcb_bits.msb)
+    if (PH_T1_I_BLOCK == pcb_fields.type)
     {
         NXPLOG_SPIHAL_D("%s I-Frame Received", __FUNCTION__);
-        frame_type = PH_SCAL_I_FRAME;
         nxpesehal_ctrl.isRFrame = 0;
     }
-    else if ((0x01 == pcb_bits.msb) && (0x00 == pcb_bits.bit7))
+    else if (PH_T1_R_BLOCK == pcb_fields.type)
     {
         NXPLOG_SPIHAL_D("%s R-Frame Received", __FUNCTION__);
-        frame_type = PH_SCAL_R_FRAME;
     }
-    else if ((0x01 == pcb_bits.msb) && (0x01 == pcb_bits.bit7))
+    else
     {
         NXPLOG_SPIHAL_D("%s S-Frame Received", __FUNCTION__);
-        frame_type = PH_SCAL_S_FRAME;
         nxpesehal_ctrl.isRFrame = 0;
     }
-    else
-    {
-        NXPLOG_SPIHAL_E("%s Wrong-Frame Received", __FUNCTION__);
-        status = ESESTATUS_INVALID_PARAMETER;
-    }
-    if (ESESTATUS_SUCCESS == status)
-    {
-        status = phNxpEseP61_DecodeStatus(frame_type, pcb, &pcb_bits);
-    }
-    return status;
+    return phNxpEseP61_DecodeStatus(&pcb_fields);
 }
 /**
  * \ingroup spi_t1_protocol_implementation
@@ -634,12 +559,20 @@ STATIC ESESTATUS phNxpEseP61_CheckPCB(uint8_t pcb)
 
 STATIC void phNxpEseP61_SendtoUpper(ESESTATUS status, void *data)
 {
+    ese_stack_data_callback_t *p_data_cback = nxpesehal_ctrl.p_ese_stack_data_cback;
 
     NXPLOG_SPIHAL_E("%s status 0x%x", __FUNCTION__, status);
     nxpesehal_ctrl.halStatus = ESE_STATUS_IDLE;
     nxpesehal_ctrl.recovery_counter = 0;
-    (nxpesehal_ctrl.p_ese_stack_data_cback)(status, data);
-
+    /* The eSE has handed the link back, unless it only asked for more time.
+     * The session switch a waiting priority request makes from here on keeps
+     * the callback of this exchange, and the next response can't overwrite
+     * the data before it returns as read completions run one at a time. */
+    if (ESESTATUS_WTX_REQ != status)
+    {
+        phNxpEseP61_ExchangeDone();
+    }
+    (p_data_cback)(status, data);
 }
 
 /**
@@ -721,7 +654,8 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
     STATIC bool_t chained_flag = FALSE;
     phNxpEseP61_data pRes;
     bool_t wtx_flag = FALSE;
-    uint8_t recv_ack[4] = {0x00, 0x80, 0x00, 0x00};
+    uint8_t r_seq = 0;
+    uint8_t wtx_inf = 0x01;
 
     NXPLOG_SPIHAL_D("%s - Enter action 0x%X - data_len %d !!!", __FUNCTION__, action_evt, data_len);
     if (nxpesehal_ctrl.recovery_counter > 3)
@@ -758,23 +692,21 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
 #ifdef SPI_RECOVERY_SUPPORTED
         status = ESESTATUS_REVOCERY_STARTED;
         nxpesehal_ctrl.halStatus = ESE_STATUS_RECOVERY;
-        recv_ack[1] = 0x82;
         if((ESESTATUS_RESPONSE_TIMEOUT == action_evt) || (ESESTATUS_FRAME_SEND_R_FRAME == action_evt))
         {
-            recv_ack[1] |= (((nxpesehal_ctrl.seq_counter) << 4));
+            r_seq = nxpesehal_ctrl.seq_counter;
         }
         else
         {
-            recv_ack[1] |= (((nxpesehal_ctrl.recv_seq_counter) << 4));
+            r_seq = nxpesehal_ctrl.recv_seq_counter;
         }
         if (nxpesehal_ctrl.recovery_counter < 3)
         {
             nxpesehal_ctrl.recovery_counter++;
-            recv_ack[3] = phNxpEseP61_ComputeLRC(recv_ack, 0x00, (sizeof(recv_ack) -1));
             nxpesehal_ctrl.last_state = PH_SCAL_R_FRAME;
-            nxpesehal_ctrl.seq_counter =(0x01 & (recv_ack[1] >> 4) );
+            nxpesehal_ctrl.seq_counter = (0x01 & r_seq);
             NXPLOG_SPIHAL_D("Send sequence num for RESPONSE_TIMEOUT or FRAME_RESEND_R_FRAME is [0x%x] \n",nxpesehal_ctrl.seq_counter);
-            phNxpEseP61_SendRawFrame(sizeof(recv_ack), recv_ack);
+            phNxpEseT1_sendBlock(PH_T1_PCB_R(nxpesehal_ctrl.seq_counter, PH_T1_R_OTHER_ERROR), NULL, 0);
         }
         else
         {
@@ -808,26 +740,25 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
         status = ESESTATUS_CRC_ERROR;
         nxpesehal_ctrl.halStatus = ESESTATUS_FRAME_RESEND_RNAK;
 
-        uint8_t recv_RNAK[4] = {0x00, 0x82, 0x00, 0x00};
         if(ESESTATUS_FRAME_RESEND_RNAK == action_evt)
         {
-            recv_RNAK[1] |= (((!(nxpesehal_ctrl.recv_seq_counter)) << 4));
+            r_seq = !(nxpesehal_ctrl.recv_seq_counter);
         }
         else if(ESESTATUS_INVALID_PARAMETER == status)
         {
-            recv_RNAK[1] |= (((nxpesehal_ctrl.seq_counter) << 4));
+            r_seq = nxpesehal_ctrl.seq_counter;
         }
         else
         {
-            recv_RNAK[1] |= (((CRC_SEQ) << 4));
+            r_seq = CRC_SEQ;
             Rframe_send = 1;
             NXPLOG_SPIHAL_D("CRC_SEQ value is [0x%x] ",CRC_SEQ);
         }
-        NXPLOG_SPIHAL_D("%s Send R Frame  0x%x ", __FUNCTION__, recv_RNAK[1]);
-        recv_RNAK[3] = phNxpEseP61_ComputeLRC(recv_RNAK, 0x00, (sizeof(recv_RNAK) -1));
-        nxpesehal_ctrl.seq_counter =(0x01 & (recv_RNAK[1] >> 4) );
+        nxpesehal_ctrl.seq_counter = (0x01 & r_seq);
+        NXPLOG_SPIHAL_D("%s Send R Frame  0x%x ", __FUNCTION__,
+                PH_T1_PCB_R(nxpesehal_ctrl.seq_counter, PH_T1_R_OTHER_ERROR));
         NXPLOG_SPIHAL_D("sequence counter for send R Frame  0x%x ",nxpesehal_ctrl.seq_counter );
-        phNxpEseP61_SendRawFrame(sizeof(recv_RNAK), recv_RNAK);
+        phNxpEseT1_sendBlock(PH_T1_PCB_R(nxpesehal_ctrl.seq_counter, PH_T1_R_OTHER_ERROR), NULL, 0);
         break;
 
     case ESESTATUS_MORE_FRAME:
@@ -835,7 +766,7 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
         /* acknowledge the frame and save data in linked list
          *
          */
-        if (ESESTATUS_SUCCESS != phNxpEseP61_StoreDatainList(data_len, p_data))
+        if (ESESTATUS_SUCCESS != phNxpEseT1_storeRxData(data_len, p_data))
         {
             NXPLOG_SPIHAL_E("%s - Error storing chained data in list", __FUNCTION__);
         }
@@ -850,7 +781,7 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
         {
             if (data_len > 0)
             {
-                if (ESESTATUS_SUCCESS != phNxpEseP61_StoreDatainList(data_len, p_data))
+                if (ESESTATUS_SUCCESS != phNxpEseT1_storeRxData(data_len, p_data))
                 {
                     NXPLOG_SPIHAL_E("%s - Error storing chained data in list", __FUNCTION__);
                 }
@@ -946,7 +877,7 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
     else if (TRUE == chained_flag && ESESTATUS_SUCCESS == status)
     {
         NXPLOG_SPIHAL_D("%s Chained Frame Resoponse", __FUNCTION__);
-        status = phNxpEseP61_GetData(&pRes.len, &pRes.p_data);
+        status = phNxpEseT1_getRxData(&pRes.len, &pRes.p_data);
         if (ESESTATUS_SUCCESS == status)
         {
             NXPLOG_SPIHAL_D("%s DataLen = %d", __FUNCTION__, pRes.len);
@@ -957,7 +888,7 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
         }
         else
         {
-            NXPLOG_SPIHAL_E("%s phNxpEseP61_GetData failed 0x%X", __FUNCTION__, status);
+            NXPLOG_SPIHAL_E("%s phNxpEseT1_getRxData failed 0x%X", __FUNCTION__, status);
             /*Unblock if any pending reset wait for reset to complete*/
             pnNxpEseP61_resetCmdRspState(status);
             phNxpEseP61_SendtoUpper(ESESTATUS_FAILED, NULL);
@@ -977,7 +908,6 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
     }
     else if (ESESTATUS_WTX_REQ == status)
     {
-        uint8_t wtx_frame[] = {0x00, 0xE3, 0x01, 0x01, 0xE3};
         NXPLOG_SPIHAL_D("%s WTX Request", __FUNCTION__);
         /* Trigger SPI service to re-set timer */
         if(wtx_flag)
@@ -986,11 +916,11 @@ ESESTATUS phNxpEseP61_Action(ESESTATUS action_evt, uint32_t data_len, uint8_t *p
             {
                 phNxpEseP61_SPM_DisablePwr();
                 NXPLOG_SPIHAL_D(" Disable power to P61 wtx count reached!!!");
-                status = phNxpEseP61_SendRawFrame(sizeof(wtx_frame), wtx_frame);
+                status = phNxpEseT1_sendBlock(PH_T1_PCB_S(WTX_RES), &wtx_inf, sizeof(wtx_inf));
                 return status;
             }
         }
-        status = phNxpEseP61_SendRawFrame(sizeof(wtx_frame), wtx_frame);
+        status = phNxpEseT1_sendBlock(PH_T1_PCB_S(WTX_RES), &wtx_inf, sizeof(wtx_inf));
         if (ESESTATUS_SUCCESS == status)
         {
             status = ESESTATUS_WTX_REQ;
@@ -1178,6 +1108,46 @@ ESESTATUS phNxpEseP61_setIfsc(uint16_t IFSC_Size)
     PH_SCAL_T1_MAXLEN = IFSC_Size;
     return ESESTATUS_SUCCESS;
 }
+
+/**
+ * \ingroup spi_t1_protocol_implementation
+ * \brief This function turns the debug logs written for every frame (HAL,
+ * TML and packet dumps) off for bulk transfers, the errors are kept.
+ * Turning them on restores the levels in use before.
+ *
+ * \param[in]       enable
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEseP61_setFrameLog(bool_t enable)
+{
+    static spi_log_level_t sSavedLevel;
+    static bool_t sSuppressed = FALSE;
+
+    if (!enable && !sSuppressed)
+    {
+        sSavedLevel = gLog_level;
+        if (gLog_level.hal_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.hal_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.tml_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.tml_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.spix_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.spix_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.spir_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.spir_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        sSuppressed = TRUE;
+    }
+    else if (enable && sSuppressed)
+    {
+        gLog_level.hal_log_level = sSavedLevel.hal_log_level;
+        gLog_level.tml_log_level = sSavedLevel.tml_log_level;
+        gLog_level.spix_log_level = sSavedLevel.spix_log_level;
+        gLog_level.spir_log_level = sSavedLevel.spir_log_level;
+        sSuppressed = FALSE;
+    }
+    return ESESTATUS_SUCCESS;
+}
 /** @} */
 
 /**
@@ -1193,14 +1163,13 @@ ESESTATUS phNxpEseP61_setIfsc(uint16_t IFSC_Size)
 STATIC ESESTATUS pnNxpEseP61_sendRFrame(void)
 {
     ESESTATUS status = ESESTATUS_FAILED;
-    uint8_t recv_ack[4]= {0x00,0x80,0x00,0x00};
+    uint8_t pcb;
 
-    recv_ack[1] |= ((!recv_chained_frame) << 4);
-    nxpesehal_ctrl.seq_counter =(0x01 & (recv_ack[1] >> 4) );
-    NXPLOG_SPIHAL_D("%s Send ACK for chained frame 0x%x seq num [0x%x]", __FUNCTION__, recv_ack[1],nxpesehal_ctrl.seq_counter);
+    nxpesehal_ctrl.seq_counter = !recv_chained_frame;
+    pcb = PH_T1_PCB_R(nxpesehal_ctrl.seq_counter, PH_T1_R_ACK);
+    NXPLOG_SPIHAL_D("%s Send ACK for chained frame 0x%x seq num [0x%x]", __FUNCTION__, pcb,nxpesehal_ctrl.seq_counter);
 
-    recv_ack[3] = phNxpEseP61_ComputeLRC(recv_ack, 0x00, (sizeof(recv_ack) -1));
-    status = phNxpEseP61_SendRawFrame(sizeof(recv_ack), recv_ack);
+    status = phNxpEseT1_sendBlock(pcb, NULL, 0);
 
     if (ESESTATUS_SUCCESS == status)
     {
@@ -18,7 +18,7 @@
 #include <phTmlEse.h>
 #include <phNxpEseHal.h>
 #include <phNxpLog.h>
-#include <phNxpEseRecvMgr.h>
+#include <phNxpEseT1.h>
 
 
 #define PH_SCAL_T1_CHAINING       0x20
@@ -49,18 +49,6 @@ typedef enum PH_SCAL_T1_IFRAME_ERROR {
     INVALID_REQ_RES
 } PH_SCAL_T1_IFRAME_ERROR_T;
 
-struct PCB_BITS {
-    uint8_t lsb :1;
-    uint8_t bit2 :1;
-    uint8_t bit3 :1;
-    uint8_t bit4 :1;
-    uint8_t bit5 :1;
-    uint8_t bit6 :1;
-    uint8_t bit7 :1;
-    uint8_t msb :1;
-
-};
-
 /* Timeout value to wait for response from P61
    Note: Timeout value updated from 1000 to 2000 to fix the JCOP delay (WTX)*/
 #define HAL_EXTNS_WRITE_RSP_TIMEOUT   (2000)
@@ -51,8 +51,24 @@ typedef enum
 typedef struct phNxpEseP61_initParams
 {
     phNxpEseP61_initMode initMode; /*!< Ese communication mode */
+    bool_t nonBlockingCallback; /*!< TRUE if the data callback never blocks, frames then complete on the TML threads instead of the client thread */
 } phNxpEseP61_initParams;
 
+/**
+ * \ingroup spi_libese
+ * \brief Counters of the priority sessions that preempted a normal session,
+ *        see phNxpEseP61_openPrioSession and phNxpEseP61_getPrioStats
+ *
+ */
+typedef struct phNxpEseP61_prioStats
+{
+    uint32_t preemptions;   /*!< Normal sessions parked for a priority session */
+    uint32_t waitTimeouts;  /*!< Priority requests refused after NXP_ESE_PRIO_MAX_WAIT_MS */
+    uint32_t resumes;       /*!< Parked normal sessions resumed */
+    uint64_t totalWaitUs;   /*!< Time priority requests waited for the block boundary */
+    uint64_t maxWaitUs;     /*!< Longest of these waits */
+} phNxpEseP61_prioStats;
+
 typedef void ese_stack_data_callback_t (ESESTATUS , phNxpEseP61_data *);
 
 /**
@@ -76,7 +92,12 @@ ESESTATUS phNxpEseP61_open(ese_stack_data_callback_t *p_data_cback, phNxpEseP61_
  * \brief This function is called by Jni during the
  *        initialization of the ESE. It opens the physical connection
  *        with ESE (P61) and creates required client thread for
- *        operation.  This will get priority access to ESE for timeout period.
+ *        operation.  This will get priority access to ESE for timeout period. \n
+ *        If a normal session of this process is open, it is preempted at its
+ *        next T=1 block boundary instead: it is parked, the priority session
+ *        runs on the same link until phNxpEseP61_closePrioSession or the
+ *        timeout, then it is resumed. The wait for the boundary is capped by
+ *        NXP_ESE_PRIO_MAX_WAIT_MS, past that ESESTATUS_BUSY is returned.
  *
  * \param[in]       ese_stack_data_callback_t
  *
@@ -85,6 +106,47 @@ ESESTATUS phNxpEseP61_open(ese_stack_data_callback_t *p_data_cback, phNxpEseP61_
 */
 ESESTATUS phNxpEseP61_openPrioSession(ese_stack_data_callback_t *p_data_cback, uint32_t timeOut, phNxpEseP61_initParams initParams);
 
+/**
+ * \ingroup spi_libese
+ * \brief This function sends an APDU of the priority session. \n
+ *        When phNxpEseP61_openPrioSession preempted a normal session of this
+ *        process, phNxpEseP61_Transceive belongs to the parked normal session
+ *        and returns ESESTATUS_BUSY until it is resumed, so the priority
+ *        client uses this function instead. Otherwise it is the same as
+ *        phNxpEseP61_Transceive.
+ *
+ * \param[in]       uint16_t
+ * \param[in]       const uint8_t *
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEseP61_PrioTransceive(uint16_t data_len, const uint8_t *p_data);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function ends the priority session. A normal session parked by
+ *        it is resumed, otherwise it is the same as phNxpEseP61_close.
+ *
+ * \param[in]       void
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEseP61_closePrioSession(void);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function copies out the counters of the priority preemption.
+ *
+ * \param[out]      phNxpEseP61_prioStats *
+ * \param[in]       bool_t TRUE to clear the counters
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEseP61_getPrioStats(phNxpEseP61_prioStats *pStats, bool_t reset);
+
 /**
  * \ingroup spi_libese
  * \brief This function update the len and provided buffer
@@ -149,5 +211,17 @@ ESESTATUS phNxpEseP61_reset(void);
 
 ESESTATUS phNxpEseP61_setIfsc(uint16_t IFSC_Size);
 
+/**
+ * \ingroup spi_libese
+ * \brief This function turns the per frame debug logs off for bulk transfers
+ * such as an OS update, and back on. Errors are always logged.
+ *
+ * \param[in]       bool_t enable: FALSE to suppress them, TRUE to restore them
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEseP61_setFrameLog(bool_t enable);
+
 /** @} */
 #endif /* _PHNXPSPIHAL_API_H_ */
@@ -54,6 +54,7 @@ static void phTmlEse_TmlThread(void *pParam);
 static void phTmlEse_TmlWriterThread(void *pParam);
 static void phTmlEse_ReTxTimerCb(uint32_t dwTimerId, void *pContext);
 static ESESTATUS phTmlEse_InitiateTimer(void);
+static void phTmlEse_PostCompletion(phLibEse_Message_t *ptMsg);
 
 extern phNxpEseP61_Control_t nxpesehal_ctrl;
 /* Function definitions */
@@ -213,6 +214,32 @@ void phTmlEse_ConfigSpiPktReTx(phTmlEse_ConfigRetrans_t eConfiguration, uint8_t
     return;
 }
 
+/*******************************************************************************
+**
+** Function         phTmlEse_ConfigCompletion
+**
+** Description      Selects the thread invoking the read and write completion
+**                  callbacks. Deferred completions take a message queue round
+**                  trip and a switch to the callback thread per frame, inline
+**                  ones run on the reader/writer thread under the same
+**                  reentrance lock, so the callbacks must not block on another
+**                  completion.
+**
+** Parameters       eMode       - values from phTmlEse_CompletionMode_t
+**
+** Returns          None
+**
+*******************************************************************************/
+void phTmlEse_ConfigCompletion(phTmlEse_CompletionMode_t eMode)
+{
+    if (NULL != gpphTmlEse_Context)
+    {
+        gpphTmlEse_Context->eCompletion = eMode;
+    }
+
+    return;
+}
+
 /*******************************************************************************
 **
 ** Function         phTmlEse_StartThread
@@ -412,7 +439,7 @@ static void phTmlEse_TmlThread(void *pParam)
                     tMsg.pMsgData = &tDeferredInfo;
                     tMsg.Size = sizeof(tDeferredInfo);
                     NXPLOG_TML_D("P61 - Posting read message.....\n");
-                    phTmlEse_DeferredCall(gpphTmlEse_Context->dwCallbackThreadId, &tMsg);
+                    phTmlEse_PostCompletion(&tMsg);
 
                 }
             }
@@ -528,8 +555,7 @@ static void phTmlEse_TmlWriterThread(void *pParam)
                                 (bCurrentRetryCount == 0))
                         {
                                 NXPLOG_TML_D("P61 - Posting Write message.....\n");
-                                phTmlEse_DeferredCall(gpphTmlEse_Context->dwCallbackThreadId,
-                                        &tMsg);
+                                phTmlEse_PostCompletion(&tMsg);
                                 gpphTmlEse_Context->bWriteCbInvoked = TRUE;
                         }
                     }
@@ -537,7 +563,7 @@ static void phTmlEse_TmlWriterThread(void *pParam)
                 else
                 {
                     NXPLOG_TML_D("P61 - Posting Fresh Write message.....\n");
-                    phTmlEse_DeferredCall(gpphTmlEse_Context->dwCallbackThreadId, &tMsg);
+                    phTmlEse_PostCompletion(&tMsg);
                 }
             }
             else
@@ -947,6 +973,37 @@ void phTmlEse_DeferredCall(uintptr_t dwThreadId, phLibEse_Message_t *ptWorkerMsg
     sem_post(&gpphTmlEse_Context->postMsgSemaphore);
 }
 
+/*******************************************************************************
+**
+** Function         phTmlEse_PostCompletion
+**
+** Description      Invokes a read or write completion on the current thread
+**                  in inline mode, else posts it to the callback thread
+**
+** Parameters       ptMsg - deferred call message of the completion
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phTmlEse_PostCompletion(phLibEse_Message_t *ptMsg)
+{
+    phLibEse_DeferredCall_t *pDeferCall;
+
+    if (phTmlEse_e_CompleteInline == gpphTmlEse_Context->eCompletion)
+    {
+        pDeferCall = (phLibEse_DeferredCall_t *) ptMsg->pMsgData;
+        REENTRANCE_LOCK();
+        pDeferCall->pCallback(pDeferCall->pParameter);
+        REENTRANCE_UNLOCK();
+    }
+    else
+    {
+        phTmlEse_DeferredCall(gpphTmlEse_Context->dwCallbackThreadId, ptMsg);
+    }
+
+    return;
+}
+
 /*******************************************************************************
 **
 ** Function         phTmlEse_ReadDeferredCb
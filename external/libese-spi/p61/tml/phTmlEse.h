@@ -116,6 +116,17 @@ typedef enum
     phTmlEse_e_DisableRetrans = 0x01 /*Disable retransmission of Spi packet */
 } phTmlEse_ConfigRetrans_t ;  /* Configuration for Retransmission */
 
+/*
+ * Thread invoking the read and write completion callbacks
+ *
+ * phTmlEse_ConfigCompletion
+ */
+typedef enum
+{
+    phTmlEse_e_CompleteDeferred = 0x00, /* Posted to the callback thread (default) */
+    phTmlEse_e_CompleteInline = 0x01 /* Invoked on the reader/writer thread, callbacks must not block */
+} phTmlEse_CompletionMode_t ;  /* Configuration for completion dispatch */
+
 /*
  * Structure containing details related to read and write operations
  *
@@ -143,6 +154,7 @@ typedef struct phTmlEse_Context
     phTmlEse_ConfigRetrans_t eConfig; /*Retransmission of Spi Packet during timeout */
     uint8_t bRetryCount; /*Number of times retransmission shall happen */
     uint8_t bWriteCbInvoked; /* Indicates whether write callback is invoked during retransmission */
+    phTmlEse_CompletionMode_t eCompletion; /* Thread invoking the completion callbacks */
     uint32_t dwTimerId; /* Timer used to retransmit spi packet */
     phTmlEse_ReadWriteInfo_t tReadInfo; /*Pointer to Reader Thread Structure */
     phTmlEse_ReadWriteInfo_t tWriteInfo; /*Pointer to Writer Thread Structure */
@@ -203,5 +215,6 @@ ESESTATUS phTmlEse_ReadAbort(void);
 ESESTATUS phTmlEse_IoCtl(phTmlEse_ControlCode_t eControlCode, long level);
 void phTmlEse_DeferredCall(uintptr_t dwThreadId, phLibEse_Message_t *ptWorkerMsg);
 void phTmlEse_ConfigSpiPktReTx( phTmlEse_ConfigRetrans_t eConfig, uint8_t bRetryCount);
+void phTmlEse_ConfigCompletion(phTmlEse_CompletionMode_t eMode);
 
 #endif /*  PHTMLESE_H  */
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host micro benchmarks of the DAL message queue carrying the TML and
+ * HAL messages. Run with --benchmark_format=json for regression gating.
+ */
+#include <string.h>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <phDal4Ese_messageQueueLib.h>
+}
+
+#define BENCH_MSG_DATA  0x01
+#define BENCH_MSG_STOP  0x02
+
+/* One message in, one out, behind 'depth' messages already queued */
+static void BM_QueueSendRecv(benchmark::State& state)
+{
+    intptr_t msqid = phDal4Ese_msgget(0, 0600);
+    phLibEse_Message_t msg;
+    int64_t depth = state.range(0);
+    int64_t i;
+
+    memset(&msg, 0x00, sizeof(msg));
+    msg.eMsgType = BENCH_MSG_DATA;
+    for (i = 0; i < depth; i++)
+        phDal4Ese_msgsnd(msqid, &msg, 0);
+    for (auto _ : state)
+    {
+        phDal4Ese_msgsnd(msqid, &msg, 0);
+        phDal4Ese_msgrcv(msqid, &msg, 0, 0);
+    }
+    for (i = 0; i < depth; i++)
+        phDal4Ese_msgrcv(msqid, &msg, 0, 0);
+    phDal4Ese_msgrelease(msqid);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueueSendRecv)->ArgName("depth")->Arg(0)->Arg(4)->Arg(32)->Arg(256);
+
+/* Round trip through a second thread, as between the client and the TML reader */
+static void BM_QueuePingPong(benchmark::State& state)
+{
+    intptr_t request = phDal4Ese_msgget(0, 0600);
+    intptr_t response = phDal4Ese_msgget(0, 0600);
+    phLibEse_Message_t msg;
+
+    std::thread echo([request, response]() {
+        phLibEse_Message_t rx;
+        do
+        {
+            phDal4Ese_msgrcv(request, &rx, 0, 0);
+            phDal4Ese_msgsnd(response, &rx, 0);
+        } while (rx.eMsgType != BENCH_MSG_STOP);
+    });
+
+    memset(&msg, 0x00, sizeof(msg));
+    msg.eMsgType = BENCH_MSG_DATA;
+    for (auto _ : state)
+    {
+        phDal4Ese_msgsnd(request, &msg, 0);
+        phDal4Ese_msgrcv(response, &msg, 0, 0);
+    }
+    msg.eMsgType = BENCH_MSG_STOP;
+    phDal4Ese_msgsnd(request, &msg, 0);
+    phDal4Ese_msgrcv(response, &msg, 0, 0);
+    echo.join();
+    phDal4Ese_msgrelease(request);
+    phDal4Ese_msgrelease(response);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_QueuePingPong)->UseRealTime();
+
+BENCHMARK_MAIN();
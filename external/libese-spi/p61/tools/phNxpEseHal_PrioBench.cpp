@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmark of the preemption of a normal session by a priority
+ * session, over the simulated eSE of phNxpEseHal_SimCard.c. A client thread
+ * keeps a normal session busy with APDUs of 'len' bytes, chained past the
+ * IFSC. Each iteration opens a priority session, which parks the normal one
+ * at its next block boundary, runs one APDU on it with
+ * phNxpEseP61_PrioTransceive, closes it with phNxpEseP61_closePrioSession
+ * and waits for the normal session to complete an APDU again.
+ * Run with --benchmark_format=json for regression gating.
+ */
+#include <atomic>
+#include <semaphore.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <phNxpEseHal_Api.h>
+}
+
+#define BENCH_NORMAL_CLA    0x10    /* first byte of the normal APDUs, echoed by the card */
+#define BENCH_PRIO_CLA      0x80    /* first byte of the priority APDUs */
+#define BENCH_RESUME_US     1000000 /* longest wait for the normal session to run again */
+#define BENCH_MAX_APDU_LEN  1024
+
+static sem_t gNormalDone;
+static sem_t gPrioDone;
+static std::atomic<uint32_t> gNormalApdus(0);
+static std::atomic<uint32_t> gMisrouted(0);
+static std::atomic<uint16_t> gNormalLen(4);
+
+static void BenchNormalCallback(ESESTATUS status, phNxpEseP61_data *pData)
+{
+    if (ESESTATUS_WTX_REQ == status)
+        return;
+    if ((ESESTATUS_SUCCESS == status) && (pData != NULL) && (pData->len > 0) &&
+            (pData->p_data[0] != BENCH_NORMAL_CLA))
+        gMisrouted++;
+    sem_post(&gNormalDone);
+}
+
+static void BenchPrioCallback(ESESTATUS status, phNxpEseP61_data *pData)
+{
+    if (ESESTATUS_WTX_REQ == status)
+        return;
+    if ((ESESTATUS_SUCCESS == status) && (pData != NULL) && (pData->len > 0) &&
+            (pData->p_data[0] != BENCH_PRIO_CLA))
+        gMisrouted++;
+    sem_post(&gPrioDone);
+}
+
+/* The client of the normal session: waits while it is parked, as a real one would */
+static void BenchNormalThread()
+{
+    uint8_t cmd[BENCH_MAX_APDU_LEN];
+    ESESTATUS status;
+
+    memset(cmd, BENCH_NORMAL_CLA, sizeof(cmd));
+    for (;;)
+    {
+        status = phNxpEseP61_Transceive(gNormalLen.load(), cmd);
+        if (ESESTATUS_SUCCESS != status)
+        {
+            usleep(1000);
+            continue;
+        }
+        sem_wait(&gNormalDone);
+        gNormalApdus++;
+    }
+}
+
+/* The normal session and its client live for the whole run */
+static bool BenchSetup()
+{
+    static bool ready = false;
+    phNxpEseP61_initParams initParams;
+
+    if (ready)
+        return true;
+    sem_init(&gNormalDone, 0, 0);
+    sem_init(&gPrioDone, 0, 0);
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    if (phNxpEseP61_open(BenchNormalCallback, initParams) != ESESTATUS_SUCCESS)
+        return false;
+    std::thread(BenchNormalThread).detach();
+    ready = true;
+    return true;
+}
+
+/* Waits for the normal session to complete an APDU after 'apdus' */
+static bool BenchNormalResumed(uint32_t apdus)
+{
+    uint32_t waitedUs;
+
+    for (waitedUs = 0; waitedUs < BENCH_RESUME_US; waitedUs += 100)
+    {
+        if (gNormalApdus.load() != apdus)
+            return true;
+        usleep(100);
+    }
+    return false;
+}
+
+static void BM_PrioPreemptResume(benchmark::State& state)
+{
+    phNxpEseP61_initParams initParams;
+    phNxpEseP61_prioStats stats;
+    uint8_t cmd[4] = { BENCH_PRIO_CLA, 0xCA, 0x00, 0xFE };
+
+    gNormalLen = (uint16_t) state.range(0);
+    if (!BenchSetup())
+    {
+        state.SkipWithError("normal session open failed");
+        return;
+    }
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    phNxpEseP61_getPrioStats(&stats, TRUE);
+    gMisrouted = 0;
+    for (auto _ : state)
+    {
+        if (phNxpEseP61_openPrioSession(BenchPrioCallback, 0, initParams) != ESESTATUS_SUCCESS)
+        {
+            state.SkipWithError("priority session open failed");
+            break;
+        }
+        if (phNxpEseP61_PrioTransceive(sizeof(cmd), cmd) == ESESTATUS_SUCCESS)
+            sem_wait(&gPrioDone);
+        else
+            gMisrouted++;
+        uint32_t apdus = gNormalApdus.load();
+        phNxpEseP61_closePrioSession();
+        if (!BenchNormalResumed(apdus))
+        {
+            state.SkipWithError("normal session not resumed");
+            break;
+        }
+    }
+    phNxpEseP61_getPrioStats(&stats, FALSE);
+    state.counters["preemptions"] = stats.preemptions;
+    state.counters["resumes"] = stats.resumes;
+    state.counters["waitTimeouts"] = stats.waitTimeouts;
+    state.counters["meanWaitUs"] = stats.preemptions ?
+            (double) stats.totalWaitUs / stats.preemptions : 0;
+    state.counters["maxWaitUs"] = stats.maxWaitUs;
+    state.counters["misrouted"] = gMisrouted.load();
+}
+BENCHMARK(BM_PrioPreemptResume)->ArgName("len")->Arg(4)->Arg(600)->UseRealTime();
+
+BENCHMARK_MAIN();
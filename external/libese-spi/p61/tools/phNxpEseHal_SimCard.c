@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulated eSE behind the SPI port for the host benchmarks of the HAL:
+ * every I-block of a chain is acknowledged with an R-block, the last one
+ * is answered with the first byte of the APDU followed by 9000 after
+ * SIM_CARD_APDU_US, so that a session can tell its responses apart from
+ * the ones of another session. The SPM is always granted.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <phTmlEse_spi.h>
+#include "phNxpEseP61_Spm.h"
+
+#define SIM_CARD_APDU_US    1000    /* processing time of an APDU */
+#define SIM_CARD_ACK_US     50      /* time to acknowledge a chained block */
+
+static pthread_mutex_t gSimLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gSimCond = PTHREAD_COND_INITIALIZER;
+static uint8_t gSimFrame[8];
+static int gSimLen = 0;
+static int gSimOpen = 0;
+static uint8_t gSimNs = 0;
+static uint64_t gSimReadyUs = 0;
+
+static uint64_t phNxpEseHal_simNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static uint8_t phNxpEseHal_simLrc(const uint8_t *pBuf, int len)
+{
+    uint8_t lrc = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+    {
+        lrc ^= pBuf[i];
+    }
+    return lrc;
+}
+
+ESESTATUS phTmlEse_spi_open_and_configure(pphTmlEse_Config_t pConfig, void ** pLinkHandle)
+{
+    UNUSED(pConfig);
+    pthread_mutex_lock(&gSimLock);
+    gSimLen = 0;
+    gSimNs = 0;
+    gSimOpen = 1;
+    pthread_mutex_unlock(&gSimLock);
+    *pLinkHandle = (void *) &gSimFrame;
+    return ESESTATUS_SUCCESS;
+}
+
+void phTmlEse_spi_close(void *pDevHandle)
+{
+    UNUSED(pDevHandle);
+    pthread_mutex_lock(&gSimLock);
+    gSimOpen = 0;
+    pthread_cond_broadcast(&gSimCond);
+    pthread_mutex_unlock(&gSimLock);
+}
+
+int phTmlEse_spi_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead)
+{
+    int64_t waitUs;
+    int len;
+
+    UNUSED(pDevHandle);
+    pthread_mutex_lock(&gSimLock);
+    while ((0 == gSimLen) && gSimOpen)
+    {
+        pthread_cond_wait(&gSimCond, &gSimLock);
+    }
+    if (0 == gSimLen)
+    {
+        pthread_mutex_unlock(&gSimLock);
+        return -1;
+    }
+    waitUs = (int64_t)(gSimReadyUs - phNxpEseHal_simNowUs());
+    len = (gSimLen < nNbBytesToRead) ? gSimLen : nNbBytesToRead;
+    memcpy(pBuffer, gSimFrame, len);
+    gSimLen = 0;
+    pthread_mutex_unlock(&gSimLock);
+    if (waitUs > 0)
+    {
+        usleep(waitUs);
+    }
+    return len;
+}
+
+int phTmlEse_spi_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite)
+{
+    uint8_t pcb;
+
+    UNUSED(pDevHandle);
+    if ((nNbBytesToWrite < 4) || (nNbBytesToWrite > MAX_DATA_LEN))
+    {
+        return -1;
+    }
+    pcb = pBuffer[1];
+    /* R-blocks and S-blocks of the host are not answered */
+    if (pcb & 0x80)
+    {
+        return nNbBytesToWrite;
+    }
+    pthread_mutex_lock(&gSimLock);
+    gSimFrame[0] = 0x00;
+    if (pcb & 0x20)
+    {
+        /* chained I-block: ask for the next one */
+        gSimFrame[1] = 0x80 | ((((pcb >> 6) & 1) ^ 1) << 4);
+        gSimFrame[2] = 0x00;
+        gSimFrame[3] = phNxpEseHal_simLrc(gSimFrame, 3);
+        gSimLen = 4;
+        gSimReadyUs = phNxpEseHal_simNowUs() + SIM_CARD_ACK_US;
+    }
+    else
+    {
+        gSimFrame[1] = gSimNs << 6;
+        gSimFrame[2] = 0x03;
+        gSimFrame[3] = pBuffer[3];
+        gSimFrame[4] = 0x90;
+        gSimFrame[5] = 0x00;
+        gSimFrame[6] = phNxpEseHal_simLrc(gSimFrame, 6);
+        gSimLen = 7;
+        gSimNs ^= 1;
+        gSimReadyUs = phNxpEseHal_simNowUs() + SIM_CARD_APDU_US;
+    }
+    pthread_cond_broadcast(&gSimCond);
+    pthread_mutex_unlock(&gSimLock);
+    return nNbBytesToWrite;
+}
+
+int phTmlEse_spi_ioctl(phTmlEse_ControlCode_t eControlCode, void *pDevHandle, long level)
+{
+    UNUSED(eControlCode);
+    UNUSED(pDevHandle);
+    UNUSED(level);
+    return 0;
+}
+
+SPMSTATUS phNxpEseP61_SPM_Init(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_DeInit(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_ConfigPwr(spm_power_t arg)
+{
+    UNUSED(arg);
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_EnablePwr(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_DisablePwr(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_GetState(spm_state_t *current_state)
+{
+    *current_state = SPM_STATE_IDLE;
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_ResetPwr(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_SetState(spm_state_t arg)
+{
+    UNUSED(arg);
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_GetAccess(long timeout)
+{
+    UNUSED(timeout);
+    return SPMSTATUS_SUCCESS;
+}
+
+SPMSTATUS phNxpEseP61_SPM_RelAccess(void)
+{
+    return SPMSTATUS_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmarks of the shared T=1 core as the P61 build compiles it, with
+ * the steps phNxpEseProtocol.c runs per frame: building a block and handing
+ * it to the transport, here a frame sink in place of the TML write, and
+ * checking the LRC, decoding the PCB and storing the INF of a received one.
+ * Each reports insnPerFrame, the instructions retired per frame, to compare
+ * with the frame benchmarks of ese_micro_bench on P73. The HAL itself is
+ * left out: its frames are written and read on the TML threads, which the
+ * counter of the benchmark thread does not see.
+ * Run with --benchmark_format=json for regression gating.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <phNxpEseT1.h>
+}
+#include <phNxpEseBench_InsnCounter.h>
+
+#define BENCH_NAD_CARD      0x00
+
+static uint32_t gSinkLen = 0;
+
+/* Transport of the blocks: only keeps the length, as the TML write would */
+extern "C" ESESTATUS phNxpEseT1_WriteFrame(uint32_t data_len, const uint8_t *p_data)
+{
+    benchmark::DoNotOptimize(p_data);
+    gSinkLen = data_len;
+    return ESESTATUS_SUCCESS;
+}
+
+/* Card frame: [NAD PCB LEN INF LRC] */
+static uint32_t bench_buildCardFrame(uint8_t *pFrame, uint8_t pcb, uint32_t infLen)
+{
+    uint32_t i;
+
+    pFrame[PH_T1_NAD_OFFSET] = BENCH_NAD_CARD;
+    pFrame[PH_T1_PCB_OFFSET] = pcb;
+    pFrame[PH_T1_LEN_OFFSET] = (uint8_t)infLen;
+    for (i = 0; i < infLen; i++)
+        pFrame[PH_T1_HEADER_LEN + i] = (uint8_t)i;
+    pFrame[PH_T1_HEADER_LEN + infLen] = phNxpEseT1_computeLrc(pFrame, 0, PH_T1_HEADER_LEN + infLen);
+    return infLen + PH_T1_HEADER_LEN + PH_T1_LRC_LEN;
+}
+
+/* I-block of a command APDU, N(S) alternating as the HAL sends them */
+static void BM_P61BuildIframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t inf[PH_T1_MAX_INF_LEN];
+    uint8_t ns = 0;
+
+    memset(inf, 0x5A, sizeof(inf));
+    insn.resume();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(phNxpEseT1_sendBlock(PH_T1_PCB_I(ns, state.range(1)), inf,
+                state.range(0)));
+        ns ^= 1;
+    }
+    insn.report(state, state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_P61BuildIframe)->ArgNames({"inf", "chained"})
+    ->Args({1, 0})->Args({16, 0})->Args({64, 0})->Args({PH_T1_MAX_INF_LEN, 0})
+    ->Args({PH_T1_MAX_INF_LEN, 1});
+
+static void BM_P61BuildRframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t error = state.range(0) ? PH_T1_R_OTHER_ERROR : PH_T1_R_ACK;
+
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseT1_sendBlock(PH_T1_PCB_R(1, error), NULL, 0));
+    insn.report(state, state.iterations());
+}
+BENCHMARK(BM_P61BuildRframe)->ArgName("nack")->Arg(0)->Arg(1);
+
+/* LRC check, PCB decode and, for an I-block, the INF appended to the response */
+static void BM_P61DecodeFrame(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t frame[PH_T1_MAX_BLOCK_LEN];
+    uint32_t infLen = state.range(1);
+    uint32_t len = bench_buildCardFrame(frame, (uint8_t)state.range(0), infLen);
+    phNxpEseT1_Pcb_t pcb;
+    uint32_t rspLen = 0;
+    uint8_t *pRsp = NULL;
+
+    insn.resume();
+    for (auto _ : state)
+    {
+        if (phNxpEseT1_computeLrc(frame, 0, len - 1) != frame[len - 1])
+        {
+            state.SkipWithError("LRC mismatch");
+            break;
+        }
+        phNxpEseT1_decodePcb(frame[PH_T1_PCB_OFFSET], &pcb);
+        if (PH_T1_I_BLOCK == pcb.type)
+        {
+            phNxpEseT1_storeRxData(infLen, &frame[PH_T1_HEADER_LEN]);
+            insn.pause();
+            state.PauseTiming();
+            if (phNxpEseT1_getRxData(&rspLen, &pRsp) == ESESTATUS_SUCCESS)
+                free(pRsp);
+            state.ResumeTiming();
+            insn.resume();
+        }
+        benchmark::DoNotOptimize(pcb);
+    }
+    insn.report(state, state.iterations());
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_P61DecodeFrame)->ArgNames({"pcb", "inf"})
+    ->Args({0x00, 2})->Args({0x40, 64})->Args({0x20, PH_T1_MAX_INF_LEN})
+    ->Args({0x90, 0})->Args({0xE3, 1});
+
+/* Reassembly of a response chained over N I-blocks */
+static void BM_P61RxReassemble(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t inf[PH_T1_MAX_INF_LEN];
+    int64_t frames = state.range(0);
+    uint32_t rspLen = 0;
+    uint8_t *pRsp = NULL;
+    int64_t i;
+
+    memset(inf, 0xA5, sizeof(inf));
+    insn.resume();
+    for (auto _ : state)
+    {
+        for (i = 0; i < frames; i++)
+            phNxpEseT1_storeRxData(sizeof(inf), inf);
+        if (phNxpEseT1_getRxData(&rspLen, &pRsp) == ESESTATUS_SUCCESS)
+            free(pRsp);
+    }
+    insn.report(state, state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * frames * sizeof(inf));
+}
+BENCHMARK(BM_P61RxReassemble)->ArgName("frames")->RangeMultiplier(2)->Range(1, 128);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmarks of the registration of the pending semaphores, with many
+ * waiters registering and releasing one concurrently behind a backlog of
+ * waiters already pending: the monitor list embedded in the semaphores
+ * against the generic list it replaced.
+ * Run with --benchmark_format=json for regression gating.
+ */
+#include <mutex>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <phNxpSpiHal_utils.h>
+}
+
+#define BENCH_BACKLOG   64
+
+static phNxpSpiHal_Sem_t gBacklog[BENCH_BACKLOG];
+static struct listHead gGenericList;
+static std::once_flag gSetupOnce;
+
+/* Waiters left pending for the whole run, registered in both lists */
+static void BenchSetup()
+{
+    int i;
+
+    phNxpEseHal_init_monitor();
+    listInit(&gGenericList);
+    for (i = 0; i < BENCH_BACKLOG; i++)
+    {
+        phNxpSpiHal_init_cb_data(&gBacklog[i], NULL);
+        listAdd(&gGenericList, &gBacklog[i]);
+    }
+}
+
+/* Register then release one waiter, as phNxpEseP61_WriteFrame does per frame */
+static void BM_SemListMonitor(benchmark::State& state)
+{
+    phNxpSpiHal_Sem_t cb_data;
+
+    std::call_once(gSetupOnce, BenchSetup);
+    for (auto _ : state)
+    {
+        phNxpSpiHal_init_cb_data(&cb_data, NULL);
+        phNxpSpiHal_cleanup_cb_data(&cb_data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SemListMonitor)->ThreadRange(1, 16)->UseRealTime();
+
+/* Same with the generic list: a node allocated per add, a walk per add and remove */
+static void BM_SemListGeneric(benchmark::State& state)
+{
+    phNxpSpiHal_Sem_t cb_data;
+
+    std::call_once(gSetupOnce, BenchSetup);
+    for (auto _ : state)
+    {
+        sem_init(&cb_data.sem, 0, 0);
+        listAdd(&gGenericList, &cb_data);
+        sem_destroy(&cb_data.sem);
+        listRemove(&gGenericList, &cb_data);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SemListGeneric)->ThreadRange(1, 16)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmarks of the TML frame completion latency over the simulated
+ * SPI port of phTmlEse_SimSpi.c: one frame written and echoed back, timed
+ * from the write request to the read callback, with the completions posted
+ * to a client thread (deferred) or run on the TML threads (inline).
+ * Run with --benchmark_format=json for regression gating.
+ */
+#include <semaphore.h>
+#include <string.h>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include <phNxpSpiHal_utils.h>
+#include <phDal4Ese_messageQueueLib.h>
+#include <phTmlEse.h>
+}
+
+static sem_t gFrameDone;
+
+static void BenchWriteComplete(void *pContext, phTmlEse_TransactInfo_t *pInfo)
+{
+    UNUSED(pContext);
+    UNUSED(pInfo);
+    sem_post(&gFrameDone);
+}
+
+static void BenchReadComplete(void *pContext, phTmlEse_TransactInfo_t *pInfo)
+{
+    UNUSED(pContext);
+    UNUSED(pInfo);
+    sem_post(&gFrameDone);
+}
+
+/* The HAL client thread: runs the deferred completions under the reentrance lock */
+static void BenchClientThread(intptr_t msqid)
+{
+    phLibEse_Message_t msg;
+
+    for (;;)
+    {
+        if (phDal4Ese_msgrcv(msqid, &msg, 0, 0) == -1)
+            continue;
+        if (msg.eMsgType == PH_LIBESE_DEFERREDCALL_MSG)
+        {
+            phLibEse_DeferredCall_t *deferCall = (phLibEse_DeferredCall_t *) (msg.pMsgData);
+
+            REENTRANCE_LOCK();
+            deferCall->pCallback(deferCall->pParameter);
+            REENTRANCE_UNLOCK();
+        }
+    }
+}
+
+/* TML and client thread live for the whole run, as the TML threads are not joined on shutdown */
+static bool BenchSetup()
+{
+    static bool ready = false;
+    phTmlEse_Config_t tTmlConfig;
+    intptr_t msqid;
+
+    if (ready)
+        return true;
+    if (phNxpEseHal_init_monitor() == NULL)
+        return false;
+    msqid = phDal4Ese_msgget(0, 0600);
+    sem_init(&gFrameDone, 0, 0);
+    memset(&tTmlConfig, 0x00, sizeof(tTmlConfig));
+    tTmlConfig.pDevName = (int8_t *) "sim";
+    tTmlConfig.dwGetMsgThreadId = (uintptr_t) msqid;
+    if (phTmlEse_Init(&tTmlConfig) != ESESTATUS_SUCCESS)
+        return false;
+    std::thread(BenchClientThread, msqid).detach();
+    ready = true;
+    return true;
+}
+
+/* Write of 'len' bytes and its echo read back, as one T=1 frame exchange */
+static void BM_FrameCompletion(benchmark::State& state, phTmlEse_CompletionMode_t eMode)
+{
+    uint8_t txBuf[MAX_DATA_LEN];
+    uint8_t rxBuf[MAX_DATA_LEN];
+    uint16_t len = (uint16_t) state.range(0);
+
+    if (!BenchSetup())
+    {
+        state.SkipWithError("TML init failed");
+        return;
+    }
+    phTmlEse_ConfigCompletion(eMode);
+    memset(txBuf, 0x5A, sizeof(txBuf));
+    for (auto _ : state)
+    {
+        phTmlEse_Read(rxBuf, sizeof(rxBuf), &BenchReadComplete, NULL);
+        phTmlEse_Write(txBuf, len, &BenchWriteComplete, NULL);
+        sem_wait(&gFrameDone);
+        sem_wait(&gFrameDone);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK_CAPTURE(BM_FrameCompletion, deferred, phTmlEse_e_CompleteDeferred)
+        ->ArgName("len")->Arg(4)->Arg(258)->UseRealTime();
+BENCHMARK_CAPTURE(BM_FrameCompletion, inline, phTmlEse_e_CompleteInline)
+        ->ArgName("len")->Arg(4)->Arg(258)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulated SPI port for the host benchmarks of the TML: every frame
+ * written is echoed back on the next read, with no device latency, so the
+ * cost measured is the one of the TML threads and of the completion path.
+ */
+#include <pthread.h>
+#include <string.h>
+#include <phTmlEse_spi.h>
+#include <phNxpEseHal.h>
+#include "phNxpEseP61_Spm.h"
+
+/* HAL and SPM symbols the TML and the OSAL timers refer to */
+phNxpEseP61_Control_t nxpesehal_ctrl;
+
+static pthread_mutex_t gSimLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gSimCond = PTHREAD_COND_INITIALIZER;
+static uint8_t gSimFrame[MAX_DATA_LEN];
+static int gSimLen = 0;
+static int gSimOpen = 0;
+
+ESESTATUS phTmlEse_spi_open_and_configure(pphTmlEse_Config_t pConfig, void ** pLinkHandle)
+{
+    UNUSED(pConfig);
+    pthread_mutex_lock(&gSimLock);
+    gSimLen = 0;
+    gSimOpen = 1;
+    pthread_mutex_unlock(&gSimLock);
+    *pLinkHandle = (void *) &gSimFrame;
+    return ESESTATUS_SUCCESS;
+}
+
+void phTmlEse_spi_close(void *pDevHandle)
+{
+    UNUSED(pDevHandle);
+    pthread_mutex_lock(&gSimLock);
+    gSimOpen = 0;
+    pthread_cond_broadcast(&gSimCond);
+    pthread_mutex_unlock(&gSimLock);
+}
+
+int phTmlEse_spi_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead)
+{
+    int len;
+
+    UNUSED(pDevHandle);
+    pthread_mutex_lock(&gSimLock);
+    while ((0 == gSimLen) && gSimOpen)
+    {
+        pthread_cond_wait(&gSimCond, &gSimLock);
+    }
+    if (0 == gSimLen)
+    {
+        pthread_mutex_unlock(&gSimLock);
+        return -1;
+    }
+    len = (gSimLen < nNbBytesToRead) ? gSimLen : nNbBytesToRead;
+    memcpy(pBuffer, gSimFrame, len);
+    gSimLen = 0;
+    pthread_mutex_unlock(&gSimLock);
+    return len;
+}
+
+int phTmlEse_spi_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite)
+{
+    UNUSED(pDevHandle);
+    if (nNbBytesToWrite > MAX_DATA_LEN)
+    {
+        return -1;
+    }
+    pthread_mutex_lock(&gSimLock);
+    memcpy(gSimFrame, pBuffer, nNbBytesToWrite);
+    gSimLen = nNbBytesToWrite;
+    pthread_cond_broadcast(&gSimCond);
+    pthread_mutex_unlock(&gSimLock);
+    return nNbBytesToWrite;
+}
+
+int phTmlEse_spi_ioctl(phTmlEse_ControlCode_t eControlCode, void *pDevHandle, long level)
+{
+    UNUSED(eControlCode);
+    UNUSED(pDevHandle);
+    UNUSED(level);
+    return 0;
+}
+
+SPMSTATUS phNxpEseP61_SPM_ConfigPwr(spm_power_t arg)
+{
+    UNUSED(arg);
+    return SPMSTATUS_SUCCESS;
+}
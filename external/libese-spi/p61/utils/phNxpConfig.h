@@ -62,4 +62,5 @@ void resetNxpConfig(void);
 #define NAME_NXP_JCOPDL_AT_BOOT_ENABLE "NXP_JCOPDL_AT_BOOT_ENABLE"
 #define NAME_NXP_WTX_COUNT_VALUE     "NXP_WTX_COUNT_VALUE"
 #define NAME_NXP_MAX_RSP_TIMEOUT     "NXP_MAX_RSP_TIMEOUT"
+#define NAME_NXP_ESE_PRIO_MAX_WAIT_MS "NXP_ESE_PRIO_MAX_WAIT_MS"
 #endif
@@ -36,6 +36,7 @@
 
 #include <phNxpSpiHal_utils.h>
 #include <errno.h>
+#include <stddef.h>
 #include <phNxpLog.h>
 
 /*********************** Link list functions **********************************/
@@ -325,13 +326,15 @@ phNxpEseHal_init_monitor(void)
             goto clean_and_return;
         }
 
-        if (listInit(&nxpspihal_monitor->sem_list) != 1)
+        if (pthread_mutex_init(&nxpspihal_monitor->sem_mutex, NULL) == -1)
         {
             NXPLOG_SPIHAL_E("Semaphore List creation failed");
             pthread_mutex_destroy(&nxpspihal_monitor->concurrency_mutex);
             pthread_mutex_destroy(&nxpspihal_monitor->reentrance_mutex);
             goto clean_and_return;
         }
+        nxpspihal_monitor->sem_list.pPrev = &nxpspihal_monitor->sem_list;
+        nxpspihal_monitor->sem_list.pNext = &nxpspihal_monitor->sem_list;
     }
     else
     {
@@ -371,7 +374,7 @@ void phNxpSpiHal_cleanup_monitor(void)
         pthread_mutex_destroy(&nxpspihal_monitor->concurrency_mutex);
         pthread_mutex_destroy(&nxpspihal_monitor->reentrance_mutex);
         phNxpSpiHal_releaseall_cb_data();
-        listDestroy(&nxpspihal_monitor->sem_list);
+        pthread_mutex_destroy(&nxpspihal_monitor->sem_mutex);
     }
 
     free(nxpspihal_monitor);
@@ -399,6 +402,13 @@ phNxpSpiHal_get_monitor(void)
 ESESTATUS phNxpSpiHal_init_cb_data(phNxpSpiHal_Sem_t *pCallbackData,
         void *pContext)
 {
+    phNxpSpiHal_Monitor_t *pMonitor = phNxpSpiHal_get_monitor();
+    struct phNxpSpiHal_SemLink *pHead = &pMonitor->sem_list;
+
+    /* Not listed until the semaphore is created */
+    pCallbackData->link.pPrev = NULL;
+    pCallbackData->link.pNext = NULL;
+
     /* Create semaphore */
     if (sem_init(&pCallbackData->sem, 0, 0) == -1)
     {
@@ -413,10 +423,12 @@ ESESTATUS phNxpSpiHal_init_cb_data(phNxpSpiHal_Sem_t *pCallbackData,
     pCallbackData->pContext = pContext;
 
     /* Add to active semaphore list */
-    if (listAdd(&phNxpSpiHal_get_monitor()->sem_list, pCallbackData) != 1)
-    {
-        NXPLOG_SPIHAL_E("Failed to add the semaphore to the list");
-    }
+    pthread_mutex_lock(&pMonitor->sem_mutex);
+    pCallbackData->link.pPrev = pHead->pPrev;
+    pCallbackData->link.pNext = pHead;
+    pHead->pPrev->pNext = &pCallbackData->link;
+    pHead->pPrev = &pCallbackData->link;
+    pthread_mutex_unlock(&pMonitor->sem_mutex);
 
     return ESESTATUS_SUCCESS;
 }
@@ -432,6 +444,9 @@ ESESTATUS phNxpSpiHal_init_cb_data(phNxpSpiHal_Sem_t *pCallbackData,
 *******************************************************************************/
 void phNxpSpiHal_cleanup_cb_data(phNxpSpiHal_Sem_t* pCallbackData)
 {
+    phNxpSpiHal_Monitor_t *pMonitor = phNxpSpiHal_get_monitor();
+    bool_t bListed = FALSE;
+
     /* Destroy semaphore */
     if (sem_destroy(&pCallbackData->sem))
     {
@@ -439,7 +454,17 @@ void phNxpSpiHal_cleanup_cb_data(phNxpSpiHal_Sem_t* pCallbackData)
     }
 
     /* Remove from active semaphore list */
-    if (listRemove(&phNxpSpiHal_get_monitor()->sem_list, pCallbackData) != 1)
+    pthread_mutex_lock(&pMonitor->sem_mutex);
+    if (pCallbackData->link.pNext != NULL)
+    {
+        pCallbackData->link.pPrev->pNext = pCallbackData->link.pNext;
+        pCallbackData->link.pNext->pPrev = pCallbackData->link.pPrev;
+        pCallbackData->link.pPrev = NULL;
+        pCallbackData->link.pNext = NULL;
+        bListed = TRUE;
+    }
+    pthread_mutex_unlock(&pMonitor->sem_mutex);
+    if (!bListed)
     {
         NXPLOG_SPIHAL_E("phNxpSpiHal_cleanup_cb_data: Failed to remove semaphore from the list");
     }
@@ -458,14 +483,25 @@ void phNxpSpiHal_cleanup_cb_data(phNxpSpiHal_Sem_t* pCallbackData)
 *******************************************************************************/
 void phNxpSpiHal_releaseall_cb_data(void)
 {
+    phNxpSpiHal_Monitor_t *pMonitor = phNxpSpiHal_get_monitor();
+    struct phNxpSpiHal_SemLink *pHead = &pMonitor->sem_list;
+    struct phNxpSpiHal_SemLink *pLink;
     phNxpSpiHal_Sem_t* pCallbackData;
 
-    while (listGetAndRemoveNext(&phNxpSpiHal_get_monitor()->sem_list,
-            (void**) &pCallbackData))
+    pthread_mutex_lock(&pMonitor->sem_mutex);
+    while (pHead->pNext != pHead)
     {
+        pLink = pHead->pNext;
+        pHead->pNext = pLink->pNext;
+        pLink->pNext->pPrev = pHead;
+        pLink->pPrev = NULL;
+        pLink->pNext = NULL;
+        pCallbackData = (phNxpSpiHal_Sem_t*) ((uint8_t*) pLink -
+                offsetof(phNxpSpiHal_Sem_t, link));
         pCallbackData->status = ESESTATUS_FAILED;
         sem_post(&pCallbackData->sem);
     }
+    pthread_mutex_unlock(&pMonitor->sem_mutex);
 
     return;
 }
@@ -489,6 +525,12 @@ void phNxpSpiHal_print_packet(const char *pString, const uint8_t *p_data,
     uint32_t i;
     char print_buffer[len * 3 + 1];
 
+    /* not formatted when it is not logged, as while a bulk transfer runs */
+    if ((gLog_level.spix_log_level < NXPLOG_LOG_DEBUG_LOGLEVEL) &&
+            (gLog_level.spir_log_level < NXPLOG_LOG_DEBUG_LOGLEVEL))
+    {
+        return;
+    }
     memset (print_buffer, 0, sizeof(print_buffer));
     for (i = 0; i < len; i++) {
         snprintf(&print_buffer[i * 2], 3, "%02X", p_data[i]);
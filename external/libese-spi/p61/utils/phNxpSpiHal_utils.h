@@ -57,6 +57,14 @@ struct listHead
     pthread_mutex_t mutex;
 };
 
+/* Link of a pending semaphore, embedded in it so that tracking it does not
+ * allocate nor search */
+struct phNxpSpiHal_SemLink
+{
+    struct phNxpSpiHal_SemLink* pPrev;
+    struct phNxpSpiHal_SemLink* pNext;
+};
+
 
 /* Semaphore handling structure */
 typedef struct phNxpSpiHal_Sem
@@ -70,6 +78,9 @@ typedef struct phNxpSpiHal_Sem
     /* Used to provide a local context to the callback */
     void* pContext;
 
+    /* Link in the list of pending semaphores, pNext is NULL when not listed */
+    struct phNxpSpiHal_SemLink link;
+
 } phNxpSpiHal_Sem_t;
 
 /* Semaphore helper macros */
@@ -85,8 +96,11 @@ typedef struct phNxpSpiHal_Monitor
     /* Mutex protecting native library against concurrency */
     pthread_mutex_t concurrency_mutex;
 
-    /* List used to track pending semaphores waiting for callback */
-    struct listHead sem_list;
+    /* Circular list used to track pending semaphores waiting for callback */
+    struct phNxpSpiHal_SemLink sem_list;
+
+    /* Mutex protecting the list of pending semaphores */
+    pthread_mutex_t sem_mutex;
 
 } phNxpSpiHal_Monitor_t;
 
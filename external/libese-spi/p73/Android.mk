@@ -50,13 +50,30 @@ endif
 LOCAL_SRC_FILES += \
     /log/phNxpLog.c \
     /spm/phNxpEse_Spm.c \
+    /spm/phNxpEse_SpmPolicy.c \
     /lib/phNxpEseProto7816_3.c \
     /lib/phNxpEse_Apdu_Api.c \
-    /lib/phNxpEseDataMgr.c \
+    /lib/phNxpEse_SelCache.c \
+    /lib/phNxpEse_FrameCache.c \
+    /../common/src/phNxpEseT1.c \
     /lib/phNxpEse_Api.c \
     /pal/phNxpEsePal.c \
     /pal/spi/phNxpEsePal_spi.c
 
+# Set ESE_FAULT_INJECTION_INCLUDED TRUE to inject T=1 link faults (test builds only)
+ESE_FAULT_INJECTION_INCLUDED := FALSE
+ifeq ($(ESE_FAULT_INJECTION_INCLUDED), TRUE)
+LOCAL_CFLAGS += -DESE_FAULT_INJECTION_INCLUDED
+LOCAL_SRC_FILES += /pal/phNxpEsePal_fault.c
+endif
+
+# Set ESE_PAL_TRACE_INCLUDED TRUE to capture/replay the PAL traffic (NXP_PAL_TRACE_MODE)
+ESE_PAL_TRACE_INCLUDED := FALSE
+ifeq ($(ESE_PAL_TRACE_INCLUDED), TRUE)
+LOCAL_CFLAGS += -DESE_PAL_TRACE_INCLUDED
+LOCAL_SRC_FILES += /pal/phNxpEsePal_trace.c
+endif
+
 ANDROID_VER := $(subst ., , $(PLATFORM_VERSION))
 ANDROID_VER := $(word 1, $(ANDROID_VER))
 LOCAL_SHARED_LIBSTL := TRUE
@@ -141,4 +158,151 @@ else ifeq ($(NXP_CHIP_TYPE),$(PN81A))
 LOCAL_CFLAGS += -DNFC_NXP_CHIP_TYPE=PN81A
 endif
 
+# Flags of the tools: the device ones never take the test-only PAL layers,
+# the host ones always run the stack over the simulated eSE with both.
+ESE_SPI_CFLAGS := $(filter-out -DESE_FAULT_INJECTION_INCLUDED -DESE_PAL_TRACE_INCLUDED, $(LOCAL_CFLAGS))
+ESE_SPI_SIM_CFLAGS := $(ESE_SPI_CFLAGS) \
+    -DESE_PAL_SIM_INCLUDED \
+    -DESE_FAULT_INJECTION_INCLUDED \
+    -DESE_PAL_TRACE_INCLUDED
+ESE_SPI_SRC_FILES := $(filter-out /pal/spi/phNxpEsePal_spi.c /pal/phNxpEsePal_fault.c /pal/phNxpEsePal_trace.c, $(LOCAL_SRC_FILES))
+ESE_SPI_C_INCLUDES := \
+        $(LOCAL_PATH)/utils \
+	$(LOCAL_PATH)/inc \
+	$(LOCAL_PATH)/common \
+	$(LOCAL_PATH)/lib \
+	$(LOCAL_PATH)/log \
+	$(LOCAL_PATH)/pal/spi \
+	$(LOCAL_PATH)/pal/sim \
+	$(LOCAL_PATH)/pal \
+	$(LOCAL_PATH)/broker \
+	$(LOCAL_PATH)/../common/include \
+
 include $(BUILD_SHARED_LIBRARY)
+
+#### Host library: complete stack over the simulated eSE with fault injection ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := libese-spi-sim
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := $(ESE_SPI_SRC_FILES) \
+    /pal/phNxpEsePal_fault.c \
+    /pal/phNxpEsePal_trace.c \
+    /pal/sim/phNxpEsePal_sim.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+#### T=1 recovery benchmark, runs on the host against libese-spi-sim ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_fault_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := /tools/phNxpEse_FaultBench.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := libese-spi-sim
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_EXECUTABLE)
+
+#### PAL trace replay, runs on the host against libese-spi-sim ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_replay
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := /tools/phNxpEse_Replay.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := libese-spi-sim
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_EXECUTABLE)
+
+#### Micro benchmarks of the T=1, APDU and config hot paths (Google Benchmark) ####
+# phNxpEse_BenchHooks.c builds the protocol and APDU layers itself and the
+# benchmark builds the config module, to reach their internal functions.
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_micro_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := $(filter-out /utils/phNxpConfig.cpp /lib/phNxpEseProto7816_3.c /lib/phNxpEse_Apdu_Api.c, $(ESE_SPI_SRC_FILES)) \
+    /pal/phNxpEsePal_fault.c \
+    /pal/phNxpEsePal_trace.c \
+    /pal/sim/phNxpEsePal_sim.c \
+    /tools/phNxpEse_BenchHooks.c \
+    /tools/phNxpEse_MicroBench.cpp
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_NATIVE_BENCHMARK)
+
+#### End to end transceive benchmark against the device (workloads in tools/workloads) ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_transceive_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_CFLAGS)
+LOCAL_SRC_FILES := /tools/phNxpEse_TransceiveBench.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_SHARED_LIBRARIES := libese-spi liblog libcutils
+include $(BUILD_EXECUTABLE)
+
+#### Same benchmark on the host against libese-spi-sim ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_transceive_bench_sim
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := /tools/phNxpEse_TransceiveBench.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := libese-spi-sim
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_EXECUTABLE)
+
+#### eSE broker daemon: serves local clients over shared-memory rings ####
+ESE_BROKER_SRC_FILES := \
+    /broker/phNxpEse_BrokerRing.c \
+    /broker/phNxpEse_BrokerProto.c
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_broker
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_CFLAGS)
+LOCAL_SRC_FILES := $(ESE_BROKER_SRC_FILES) \
+    /broker/phNxpEse_BrokerServer.c \
+    /broker/phNxpEse_BrokerMain.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_SHARED_LIBRARIES := libese-spi liblog libcutils
+include $(BUILD_EXECUTABLE)
+
+#### Client side of the broker, does not depend on libese-spi ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := libese-broker-client
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_CFLAGS)
+LOCAL_SRC_FILES := $(ESE_BROKER_SRC_FILES) \
+    /broker/phNxpEse_BrokerClient.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)/broker
+include $(BUILD_STATIC_LIBRARY)
+
+#### Same daemon on the host against libese-spi-sim ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_broker_sim
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := $(ESE_BROKER_SRC_FILES) \
+    /broker/phNxpEse_BrokerServer.c \
+    /broker/phNxpEse_BrokerMain.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := libese-spi-sim
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+include $(BUILD_HOST_EXECUTABLE)
+
+#### Direct vs. broker transceive benchmark on the host against libese-spi-sim ####
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_broker_bench_sim
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := $(ESE_SPI_SIM_CFLAGS)
+LOCAL_SRC_FILES := $(ESE_BROKER_SRC_FILES) \
+    /broker/phNxpEse_BrokerServer.c \
+    /broker/phNxpEse_BrokerClient.c \
+    /tools/phNxpEse_BrokerBench.c
+LOCAL_C_INCLUDES := $(ESE_SPI_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := libese-spi-sim
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_LDLIBS := -lpthread
+include $(BUILD_HOST_EXECUTABLE)
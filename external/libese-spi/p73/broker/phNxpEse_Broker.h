@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup spi_broker
+ * \brief eSE broker: one process owns the eSE and serves local clients.
+ *
+ * A client connects to the broker over a Unix socket and receives a shared
+ * memory block holding two single producer, single consumer rings, one for
+ * its commands and one for its responses, and two eventfd doorbells. The
+ * socket is only used to set up the rings and to notice that the client
+ * went away; the APDUs never go through it.
+ * @{ */
+
+#ifndef _PHNXPESE_BROKER_H_
+#define _PHNXPESE_BROKER_H_
+
+#include <phNxpEse_Api.h>
+
+/*!
+ * \brief Socket the broker daemon listens on by default
+ */
+#define PH_BROKER_DEFAULT_SOCKET        "/dev/socket/ese_broker"
+
+/*!
+ * \brief Max. clients connected at the same time
+ */
+#define PH_BROKER_MAX_CLIENTS           8
+
+/*!
+ * \brief Max. command and response length, extended APDUs included
+ */
+#define PH_BROKER_MAX_APDU_LEN          (65536 + 16)
+
+/**
+ * \ingroup spi_broker
+ * \brief Connection of a client to the broker
+ *
+ */
+typedef struct phNxpEseBroker_Client phNxpEseBroker_Client_t;
+
+/**
+ * \ingroup spi_broker
+ * \brief This function serves the clients connecting on pSocketPath until
+ *        stopFd becomes readable. The eSE has to be opened and initialized
+ *        by the caller, the broker only calls phNxpEse_TransceiveStream.
+ *
+ * \param[in]       const char *: Socket path, replaced if it exists
+ * \param[in]       int: File descriptor signalled to stop, -1 for none
+ *
+ * \retval ESESTATUS_SUCCESS when stopped, ESESTATUS_FAILED if the socket
+ *         could not be set up
+ *
+*/
+ESESTATUS phNxpEseBroker_run(const char *pSocketPath, int stopFd);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function connects to the broker and maps the rings
+ *
+ * \param[in]       const char *: Socket path of the broker
+ *
+ * \retval Connection, NULL on error
+ *
+*/
+phNxpEseBroker_Client_t *phNxpEseBroker_connect(const char *pSocketPath);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function sends the command through the broker and waits for
+ *        the response. A connection is used by one thread at a time.
+ *
+ * \param[in]       phNxpEseBroker_Client_t *: Connection
+ * \param[in]       const uint8_t *: Command
+ * \param[in]       uint32_t: Command length
+ * \param[out]      uint8_t *: Response buffer
+ * \param[in]       uint32_t: Response buffer size
+ * \param[out]      uint32_t *: Response length
+ *
+ * \retval ESESTATUS_SUCCESS On Success, the status of the broker side
+ *         transceive, ESESTATUS_BUFFER_TOO_SMALL or ESESTATUS_FAILED
+ *
+*/
+ESESTATUS phNxpEseBroker_transceive(phNxpEseBroker_Client_t *pClient,
+        const uint8_t *pCmd, uint32_t cmdLen, uint8_t *pRsp, uint32_t rspMaxLen,
+        uint32_t *pRspLen);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function closes the connection and unmaps the rings
+ *
+ * \param[in]       phNxpEseBroker_Client_t *: Connection
+ *
+ * \retval None
+ *
+*/
+void phNxpEseBroker_disconnect(phNxpEseBroker_Client_t *pClient);
+/** @} */
+#endif /* _PHNXPESE_BROKER_H_ */
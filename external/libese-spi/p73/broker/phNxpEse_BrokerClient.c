@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Client side of the broker. It does not link libese-spi: the commands are
+ * written into the command ring, the broker is woken through its doorbell
+ * and the response is read from the response ring once the client doorbell
+ * rings.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <phNxpEse_Broker.h>
+#include <phNxpEse_BrokerRing.h>
+#include <phNxpEse_BrokerProto.h>
+
+struct phNxpEseBroker_Client
+{
+    int sockFd;
+    int reqBellFd;
+    int rspBellFd;
+    phNxpEseBroker_Shm_t *pShm;
+    uint32_t nextTag;
+};
+
+/******************************************************************************
+ * Function         phNxpEseBroker_connect
+ *
+ * Description      This function connects to the broker and maps the rings
+ *
+ * Returns          Connection, NULL on error
+ *
+ ******************************************************************************/
+phNxpEseBroker_Client_t *phNxpEseBroker_connect(const char *pSocketPath)
+{
+    phNxpEseBroker_Client_t *pClient;
+    phNxpEseBroker_Hello_t hello;
+    struct sockaddr_un addr;
+    int fds[3];
+    void *pShm;
+
+    if ((pSocketPath == NULL) || (strlen(pSocketPath) >= sizeof(addr.sun_path)))
+        return NULL;
+    pClient = (phNxpEseBroker_Client_t *)calloc(1, sizeof(*pClient));
+    if (pClient == NULL)
+        return NULL;
+    pClient->reqBellFd = -1;
+    pClient->rspBellFd = -1;
+    pClient->sockFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (pClient->sockFd < 0)
+    {
+        free(pClient);
+        return NULL;
+    }
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, pSocketPath, sizeof(addr.sun_path) - 1);
+    if ((connect(pClient->sockFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+            (phNxpEseBroker_recvHello(pClient->sockFd, &hello, fds, 3) != 0))
+    {
+        phNxpEseBroker_disconnect(pClient);
+        return NULL;
+    }
+    pClient->reqBellFd = fds[1];
+    pClient->rspBellFd = fds[2];
+    if ((hello.magic != PH_BROKER_SHM_MAGIC) || (hello.version != PH_BROKER_SHM_VERSION) ||
+            (hello.status != ESESTATUS_SUCCESS) || (hello.shmSize != sizeof(phNxpEseBroker_Shm_t)) ||
+            (fds[0] < 0) || (fds[1] < 0) || (fds[2] < 0))
+    {
+        if (fds[0] >= 0)
+            close(fds[0]);
+        phNxpEseBroker_disconnect(pClient);
+        return NULL;
+    }
+    pShm = mmap(NULL, sizeof(phNxpEseBroker_Shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    close(fds[0]);
+    if (pShm == MAP_FAILED)
+    {
+        phNxpEseBroker_disconnect(pClient);
+        return NULL;
+    }
+    pClient->pShm = (phNxpEseBroker_Shm_t *)pShm;
+    if ((pClient->pShm->magic != PH_BROKER_SHM_MAGIC) ||
+            (pClient->pShm->version != PH_BROKER_SHM_VERSION))
+    {
+        phNxpEseBroker_disconnect(pClient);
+        return NULL;
+    }
+    return pClient;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_waitRsp
+ *
+ * Description      This function sleeps until the client doorbell rings or
+ *                  the broker goes away
+ *
+ * Returns          0 when rung, -1 when the broker is gone
+ *
+ ******************************************************************************/
+static int phNxpEseBroker_waitRsp(phNxpEseBroker_Client_t *pClient)
+{
+    struct pollfd pfds[2];
+    uint64_t count;
+
+    pfds[0].fd = pClient->rspBellFd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = pClient->sockFd;
+    pfds[1].events = POLLIN;
+    pfds[0].revents = pfds[1].revents = 0;
+    if (poll(pfds, 2, -1) < 0)
+        return (errno == EINTR) ? 0 : -1;
+    if (pfds[0].revents & POLLIN)
+    {
+        if (read(pClient->rspBellFd, &count, sizeof(count)) < 0) {}
+        return 0;
+    }
+    if (pfds[1].revents != 0)
+        return -1;
+    return 0;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_transceive
+ *
+ * Description      This function sends the command through the broker and
+ *                  waits for its response
+ *
+ * Returns          ESESTATUS_SUCCESS On Success, else the status of the broker
+ *                  side transceive or the error of the connection
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseBroker_transceive(phNxpEseBroker_Client_t *pClient,
+        const uint8_t *pCmd, uint32_t cmdLen, uint8_t *pRsp, uint32_t rspMaxLen,
+        uint32_t *pRspLen)
+{
+    phNxpEseBroker_Ring_t *pRing;
+    phNxpEseBroker_RecHdr_t hdr;
+    uint64_t one = 1;
+    uint32_t tag;
+    int ret;
+
+    if ((pClient == NULL) || (pCmd == NULL) || (cmdLen == 0) ||
+            (cmdLen > PH_BROKER_MAX_APDU_LEN) || (pRspLen == NULL))
+        return ESESTATUS_INVALID_PARAMETER;
+    *pRspLen = 0;
+    tag = ++pClient->nextTag;
+    hdr.len = cmdLen;
+    hdr.tag = tag;
+    hdr.status = ESESTATUS_SUCCESS;
+    /* one command at a time, the ring always has room for it */
+    if (FALSE == phNxpEseBroker_ringPut(&pClient->pShm->req, &hdr, pCmd))
+        return ESESTATUS_FAILED;
+    if (write(pClient->reqBellFd, &one, sizeof(one)) != sizeof(one))
+        return ESESTATUS_FAILED;
+
+    pRing = &pClient->pShm->rsp;
+    for (;;)
+    {
+        ret = phNxpEseBroker_ringPeek(pRing, &hdr, PH_BROKER_MAX_APDU_LEN);
+        if (ret < 0)
+            return ESESTATUS_FAILED;
+        if (ret == 0)
+        {
+            if (phNxpEseBroker_waitRsp(pClient) != 0)
+                return ESESTATUS_FAILED;
+            continue;
+        }
+        if (hdr.tag != tag)
+        {
+            /* response of a command whose caller gave up */
+            phNxpEseBroker_ringConsume(pRing, hdr.len);
+            continue;
+        }
+        break;
+    }
+    if (hdr.len > rspMaxLen)
+    {
+        phNxpEseBroker_ringConsume(pRing, hdr.len);
+        return ESESTATUS_BUFFER_TOO_SMALL;
+    }
+    phNxpEseBroker_ringRead(pRing, pRing->tail + sizeof(hdr), pRsp, hdr.len);
+    phNxpEseBroker_ringConsume(pRing, hdr.len);
+    *pRspLen = hdr.len;
+    return (ESESTATUS)hdr.status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_disconnect
+ *
+ * Description      This function closes the connection
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseBroker_disconnect(phNxpEseBroker_Client_t *pClient)
+{
+    if (pClient == NULL)
+        return;
+    if (pClient->pShm != NULL)
+        munmap(pClient->pShm, sizeof(phNxpEseBroker_Shm_t));
+    if (pClient->reqBellFd >= 0)
+        close(pClient->reqBellFd);
+    if (pClient->rspBellFd >= 0)
+        close(pClient->rspBellFd);
+    if (pClient->sockFd >= 0)
+        close(pClient->sockFd);
+    free(pClient);
+}
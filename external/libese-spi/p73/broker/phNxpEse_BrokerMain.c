@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * eSE broker daemon
+ *
+ * Opens the eSE and serves the local clients of phNxpEse_Broker.h until
+ * SIGTERM or SIGINT, then closes the eSE. The host build runs over the
+ * simulated eSE.
+ *
+ * usage: ese_broker [-s socket] [-m normal|osu]
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <phNxpEse_Api.h>
+#include <phNxpEse_Broker.h>
+
+static int gStopFd = -1;
+
+static void broker_onSignal(int signo)
+{
+    uint64_t one = 1;
+    (void)signo;
+
+    if (write(gStopFd, &one, sizeof(one)) < 0) {}
+}
+
+static void broker_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-s socket] [-m normal|osu]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *pSocketPath = PH_BROKER_DEFAULT_SOCKET;
+    phNxpEse_initParams initParams;
+    struct sigaction sa;
+    ESESTATUS status;
+    int opt;
+
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    while ((opt = getopt(argc, argv, "s:m:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': pSocketPath = optarg; break;
+        case 'm':
+            if (!strcmp(optarg, "osu"))
+                initParams.initMode = ESE_MODE_OSU;
+            else if (strcmp(optarg, "normal"))
+            {
+                broker_usage(argv[0]);
+                return 2;
+            }
+            break;
+        default: broker_usage(argv[0]); return 2;
+        }
+    }
+    gStopFd = eventfd(0, EFD_CLOEXEC);
+    if (gStopFd < 0)
+        return 1;
+    memset(&sa, 0x00, sizeof(sa));
+    sa.sa_handler = broker_onSignal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+            (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+    {
+        fprintf(stderr, "eSE open/init failed\n");
+        phNxpEse_close();
+        return 1;
+    }
+    status = phNxpEseBroker_run(pSocketPath, gStopFd);
+    if (status != ESESTATUS_SUCCESS)
+        fprintf(stderr, "cannot serve on %s\n", pSocketPath);
+    phNxpEse_deInit();
+    phNxpEse_close();
+    close(gStopFd);
+    return (status == ESESTATUS_SUCCESS) ? 0 : 1;
+}
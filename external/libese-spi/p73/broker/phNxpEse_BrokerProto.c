@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Connection set up between the broker and a client: one message carrying
+ * the file descriptors of the shared memory and of the doorbells.
+ */
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <phNxpEse_BrokerProto.h>
+
+#define PH_BROKER_MAX_FDS       3
+
+/******************************************************************************
+ * Function         phNxpEseBroker_sendHello
+ *
+ * Description      This function sends the hello message and the descriptors
+ *
+ * Returns          0 On Success, -1 on error
+ *
+ ******************************************************************************/
+int phNxpEseBroker_sendHello(int sockFd, const phNxpEseBroker_Hello_t *pHello,
+        const int *pFds, int numFds)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * PH_BROKER_MAX_FDS)];
+    } control;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *pCmsg;
+
+    if ((numFds < 0) || (numFds > PH_BROKER_MAX_FDS))
+        return -1;
+    memset(&msg, 0x00, sizeof(msg));
+    memset(&control, 0x00, sizeof(control));
+    iov.iov_base = (void *)pHello;
+    iov.iov_len = sizeof(*pHello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (numFds > 0)
+    {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * numFds);
+        pCmsg = CMSG_FIRSTHDR(&msg);
+        pCmsg->cmsg_level = SOL_SOCKET;
+        pCmsg->cmsg_type = SCM_RIGHTS;
+        pCmsg->cmsg_len = CMSG_LEN(sizeof(int) * numFds);
+        memcpy(CMSG_DATA(pCmsg), pFds, sizeof(int) * numFds);
+    }
+    if (sendmsg(sockFd, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(*pHello))
+        return -1;
+    return 0;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_recvHello
+ *
+ * Description      This function receives the hello message and descriptors
+ *
+ * Returns          0 On Success, -1 on error
+ *
+ ******************************************************************************/
+int phNxpEseBroker_recvHello(int sockFd, phNxpEseBroker_Hello_t *pHello,
+        int *pFds, int maxFds)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int) * PH_BROKER_MAX_FDS)];
+    } control;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *pCmsg;
+    ssize_t len;
+    int i, n;
+
+    for (i = 0; i < maxFds; i++)
+        pFds[i] = -1;
+    memset(&msg, 0x00, sizeof(msg));
+    iov.iov_base = pHello;
+    iov.iov_len = sizeof(*pHello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    do
+    {
+        len = recvmsg(sockFd, &msg, MSG_CMSG_CLOEXEC);
+    } while ((len < 0) && (errno == EINTR));
+    if (len != (ssize_t)sizeof(*pHello))
+        return -1;
+    for (pCmsg = CMSG_FIRSTHDR(&msg); pCmsg != NULL; pCmsg = CMSG_NXTHDR(&msg, pCmsg))
+    {
+        if ((pCmsg->cmsg_level != SOL_SOCKET) || (pCmsg->cmsg_type != SCM_RIGHTS))
+            continue;
+        n = (pCmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (i = 0; i < n; i++)
+        {
+            int fd;
+            memcpy(&fd, CMSG_DATA(pCmsg) + (i * sizeof(int)), sizeof(int));
+            if (i < maxFds)
+                pFds[i] = fd;
+            else
+                close(fd);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup spi_broker
+ * @{ */
+
+#ifndef _PHNXPESE_BROKERPROTO_H_
+#define _PHNXPESE_BROKERPROTO_H_
+
+#include <phEseTypes.h>
+
+/**
+ * \ingroup spi_broker
+ * \brief Message sent by the broker on a new connection, with the shared
+ *        memory, command doorbell and response doorbell file descriptors
+ *        attached when status is ESESTATUS_SUCCESS
+ *
+ */
+typedef struct phNxpEseBroker_Hello
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t status;
+    uint32_t shmSize;
+} phNxpEseBroker_Hello_t;
+
+/**
+ * \ingroup spi_broker
+ * \brief This function sends the hello message with numFds descriptors
+ *
+ * \retval 0 On Success, -1 on error
+ *
+*/
+int phNxpEseBroker_sendHello(int sockFd, const phNxpEseBroker_Hello_t *pHello,
+        const int *pFds, int numFds);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function receives the hello message and up to maxFds
+ *        descriptors, the missing ones are set to -1
+ *
+ * \retval 0 On Success, -1 on error
+ *
+*/
+int phNxpEseBroker_recvHello(int sockFd, phNxpEseBroker_Hello_t *pHello,
+        int *pFds, int maxFds);
+/** @} */
+#endif /* _PHNXPESE_BROKERPROTO_H_ */
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Shared memory rings between the broker and a client. The producer writes
+ * a record past head and then moves head with release semantics; the
+ * consumer reads head with acquire semantics, so it never sees a record
+ * before its bytes. The same goes for tail in the other direction. The
+ * other side may be buggy or hostile, the indexes read from the ring are
+ * checked before use.
+ */
+#include <string.h>
+#include <phNxpEse_BrokerRing.h>
+
+#define PH_BROKER_RING_MASK     (PH_BROKER_RING_SIZE - 1)
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringFree
+ *
+ * Description      This function returns the bytes the producer may write
+ *
+ * Returns          Free bytes, 0 if the indexes are inconsistent
+ *
+ ******************************************************************************/
+uint32_t phNxpEseBroker_ringFree(phNxpEseBroker_Ring_t *pRing)
+{
+    uint32_t head = pRing->head;
+    uint32_t tail = __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);
+    uint32_t used = head - tail;
+
+    if (used > PH_BROKER_RING_SIZE)
+        return 0;
+    return PH_BROKER_RING_SIZE - used;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringWrite
+ *
+ * Description      This function copies bytes into the ring, wrapping around
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseBroker_ringWrite(phNxpEseBroker_Ring_t *pRing, uint32_t pos,
+        const void *pSrc, uint32_t len)
+{
+    uint32_t offset = pos & PH_BROKER_RING_MASK;
+    uint32_t first = PH_BROKER_RING_SIZE - offset;
+
+    if (first >= len)
+    {
+        memcpy(&pRing->data[offset], pSrc, len);
+    }
+    else
+    {
+        memcpy(&pRing->data[offset], pSrc, first);
+        memcpy(&pRing->data[0], (const uint8_t *)pSrc + first, len - first);
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringRead
+ *
+ * Description      This function copies bytes out of the ring, wrapping around
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseBroker_ringRead(const phNxpEseBroker_Ring_t *pRing, uint32_t pos,
+        void *pDst, uint32_t len)
+{
+    uint32_t offset = pos & PH_BROKER_RING_MASK;
+    uint32_t first = PH_BROKER_RING_SIZE - offset;
+
+    if (first >= len)
+    {
+        memcpy(pDst, &pRing->data[offset], len);
+    }
+    else
+    {
+        memcpy(pDst, &pRing->data[offset], first);
+        memcpy((uint8_t *)pDst + first, &pRing->data[0], len - first);
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringPut
+ *
+ * Description      This function writes a complete record and publishes it
+ *
+ * Returns          TRUE if written, FALSE if the ring is full
+ *
+ ******************************************************************************/
+bool_t phNxpEseBroker_ringPut(phNxpEseBroker_Ring_t *pRing,
+        const phNxpEseBroker_RecHdr_t *pHdr, const uint8_t *pData)
+{
+    uint32_t head = pRing->head;
+
+    if (phNxpEseBroker_ringFree(pRing) < PH_BROKER_REC_SIZE(pHdr->len))
+        return FALSE;
+    phNxpEseBroker_ringWrite(pRing, head, pHdr, sizeof(*pHdr));
+    if (pHdr->len > 0)
+        phNxpEseBroker_ringWrite(pRing, head + sizeof(*pHdr), pData, pHdr->len);
+    phNxpEseBroker_ringPublish(pRing, pHdr->len);
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringPublish
+ *
+ * Description      This function makes the record written at head visible
+ *                  to the consumer
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseBroker_ringPublish(phNxpEseBroker_Ring_t *pRing, uint32_t len)
+{
+    __atomic_store_n(&pRing->head, pRing->head + PH_BROKER_REC_SIZE(len), __ATOMIC_RELEASE);
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringPeek
+ *
+ * Description      This function reads the header of the next record
+ *
+ * Returns          1 if there is one, 0 if the ring is empty, -1 if the ring
+ *                  is corrupted or the record longer than maxLen
+ *
+ ******************************************************************************/
+int phNxpEseBroker_ringPeek(const phNxpEseBroker_Ring_t *pRing,
+        phNxpEseBroker_RecHdr_t *pHdr, uint32_t maxLen)
+{
+    uint32_t head = __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = pRing->tail;
+    uint32_t used = head - tail;
+
+    if (used == 0)
+        return 0;
+    if ((used > PH_BROKER_RING_SIZE) || (used < sizeof(*pHdr)))
+        return -1;
+    phNxpEseBroker_ringRead(pRing, tail, pHdr, sizeof(*pHdr));
+    if ((pHdr->len > maxLen) || (PH_BROKER_REC_SIZE(pHdr->len) > used))
+        return -1;
+    return 1;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_ringConsume
+ *
+ * Description      This function gives the bytes of the record back to the
+ *                  producer
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEseBroker_ringConsume(phNxpEseBroker_Ring_t *pRing, uint32_t len)
+{
+    __atomic_store_n(&pRing->tail, pRing->tail + PH_BROKER_REC_SIZE(len), __ATOMIC_RELEASE);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup spi_broker
+ * @{ */
+
+#ifndef _PHNXPESE_BROKERRING_H_
+#define _PHNXPESE_BROKERRING_H_
+
+#include <phEseTypes.h>
+
+/*!
+ * \brief Data bytes of a ring, a power of 2 that holds the largest record
+ */
+#define PH_BROKER_RING_SIZE             (256 * 1024)
+
+/*!
+ * \brief Shared memory layout version, checked by the client
+ */
+#define PH_BROKER_SHM_MAGIC             0x45534252 /* "ESBR" */
+#define PH_BROKER_SHM_VERSION           1
+
+/*!
+ * \brief Records start on this boundary
+ */
+#define PH_BROKER_REC_ALIGN             4
+
+/**
+ * \ingroup spi_broker
+ * \brief Header of a command or response record
+ *
+ */
+typedef struct phNxpEseBroker_RecHdr
+{
+    uint32_t len;    /*!< payload bytes following the header */
+    uint32_t tag;    /*!< request number, copied into the response */
+    uint32_t status; /*!< ESESTATUS of the transceive, responses only */
+} phNxpEseBroker_RecHdr_t;
+
+/**
+ * \ingroup spi_broker
+ * \brief Single producer, single consumer ring. head and tail count bytes
+ *        from the creation of the ring and wrap at 2^32; each one is only
+ *        written by its side and lives on its own cache line.
+ *
+ */
+typedef struct phNxpEseBroker_Ring
+{
+    volatile uint32_t head;  /*!< end of the published records, producer */
+    uint8_t pad0[60];
+    volatile uint32_t tail;  /*!< end of the consumed records, consumer */
+    uint8_t pad1[60];
+    uint8_t data[PH_BROKER_RING_SIZE];
+} phNxpEseBroker_Ring_t;
+
+/**
+ * \ingroup spi_broker
+ * \brief Shared memory block of a client
+ *
+ */
+typedef struct phNxpEseBroker_Shm
+{
+    uint32_t magic;
+    uint32_t version;
+    uint8_t pad[56];
+    phNxpEseBroker_Ring_t req; /*!< commands, client to broker */
+    phNxpEseBroker_Ring_t rsp; /*!< responses, broker to client */
+} phNxpEseBroker_Shm_t;
+
+/**
+ * \ingroup spi_broker
+ * \brief Bytes taken in the ring by a record with len payload bytes
+ *
+ */
+#define PH_BROKER_REC_SIZE(len) \
+    ((sizeof(phNxpEseBroker_RecHdr_t) + (len) + (PH_BROKER_REC_ALIGN - 1)) & \
+     ~(uint32_t)(PH_BROKER_REC_ALIGN - 1))
+
+/**
+ * \ingroup spi_broker
+ * \brief This function returns the bytes the producer may still write
+ *
+ * \retval Free bytes, 0 if the indexes are inconsistent
+ *
+*/
+uint32_t phNxpEseBroker_ringFree(phNxpEseBroker_Ring_t *pRing);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function copies len bytes into the ring at byte position pos,
+ *        wrapping around, without publishing them
+ *
+ * \retval None
+ *
+*/
+void phNxpEseBroker_ringWrite(phNxpEseBroker_Ring_t *pRing, uint32_t pos,
+        const void *pSrc, uint32_t len);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function copies len bytes out of the ring from byte position pos
+ *
+ * \retval None
+ *
+*/
+void phNxpEseBroker_ringRead(const phNxpEseBroker_Ring_t *pRing, uint32_t pos,
+        void *pDst, uint32_t len);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function writes a complete record and publishes it
+ *
+ * \retval TRUE if written, FALSE if the ring is full
+ *
+*/
+bool_t phNxpEseBroker_ringPut(phNxpEseBroker_Ring_t *pRing,
+        const phNxpEseBroker_RecHdr_t *pHdr, const uint8_t *pData);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function publishes the record written at the current head
+ *
+ * \retval None
+ *
+*/
+void phNxpEseBroker_ringPublish(phNxpEseBroker_Ring_t *pRing, uint32_t len);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function reads the header of the next record, after checking
+ *        it against the bytes published so that a corrupted ring is noticed
+ *
+ * \retval 1 if a record is there, 0 if the ring is empty, -1 if corrupted
+ *
+*/
+int phNxpEseBroker_ringPeek(const phNxpEseBroker_Ring_t *pRing,
+        phNxpEseBroker_RecHdr_t *pHdr, uint32_t maxLen);
+
+/**
+ * \ingroup spi_broker
+ * \brief This function releases the record returned by phNxpEseBroker_ringPeek
+ *
+ * \retval None
+ *
+*/
+void phNxpEseBroker_ringConsume(phNxpEseBroker_Ring_t *pRing, uint32_t len);
+/** @} */
+#endif /* _PHNXPESE_BROKERRING_H_ */
@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Broker side: accepts the clients, gives each one its shared memory block
+ * and doorbells, and runs their commands on the eSE one at a time, taking
+ * one command from every client that has some in turn. Commands are copied
+ * out of the ring before they are run, since the client can still write
+ * to it, responses are streamed straight into the response ring.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <phNxpLog.h>
+#include <phNxpEse_Broker.h>
+#include <phNxpEse_BrokerRing.h>
+#include <phNxpEse_BrokerProto.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC                     0x0001U
+#endif
+
+#define PH_BROKER_EV_LISTEN             0
+#define PH_BROKER_EV_STOP               1
+#define PH_BROKER_EV_SOCK               2
+#define PH_BROKER_EV_BELL               3
+#define PH_BROKER_EV(type, index)       (((uint64_t)(type) << 32) | (uint32_t)(index))
+#define PH_BROKER_MAX_EVENTS            (2 + (2 * PH_BROKER_MAX_CLIENTS))
+
+typedef struct phNxpEseBroker_Conn
+{
+    bool_t active;
+    bool_t pending;     /* doorbell rung since the ring was last found empty */
+    int sockFd;
+    int reqBellFd;
+    int rspBellFd;
+    phNxpEseBroker_Shm_t *pShm;
+} phNxpEseBroker_Conn_t;
+
+typedef struct phNxpEseBroker_Sink
+{
+    phNxpEseBroker_Ring_t *pRing;
+    uint32_t pos;
+    uint32_t len;
+} phNxpEseBroker_Sink_t;
+
+STATIC phNxpEseBroker_Conn_t gBrokerConns[PH_BROKER_MAX_CLIENTS];
+STATIC uint8_t gBrokerCmdBuf[PH_BROKER_MAX_APDU_LEN];
+STATIC int gBrokerEpollFd = -1;
+STATIC uint32_t gBrokerNext = 0;
+
+/******************************************************************************
+ * Function         phNxpEseBroker_createShm
+ *
+ * Description      This function creates the shared memory block of a client
+ *
+ * Returns          File descriptor, -1 on error
+ *
+ ******************************************************************************/
+STATIC int phNxpEseBroker_createShm(phNxpEseBroker_Shm_t **ppShm)
+{
+    int fd = -1;
+
+#ifdef __NR_memfd_create
+    fd = (int)syscall(__NR_memfd_create, "ese_broker", MFD_CLOEXEC);
+#endif
+    if (fd < 0)
+    {
+        NXPLOG_ESELIB_E("%s memfd_create: %s", __FUNCTION__, strerror(errno));
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(phNxpEseBroker_Shm_t)) != 0)
+    {
+        NXPLOG_ESELIB_E("%s ftruncate: %s", __FUNCTION__, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    *ppShm = (phNxpEseBroker_Shm_t *)mmap(NULL, sizeof(phNxpEseBroker_Shm_t),
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (*ppShm == MAP_FAILED)
+    {
+        NXPLOG_ESELIB_E("%s mmap: %s", __FUNCTION__, strerror(errno));
+        *ppShm = NULL;
+        close(fd);
+        return -1;
+    }
+    (*ppShm)->magic = PH_BROKER_SHM_MAGIC;
+    (*ppShm)->version = PH_BROKER_SHM_VERSION;
+    return fd;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_closeConn
+ *
+ * Description      This function forgets a client, its pending commands are
+ *                  dropped
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+STATIC void phNxpEseBroker_closeConn(phNxpEseBroker_Conn_t *pConn)
+{
+    if (pConn->sockFd >= 0)
+        close(pConn->sockFd);
+    if (pConn->reqBellFd >= 0)
+        close(pConn->reqBellFd);
+    if (pConn->rspBellFd >= 0)
+        close(pConn->rspBellFd);
+    if (pConn->pShm != NULL)
+        munmap(pConn->pShm, sizeof(phNxpEseBroker_Shm_t));
+    phNxpEse_memset(pConn, 0x00, sizeof(*pConn));
+    pConn->sockFd = -1;
+    pConn->reqBellFd = -1;
+    pConn->rspBellFd = -1;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_accept
+ *
+ * Description      This function accepts a client and hands it its shared
+ *                  memory and doorbells
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+STATIC void phNxpEseBroker_accept(int listenFd)
+{
+    phNxpEseBroker_Conn_t *pConn = NULL;
+    phNxpEseBroker_Hello_t hello;
+    struct epoll_event ev;
+    int fds[3] = {-1, -1, -1};
+    int sockFd;
+    uint32_t i;
+
+    sockFd = accept(listenFd, NULL, NULL);
+    if (sockFd < 0)
+    {
+        NXPLOG_ESELIB_E("%s accept: %s", __FUNCTION__, strerror(errno));
+        return;
+    }
+    fcntl(sockFd, F_SETFD, FD_CLOEXEC);
+    phNxpEse_memset(&hello, 0x00, sizeof(hello));
+    hello.magic = PH_BROKER_SHM_MAGIC;
+    hello.version = PH_BROKER_SHM_VERSION;
+    hello.shmSize = sizeof(phNxpEseBroker_Shm_t);
+    hello.status = ESESTATUS_FAILED;
+    for (i = 0; i < PH_BROKER_MAX_CLIENTS; i++)
+    {
+        if (FALSE == gBrokerConns[i].active)
+        {
+            pConn = &gBrokerConns[i];
+            break;
+        }
+    }
+    if (pConn == NULL)
+    {
+        NXPLOG_ESELIB_E("%s too many clients", __FUNCTION__);
+        phNxpEseBroker_sendHello(sockFd, &hello, NULL, 0);
+        close(sockFd);
+        return;
+    }
+    pConn->sockFd = sockFd;
+    fds[0] = phNxpEseBroker_createShm(&pConn->pShm);
+    pConn->reqBellFd = fds[1] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    pConn->rspBellFd = fds[2] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ((fds[0] >= 0) && (fds[1] >= 0) && (fds[2] >= 0))
+        hello.status = ESESTATUS_SUCCESS;
+    if ((0 != phNxpEseBroker_sendHello(sockFd, &hello, fds, 3)) ||
+            (ESESTATUS_SUCCESS != hello.status))
+    {
+        if (fds[0] >= 0)
+            close(fds[0]);
+        phNxpEseBroker_closeConn(pConn);
+        return;
+    }
+    /* the client holds the mapping now */
+    close(fds[0]);
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = PH_BROKER_EV(PH_BROKER_EV_SOCK, i);
+    epoll_ctl(gBrokerEpollFd, EPOLL_CTL_ADD, pConn->sockFd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.u64 = PH_BROKER_EV(PH_BROKER_EV_BELL, i);
+    epoll_ctl(gBrokerEpollFd, EPOLL_CTL_ADD, pConn->reqBellFd, &ev);
+    pConn->active = TRUE;
+    /* commands may have been queued before the doorbell was watched */
+    pConn->pending = TRUE;
+    NXPLOG_ESELIB_D("%s client %u connected", __FUNCTION__, i);
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_rspSink
+ *
+ * Description      This function appends the response payload to the
+ *                  response ring, it is published once complete
+ *
+ * Returns          ESESTATUS_SUCCESS, ESESTATUS_BUFFER_TOO_SMALL past the
+ *                  max. APDU length
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEseBroker_rspSink(void *pContext, const uint8_t *pData,
+        uint32_t len, bool_t last)
+{
+    phNxpEseBroker_Sink_t *pSink = (phNxpEseBroker_Sink_t *)pContext;
+    (void)last;
+
+    if (len > (PH_BROKER_MAX_APDU_LEN - pSink->len))
+        return ESESTATUS_BUFFER_TOO_SMALL;
+    phNxpEseBroker_ringWrite(pSink->pRing, pSink->pos + pSink->len, pData, len);
+    pSink->len += len;
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_serveOne
+ *
+ * Description      This function runs the next command of the client on the
+ *                  eSE and publishes its response
+ *
+ * Returns          TRUE if a command was run, FALSE if there is none or no
+ *                  room for its response
+ *
+ ******************************************************************************/
+STATIC bool_t phNxpEseBroker_serveOne(phNxpEseBroker_Conn_t *pConn)
+{
+    phNxpEseBroker_Ring_t *pReq = &pConn->pShm->req;
+    phNxpEseBroker_Ring_t *pRsp = &pConn->pShm->rsp;
+    phNxpEseBroker_RecHdr_t hdr;
+    phNxpEseBroker_Sink_t sink;
+    phNxpEse_data cmd;
+    ESESTATUS status;
+    uint64_t one = 1;
+    int ret;
+
+    ret = phNxpEseBroker_ringPeek(pReq, &hdr, PH_BROKER_MAX_APDU_LEN);
+    if (ret < 0)
+    {
+        NXPLOG_ESELIB_E("%s corrupted command ring, client dropped", __FUNCTION__);
+        phNxpEseBroker_closeConn(pConn);
+        return FALSE;
+    }
+    if (ret == 0)
+        return FALSE;
+    /* the client rings again once it has read its responses */
+    if (phNxpEseBroker_ringFree(pRsp) < PH_BROKER_REC_SIZE(PH_BROKER_MAX_APDU_LEN))
+        return FALSE;
+    /* the exchange and the SELECT cache only ever see the broker's copy */
+    phNxpEseBroker_ringRead(pReq, pReq->tail + sizeof(hdr), gBrokerCmdBuf, hdr.len);
+    cmd.len = hdr.len;
+    cmd.p_data = gBrokerCmdBuf;
+    sink.pRing = pRsp;
+    sink.pos = pRsp->head + sizeof(hdr);
+    sink.len = 0;
+    status = phNxpEse_TransceiveStream(&cmd, phNxpEseBroker_rspSink, &sink);
+    phNxpEseBroker_ringConsume(pReq, hdr.len);
+
+    hdr.status = status;
+    hdr.len = (ESESTATUS_SUCCESS == status) ? sink.len : 0;
+    phNxpEseBroker_ringWrite(pRsp, pRsp->head, &hdr, sizeof(hdr));
+    phNxpEseBroker_ringPublish(pRsp, hdr.len);
+    if (write(pConn->rspBellFd, &one, sizeof(one)) != sizeof(one))
+        NXPLOG_ESELIB_E("%s doorbell: %s", __FUNCTION__, strerror(errno));
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_serve
+ *
+ * Description      This function runs the pending commands, one per client
+ *                  in turn, until none is left
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+STATIC void phNxpEseBroker_serve(void)
+{
+    bool_t work = TRUE;
+    uint32_t i, n;
+
+    while (work)
+    {
+        work = FALSE;
+        for (n = 0; n < PH_BROKER_MAX_CLIENTS; n++)
+        {
+            i = (gBrokerNext + n) % PH_BROKER_MAX_CLIENTS;
+            if ((FALSE == gBrokerConns[i].active) || (FALSE == gBrokerConns[i].pending))
+                continue;
+            if (phNxpEseBroker_serveOne(&gBrokerConns[i]))
+                work = TRUE;
+            else
+                gBrokerConns[i].pending = FALSE;
+        }
+        gBrokerNext = (gBrokerNext + 1) % PH_BROKER_MAX_CLIENTS;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_listen
+ *
+ * Description      This function creates the listening socket
+ *
+ * Returns          File descriptor, -1 on error
+ *
+ ******************************************************************************/
+STATIC int phNxpEseBroker_listen(const char *pSocketPath)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(pSocketPath) >= sizeof(addr.sun_path))
+        return -1;
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    phNxpEse_memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, pSocketPath, sizeof(addr.sun_path) - 1);
+    unlink(pSocketPath);
+    if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+            (listen(fd, PH_BROKER_MAX_CLIENTS) != 0))
+    {
+        NXPLOG_ESELIB_E("%s %s: %s", __FUNCTION__, pSocketPath, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/******************************************************************************
+ * Function         phNxpEseBroker_run
+ *
+ * Description      This function serves the clients until stopFd is readable
+ *
+ * Returns          ESESTATUS_SUCCESS when stopped, ESESTATUS_FAILED if the
+ *                  socket could not be set up
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEseBroker_run(const char *pSocketPath, int stopFd)
+{
+    struct epoll_event ev;
+    struct epoll_event events[PH_BROKER_MAX_EVENTS];
+    bool_t stop = FALSE;
+    bool_t incoming;
+    uint64_t count;
+    char buf[16];
+    int listenFd;
+    int n, i;
+
+    for (i = 0; i < PH_BROKER_MAX_CLIENTS; i++)
+    {
+        phNxpEse_memset(&gBrokerConns[i], 0x00, sizeof(gBrokerConns[i]));
+        gBrokerConns[i].sockFd = -1;
+        gBrokerConns[i].reqBellFd = -1;
+        gBrokerConns[i].rspBellFd = -1;
+    }
+    listenFd = phNxpEseBroker_listen(pSocketPath);
+    gBrokerEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if ((listenFd < 0) || (gBrokerEpollFd < 0))
+    {
+        if (listenFd >= 0)
+            close(listenFd);
+        if (gBrokerEpollFd >= 0)
+            close(gBrokerEpollFd);
+        gBrokerEpollFd = -1;
+        return ESESTATUS_FAILED;
+    }
+    ev.events = EPOLLIN;
+    ev.data.u64 = PH_BROKER_EV(PH_BROKER_EV_LISTEN, 0);
+    epoll_ctl(gBrokerEpollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    if (stopFd >= 0)
+    {
+        ev.data.u64 = PH_BROKER_EV(PH_BROKER_EV_STOP, 0);
+        epoll_ctl(gBrokerEpollFd, EPOLL_CTL_ADD, stopFd, &ev);
+    }
+    NXPLOG_ESELIB_D("%s listening on %s", __FUNCTION__, pSocketPath);
+
+    while (FALSE == stop)
+    {
+        n = epoll_wait(gBrokerEpollFd, events, PH_BROKER_MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            NXPLOG_ESELIB_E("%s epoll_wait: %s", __FUNCTION__, strerror(errno));
+            break;
+        }
+        incoming = FALSE;
+        for (i = 0; i < n; i++)
+        {
+            uint32_t type = (uint32_t)(events[i].data.u64 >> 32);
+            phNxpEseBroker_Conn_t *pConn = &gBrokerConns[(uint32_t)events[i].data.u64 % PH_BROKER_MAX_CLIENTS];
+
+            switch (type)
+            {
+            case PH_BROKER_EV_LISTEN:
+                /* after the other events, a slot freed above is not reused
+                 * while events of its previous client are still handled */
+                incoming = TRUE;
+                break;
+            case PH_BROKER_EV_STOP:
+                stop = TRUE;
+                break;
+            case PH_BROKER_EV_SOCK:
+                /* nothing is expected on the socket but its closing */
+                if ((TRUE == pConn->active) &&
+                        ((events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) ||
+                         (recv(pConn->sockFd, buf, sizeof(buf), MSG_DONTWAIT) == 0)))
+                {
+                    NXPLOG_ESELIB_D("%s client disconnected", __FUNCTION__);
+                    phNxpEseBroker_closeConn(pConn);
+                }
+                break;
+            case PH_BROKER_EV_BELL:
+                if (TRUE == pConn->active)
+                {
+                    if (read(pConn->reqBellFd, &count, sizeof(count)) < 0) {}
+                    pConn->pending = TRUE;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        if (TRUE == incoming)
+            phNxpEseBroker_accept(listenFd);
+        phNxpEseBroker_serve();
+    }
+
+    for (i = 0; i < PH_BROKER_MAX_CLIENTS; i++)
+    {
+        if (TRUE == gBrokerConns[i].active)
+            phNxpEseBroker_closeConn(&gBrokerConns[i]);
+    }
+    close(listenFd);
+    close(gBrokerEpollFd);
+    gBrokerEpollFd = -1;
+    unlink(pSocketPath);
+    return ESESTATUS_SUCCESS;
+}
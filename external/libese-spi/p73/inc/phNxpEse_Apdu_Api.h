@@ -26,6 +26,12 @@
 
 #define MIN_HEADER_LEN  4
 
+/**
+ * \ingroup ISO7816-4_application_protocol_implementation
+ * \brief Upper bound of a response assembled from 61xx pieces, rpdu len is 16 bits
+ */
+#define PH_7816_AUTO_RSP_MAX_LEN  0xFFFF
+
 /**
  * \ingroup ISO7816-4_application_protocol_implementation
  * \brief Command data unit structure params
@@ -90,5 +96,32 @@ typedef phNxpEse_7816_rpdu_t *pphNxpEse_7816_rpdu_t;
 
 ESESTATUS phNxpEse_7816_Transceive(pphNxpEse_7816_cpdu_t pCmd, pphNxpEse_7816_rpdu_t pRsp);
 
+/**
+ * \ingroup ISO7816-4_application_protocol_implementation
+ * \brief This function makes phNxpEse_7816_Transceive handle the 61xx and 6Cxx
+ * status words itself. On 6Cxx the command is sent once more with the Le given
+ * by the card. On 61xx the remaining data is fetched with GET RESPONSE and
+ * appended to the response, until another status word is returned or the next
+ * piece would take the response beyond maxRspLen, or beyond pRsp->len when the
+ * caller sets it to the size of its buffer. The response then ends with 61xx.
+ *
+ * \param[in]       bool_t enable - TRUE to enable, FALSE (default) to disable
+ * \param[in]       uint32_t maxRspLen - Cap of the response data, 0 for PH_7816_AUTO_RSP_MAX_LEN
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ */
+ESESTATUS phNxpEse_7816_setAutoResponse(bool_t enable, uint32_t maxRspLen);
+
+/**
+ * \ingroup ISO7816-4_application_protocol_implementation
+ * \brief This function reports whether phNxpEse_7816_Transceive handles 61xx and
+ * 6Cxx itself, see phNxpEse_7816_setAutoResponse.
+ *
+ * \param[out]      uint32_t *pMaxRspLen - Cap of the response data, may be NULL
+ *
+ * \retval TRUE when enabled, FALSE otherwise.
+ */
+bool_t phNxpEse_7816_getAutoResponse(uint32_t *pMaxRspLen);
+
 #endif  /*  _PHNXPESE_APDU_H    */
 /** @} */
@@ -47,6 +47,32 @@ typedef enum
     ESE_MODE_OSU /*!< Jcop Os update mode */
 } phNxpEse_initMode;
 
+/**
+ * \ingroup spi_libese
+ * \brief Kind of client opening the Ese, the power policy learns the
+ *        access pattern of each kind separately
+ *
+ */
+typedef enum
+{
+    ESE_CLIENT_DEFAULT = 0, /*!< Client of unknown kind */
+    ESE_CLIENT_WALLET, /*!< Payment wallet */
+    ESE_CLIENT_TRANSIT, /*!< Transit ticketing */
+    ESE_CLIENT_SERVICE, /*!< Background synchronization and maintenance */
+    ESE_CLIENT_MAX
+} phNxpEse_clientType;
+
+/**
+ * \ingroup spi_libese
+ * \brief Hints given to the power policy, see phNxpEse_powerHint
+ *
+ */
+typedef enum
+{
+    ESE_PWR_HINT_ACTIVE = 0, /*!< The Ese is about to be used, e.g. the wallet is shown */
+    ESE_PWR_HINT_IDLE /*!< No use is expected soon */
+} phNxpEse_pwrHint;
+
 /**
  * \ingroup spi_libese
  * \brief Ese library init parameters to be set while calling phNxpEse_init
@@ -55,8 +81,68 @@ typedef enum
 typedef struct phNxpEse_initParams
 {
     phNxpEse_initMode initMode; /*!< Ese communication mode */
+    phNxpEse_clientType clientType; /*!< Kind of client, for the power policy */
 } phNxpEse_initParams;
 
+/**
+ * \ingroup spi_libese
+ * \brief Ese link counters, see phNxpEse_getStats
+ *
+ */
+typedef struct phNxpEse_Stats
+{
+    phPalEse_Stats_t pal; /*!< device calls, one per syscall on the target */
+    uint32_t sofPolls; /*!< SOF polls, including the ones that found a frame */
+    uint32_t framesRx; /*!< T=1 frames received */
+    uint32_t framesTx; /*!< T=1 frames sent */
+    uint32_t selectsElided; /*!< SELECT commands answered from the SELECT cache */
+    uint32_t selectsForwarded; /*!< SELECT commands sent to the eSE */
+    uint32_t framesCached; /*!< I-blocks sent as encoded for a previous identical command */
+    uint32_t framesEncoded; /*!< I-blocks encoded into the frame cache */
+    uint32_t spmIoctls; /*!< power management driver calls */
+    uint32_t spmLeaseResumes; /*!< sessions opened on the access of the previous one */
+    uint32_t spmLeaseRevokes; /*!< parked accesses given back on NFC/DWP activity */
+    uint64_t spmAccessWaitUs; /*!< time spent waiting for the driver to grant access */
+    uint64_t spmMaxAccessWaitUs; /*!< longest of these waits */
+    uint32_t sessionsCold; /*!< normal sessions that powered the Ese up */
+    uint32_t sessionsWarm; /*!< normal sessions opened on an Ese left or brought up powered */
+    uint64_t ttfaColdUs; /*!< time from phNxpEse_open to the first APDU, cold sessions */
+    uint64_t ttfaWarmUs; /*!< time from phNxpEse_open to the first APDU, warm sessions */
+    uint64_t ttfaMaxUs; /*!< longest time from phNxpEse_open to the first APDU */
+    uint32_t spmWarmups; /*!< speculative power ups of the power policy */
+    uint32_t spmWarmupsUsed; /*!< of these, the ones a session opened on */
+    uint64_t spmOnTimeUs; /*!< estimated time the Ese was powered for SPI */
+    uint64_t spmIdleOnTimeUs; /*!< of it, the time powered without session */
+} phNxpEse_Stats_t;
+
+/**
+ * \ingroup spi_libese
+ * \brief Response sink of phNxpEse_TransceiveStream
+ *
+ * Called once per received I-block payload, after the block has been
+ * acknowledged, with last set to TRUE on the final block of the response.
+ * pData is only valid for the duration of the call. Returning anything
+ * other than ESESTATUS_SUCCESS stops further delivery; the rest of the
+ * chain is still read out so that the link stays in sync.
+ *
+ */
+typedef ESESTATUS (*pphNxpEse_RspSink_t)(void *pContext, const uint8_t *pData,
+        uint32_t len, bool_t last);
+
+/**
+ * \ingroup spi_libese
+ * \brief Command source of phNxpEse_TransceiveFromSource
+ *
+ * Fills pBuff with len bytes of the command, starting at offset. Called
+ * once per I-block, the next block being requested while the card is still
+ * processing the current one. Returning anything other than
+ * ESESTATUS_SUCCESS fails the transceive. When NXP_SELECT_CACHE is enabled,
+ * the start of the command is read once more before it is sent.
+ *
+ */
+typedef ESESTATUS (*pphNxpEse_CmdSource_t)(void *pContext, uint8_t *pBuff,
+        uint32_t offset, uint32_t len);
+
 /*!
  * \brief SEAccess kit MW Android version
  */
@@ -122,6 +208,70 @@ ESESTATUS phNxpEse_openPrioSession(phNxpEse_initParams initParams);
 
 ESESTATUS phNxpEse_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp);
 
+/**
+ * \ingroup spi_libese
+ * \brief This function is phNxpEse_Transceive for a SELECT that has to reach the
+ *        applet even when it is already selected, when NXP_SELECT_CACHE is enabled.
+ *
+ * \param[in]       phNxpEse_data: Command to ESE
+ * \param[out]     phNxpEse_data: Response from ESE (Returned data to be freed after copying)
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEse_TransceiveUncached(phNxpEse_data *pCmd, phNxpEse_data *pRsp);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function sends the C-APDU to ESE and hands the response to pSink
+ *         block by block as it is received, instead of buffering it whole.
+ *         On failure the sink may already have received part of the response.
+ *
+ * \param[in]       phNxpEse_data: Command to ESE
+ * \param[in]       pphNxpEse_RspSink_t: Response sink
+ * \param[in]       void *: Context passed back to the sink
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEse_TransceiveStream(phNxpEse_data *pCmd, pphNxpEse_RspSink_t pSink,
+        void *pContext);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function sends a C-APDU pulled from pSource one I-block at a time,
+ *         so that the command never has to be held in memory as a whole,
+ *         then receives the response from ESE like phNxpEse_Transceive.
+ *
+ * \param[in]       uint32_t: Total length of the command
+ * \param[in]       pphNxpEse_CmdSource_t: Command source
+ * \param[in]       void *: Context passed back to the source
+ * \param[out]     phNxpEse_data: Response from ESE (Returned data to be freed after copying)
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEse_TransceiveFromSource(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pContext, phNxpEse_data *pRsp);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function sends a C-APDU pulled from pSource and hands the response
+ *         to pSink, one I-block at a time in both directions, so that neither
+ *         is held in memory as a whole.
+ *
+ * \param[in]       uint32_t: Total length of the command
+ * \param[in]       pphNxpEse_CmdSource_t: Command source
+ * \param[in]       void *: Context passed back to the source
+ * \param[in]       pphNxpEse_RspSink_t: Response sink
+ * \param[in]       void *: Context passed back to the sink
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phNxpEse_TransceiveSourceStream(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pSrcContext, pphNxpEse_RspSink_t pSink, void *pSinkContext);
+
 /******************************************************************************
  * \ingroup spi_libese
  *
@@ -190,6 +340,45 @@ ESESTATUS phNxpEse_chipReset(void);
 */
 ESESTATUS phNxpEse_setIfsc(uint16_t IFSC_Size);
 
+/**
+ * \ingroup spi_libese
+ * \brief This function turns the per frame debug logs off for bulk transfers
+ * such as an OS update, and back on. Errors are always logged.
+ *
+ * \param[in]       bool_t enable: FALSE to suppress them, TRUE to restore them
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEse_setFrameLog(bool_t enable);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function copies out and optionally clears the link counters
+ *
+ * \param[out]      phNxpEse_Stats_t: counters, may be NULL to only clear them
+ * \param[in]       bool_t reset: TRUE to clear the counters after reading
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEse_getStats(phNxpEse_Stats_t *pStats, bool_t reset);
+
+/**
+ * \ingroup spi_libese
+ * \brief This function tells the power policy what use of the Ese to expect.
+ *        ESE_PWR_HINT_ACTIVE powers the Ese up in the background for
+ *        NXP_ESE_PWR_HINT_HOLD_MS so that the next phNxpEse_open finds it
+ *        ready, ESE_PWR_HINT_IDLE powers it down if no session is open.
+ *        Without effect unless NXP_ESE_PWR_POLICY is set.
+ *
+ * \param[in]       phNxpEse_pwrHint: expected use
+ *
+ * \retval ESESTATUS_SUCCESS Always return ESESTATUS_SUCCESS (0).
+ *
+*/
+ESESTATUS phNxpEse_powerHint(phNxpEse_pwrHint hint);
+
 /**
  * \ingroup spi_libese
  * \brief This function sends the S-frame to indicate END_OF_APDU
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 #include <phNxpEseProto7816_3.h>
+#include <phNxpEse_SelCache.h>
+#include <phNxpEse_FrameCache.h>
 
 /**
  * \addtogroup ISO7816-3_protocol_lib
@@ -26,10 +28,8 @@
  *
  ******************************************************************************/
 static bool_t phNxpEseProto7816_ResetProtoParams(void);
-static bool_t phNxpEseProto7816_SendRawFrame(uint32_t data_len, uint8_t *p_data);
+static bool_t phNxpEseProto7816_SendRawFrame(uint32_t data_len, const uint8_t *p_data);
 static bool_t phNxpEseProto7816_GetRawFrame(uint32_t *data_len, uint8_t **pp_data);
-static uint8_t phNxpEseProto7816_ComputeLRC(unsigned char *p_buff, uint32_t offset,
-        uint32_t length);
 static bool_t phNxpEseProto7816_CheckLRC(uint32_t data_len, uint8_t *p_data);
 static uint8_t getMaxSupportedSendIFrameSize();
 static bool_t phNxpEseProto7816_SendSFrame(sFrameInfo_t sFrameData);
@@ -37,12 +37,21 @@ static bool_t phNxpEseProto7816_SendIframe(iFrameInfo_t iFrameData);
 static  bool_t phNxpEseProto7816_sendRframe(rFrameTypes_t rFrameType);
 static bool_t phNxpEseProto7816_SetFirstIframeContxt(void);
 static bool_t phNxpEseProto7816_SetNextIframeContxt(void);
+static bool_t phNxpEseProto7816_LoadCmdChunk(uint32_t cmdOffset);
+static void phNxpEseProto7816_PrefetchCmdChunk(void);
 static bool_t phNxpEseProro7816_SaveIframeData(uint8_t *p_data, uint32_t data_len);
+static void phNxpEseProto7816_FlushRspSink(void);
 static bool_t phNxpEseProto7816_ResetRecovery(void);
 static bool_t phNxpEseProto7816_RecoverySteps(void);
 static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len);
 static bool_t phNxpEseProto7816_ProcessResponse(void);
 static bool_t TransceiveProcess(void);
+static bool_t phNxpEseProto7816_TransceiveCore(phNxpEse_data *pCmd, phNxpEse_data *pRsp);
+static void phNxpEseProto7816_SetRspSink(pphNxpEse_RspSink_t pSink, void *pContext);
+static bool_t phNxpEseProto7816_SetCmdSource(pphNxpEse_CmdSource_t pSource, void *pContext);
+
+/* 7816_3 protocol stack instance */
+phNxpEseProto7816_t phNxpEseProto7816_3_Var;
 static bool_t phNxpEseProto7816_RSync(void);
 static bool_t phNxpEseProto7816_ResetProtoParams(void);
 
@@ -54,7 +63,7 @@ static bool_t phNxpEseProto7816_ResetProtoParams(void);
  * Returns          On success return TRUE or else FALSE.
  *
  ******************************************************************************/
-static bool_t phNxpEseProto7816_SendRawFrame(uint32_t data_len, uint8_t *p_data)
+static bool_t phNxpEseProto7816_SendRawFrame(uint32_t data_len, const uint8_t *p_data)
 {
     ESESTATUS status = ESESTATUS_FAILED;
     NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
@@ -97,25 +106,16 @@ static bool_t phNxpEseProto7816_GetRawFrame(uint32_t *data_len, uint8_t **pp_dat
 }
 
 /******************************************************************************
- * Function         phNxpEseProto7816_ComputeLRC
+ * Function         phNxpEseT1_WriteFrame
  *
- * Description      This internal function is called compute the LRC
+ * Description      This function is the transport of the shared T=1 blocks
  *
- * Returns          On success return TRUE or else FALSE.
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
  *
  ******************************************************************************/
-static uint8_t phNxpEseProto7816_ComputeLRC(unsigned char *p_buff, uint32_t offset,
-        uint32_t length)
+ESESTATUS phNxpEseT1_WriteFrame(uint32_t data_len, const uint8_t *p_data)
 {
-    uint32_t LRC = 0, i = 0;
-    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
-    for (i = offset; i < length; i++)
-    {
-        LRC = LRC ^ p_buff[i];
-        //NXPLOG_ESELIB_E("%s data 0x%x", __FUNCTION__, p_buff[i]);
-    }
-    NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
-    return (uint8_t) LRC;
+    return phNxpEseProto7816_SendRawFrame(data_len, p_data) ? ESESTATUS_SUCCESS : ESESTATUS_FAILED;
 }
 
 /******************************************************************************
@@ -136,7 +136,7 @@ static bool_t phNxpEseProto7816_CheckLRC(uint32_t data_len, uint8_t *p_data)
     recv_crc = p_data[data_len - 1];
 
     /* calculate the CRC after excluding CRC  */
-    calc_crc = phNxpEseProto7816_ComputeLRC(p_data, 1, (data_len -1));
+    calc_crc = phNxpEseT1_computeLrc(p_data, 1, (data_len -1));
     NXPLOG_ESELIB_D("Received LRC:0x%x Calculated LRC:0x%x", recv_crc, calc_crc);
     if (recv_crc != calc_crc)
     {
@@ -172,10 +172,10 @@ static uint8_t getMaxSupportedSendIFrameSize()
  ******************************************************************************/
 static bool_t phNxpEseProto7816_SendSFrame(sFrameInfo_t sFrameData)
 {
-    bool_t status = ESESTATUS_FAILED;
-    uint32_t frame_len = 0;
-    uint8_t *p_framebuff = NULL;
+    bool_t status = FALSE;
     uint8_t pcb_byte = 0;
+    uint8_t inf = 0x01;
+    uint32_t inf_len = 0;
     NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
     sFrameInfo_t sframeData = sFrameData;
     /* This update is helpful in-case a R-NACK is transmitted from the MW */
@@ -183,76 +183,28 @@ static bool_t phNxpEseProto7816_SendSFrame(sFrameInfo_t sFrameData)
     switch(sframeData.sFrameType)
     {
         case RESYNCH_REQ:
-            frame_len = (PH_PROTO_7816_HEADER_LEN + PH_PROTO_7816_CRC_LEN);
-            p_framebuff = phNxpEse_memalloc(frame_len * sizeof(uint8_t));
-            if (NULL == p_framebuff)
-            {
-                return FALSE;
-            }
-            p_framebuff[2] = 0;
-            p_framebuff[3] = 0x00;
-
-            pcb_byte |= PH_PROTO_7816_S_BLOCK_REQ; /* PCB */
-            pcb_byte |= PH_PROTO_7816_S_RESYNCH;
+            pcb_byte = PH_PROTO_7816_S_BLOCK_REQ | PH_PROTO_7816_S_RESYNCH;
             break;
         case INTF_RESET_REQ:
-            frame_len = (PH_PROTO_7816_HEADER_LEN + PH_PROTO_7816_CRC_LEN);
-            p_framebuff = phNxpEse_memalloc(frame_len * sizeof(uint8_t));
-            if (NULL == p_framebuff)
-            {
-                return FALSE;
-            }
-            p_framebuff[2] = 0;
-            p_framebuff[3] = 0x00;
-
-            pcb_byte |= PH_PROTO_7816_S_BLOCK_REQ; /* PCB */
-            pcb_byte |= PH_PROTO_7816_S_RESET;
+            /* the applets selected on the logical channels are deselected */
+            phNxpEse_SelCache_invalidate();
+            pcb_byte = PH_PROTO_7816_S_BLOCK_REQ | PH_PROTO_7816_S_RESET;
             break;
         case PROP_END_APDU_REQ:
-            frame_len = (PH_PROTO_7816_HEADER_LEN + PH_PROTO_7816_CRC_LEN);
-            p_framebuff = phNxpEse_memalloc(frame_len * sizeof(uint8_t));
-            if (NULL == p_framebuff)
-            {
-                return FALSE;
-            }
-            p_framebuff[2] = 0;
-            p_framebuff[3] = 0x00;
-
-            pcb_byte |= PH_PROTO_7816_S_BLOCK_REQ; /* PCB */
-            pcb_byte |= PH_PROTO_7816_S_END_OF_APDU;
+            pcb_byte = PH_PROTO_7816_S_BLOCK_REQ | PH_PROTO_7816_S_END_OF_APDU;
             break;
         case WTX_RSP:
-            frame_len = (PH_PROTO_7816_HEADER_LEN + 1 + PH_PROTO_7816_CRC_LEN);
-            p_framebuff = phNxpEse_memalloc(frame_len * sizeof(uint8_t));
-            if (NULL == p_framebuff)
-            {
-                return FALSE;
-            }
-            p_framebuff[2] = 0x01;
-            p_framebuff[3] = 0x01;
-
-            pcb_byte |= PH_PROTO_7816_S_BLOCK_RSP;
-            pcb_byte |= PH_PROTO_7816_S_WTX;
+            pcb_byte = PH_PROTO_7816_S_BLOCK_RSP | PH_PROTO_7816_S_WTX;
+            inf_len = 1;
             break;
         default:
             NXPLOG_ESELIB_E("Invalid S-block");
             break;
     }
-    if(NULL != p_framebuff)
+    if(0 != pcb_byte)
     {
-        /* frame the packet */
-        p_framebuff[0] = 0x00; /* NAD Byte */
-        p_framebuff[1] = pcb_byte; /* PCB */
-
-        p_framebuff[frame_len - 1] = phNxpEseProto7816_ComputeLRC(p_framebuff, 0,
-                (frame_len - 1));
-        NXPLOG_ESELIB_D("S-Frame PCB: %x\n", p_framebuff[1]);
-        status = phNxpEseProto7816_SendRawFrame(frame_len, p_framebuff);
-        phNxpEse_free(p_framebuff);
-    }
-    else
-    {
-        NXPLOG_ESELIB_E("Invalid S-block or malloc for s-block failed");
+        NXPLOG_ESELIB_D("S-Frame PCB: %x\n", pcb_byte);
+        status = (ESESTATUS_SUCCESS == phNxpEseT1_sendBlock(pcb_byte, &inf, inf_len)) ? TRUE : FALSE;
     }
     NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
     return status;
@@ -270,20 +222,20 @@ static bool_t phNxpEseProto7816_SendSFrame(sFrameInfo_t sFrameData)
 static  bool_t phNxpEseProto7816_sendRframe(rFrameTypes_t rFrameType)
 {
     bool_t status = FALSE;
-    uint8_t recv_ack[4]= {0x00,0x80,0x00,0x00};
+    uint8_t error = PH_T1_R_ACK;
+    uint8_t pcb_byte;
     if(RNACK == rFrameType) /* R-NACK */
     {
-        recv_ack[1] = 0x82;
+        error = PH_T1_R_OTHER_ERROR;
     }
     else /* R-ACK*/
     {
         /* This update is helpful in-case a R-NACK is transmitted from the MW */
         phNxpEseProto7816_3_Var.lastSentNonErrorframeType = RFRAME;
     }
-    recv_ack[1] |=((phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo^1) << 4);
-    NXPLOG_ESELIB_D("%s recv_ack[1]:0x%x", __FUNCTION__, recv_ack[1]);
-    recv_ack[3] = phNxpEseProto7816_ComputeLRC(recv_ack, 0x00, (sizeof(recv_ack) -1));
-    status = phNxpEseProto7816_SendRawFrame(sizeof(recv_ack), recv_ack);
+    pcb_byte = PH_T1_PCB_R(phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo^1, error);
+    NXPLOG_ESELIB_D("%s pcb:0x%x", __FUNCTION__, pcb_byte);
+    status = (ESESTATUS_SUCCESS == phNxpEseT1_sendBlock(pcb_byte, NULL, 0)) ? TRUE : FALSE;
     return status;
 }
 
@@ -312,38 +264,28 @@ static bool_t phNxpEseProto7816_SendIframe(iFrameInfo_t iFrameData)
     phNxpEseProto7816_3_Var.lastSentNonErrorframeType = IFRAME;
     frame_len = (iFrameData.sendDataLen+ PH_PROTO_7816_HEADER_LEN + PH_PROTO_7816_CRC_LEN);
 
-    p_framebuff = phNxpEse_memalloc(frame_len * sizeof(uint8_t));
-    if (NULL == p_framebuff)
+    if (iFrameData.sendDataLen > PH_T1_MAX_INF_LEN)
     {
-        NXPLOG_ESELIB_E("Heap allocation failed");
+        NXPLOG_ESELIB_E("I frame Len %d too large", iFrameData.sendDataLen);
         return FALSE;
     }
-
-    /* frame the packet */
-    p_framebuff[0] = 0x00; /* NAD Byte */
-
-    if (iFrameData.isChained)
+    if (FALSE == iFrameData.isChained)
     {
-        /* make B6 (M) bit high */
-        pcb_byte |= PH_PROTO_7816_CHAINING;
+        /* A short command sent before goes out of its cached block */
+        p_framebuff = phNxpEse_FrameCache_getIframe(iFrameData.p_data + iFrameData.dataOffset,
+                iFrameData.sendDataLen, phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.seqNo);
+        if (NULL != p_framebuff)
+        {
+            status = phNxpEseProto7816_SendRawFrame(frame_len, p_framebuff);
+            NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
+            return status;
+        }
     }
-
-    /* Update the send seq no */
-    pcb_byte |= (phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.seqNo << 6);
-
-    /* store the pcb byte */
-    p_framebuff[1] = pcb_byte;
-    /* store I frame length */
-    p_framebuff[2] = iFrameData.sendDataLen;
-    /* store I frame */
-    phNxpEse_memcpy(&(p_framebuff[3]), iFrameData.p_data + iFrameData.dataOffset, iFrameData.sendDataLen);
-
-    p_framebuff[frame_len - 1] = phNxpEseProto7816_ComputeLRC(p_framebuff, 0,
-            (frame_len - 1));
-
-    status = phNxpEseProto7816_SendRawFrame(frame_len, p_framebuff);
-
-    phNxpEse_free(p_framebuff);
+    /* send seq no and B6 (M) bit */
+    pcb_byte = PH_T1_PCB_I(phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.seqNo,
+            iFrameData.isChained);
+    status = (ESESTATUS_SUCCESS == phNxpEseT1_sendBlock(pcb_byte,
+            iFrameData.p_data + iFrameData.dataOffset, iFrameData.sendDataLen)) ? TRUE : FALSE;
     NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
     return status;
 }
@@ -378,6 +320,8 @@ static bool_t phNxpEseProto7816_SetFirstIframeContxt(void)
     }
     NXPLOG_ESELIB_D("I-Frame Data Len: %d Seq. no:%d", phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.sendDataLen, phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.seqNo);
     NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
+    if (NULL != phNxpEseProto7816_3_Var.cmdSource.pSource)
+        return phNxpEseProto7816_LoadCmdChunk(0);
     return TRUE;
 }
 
@@ -420,9 +364,78 @@ static bool_t phNxpEseProto7816_SetNextIframeContxt(void)
     }
     NXPLOG_ESELIB_D("I-Frame Data Len: %d", phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.sendDataLen);
     NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
+    if (NULL != phNxpEseProto7816_3_Var.cmdSource.pSource)
+        return phNxpEseProto7816_LoadCmdChunk(phNxpEseProto7816_3_Var.cmdSource.cmdOffset +
+                phNxpEseProto7816_3_Var.phNxpEseLastTx_Cntx.IframeInfo.sendDataLen);
     return TRUE;
 }
 
+/******************************************************************************
+ * Function         phNxpEseProto7816_LoadCmdChunk
+ *
+ * Description      This internal function points the next I-frame at the
+ *                  command data at cmdOffset, pulling it from the command
+ *                  source unless it has been prefetched already
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+static bool_t phNxpEseProto7816_LoadCmdChunk(uint32_t cmdOffset)
+{
+    phNxpEseProto7816_CmdSource_t *pCmdSource = &phNxpEseProto7816_3_Var.cmdSource;
+    iFrameInfo_t *pIframeInfo = &phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo;
+    uint8_t next = pCmdSource->active ^ 1;
+
+    if (((FALSE == pCmdSource->isPrefetched) || (pCmdSource->prefetchOffset != cmdOffset)) &&
+            (ESESTATUS_SUCCESS == pCmdSource->srcStatus))
+    {
+        pCmdSource->srcStatus = pCmdSource->pSource(pCmdSource->pContext, pCmdSource->chunk[next],
+                cmdOffset, pIframeInfo->sendDataLen);
+    }
+    pCmdSource->isPrefetched = FALSE;
+    if (ESESTATUS_SUCCESS != pCmdSource->srcStatus)
+    {
+        NXPLOG_ESELIB_E("%s - source failed 0x%x at offset %d", __FUNCTION__,
+                pCmdSource->srcStatus, cmdOffset);
+        phNxpEseProto7816_3_Var.phNxpEseProto7816_nextTransceiveState = IDLE_STATE;
+        return FALSE;
+    }
+    pCmdSource->active = next;
+    pCmdSource->cmdOffset = cmdOffset;
+    pIframeInfo->p_data = pCmdSource->chunk[next];
+    pIframeInfo->dataOffset = 0;
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_PrefetchCmdChunk
+ *
+ * Description      This internal function pulls the I-frame following the
+ *                  chained I-frame just sent into the free buffer, while the
+ *                  card processes the one sent
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEseProto7816_PrefetchCmdChunk(void)
+{
+    phNxpEseProto7816_CmdSource_t *pCmdSource = &phNxpEseProto7816_3_Var.cmdSource;
+    iFrameInfo_t *pIframeInfo = &phNxpEseProto7816_3_Var.phNxpEseLastTx_Cntx.IframeInfo;
+    uint32_t len;
+
+    if ((NULL == pCmdSource->pSource) || (TRUE == pCmdSource->isPrefetched) ||
+            (ESESTATUS_SUCCESS != pCmdSource->srcStatus) ||
+            (IFRAME != phNxpEseProto7816_3_Var.phNxpEseLastTx_Cntx.FrameType) ||
+            (FALSE == pIframeInfo->isChained))
+        return;
+    len = (pIframeInfo->totalDataLen > pIframeInfo->maxDataLen) ?
+            pIframeInfo->maxDataLen : pIframeInfo->totalDataLen;
+    pCmdSource->prefetchOffset = pCmdSource->cmdOffset + pIframeInfo->sendDataLen;
+    pCmdSource->srcStatus = pCmdSource->pSource(pCmdSource->pContext,
+            pCmdSource->chunk[pCmdSource->active ^ 1], pCmdSource->prefetchOffset, len);
+    pCmdSource->isPrefetched = TRUE;
+}
+
 /******************************************************************************
  * Function         phNxpEseProto7816_ResetRecovery
  *
@@ -436,7 +449,17 @@ static bool_t phNxpEseProro7816_SaveIframeData(uint8_t *p_data, uint32_t data_le
     bool_t status = FALSE;
     NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
     NXPLOG_ESELIB_D("Data[0]=0x%x len=%d Data[%d]=0x%x", p_data[0], data_len, data_len-1, p_data[data_len-1]);
-    if (ESESTATUS_SUCCESS != phNxpEse_StoreDatainList(data_len, p_data))
+    if (NULL != phNxpEseProto7816_3_Var.rspSink.pSink)
+    {
+        /* Delivered by TransceiveProcess once the block is acknowledged */
+        phNxpEseProto7816_3_Var.rspSink.pPendingData = p_data;
+        phNxpEseProto7816_3_Var.rspSink.pendingLen = data_len;
+        phNxpEseProto7816_3_Var.rspSink.isPendingLast =
+                !phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.isChained;
+        phNxpEseProto7816_3_Var.rspSink.isPending = TRUE;
+        status = TRUE;
+    }
+    else if (ESESTATUS_SUCCESS != phNxpEseT1_storeRxData(data_len, p_data))
     {
         NXPLOG_ESELIB_E("%s - Error storing chained data in list", __FUNCTION__);
     }
@@ -448,6 +471,37 @@ static bool_t phNxpEseProro7816_SaveIframeData(uint8_t *p_data, uint32_t data_le
     return status;
 }
 
+/******************************************************************************
+ * Function         phNxpEseProto7816_FlushRspSink
+ *
+ * Description      This internal function hands the pending I-block payload to
+ *                  the response sink. After the sink has failed the payload is
+ *                  dropped, so that the remaining chain is only drained.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEseProto7816_FlushRspSink(void)
+{
+    phNxpEseProto7816_RspSink_t *pRspSink = &phNxpEseProto7816_3_Var.rspSink;
+
+    if ((NULL == pRspSink->pSink) || (FALSE == pRspSink->isPending))
+        return;
+    pRspSink->isPending = FALSE;
+    if (ESESTATUS_SUCCESS == pRspSink->sinkStatus)
+    {
+        pRspSink->sinkStatus = pRspSink->pSink(pRspSink->pContext, pRspSink->pPendingData,
+                pRspSink->pendingLen, pRspSink->isPendingLast);
+        if (ESESTATUS_SUCCESS != pRspSink->sinkStatus)
+        {
+            NXPLOG_ESELIB_E("%s - sink failed 0x%x, draining the response", __FUNCTION__,
+                    pRspSink->sinkStatus);
+        }
+    }
+    if (pRspSink->isPendingLast)
+        pRspSink->isComplete = TRUE;
+}
+
 /******************************************************************************
  * Function         phNxpEseProto7816_ResetRecovery
  *
@@ -573,28 +627,23 @@ static void phNxpEseProto7816_DecodeSFrameData(uint8_t *p_data)
 static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
 {
     bool_t status = TRUE;
-    uint8_t pcb;
-    phNxpEseProto7816_PCB_bits_t pcb_bits;
+    phNxpEseT1_Pcb_t pcb;
     NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
     NXPLOG_ESELIB_D("Retry Counter = %d\n", phNxpEseProto7816_3_Var.recoveryCounter);
-    pcb = p_data[PH_PROPTO_7816_PCB_OFFSET];
-    //memset(&phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.rcvPcbBits, 0x00, sizeof(struct PCB_BITS));
-    phNxpEse_memset(&pcb_bits, 0x00, sizeof(phNxpEseProto7816_PCB_bits_t));
-    phNxpEse_memcpy(&pcb_bits, &pcb, sizeof(uint8_t));
+    phNxpEseT1_decodePcb(p_data[PH_PROPTO_7816_PCB_OFFSET], &pcb);
 
-    if (0x00 == pcb_bits.msb) /* I-FRAME decoded should come here */
+    if (PH_T1_I_BLOCK == pcb.type) /* I-FRAME decoded should come here */
     {
         NXPLOG_ESELIB_D("%s I-Frame Received", __FUNCTION__);
         phNxpEseProto7816_3_Var.wtx_counter = 0;
         phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdFrameType = IFRAME ;
-        if (phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo != pcb_bits.bit7)       //   != pcb_bits->bit7)
+        if (phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo != pcb.seqNo)
         {
-            NXPLOG_ESELIB_D("%s I-Frame lastRcvdIframeInfo.seqNo:0x%x", __FUNCTION__, pcb_bits.bit7);
+            NXPLOG_ESELIB_D("%s I-Frame lastRcvdIframeInfo.seqNo:0x%x", __FUNCTION__, pcb.seqNo);
             phNxpEseProto7816_ResetRecovery();
-            phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo = 0x00;
-            phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo |= pcb_bits.bit7;
+            phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.seqNo = pcb.seqNo;
 
-            if (pcb_bits.bit6)
+            if (pcb.more)
             {
                 phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdIframeInfo.isChained = TRUE;
                 phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.FrameType = RFRAME;
@@ -626,15 +675,14 @@ static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
             }
         }
     }
-    else if ((0x01 == pcb_bits.msb) && (0x00 == pcb_bits.bit7)) /* R-FRAME decoded should come here */
+    else if (PH_T1_R_BLOCK == pcb.type) /* R-FRAME decoded should come here */
     {
         NXPLOG_ESELIB_D("%s R-Frame Received", __FUNCTION__);
         phNxpEseProto7816_3_Var.wtx_counter = 0;
         phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdFrameType = RFRAME;
-        phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.seqNo = 0; // = 0;
-        phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.seqNo |= pcb_bits.bit5;
+        phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.seqNo = pcb.seqNo;
 
-        if ((pcb_bits.lsb == 0x00) && (pcb_bits.bit2 == 0x00))
+        if (PH_T1_R_ACK == pcb.code)
         {
             phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.errCode = NO_ERROR;
             phNxpEseProto7816_ResetRecovery();
@@ -642,19 +690,22 @@ static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
                     phNxpEseProto7816_3_Var.phNxpEseLastTx_Cntx.IframeInfo.seqNo)
             {
                 status = phNxpEseProto7816_SetNextIframeContxt();
-                phNxpEseProto7816_3_Var.phNxpEseProto7816_nextTransceiveState = SEND_IFRAME;
+                if (TRUE == status)
+                {
+                    phNxpEseProto7816_3_Var.phNxpEseProto7816_nextTransceiveState = SEND_IFRAME;
+                }
             }
             else
             {
                 //error handling.
             }
         } /* Error handling 1 : Parity error */
-        else if (((pcb_bits.lsb == 0x01) && (pcb_bits.bit2 == 0x00)) ||
+        else if ((PH_T1_R_PARITY_ERROR == pcb.code) ||
             /* Error handling 2: Other indicated error */
-            ((pcb_bits.lsb == 0x00) && (pcb_bits.bit2 == 0x01)))
+            (PH_T1_R_OTHER_ERROR == pcb.code))
         {
             phNxpEse_Sleep(DELAY_ERROR_RECOVERY);
-            if((pcb_bits.lsb == 0x00) && (pcb_bits.bit2 == 0x01))
+            if(PH_T1_R_OTHER_ERROR == pcb.code)
                 phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.errCode = OTHER_ERROR;
             else
                 phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.errCode = PARITY_ERROR;
@@ -720,8 +771,7 @@ static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
             }
             //resend previously send I frame
         }
-        /* Error handling 3 */
-        else if ((pcb_bits.lsb == 0x01) && (pcb_bits.bit2 == 0x01))
+        else /* Error handling 3: both bits set */
         {
             phNxpEse_Sleep(DELAY_ERROR_RECOVERY);
             if(phNxpEseProto7816_3_Var.recoveryCounter < PH_PROTO_7816_FRAME_RETRY_COUNT)
@@ -736,25 +786,11 @@ static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
                 phNxpEseProto7816_3_Var.recoveryCounter++;
             }
         }
-        else /* Error handling 4 */
-        {
-            phNxpEse_Sleep(DELAY_ERROR_RECOVERY);
-            if(phNxpEseProto7816_3_Var.recoveryCounter < PH_PROTO_7816_FRAME_RETRY_COUNT)
-            {
-                phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdRframeInfo.errCode = UNDEFINED_ERROR;
-                phNxpEseProto7816_3_Var.recoveryCounter++;
-            }
-            else
-            {
-                phNxpEseProto7816_RecoverySteps();
-                phNxpEseProto7816_3_Var.recoveryCounter++;
-            }
-        }
     }
-    else if ((0x01 == pcb_bits.msb) && (0x01 == pcb_bits.bit7)) /* S-FRAME decoded should come here */
+    else /* S-FRAME decoded should come here */
     {
         NXPLOG_ESELIB_D("%s S-Frame Received", __FUNCTION__);
-        int32_t frameType = (int32_t)(pcb & 0x3F); /*discard upper 2 bits */
+        int32_t frameType = (int32_t)pcb.code;
         phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdFrameType = SFRAME;
         if(frameType!=WTX_REQ)
         {
@@ -855,10 +891,6 @@ static bool_t phNxpEseProto7816_DecodeFrame(uint8_t *p_data, uint32_t data_len)
                 break;
         }
     }
-    else
-    {
-        NXPLOG_ESELIB_E("%s Wrong-Frame Received", __FUNCTION__);
-    }
     NXPLOG_ESELIB_D("Exit %s ", __FUNCTION__);
     return status;
 }
@@ -1016,6 +1048,9 @@ static bool_t TransceiveProcess(void)
             phNxpEse_memcpy(&phNxpEseProto7816_3_Var.phNxpEseLastTx_Cntx,
                 &phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx,
                     sizeof(phNxpEseProto7816_NextTx_Info_t));
+            /* The block just acknowledged is still in the read buffer */
+            phNxpEseProto7816_FlushRspSink();
+            phNxpEseProto7816_PrefetchCmdChunk();
             status = phNxpEseProto7816_ProcessResponse();
         }
         else
@@ -1024,31 +1059,27 @@ static bool_t TransceiveProcess(void)
             phNxpEseProto7816_3_Var.phNxpEseProto7816_nextTransceiveState = IDLE_STATE;
         }
     };
+    /* The last block of a response is not acknowledged by a frame of its own */
+    phNxpEseProto7816_FlushRspSink();
     NXPLOG_ESELIB_D("Exit %s Status 0x%x", __FUNCTION__, status);
     return status;
 }
 
 /******************************************************************************
- * Function         phNxpEseProto7816_Transceive
+ * Function         phNxpEseProto7816_TransceiveCore
  *
- * Description      This function is used to
- *                  1. Send the raw data received from application after computing LRC
- *                  2. Receive the the response data from ESE, decode, process and
- *                     store the data.
- *                  3. Get the final complete data and sent back to application
+ * Description      This internal function runs one transceive with the command
+ *                  source and response sink set up by the caller, if any. The
+ *                  response is returned in pRsp unless a sink is set.
  *
  * Returns          On success return TRUE or else FALSE.
  *
  ******************************************************************************/
-bool_t phNxpEseProto7816_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
+static bool_t phNxpEseProto7816_TransceiveCore(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
 {
     bool_t status = FALSE;
     ESESTATUS wStatus = ESESTATUS_FAILED;
     phNxpEse_data pRes;
-    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
-    if((NULL == pCmd) || (NULL == pRsp) ||
-            (phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState != PH_NXP_ESE_PROTO_7816_IDLE))
-        return status;
     phNxpEse_memset(&pRes, 0x00, sizeof(phNxpEse_data));
     /* Updating the transceive information to the protocol stack */
     phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState = PH_NXP_ESE_PROTO_7816_TRANSCEIVE;
@@ -1062,10 +1093,24 @@ bool_t phNxpEseProto7816_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
         /* ESE hard reset to be done */
         NXPLOG_ESELIB_E("Transceive failed, hard reset to proceed");
     }
+    else if(ESESTATUS_SUCCESS != phNxpEseProto7816_3_Var.cmdSource.srcStatus)
+    {
+        NXPLOG_ESELIB_E("%s Command not sent completely", __FUNCTION__);
+        status = FALSE;
+    }
+    else if(NULL != phNxpEseProto7816_3_Var.rspSink.pSink)
+    {
+        if((FALSE == phNxpEseProto7816_3_Var.rspSink.isComplete) ||
+                (ESESTATUS_SUCCESS != phNxpEseProto7816_3_Var.rspSink.sinkStatus))
+        {
+            NXPLOG_ESELIB_E("%s Response not delivered completely", __FUNCTION__);
+            status = FALSE;
+        }
+    }
     else
     {
         //fetch the data info and report to upper layer.
-        wStatus = phNxpEse_GetData(&pRes.len, &pRes.p_data);
+        wStatus = phNxpEseT1_getRxData(&pRes.len, &pRes.p_data);
         if (ESESTATUS_SUCCESS == wStatus)
         {
             NXPLOG_ESELIB_D("%s Data successfully received at 7816, packaging to send upper layers: DataLen = %d", __FUNCTION__, pRes.len);
@@ -1077,6 +1122,172 @@ bool_t phNxpEseProto7816_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
             status = FALSE;
     }
     phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState = PH_NXP_ESE_PROTO_7816_IDLE;
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_SetRspSink
+ *
+ * Description      This internal function sets up the streaming receive
+ *                  context, a NULL sink clears it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEseProto7816_SetRspSink(pphNxpEse_RspSink_t pSink, void *pContext)
+{
+    phNxpEse_memset(&phNxpEseProto7816_3_Var.rspSink, 0x00, sizeof(phNxpEseProto7816_RspSink_t));
+    phNxpEseProto7816_3_Var.rspSink.pSink = pSink;
+    phNxpEseProto7816_3_Var.rspSink.pContext = pContext;
+    phNxpEseProto7816_3_Var.rspSink.sinkStatus = ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_SetCmdSource
+ *
+ * Description      This internal function sets up the command source
+ *                  context, a NULL source clears it
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+static bool_t phNxpEseProto7816_SetCmdSource(pphNxpEse_CmdSource_t pSource, void *pContext)
+{
+    phNxpEseProto7816_CmdSource_t *pCmdSource = &phNxpEseProto7816_3_Var.cmdSource;
+
+    pCmdSource->pSource = pSource;
+    pCmdSource->pContext = pContext;
+    pCmdSource->active = 0;
+    pCmdSource->cmdOffset = 0;
+    pCmdSource->isPrefetched = FALSE;
+    pCmdSource->prefetchOffset = 0;
+    pCmdSource->srcStatus = ESESTATUS_SUCCESS;
+    if ((NULL != pSource) &&
+            (phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.maxDataLen > PH_PROTO_7816_MAX_INF_LEN))
+    {
+        NXPLOG_ESELIB_E("%s IFSC %d too large", __FUNCTION__,
+                phNxpEseProto7816_3_Var.phNxpEseNextTx_Cntx.IframeInfo.maxDataLen);
+        pCmdSource->pSource = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_Transceive
+ *
+ * Description      This function is used to
+ *                  1. Send the raw data received from application after computing LRC
+ *                  2. Receive the the response data from ESE, decode, process and
+ *                     store the data.
+ *                  3. Get the final complete data and sent back to application
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+bool_t phNxpEseProto7816_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
+{
+    bool_t status = FALSE;
+    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
+    if((NULL == pCmd) || (NULL == pRsp) ||
+            (phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState != PH_NXP_ESE_PROTO_7816_IDLE))
+        return status;
+    status = phNxpEseProto7816_TransceiveCore(pCmd, pRsp);
+    NXPLOG_ESELIB_D("Exit %s Status 0x%x", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_TransceiveStream
+ *
+ * Description      This function is used to
+ *                  1. Send the raw data received from application after computing LRC
+ *                  2. Receive the response data from ESE, decode and process it
+ *                  3. Hand each I-block payload to the sink once it is acknowledged,
+ *                     without storing the response in the data list
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+bool_t phNxpEseProto7816_TransceiveStream(phNxpEse_data *pCmd, pphNxpEse_RspSink_t pSink,
+        void *pContext)
+{
+    bool_t status = FALSE;
+    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
+    if((NULL == pCmd) || (NULL == pSink) ||
+            (phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState != PH_NXP_ESE_PROTO_7816_IDLE))
+        return status;
+    phNxpEseProto7816_SetRspSink(pSink, pContext);
+    status = phNxpEseProto7816_TransceiveCore(pCmd, NULL);
+    phNxpEseProto7816_SetRspSink(NULL, NULL);
+    NXPLOG_ESELIB_D("Exit %s Status 0x%x", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_TransceiveFromSource
+ *
+ * Description      This function is used to
+ *                  1. Pull the command from the source one I-block at a time and
+ *                     send it after computing LRC
+ *                  2. Receive the the response data from ESE, decode, process and
+ *                     store the data.
+ *                  3. Get the final complete data and sent back to application
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+bool_t phNxpEseProto7816_TransceiveFromSource(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pContext, phNxpEse_data *pRsp)
+{
+    bool_t status = FALSE;
+    phNxpEse_data cmd;
+    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
+    if((NULL == pSource) || (NULL == pRsp) || (0 == cmdLen) ||
+            (phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState != PH_NXP_ESE_PROTO_7816_IDLE))
+        return status;
+    if (TRUE == phNxpEseProto7816_SetCmdSource(pSource, pContext))
+    {
+        /* The I-frames are pointed at the chunks as they are pulled */
+        cmd.len = cmdLen;
+        cmd.p_data = NULL;
+        status = phNxpEseProto7816_TransceiveCore(&cmd, pRsp);
+    }
+    phNxpEseProto7816_SetCmdSource(NULL, NULL);
+    NXPLOG_ESELIB_D("Exit %s Status 0x%x", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEseProto7816_TransceiveSourceStream
+ *
+ * Description      This function is used to
+ *                  1. Pull the command from the source one I-block at a time and
+ *                     send it after computing LRC
+ *                  2. Receive the response data from ESE, decode and process it
+ *                  3. Hand each I-block payload to the sink once it is acknowledged
+ *
+ * Returns          On success return TRUE or else FALSE.
+ *
+ ******************************************************************************/
+bool_t phNxpEseProto7816_TransceiveSourceStream(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pSrcContext, pphNxpEse_RspSink_t pSink, void *pSinkContext)
+{
+    bool_t status = FALSE;
+    phNxpEse_data cmd;
+    NXPLOG_ESELIB_D("Enter %s ", __FUNCTION__);
+    if((NULL == pSource) || (NULL == pSink) || (0 == cmdLen) ||
+            (phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState != PH_NXP_ESE_PROTO_7816_IDLE))
+        return status;
+    if (TRUE == phNxpEseProto7816_SetCmdSource(pSource, pSrcContext))
+    {
+        phNxpEseProto7816_SetRspSink(pSink, pSinkContext);
+        cmd.len = cmdLen;
+        cmd.p_data = NULL;
+        status = phNxpEseProto7816_TransceiveCore(&cmd, NULL);
+        phNxpEseProto7816_SetRspSink(NULL, NULL);
+    }
+    phNxpEseProto7816_SetCmdSource(NULL, NULL);
     NXPLOG_ESELIB_D("Exit %s Status 0x%x", __FUNCTION__, status);
     return status;
 }
@@ -1114,11 +1325,18 @@ static bool_t phNxpEseProto7816_ResetProtoParams(void)
 {
     unsigned long int tmpWTXCountlimit = PH_PROTO_7816_VALUE_ZERO;
     unsigned long int tmpRNACKCountlimit = PH_PROTO_7816_VALUE_ZERO;
+    phNxpEseProto7816_RspSink_t tmpRspSink;
+    phNxpEseProto7816_CmdSource_t tmpCmdSource;
     tmpWTXCountlimit = phNxpEseProto7816_3_Var.wtx_counter_limit;
     tmpRNACKCountlimit = phNxpEseProto7816_3_Var.rnack_retry_limit;
+    /* An interface reset during a streamed transceive must not drop the sink or the source */
+    phNxpEse_memcpy(&tmpRspSink, &phNxpEseProto7816_3_Var.rspSink, sizeof(phNxpEseProto7816_RspSink_t));
+    phNxpEse_memcpy(&tmpCmdSource, &phNxpEseProto7816_3_Var.cmdSource, sizeof(phNxpEseProto7816_CmdSource_t));
     phNxpEse_memset(&phNxpEseProto7816_3_Var, PH_PROTO_7816_VALUE_ZERO, sizeof(phNxpEseProto7816_t));
     phNxpEseProto7816_3_Var.wtx_counter_limit = tmpWTXCountlimit;
     phNxpEseProto7816_3_Var.rnack_retry_limit = tmpRNACKCountlimit;
+    phNxpEse_memcpy(&phNxpEseProto7816_3_Var.rspSink, &tmpRspSink, sizeof(phNxpEseProto7816_RspSink_t));
+    phNxpEse_memcpy(&phNxpEseProto7816_3_Var.cmdSource, &tmpCmdSource, sizeof(phNxpEseProto7816_CmdSource_t));
     phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState = PH_NXP_ESE_PROTO_7816_IDLE;
     phNxpEseProto7816_3_Var.phNxpEseProto7816_nextTransceiveState = IDLE_STATE;
     phNxpEseProto7816_3_Var.phNxpEseRx_Cntx.lastRcvdFrameType = INVALID;
@@ -1219,6 +1437,8 @@ bool_t phNxpEseProto7816_Close(phNxpEseProto7816SecureTimer_t *pSecureTimerParam
         /* reset all the structures */
         NXPLOG_ESELIB_E("%s TransceiveProcess failed ", __FUNCTION__);
     }
+    /* a response left partly received is not read any more */
+    phNxpEseT1_resetRxData();
     phNxpEse_memcpy(pSecureTimerParams, &phNxpEseProto7816_3_Var.secureTimerParams, sizeof(phNxpEseProto7816SecureTimer_t));
     phNxpEseProto7816_3_Var.phNxpEseProto7816_CurrentState = PH_NXP_ESE_PROTO_7816_IDLE;
     return status;
@@ -17,7 +17,7 @@
 #define _PHNXPESEPROTO7816_3_H_
 #include <phNxpEse_Internal.h>
 #include <phNxpLog.h>
-#include <phNxpEseDataMgr.h>
+#include <phNxpEseT1.h>
 #include <phNxpConfig.h>
 #include <NXP_ESE_FEATURES.h>
 
@@ -30,6 +30,11 @@
 
 /********************* Definitions and structures *****************************/
 
+/*!
+ * \brief Max. length of the information field of a frame, LEN is one byte
+ */
+#define PH_PROTO_7816_MAX_INF_LEN  0xFF
+
 /*!
  * \brief S-Frame types used in 7816-3 protocol stack
  */
@@ -203,6 +208,47 @@ typedef struct phNxpEseProto7816SecureTimer
   unsigned int secureTimer3;
 }phNxpEseProto7816SecureTimer_t;
 
+/*!
+ * \brief 7816-3 protocol stack streaming receive context
+ *
+ * Set for the duration of phNxpEseProto7816_TransceiveStream. A received
+ * I-block payload is parked here, still in the read buffer, until the
+ * frame acknowledging it has been sent.
+ *
+ */
+typedef struct phNxpEseProto7816_RspSink
+{
+  pphNxpEse_RspSink_t pSink; /*!< Response sink, NULL when not streaming */
+  void *pContext; /*!< Context passed back to the sink */
+  uint8_t *pPendingData; /*!< Payload of the last I-block, not yet delivered */
+  uint32_t pendingLen; /*!< Length of the pending payload */
+  bool_t isPending; /*!< A payload is waiting to be delivered */
+  bool_t isPendingLast; /*!< The pending payload ends the response */
+  bool_t isComplete; /*!< The last block of the response has been delivered */
+  ESESTATUS sinkStatus; /*!< First error returned by the sink */
+}phNxpEseProto7816_RspSink_t;
+
+/*!
+ * \brief 7816-3 protocol stack command source context
+ *
+ * Set for the duration of phNxpEseProto7816_TransceiveFromSource. The
+ * command is pulled into two I-block buffers in turn: one holds the
+ * I-block in flight, kept for retransmission, the other is filled with the
+ * next block while the card processes the current one.
+ *
+ */
+typedef struct phNxpEseProto7816_CmdSource
+{
+  pphNxpEse_CmdSource_t pSource; /*!< Command source, NULL when not pulling */
+  void *pContext; /*!< Context passed back to the source */
+  uint8_t chunk[2][PH_PROTO_7816_MAX_INF_LEN]; /*!< I-block data buffers */
+  uint8_t active; /*!< Buffer of the I-block in flight */
+  uint32_t cmdOffset; /*!< Command offset of the I-block in flight */
+  bool_t isPrefetched; /*!< The other buffer holds the next I-block */
+  uint32_t prefetchOffset; /*!< Command offset of the prefetched I-block */
+  ESESTATUS srcStatus; /*!< First error returned by the source */
+}phNxpEseProto7816_CmdSource_t;
+
 /*!
  * \brief 7816-3 protocol stack context structure
  *
@@ -226,6 +272,8 @@ typedef struct phNxpEseProto7816
   unsigned long int rnack_retry_limit;
   unsigned long int rnack_retry_counter;
   phNxpEseProto7816SecureTimer_t secureTimerParams;
+  phNxpEseProto7816_RspSink_t rspSink; /*!< Streaming receive context */
+  phNxpEseProto7816_CmdSource_t cmdSource; /*!< Command source context */
 }phNxpEseProto7816_t;
 
 /*!
@@ -242,28 +290,10 @@ typedef struct phNxpEseProto7816InitParam
     phNxpEseProto7816SecureTimer_t *pSecureTimerParams; /*!< Secure timer value updated here >*/
 }phNxpEseProto7816InitParam_t;
 
-/*!
- * \brief 7816-3 protocol PCB bit level structure
- *
- * This structure holds the bit level information of PCB byte
- * as per 7816-3 protocol
- *
- */
-typedef struct phNxpEseProto7816_PCB_bits {
-    uint8_t lsb :1; /*!< PCB: lsb */
-    uint8_t bit2 :1; /*!< PCB: bit2 */
-    uint8_t bit3 :1; /*!< PCB: bit3 */
-    uint8_t bit4 :1; /*!< PCB: bit4 */
-    uint8_t bit5 :1; /*!< PCB: bit5 */
-    uint8_t bit6 :1; /*!< PCB: bit6 */
-    uint8_t bit7 :1; /*!< PCB: bit7 */
-    uint8_t msb :1; /*!< PCB: msb */
-}phNxpEseProto7816_PCB_bits_t;
-
 /*!
  * \brief 7816_3 protocol stack instance
  */
-phNxpEseProto7816_t phNxpEseProto7816_3_Var;
+extern phNxpEseProto7816_t phNxpEseProto7816_3_Var;
 
 /*!
  * \brief Max. size of the frame that can be sent
@@ -404,6 +434,63 @@ bool_t phNxpEseProto7816_Open(phNxpEseProto7816InitParam_t initParam);
 */
 bool_t phNxpEseProto7816_Transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp);
 
+/**
+ * \ingroup ISO7816-3_protocol_lib
+ * \brief This function is used to
+ *                  1. Send the raw data received from application after computing LRC
+ *                  2. Receive the response data from ESE, decode and process it
+ *                  3. Hand each I-block payload to the sink once it is acknowledged
+ *
+ * \param[in]       phNxpEse_data: Command to ESE
+ * \param[in]       pphNxpEse_RspSink_t: Response sink
+ * \param[in]       void *: Context passed back to the sink
+ *
+ * \retval On success return TRUE or else FALSE.
+ *
+*/
+bool_t phNxpEseProto7816_TransceiveStream(phNxpEse_data *pCmd, pphNxpEse_RspSink_t pSink,
+        void *pContext);
+
+/**
+ * \ingroup ISO7816-3_protocol_lib
+ * \brief This function is used to
+ *                  1. Pull the command from the source one I-block at a time and
+ *                     send it after computing LRC
+ *                  2. Receive the the response data from ESE, decode, process and
+ *                     store the data.
+ *                  3. Get the final complete data and sent back to application
+ *
+ * \param[in]       uint32_t: Total length of the command
+ * \param[in]       pphNxpEse_CmdSource_t: Command source
+ * \param[in]       void *: Context passed back to the source
+ * \param[out]     phNxpEse_data: Response from ESE
+ *
+ * \retval On success return TRUE or else FALSE.
+ *
+*/
+bool_t phNxpEseProto7816_TransceiveFromSource(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pContext, phNxpEse_data *pRsp);
+
+/**
+ * \ingroup ISO7816-3_protocol_lib
+ * \brief This function is used to
+ *                  1. Pull the command from the source one I-block at a time and
+ *                     send it after computing LRC
+ *                  2. Receive the response data from ESE, decode and process it
+ *                  3. Hand each I-block payload to the sink once it is acknowledged
+ *
+ * \param[in]       uint32_t: Total length of the command
+ * \param[in]       pphNxpEse_CmdSource_t: Command source
+ * \param[in]       void *: Context passed back to the source
+ * \param[in]       pphNxpEse_RspSink_t: Response sink
+ * \param[in]       void *: Context passed back to the sink
+ *
+ * \retval On success return TRUE or else FALSE.
+ *
+*/
+bool_t phNxpEseProto7816_TransceiveSourceStream(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pSrcContext, pphNxpEse_RspSink_t pSink, void *pSinkContext);
+
 /**
  * \ingroup ISO7816-3_protocol_lib
  * \brief This function is used to reset the 7816 protocol stack instance
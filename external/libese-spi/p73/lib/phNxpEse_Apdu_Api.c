@@ -20,8 +20,47 @@
 #include <phNxpEse_Api.h>
 #include <phNxpLog.h>
 #include <phNxpEse_Apdu_Api.h>
-STATIC ESESTATUS phNxpEse_7816_FrameCmd(pphNxpEse_7816_cpdu_t pCmd,
-        uint8_t **pcmd_data, uint32_t *cmd_len);
+
+/* Encoded C-APDU: header and Lc, the caller's data, then Le */
+typedef struct phNxpEse_7816_CmdLayout
+{
+    uint8_t hdr[MIN_HEADER_LEN + 3];
+    uint8_t hdr_len;
+    uint8_t le[3];
+    uint8_t le_len;
+    const uint8_t *pdata;
+    uint32_t lc;
+    uint32_t total_len;
+} phNxpEse_7816_CmdLayout_t;
+
+/* R-APDU being received: data goes straight to the caller, SW1 SW2 held back */
+typedef struct phNxpEse_7816_RspCntx
+{
+    pphNxpEse_7816_rpdu_t pRsp;
+    uint32_t data_len;
+    uint32_t max_len; /* 0 when not bounded */
+    uint8_t sw[2];
+    uint8_t sw_len;
+} phNxpEse_7816_RspCntx_t;
+
+#define PH_7816_SW1_BYTES_AVAILABLE  0x61
+#define PH_7816_SW1_WRONG_LE         0x6C
+#define PH_7816_INS_GET_RESPONSE     0xC0
+
+/* Automatic 61xx / 6Cxx handling, off unless enabled */
+static bool_t gAutoRsp = FALSE;
+static uint32_t gAutoRspMaxLen = PH_7816_AUTO_RSP_MAX_LEN;
+
+STATIC ESESTATUS phNxpEse_7816_EncodeCmd(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_CmdLayout_t *pLayout);
+STATIC ESESTATUS phNxpEse_7816_CmdSource(void *pContext, uint8_t *pBuff,
+        uint32_t offset, uint32_t len);
+STATIC ESESTATUS phNxpEse_7816_RspSink(void *pContext, const uint8_t *pData,
+        uint32_t len, bool_t last);
+STATIC ESESTATUS phNxpEse_7816_Exchange(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_RspCntx_t *pCntx);
+STATIC ESESTATUS phNxpEse_7816_AutoResponse(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_RspCntx_t *pCntx);
 
 /******************************************************************************
  * Function         phNxpEse_7816_Transceive
@@ -37,12 +76,7 @@ ESESTATUS phNxpEse_7816_Transceive(pphNxpEse_7816_cpdu_t pCmd, pphNxpEse_7816_rp
 {
     ESESTATUS status = ESESTATUS_FAILED;
     NXPLOG_ESELIB_D(" %s Enter \n", __FUNCTION__);
-    uint32_t cmd_len = 0;
-    uint8_t *pCmd_data = NULL;
-    phNxpEse_data pCmdTrans;
-    phNxpEse_data pRspTrans;
-    phNxpEse_memset(&pCmdTrans,0x00,sizeof(phNxpEse_data));
-    phNxpEse_memset(&pRspTrans,0x00,sizeof(phNxpEse_data));
+    phNxpEse_7816_RspCntx_t rspCntx;
 
     if (NULL == pCmd  || NULL == pRsp)
     {
@@ -63,83 +97,289 @@ ESESTATUS phNxpEse_7816_Transceive(pphNxpEse_7816_cpdu_t pCmd, pphNxpEse_7816_rp
     }
     else
     {
-        status = phNxpEse_7816_FrameCmd(pCmd, &pCmd_data, &cmd_len);
-        if (ESESTATUS_SUCCESS == status)
+        phNxpEse_memset(&rspCntx, 0x00, sizeof(rspCntx));
+        rspCntx.pRsp = pRsp;
+        if (gAutoRsp)
         {
-            pCmdTrans.len = cmd_len;
-            pCmdTrans.p_data = pCmd_data;
-            status = phNxpEse_Transceive(&pCmdTrans, &pRspTrans);
-            //status = phNxpEse_Transceive(cmd_len, pCmd_data);
-            if (ESESTATUS_SUCCESS != status)
-            {
-                NXPLOG_ESELIB_E(" %s phNxpEse_Transceive Failed \n", __FUNCTION__);
-            }
-            else
+            /* the caller's buffer length, if given, bounds the pieces appended */
+            rspCntx.max_len = ((pRsp->len > 0) && (pRsp->len < gAutoRspMaxLen)) ?
+                    pRsp->len : gAutoRspMaxLen;
+        }
+        status = phNxpEse_7816_Exchange(pCmd, &rspCntx);
+        if ((ESESTATUS_SUCCESS == status) && gAutoRsp)
+        {
+            status = phNxpEse_7816_AutoResponse(pCmd, &rspCntx);
+        }
+        if (ESESTATUS_SUCCESS != status)
+        {
+            NXPLOG_ESELIB_E(" %s phNxpEse_Transceive Failed \n", __FUNCTION__);
+        }
+        else if (rspCntx.sw_len == 2)
+        {
+            pRsp->sw1 = rspCntx.sw[0];
+            pRsp->sw2 = rspCntx.sw[1];
+            pRsp->len = rspCntx.data_len;
+            NXPLOG_ESELIB_D("pRsp->len %d", pRsp->len);
+        }
+        else
+        {
+            NXPLOG_ESELIB_E("pRspTrans.len error = %d", rspCntx.data_len + rspCntx.sw_len);
+            status = ESESTATUS_FAILED;
+        }
+    }
+    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_7816_setAutoResponse
+ *
+ * Description      This function enables or disables the handling of 61xx and
+ *                  6Cxx status words inside phNxpEse_7816_Transceive.
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_7816_setAutoResponse(bool_t enable, uint32_t maxRspLen)
+{
+    gAutoRsp = enable;
+    gAutoRspMaxLen = ((maxRspLen > 0) && (maxRspLen < PH_7816_AUTO_RSP_MAX_LEN)) ?
+            maxRspLen : PH_7816_AUTO_RSP_MAX_LEN;
+    NXPLOG_ESELIB_D("%s enable %d max %d", __FUNCTION__, gAutoRsp, gAutoRspMaxLen);
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_7816_getAutoResponse
+ *
+ * Description      This function reports whether 61xx and 6Cxx are handled
+ *                  inside phNxpEse_7816_Transceive, and the response size cap.
+ *
+ * Returns          TRUE when enabled, FALSE otherwise.
+ *
+ ******************************************************************************/
+bool_t phNxpEse_7816_getAutoResponse(uint32_t *pMaxRspLen)
+{
+    if (NULL != pMaxRspLen)
+        *pMaxRspLen = gAutoRspMaxLen;
+    return gAutoRsp;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_7816_Exchange
+ *
+ * Description      Sends one C-APDU and appends its response data to the
+ *                  caller's buffer, after the data already received.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEse_7816_Exchange(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_RspCntx_t *pCntx)
+{
+    phNxpEse_7816_CmdLayout_t cmdLayout;
+    ESESTATUS status;
+
+    /* The command is encoded into the I-frames as they are sent and the
+     * response data is copied from the received frames to the caller */
+    status = phNxpEse_7816_EncodeCmd(pCmd, &cmdLayout);
+    if (ESESTATUS_SUCCESS == status)
+    {
+        pCntx->sw_len = 0;
+        status = phNxpEse_TransceiveSourceStream(cmdLayout.total_len, phNxpEse_7816_CmdSource,
+                &cmdLayout, phNxpEse_7816_RspSink, pCntx);
+    }
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_7816_AutoResponse
+ *
+ * Description      Follows up the response of pCmd: re-issues the command that
+ *                  got 6Cxx, pCmd or a GET RESPONSE, with the Le given by SW2
+ *                  and fetches the data announced by 61xx with GET RESPONSE,
+ *                  appending it to the data already received. Stops with the
+ *                  61xx status word still set when the next piece would not
+ *                  fit in the response buffer.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEse_7816_AutoResponse(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_RspCntx_t *pCntx)
+{
+    ESESTATUS status = ESESTATUS_SUCCESS;
+    phNxpEse_7816_cpdu_t cmd;
+    pphNxpEse_7816_cpdu_t pLast = pCmd;
+    bool_t isLeFixed = FALSE;
+    uint32_t le, data_len, fixed_len = 0;
+
+    while ((ESESTATUS_SUCCESS == status) && (pCntx->sw_len == 2))
+    {
+        le = (pCntx->sw[1] == 0x00) ? 256 : pCntx->sw[1];
+        /* One Le correction per piece of data: a card answering 6Cxx again
+         * without having returned anything since the last one is not retried */
+        if ((PH_7816_SW1_WRONG_LE == pCntx->sw[0]) &&
+                ((FALSE == isLeFixed) || (pCntx->data_len > fixed_len)))
+        {
+            NXPLOG_ESELIB_D("%s 6C%02X, re-issuing the last command", __FUNCTION__, pCntx->sw[1]);
+            /* pLast is either pCmd or the GET RESPONSE already held in cmd */
+            if (pLast != &cmd)
+                phNxpEse_memcpy(&cmd, pLast, sizeof(cmd));
+            cmd.le = le;
+            if (cmd.le_type == 0)
+                cmd.le_type = ((cmd.lc > 0) && (cmd.cpdu_type == 1)) ? 2 : 1;
+            pLast = &cmd;
+            isLeFixed = TRUE;
+            fixed_len = pCntx->data_len;
+            status = phNxpEse_7816_Exchange(&cmd, pCntx);
+        }
+        else if (PH_7816_SW1_BYTES_AVAILABLE == pCntx->sw[0])
+        {
+            if ((pCntx->max_len > 0) && ((pCntx->data_len + le) > pCntx->max_len))
             {
-                if ((pRspTrans.len > 0) && (pRspTrans.p_data != NULL))
-                {
-                    pRsp->sw2 = *(pRspTrans.p_data + (pRspTrans.len -1));
-                    pRspTrans.len--;
-                    pRsp->sw1 = *(pRspTrans.p_data + (pRspTrans.len -1));
-                    pRspTrans.len--;
-                    pRsp->len = pRspTrans.len;
-                    NXPLOG_ESELIB_D("pRsp->len %d", pRsp->len);
-                    if (pRspTrans.len > 0 && NULL != pRsp->pdata)
-                    {
-                        phNxpEse_memcpy(pRsp->pdata, pRspTrans.p_data , pRspTrans.len);
-                        status = ESESTATUS_SUCCESS;
-                    }
-                    else if(pRspTrans.len == 0)
-                    {
-                        status = ESESTATUS_SUCCESS;
-                    }
-                    else
-                    {
-                       /* if application response buffer is null and data is present */
-                        NXPLOG_ESELIB_E("Invalid Res buffer");
-                        status = ESESTATUS_FAILED;
-                    }
-                    NXPLOG_ESELIB_D("Freeing memroy pRspTrans.p_data ");
-                    phNxpEse_free(pRspTrans.p_data );
-                    pRspTrans.p_data  = NULL;
-                    pRspTrans.len = 0;
-                }
-                else
-                {
-                    NXPLOG_ESELIB_E("pRspTrans.len error = %d", pRspTrans.len);
-                    status = ESESTATUS_FAILED;
-                }
+                NXPLOG_ESELIB_D("%s response cap reached at %d", __FUNCTION__, pCntx->data_len);
+                break;
             }
-            if (pCmd_data != NULL)
+            phNxpEse_memset(&cmd, 0x00, sizeof(cmd));
+            /* GET RESPONSE on the logical channel of the command */
+            cmd.cla = (pCmd->cla & 0x40) ? (0x40 | (pCmd->cla & 0x0F)) : (pCmd->cla & 0x03);
+            cmd.ins = PH_7816_INS_GET_RESPONSE;
+            cmd.le_type = 1;
+            cmd.le = le;
+            pLast = &cmd;
+            data_len = pCntx->data_len;
+            status = phNxpEse_7816_Exchange(&cmd, pCntx);
+            if ((data_len == pCntx->data_len) && (pCntx->sw_len == 2) &&
+                    (PH_7816_SW1_BYTES_AVAILABLE == pCntx->sw[0]))
             {
-                NXPLOG_ESELIB_D("Freeing memory pCmd_data");
-                phNxpEse_free(pCmd_data);
+                NXPLOG_ESELIB_E("%s GET RESPONSE returned no data", __FUNCTION__);
+                break;
             }
         }
+        else
+        {
+            break;
+        }
     }
-    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
     return status;
 }
 
+/******************************************************************************
+ * Function         phNxpEse_7816_CmdSource
+ *
+ * Description      Command source of phNxpEse_7816_Transceive: copies the part
+ *                  of the encoded C-APDU at offset into the I-frame data.
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEse_7816_CmdSource(void *pContext, uint8_t *pBuff,
+        uint32_t offset, uint32_t len)
+{
+    phNxpEse_7816_CmdLayout_t *pLayout = (phNxpEse_7816_CmdLayout_t *)pContext;
+    uint32_t data_end = pLayout->hdr_len + pLayout->lc;
+    uint32_t count;
+
+    if (offset < pLayout->hdr_len)
+    {
+        count = pLayout->hdr_len - offset;
+        count = (count > len) ? len : count;
+        phNxpEse_memcpy(pBuff, &pLayout->hdr[offset], count);
+        pBuff += count;
+        offset += count;
+        len -= count;
+    }
+    if ((len > 0) && (offset < data_end))
+    {
+        count = data_end - offset;
+        count = (count > len) ? len : count;
+        phNxpEse_memcpy(pBuff, pLayout->pdata + (offset - pLayout->hdr_len), count);
+        pBuff += count;
+        offset += count;
+        len -= count;
+    }
+    if (len > 0)
+    {
+        phNxpEse_memcpy(pBuff, &pLayout->le[offset - data_end], len);
+    }
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_7816_RspSink
+ *
+ * Description      Response sink of phNxpEse_7816_Transceive: copies the
+ *                  response data to the caller's buffer, keeping the last two
+ *                  bytes back until it is known whether they are SW1 SW2.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+STATIC ESESTATUS phNxpEse_7816_RspSink(void *pContext, const uint8_t *pData,
+        uint32_t len, bool_t last)
+{
+    phNxpEse_7816_RspCntx_t *pCntx = (phNxpEse_7816_RspCntx_t *)pContext;
+    uint8_t *pdata = pCntx->pRsp->pdata;
+    uint32_t count;
+    (void)last;
+
+    /* bytes pushed out of the held back pair by this block */
+    count = pCntx->sw_len + len;
+    count = (count > 2) ? (count - 2) : 0;
+    if ((count > 0) && (NULL == pdata))
+    {
+        /* if application response buffer is null and data is present */
+        NXPLOG_ESELIB_E("Invalid Res buffer");
+        return ESESTATUS_FAILED;
+    }
+    if ((pCntx->max_len > 0) && ((pCntx->data_len + count) > pCntx->max_len))
+    {
+        NXPLOG_ESELIB_E("Res buffer too small");
+        return ESESTATUS_BUFFER_TOO_SMALL;
+    }
+    if (len >= 2)
+    {
+        if (pCntx->sw_len > 0)
+        {
+            phNxpEse_memcpy(pdata + pCntx->data_len, pCntx->sw, pCntx->sw_len);
+            pCntx->data_len += pCntx->sw_len;
+        }
+        phNxpEse_memcpy(pdata + pCntx->data_len, pData, len - 2);
+        pCntx->data_len += len - 2;
+        pCntx->sw[0] = pData[len - 2];
+        pCntx->sw[1] = pData[len - 1];
+        pCntx->sw_len = 2;
+    }
+    else if (len == 1)
+    {
+        if (pCntx->sw_len == 2)
+        {
+            pdata[pCntx->data_len++] = pCntx->sw[0];
+            pCntx->sw[0] = pCntx->sw[1];
+            pCntx->sw_len = 1;
+        }
+        pCntx->sw[pCntx->sw_len++] = pData[0];
+    }
+    return ESESTATUS_SUCCESS;
+}
+
 /**
  * \ingroup ISO7816-4_application_protocol_implementation
- * \brief Frames ISO7816-4 command.
- *                  pCmd: 7816 command structure.
- *                  pcmd_data: command buffer pointer.
+ * \brief Encodes the header, Lc and Le fields of an ISO7816-4 command.
+ *                  The data field is left in place in pCmd->pdata.
  *
  * \param[in]       pphNxpEse_7816_cpdu_t pCmd- Structure pointer passed from application
- * \param[in]       uint32_t *cmd_len - Hold the buffer length, update by this function
- * \param[in]       uint8_t **pcmd_data - Hold the allocated memory buffer for command.
+ * \param[out]      phNxpEse_7816_CmdLayout_t *pLayout - Encoded fields and total length
  *
  * \retval  ESESTATUS_SUCCESS on Success else proper error code
  *
  */
 
-STATIC ESESTATUS phNxpEse_7816_FrameCmd(pphNxpEse_7816_cpdu_t pCmd,
-        uint8_t **pcmd_data, uint32_t *cmd_len)
+STATIC ESESTATUS phNxpEse_7816_EncodeCmd(pphNxpEse_7816_cpdu_t pCmd,
+        phNxpEse_7816_CmdLayout_t *pLayout)
 {
     uint32_t cmd_total_len = MIN_HEADER_LEN;/* header is always 4 bytes */
-    uint8_t *pbuff = NULL;
     uint32_t index = 0;
     uint8_t lc_len = 0;
     uint8_t le_len = 0;
@@ -216,96 +456,47 @@ STATIC ESESTATUS phNxpEse_7816_FrameCmd(pphNxpEse_7816_cpdu_t pCmd,
     NXPLOG_ESELIB_D("%s cmd_total_len = %d, le_len = %d, lc_len = %d",
             __FUNCTION__, cmd_total_len, le_len, lc_len);
 
-    pbuff = (uint8_t *)phNxpEse_calloc(cmd_total_len, sizeof(uint8_t));
-    if (pbuff == NULL)
-    {
-        NXPLOG_ESELIB_D("%s Error allocating memory", __FUNCTION__);
-        return ESESTATUS_INSUFFICIENT_RESOURCES;
-    }
-    *cmd_len = cmd_total_len;
-    *pcmd_data = pbuff;
-    index = 0;
-
-    *(pbuff + index) = pCmd->cla;
-    index++;
-
-    *(pbuff + index) = pCmd->ins;
-    index++;
-
-    *(pbuff + index) = pCmd->p1;
-    index++;
-
-    *(pbuff + index) = pCmd->p2;
-    index++;
+    pLayout->hdr[index++] = pCmd->cla;
+    pLayout->hdr[index++] = pCmd->ins;
+    pLayout->hdr[index++] = pCmd->p1;
+    pLayout->hdr[index++] = pCmd->p2;
 
     /* lc_len can be 0, 1 or 3 bytes */
-    if (lc_len > 0)
+    if (lc_len == 1)
     {
-        if (lc_len == 1)
-        {
-            *(pbuff + index) = pCmd->lc;
-            index++;
-        }
-        else
-        {
-            /* extended cmd buffer*/
-            *(pbuff + index) = 0x00; /* three byte lc */
-            index++;
-            *(pbuff + index) = ((pCmd->lc & 0xFF00) >> 8);
-            index++;
-            *(pbuff + index) = (pCmd->lc & 0x00FF);
-            index++;
-        }
-        /* copy the lc bytes data */
-        phNxpEse_memcpy((pbuff+index), pCmd->pdata, pCmd->lc);
-        index += pCmd->lc;
+        pLayout->hdr[index++] = pCmd->lc;
+    }
+    else if (lc_len == 3)
+    {
+        /* extended cmd buffer*/
+        pLayout->hdr[index++] = 0x00; /* three byte lc */
+        pLayout->hdr[index++] = ((pCmd->lc & 0xFF00) >> 8);
+        pLayout->hdr[index++] = (pCmd->lc & 0x00FF);
     }
+    pLayout->hdr_len = index;
+    pLayout->pdata = pCmd->pdata;
+    pLayout->lc = pCmd->lc;
+
     /* le_len can be 0, 1, 2 or 3 bytes */
-    if (le_len > 0)
+    index = 0;
+    if (le_len == 1)
     {
-        if (le_len == 1)
-        {
-            if(pCmd->le == 256)
-            {
-                /* if le is 256 assign max value*/
-                *(pbuff + index) = 0x00;
-            }
-            else
-            {
-                *(pbuff + index) = (uint8_t) pCmd->le;
-            }
-            index++;
-        }
-        else
+        /* if le is 256 assign max value*/
+        pLayout->le[index++] = (pCmd->le == 256) ? 0x00 : (uint8_t) pCmd->le;
+    }
+    else if (le_len > 1)
+    {
+        if (le_len == 3)
         {
-            if (pCmd->le == 65536)
-            {
-                if (le_len == 3)
-                {
-                    /* assign max value */
-                    *(pbuff + index) = 0x00; /* three byte le */
-                    index++;
-                }
-                *(pbuff + index) = 0x00;
-                index++;
-                *(pbuff + index) = 0x00;
-                index++;
-            }
-            else
-            {
-                if (le_len == 3)
-                {
-                    *(pbuff + index) = 0x00; /* three byte le */
-                    index++;
-                }
-                *(pbuff + index) = ((pCmd->le & 0x0000FF00) >> 8);
-                index++;
-                *(pbuff + index) = (pCmd->le & 0x000000FF);
-                index++;
-            }
+            pLayout->le[index++] = 0x00; /* three byte le */
         }
+        /* 65536 is coded as 00 00 */
+        pLayout->le[index++] = ((pCmd->le & 0x0000FF00) >> 8);
+        pLayout->le[index++] = (pCmd->le & 0x000000FF);
     }
-    NXPLOG_ESELIB_D("Exit %s cmd_total_len = %d, index = %d", __FUNCTION__, index, cmd_total_len);
+    pLayout->le_len = index;
+    pLayout->total_len = cmd_total_len;
     return ESESTATUS_SUCCESS;
 }
+
 /** @} */
@@ -18,9 +18,14 @@
 #include <phNxpEsePal.h>
 #include <phNxpLog.h>
 #include <phNxpEseProto7816_3.h>
+#include <phNxpEse_Apdu_Api.h>
+#include <phNxpEse_SelCache.h>
+#include <phNxpEse_FrameCache.h>
 #include <phNxpConfig.h>
 #include <NXP_ESE_FEATURES.h>
 #include <phNxpEsePal_spi.h>
+#include <time.h>
+#include "../spm/phNxpEse_SpmPolicy.h"
 
 #define RECIEVE_PACKET_SOF      0xA5
 #define CHAINED_PACKET_WITHSEQN      0x60
@@ -39,7 +44,25 @@ static ESESTATUS phNxpEse_setJcopDwnldState(phNxpEse_JcopDwnldState state);
 static ESESTATUS phNxpEse_checkFWDwnldStatus(void);
 static void phNxpEse_GetMaxTimer(unsigned long *pMaxTimer);
 static unsigned char * phNxpEse_GgetTimerTlvBuffer(unsigned char *timer_buffer, unsigned int value);
+static ESESTATUS phNxpEse_beginTransceive(void);
+static uint64_t phNxpEse_nowUs(void);
+static void phNxpEse_sessionOpened(bool_t warm);
+static ESESTATUS phNxpEse_transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp, bool_t bSelCache);
+static ESESTATUS phNxpEse_selCacheCopyRsp(const uint8_t *pData, uint32_t len,
+        phNxpEse_data *pRsp);
 static int poll_sof_chained_delay = 0;
+static phNxpEse_Stats_t gEseStats;
+
+/* Response sink placed in front of the caller's one to see the response of a
+ * streamed command, see phNxpEse_selCacheSink */
+typedef struct phNxpEse_SelCacheSink
+{
+    pphNxpEse_RspSink_t pSink;
+    void *pContext;
+    uint32_t rsp_len;
+    uint8_t rsp[PH_SELCACHE_MAX_RSP_LEN];
+    uint8_t sw[2];
+} phNxpEse_SelCacheSink_t;
 /*********************** Global Variables *************************************/
 
 /* ESE Context structure */
@@ -84,6 +107,21 @@ ESESTATUS phNxpEse_init(phNxpEse_initParams initParams)
     {
         protoInitParam.rnack_retry_limit = MAX_RNACK_RETRY_LIMIT;
     }
+    if (GetNxpNumValue (NAME_NXP_AUTO_GET_RESPONSE, &num, sizeof(num)))
+    {
+        unsigned long int maxRspLen = 0;
+        if (!GetNxpNumValue (NAME_NXP_AUTO_GET_RESPONSE_MAX, &maxRspLen, sizeof(maxRspLen)))
+            maxRspLen = 0;
+        phNxpEse_7816_setAutoResponse((num == 1) ? TRUE : FALSE, maxRspLen);
+    }
+    if (GetNxpNumValue (NAME_NXP_SELECT_CACHE, &num, sizeof(num)))
+    {
+        phNxpEse_SelCache_init((num == 1) ? TRUE : FALSE);
+    }
+    if (GetNxpNumValue (NAME_NXP_T1_FRAME_CACHE, &num, sizeof(num)))
+    {
+        phNxpEse_FrameCache_init((num == 1) ? TRUE : FALSE);
+    }
 #else
     protoInitParam.wtx_counter_limit = PH_PROTO_WTX_DEFAULT_COUNT;
 #endif
@@ -165,6 +203,7 @@ ESESTATUS phNxpEse_open(phNxpEse_initParams initParams)
 
     phNxpEse_memset(&nxpese_ctxt, 0x00, sizeof(nxpese_ctxt));
     phNxpEse_memset(&tPalConfig, 0x00, sizeof(tPalConfig));
+    nxpese_ctxt.openTimeUs = phNxpEse_nowUs();
 
     NXPLOG_ESELIB_E("MW SEAccessKit Version");
     NXPLOG_ESELIB_E("Android Version:0x%x", NXP_ANDROID_VER);
@@ -204,6 +243,19 @@ ESESTATUS phNxpEse_open(phNxpEse_initParams initParams)
     phNxpLog_InitializeLogLevel();
     tPalConfig.pDevName = (int8_t *) "/dev/p73";
 
+#ifdef SPM_INTEGRATED
+    /* The previous session may have left the device open with the access held */
+    if ((ESE_MODE_NORMAL == initParams.initMode) &&
+            (phNxpEse_SPM_LeaseResume(&nxpese_ctxt.pDevHandle) == SPMSTATUS_SUCCESS))
+    {
+        NXPLOG_ESELIB_D("%s : resumed on the SPM lease", __FUNCTION__);
+        phNxpEse_memcpy(&nxpese_ctxt.initParams, &initParams, sizeof(phNxpEse_initParams));
+        nxpese_ctxt.spm_power_state = TRUE;
+        phNxpEse_sessionOpened(TRUE);
+        return ESESTATUS_SUCCESS;
+    }
+    phNxpEse_SPM_LeaseRelease();
+#endif
     /* Initialize PAL layer */
     wConfigStatus = phPalEse_open_and_configure(&tPalConfig);
     if (wConfigStatus != ESESTATUS_SUCCESS)
@@ -330,19 +382,24 @@ ESESTATUS phNxpEse_open(phNxpEse_initParams initParams)
         goto clean_and_return;
     }
 
+    if (ESE_MODE_NORMAL == nxpese_ctxt.initParams.initMode)
+    {
+        phNxpEse_sessionOpened(FALSE);
+    }
     NXPLOG_ESELIB_D("wConfigStatus %x", wConfigStatus);
     return wConfigStatus;
 
     clean_and_return:
 #ifdef SPM_INTEGRATED
+    phNxpEse_SelCache_invalidate();
     wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_DISABLE);
     if ( wSpmStatus != SPMSTATUS_SUCCESS)
     {
         NXPLOG_ESELIB_E("phNxpEse_SPM_ConfigPwr: disabling power Failed");
     }
     clean_and_return_1:
-    phNxpEse_SPM_DeInit();
     clean_and_return_2:
+    phNxpEse_SPM_DeInit();
 #endif
     if (NULL != nxpese_ctxt.pDevHandle)
     {
@@ -418,6 +475,10 @@ ESESTATUS phNxpEse_openPrioSession(phNxpEse_initParams initParams)
 
     tPalConfig.pDevName = (int8_t *) "/dev/p73";
 
+#ifdef SPM_INTEGRATED
+    /* A priority session never runs on the access of a previous session */
+    phNxpEse_SPM_LeaseRelease();
+#endif
 
     /* Initialize PAL layer */
     wConfigStatus = phPalEse_open_and_configure(&tPalConfig);
@@ -550,14 +611,15 @@ ESESTATUS phNxpEse_openPrioSession(phNxpEse_initParams initParams)
 
     clean_and_return:
 #ifdef SPM_INTEGRATED
+    phNxpEse_SelCache_invalidate();
     wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_DISABLE);
     if ( wSpmStatus != SPMSTATUS_SUCCESS)
     {
         NXPLOG_ESELIB_E("phNxpEse_SPM_ConfigPwr: disabling power Failed");
     }
     clean_and_return_1:
-    phNxpEse_SPM_DeInit();
     clean_and_return_2:
+    phNxpEse_SPM_DeInit();
 #endif
     if (NULL != nxpese_ctxt.pDevHandle)
     {
@@ -656,9 +718,41 @@ static ESESTATUS phNxpEse_checkJcopDwnldState(void)
  *
  ******************************************************************************/
 ESESTATUS phNxpEse_Transceive( phNxpEse_data *pCmd, phNxpEse_data *pRsp)
+{
+    return phNxpEse_transceive(pCmd, pRsp, TRUE);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_TransceiveUncached
+ *
+ * Description      This function sends the command to the eSE even when it
+ *                  is a SELECT the cache could answer
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_TransceiveUncached(phNxpEse_data *pCmd, phNxpEse_data *pRsp)
+{
+    return phNxpEse_transceive(pCmd, pRsp, FALSE);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_transceive
+ *
+ * Description      This internal function sends the command and returns the
+ *                  response in a buffer allocated for it. A SELECT repeated
+ *                  while its applet is still selected is answered from the
+ *                  cache when bSelCache is set.
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+static ESESTATUS phNxpEse_transceive(phNxpEse_data *pCmd, phNxpEse_data *pRsp, bool_t bSelCache)
 {
     ESESTATUS status = ESESTATUS_FAILED;
     bool_t bStatus = FALSE;
+    const uint8_t *pCachedRsp = NULL;
+    uint32_t cachedRspLen = 0;
 
     if((NULL == pCmd) || (NULL == pRsp))
         return ESESTATUS_INVALID_PARAMETER;
@@ -668,7 +762,143 @@ ESESTATUS phNxpEse_Transceive( phNxpEse_data *pCmd, phNxpEse_data *pRsp)
         NXPLOG_ESELIB_E(" phNxpEse_Transceive - Invalid Parameter no data\n");
         return ESESTATUS_INVALID_PARAMETER;
     }
-    else if ((ESE_STATUS_CLOSE == nxpese_ctxt.EseLibStatus))
+    status = phNxpEse_beginTransceive();
+    if (ESESTATUS_SUCCESS != status)
+        return status;
+    if ((TRUE == bSelCache) &&
+            phNxpEse_SelCache_lookup(pCmd->p_data, pCmd->len, &pCachedRsp, &cachedRspLen))
+    {
+        status = phNxpEse_selCacheCopyRsp(pCachedRsp, cachedRspLen, pRsp);
+        nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+        return status;
+    }
+    bStatus = phNxpEseProto7816_Transceive((phNxpEse_data*)pCmd, (phNxpEse_data*)pRsp);
+    if(TRUE == bStatus)
+    {
+        status = ESESTATUS_SUCCESS;
+        phNxpEse_SelCache_update(pCmd->p_data, pCmd->len, pRsp->p_data, pRsp->len, TRUE);
+    }
+    else
+    {
+        status = ESESTATUS_FAILED;
+        phNxpEse_SelCache_invalidate();
+    }
+
+    if (ESESTATUS_SUCCESS != status)
+    {
+        NXPLOG_ESELIB_E(" %s phNxpEseProto7816_Transceive- Failed \n", __FUNCTION__);
+    }
+    nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+
+    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_selCacheCopyRsp
+ *
+ * Description      This internal function returns a response kept by the
+ *                  SELECT cache as phNxpEseProto7816_Transceive would, in a
+ *                  buffer allocated for it
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+static ESESTATUS phNxpEse_selCacheCopyRsp(const uint8_t *pData, uint32_t len,
+        phNxpEse_data *pRsp)
+{
+    pRsp->p_data = (uint8_t *)phNxpEse_memalloc(len);
+    if (NULL == pRsp->p_data)
+    {
+        NXPLOG_ESELIB_E("%s Error in malloc ", __FUNCTION__);
+        pRsp->len = 0;
+        return ESESTATUS_NOT_ENOUGH_MEMORY;
+    }
+    phNxpEse_memcpy(pRsp->p_data, pData, len);
+    pRsp->len = len;
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_selCachePeekCmd
+ *
+ * Description      This internal function reads from the source the part of
+ *                  the command the SELECT cache needs: all of it when it may
+ *                  be a SELECT by AID, else the header
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+static ESESTATUS phNxpEse_selCachePeekCmd(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pContext, uint8_t *pCmd, uint32_t *pLen)
+{
+    *pLen = (cmdLen > PH_SELCACHE_MAX_CMD_LEN) ? 4 : cmdLen;
+    return pSource(pContext, pCmd, 0, *pLen);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_selCacheSink
+ *
+ * Description      This internal sink passes the response on to the caller's
+ *                  sink, keeping its start and its status word for the
+ *                  SELECT cache
+ *
+ * Returns          The status returned by the caller's sink
+ *
+ ******************************************************************************/
+static ESESTATUS phNxpEse_selCacheSink(void *pContext, const uint8_t *pData,
+        uint32_t len, bool_t last)
+{
+    phNxpEse_SelCacheSink_t *pCntx = (phNxpEse_SelCacheSink_t *)pContext;
+
+    if ((pCntx->rsp_len + len) <= PH_SELCACHE_MAX_RSP_LEN)
+    {
+        phNxpEse_memcpy(&pCntx->rsp[pCntx->rsp_len], pData, len);
+    }
+    if (len >= 2)
+    {
+        pCntx->sw[0] = pData[len - 2];
+        pCntx->sw[1] = pData[len - 1];
+    }
+    else if (len == 1)
+    {
+        pCntx->sw[0] = pCntx->sw[1];
+        pCntx->sw[1] = pData[0];
+    }
+    pCntx->rsp_len += len;
+    return pCntx->pSink(pCntx->pContext, pData, len, last);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_selCacheSinkDone
+ *
+ * Description      This internal function passes the response seen by
+ *                  phNxpEse_selCacheSink to the SELECT cache
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_selCacheSinkDone(const uint8_t *pCmd, uint32_t cmdLen,
+        phNxpEse_SelCacheSink_t *pCntx)
+{
+    if (pCntx->rsp_len <= PH_SELCACHE_MAX_RSP_LEN)
+        phNxpEse_SelCache_update(pCmd, cmdLen, pCntx->rsp, pCntx->rsp_len, TRUE);
+    else
+        phNxpEse_SelCache_update(pCmd, cmdLen, pCntx->sw, sizeof(pCntx->sw), FALSE);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_beginTransceive
+ *
+ * Description      This internal function checks that the library can take a
+ *                  new exchange and marks it busy
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+static ESESTATUS phNxpEse_beginTransceive(void)
+{
+    if ((ESE_STATUS_CLOSE == nxpese_ctxt.EseLibStatus))
     {
         NXPLOG_ESELIB_E(" %s ESE Not Initialized \n", __FUNCTION__);
         return ESESTATUS_NOT_INITIALISED;
@@ -678,28 +908,224 @@ ESESTATUS phNxpEse_Transceive( phNxpEse_data *pCmd, phNxpEse_data *pRsp)
         NXPLOG_ESELIB_E(" %s ESE - BUSY \n", __FUNCTION__);
         return ESESTATUS_BUSY;
     }
-    else
+    nxpese_ctxt.EseLibStatus = ESE_STATUS_BUSY;
+    if (TRUE == nxpese_ctxt.firstApduPending)
     {
-        nxpese_ctxt.EseLibStatus = ESE_STATUS_BUSY;
-        bStatus = phNxpEseProto7816_Transceive((phNxpEse_data*)pCmd, (phNxpEse_data*)pRsp);
-        if(TRUE == bStatus)
-        {
-            status = ESESTATUS_SUCCESS;
-        }
+        uint64_t ttfaUs = phNxpEse_nowUs() - nxpese_ctxt.openTimeUs;
+
+        nxpese_ctxt.firstApduPending = FALSE;
+        if (TRUE == nxpese_ctxt.warmOpen)
+            gEseStats.ttfaWarmUs += ttfaUs;
         else
+            gEseStats.ttfaColdUs += ttfaUs;
+        if (ttfaUs > gEseStats.ttfaMaxUs)
+            gEseStats.ttfaMaxUs = ttfaUs;
+    }
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_sessionOpened
+ *
+ * Description      This internal function accounts a normal session that is
+ *                  open and lets the power policy learn from it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_sessionOpened(bool_t warm)
+{
+    nxpese_ctxt.warmOpen = warm;
+    nxpese_ctxt.firstApduPending = TRUE;
+    if (TRUE == warm)
+        gEseStats.sessionsWarm++;
+    else
+        gEseStats.sessionsCold++;
+#ifdef SPM_INTEGRATED
+    phNxpEse_SPM_PolicyOnOpen(nxpese_ctxt.initParams.clientType, nxpese_ctxt.pwr_scheme, warm);
+#endif
+}
+
+/******************************************************************************
+ * Function         phNxpEse_nowUs
+ *
+ * Description      This internal function returns the monotonic time
+ *
+ * Returns          Time in microseconds
+ *
+ ******************************************************************************/
+static uint64_t phNxpEse_nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_TransceiveStream
+ *
+ * Description      This function sends the command and delivers the response
+ *                  to the sink one I-block at a time
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_TransceiveStream(phNxpEse_data *pCmd, pphNxpEse_RspSink_t pSink,
+        void *pContext)
+{
+    ESESTATUS status = ESESTATUS_FAILED;
+    phNxpEse_SelCacheSink_t selCacheSink;
+    const uint8_t *pCachedRsp = NULL;
+    uint32_t cachedRspLen = 0;
+
+    if((NULL == pCmd) || (NULL == pSink) || (pCmd->len == 0) || (pCmd->p_data == NULL))
+    {
+        NXPLOG_ESELIB_E(" %s - Invalid Parameter\n", __FUNCTION__);
+        return ESESTATUS_INVALID_PARAMETER;
+    }
+    status = phNxpEse_beginTransceive();
+    if (ESESTATUS_SUCCESS != status)
+        return status;
+    if (phNxpEse_SelCache_isEnabled())
+    {
+        if (phNxpEse_SelCache_lookup(pCmd->p_data, pCmd->len, &pCachedRsp, &cachedRspLen))
         {
-            status = ESESTATUS_FAILED;
+            status = pSink(pContext, pCachedRsp, cachedRspLen, TRUE);
+            nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+            return status;
         }
+        phNxpEse_memset(&selCacheSink, 0x00, sizeof(selCacheSink));
+        selCacheSink.pSink = pSink;
+        selCacheSink.pContext = pContext;
+        pSink = phNxpEse_selCacheSink;
+        pContext = &selCacheSink;
+    }
+    if (TRUE != phNxpEseProto7816_TransceiveStream(pCmd, pSink, pContext))
+    {
+        NXPLOG_ESELIB_E(" %s phNxpEseProto7816_TransceiveStream- Failed \n", __FUNCTION__);
+        status = ESESTATUS_FAILED;
+        phNxpEse_SelCache_invalidate();
+    }
+    else if (pContext == &selCacheSink)
+    {
+        phNxpEse_selCacheSinkDone(pCmd->p_data, pCmd->len, &selCacheSink);
+    }
+    nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_TransceiveFromSource
+ *
+ * Description      This function sends the command pulled from the source
+ *                  block by block and returns the response
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_TransceiveFromSource(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pContext, phNxpEse_data *pRsp)
+{
+    ESESTATUS status = ESESTATUS_FAILED;
+    uint8_t cmd[PH_SELCACHE_MAX_CMD_LEN];
+    uint32_t len = 0;
+    const uint8_t *pCachedRsp = NULL;
+    uint32_t cachedRspLen = 0;
 
-        if (ESESTATUS_SUCCESS != status)
+    if((NULL == pSource) || (NULL == pRsp) || (0 == cmdLen))
+    {
+        NXPLOG_ESELIB_E(" %s - Invalid Parameter\n", __FUNCTION__);
+        return ESESTATUS_INVALID_PARAMETER;
+    }
+    status = phNxpEse_beginTransceive();
+    if (ESESTATUS_SUCCESS != status)
+        return status;
+    if (phNxpEse_SelCache_isEnabled())
+    {
+        status = phNxpEse_selCachePeekCmd(cmdLen, pSource, pContext, cmd, &len);
+        if ((ESESTATUS_SUCCESS == status) &&
+                phNxpEse_SelCache_lookup(cmd, len, &pCachedRsp, &cachedRspLen))
         {
-            NXPLOG_ESELIB_E(" %s phNxpEseProto7816_Transceive- Failed \n", __FUNCTION__);
+            status = phNxpEse_selCacheCopyRsp(pCachedRsp, cachedRspLen, pRsp);
+            nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+            return status;
         }
-        nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+    }
+    if ((ESESTATUS_SUCCESS != status) ||
+            (TRUE != phNxpEseProto7816_TransceiveFromSource(cmdLen, pSource, pContext, pRsp)))
+    {
+        NXPLOG_ESELIB_E(" %s phNxpEseProto7816_TransceiveFromSource- Failed \n", __FUNCTION__);
+        status = ESESTATUS_FAILED;
+        phNxpEse_SelCache_invalidate();
+    }
+    else if (len > 0)
+    {
+        phNxpEse_SelCache_update(cmd, len, pRsp->p_data, pRsp->len, TRUE);
+    }
+    nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+    return status;
+}
 
-        NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+/******************************************************************************
+ * Function         phNxpEse_TransceiveSourceStream
+ *
+ * Description      This function sends the command pulled from the source and
+ *                  delivers the response to the sink, block by block
+ *
+ * Returns          On Success ESESTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_TransceiveSourceStream(uint32_t cmdLen, pphNxpEse_CmdSource_t pSource,
+        void *pSrcContext, pphNxpEse_RspSink_t pSink, void *pSinkContext)
+{
+    ESESTATUS status = ESESTATUS_FAILED;
+    phNxpEse_SelCacheSink_t selCacheSink;
+    uint8_t cmd[PH_SELCACHE_MAX_CMD_LEN];
+    uint32_t len = 0;
+    const uint8_t *pCachedRsp = NULL;
+    uint32_t cachedRspLen = 0;
+
+    if((NULL == pSource) || (NULL == pSink) || (0 == cmdLen))
+    {
+        NXPLOG_ESELIB_E(" %s - Invalid Parameter\n", __FUNCTION__);
+        return ESESTATUS_INVALID_PARAMETER;
+    }
+    status = phNxpEse_beginTransceive();
+    if (ESESTATUS_SUCCESS != status)
         return status;
+    if (phNxpEse_SelCache_isEnabled())
+    {
+        status = phNxpEse_selCachePeekCmd(cmdLen, pSource, pSrcContext, cmd, &len);
+        if ((ESESTATUS_SUCCESS == status) &&
+                phNxpEse_SelCache_lookup(cmd, len, &pCachedRsp, &cachedRspLen))
+        {
+            status = pSink(pSinkContext, pCachedRsp, cachedRspLen, TRUE);
+            nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+            return status;
+        }
+        phNxpEse_memset(&selCacheSink, 0x00, sizeof(selCacheSink));
+        selCacheSink.pSink = pSink;
+        selCacheSink.pContext = pSinkContext;
+        pSink = phNxpEse_selCacheSink;
+        pSinkContext = &selCacheSink;
+    }
+    if ((ESESTATUS_SUCCESS != status) ||
+            (TRUE != phNxpEseProto7816_TransceiveSourceStream(cmdLen, pSource, pSrcContext,
+            pSink, pSinkContext)))
+    {
+        NXPLOG_ESELIB_E(" %s phNxpEseProto7816_TransceiveSourceStream- Failed \n", __FUNCTION__);
+        status = ESESTATUS_FAILED;
+        phNxpEse_SelCache_invalidate();
+    }
+    else if (len > 0)
+    {
+        phNxpEse_selCacheSinkDone(cmd, len, &selCacheSink);
     }
+    nxpese_ctxt.EseLibStatus = ESE_STATUS_IDLE;
+    NXPLOG_ESELIB_D(" %s Exit status 0x%x \n", __FUNCTION__, status);
+    return status;
 }
 
 /******************************************************************************
@@ -739,6 +1165,7 @@ ESESTATUS phNxpEse_reset(void)
 #endif
     if((nxpese_ctxt.pwr_scheme == PN67T_POWER_SCHEME) || (nxpese_ctxt.pwr_scheme == PN80T_LEGACY_SCHEME))
     {
+        phNxpEse_SelCache_invalidate();
         wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_RESET);
         if ( wSpmStatus != SPMSTATUS_SUCCESS)
         {
@@ -793,6 +1220,7 @@ ESESTATUS phNxpEse_resetJcopUpdate(void)
         if((num == 1) || (num == 2))
         {
             NXPLOG_ESELIB_D(" %s Call Config Pwr Reset \n", __FUNCTION__);
+            phNxpEse_SelCache_invalidate();
             wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_RESET);
             if ( wSpmStatus != SPMSTATUS_SUCCESS)
             {
@@ -817,6 +1245,7 @@ ESESTATUS phNxpEse_resetJcopUpdate(void)
      }
 #else
     {
+        phNxpEse_SelCache_invalidate();
         wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_RESET);
         if ( wSpmStatus != SPMSTATUS_SUCCESS)
         {
@@ -874,6 +1303,7 @@ ESESTATUS phNxpEse_chipReset(void)
     bool_t bStatus = FALSE;
     if(nxpese_ctxt.pwr_scheme == PN80T_EXT_PMU_SCHEME)
     {
+        phNxpEse_SelCache_invalidate();
         bStatus = phNxpEseProto7816_Reset();
         if(!bStatus)
         {
@@ -906,7 +1336,10 @@ ESESTATUS phNxpEse_deInit(void)
 {
     ESESTATUS status = ESESTATUS_SUCCESS;
     unsigned long maxTimer = 0;
-    bool_t bStatus = phNxpEseProto7816_Close((phNxpEseProto7816SecureTimer_t *)&nxpese_ctxt.secureTimerParams);
+    bool_t bStatus = FALSE;
+
+    phNxpEse_SelCache_invalidate();
+    bStatus = phNxpEseProto7816_Close((phNxpEseProto7816SecureTimer_t *)&nxpese_ctxt.secureTimerParams);
     if(!bStatus)
     {
         status = ESESTATUS_FAILED;
@@ -956,6 +1389,15 @@ ESESTATUS phNxpEse_close(void)
 
 #ifdef SPM_INTEGRATED
     /* Release the Access of  */
+    phNxpEse_SelCache_invalidate();
+    /* A normal session keeps the access for the next one, see NXP_ESE_SPM_LEASE_MS */
+    if ((ESE_MODE_NORMAL == nxpese_ctxt.initParams.initMode) &&
+            (TRUE == nxpese_ctxt.spm_power_state) && (TRUE == phNxpEse_SPM_LeasePark()))
+    {
+        phNxpEse_memset (&nxpese_ctxt, 0x00, sizeof (nxpese_ctxt));
+        NXPLOG_ESELIB_D("phNxpEse_close - SPI access parked");
+        return status;
+    }
     wSpmStatus = phNxpEse_SPM_ConfigPwr(SPM_POWER_DISABLE);
     if ( wSpmStatus != SPMSTATUS_SUCCESS)
     {
@@ -1048,6 +1490,7 @@ static int phNxpEse_readPacket(void *pDevHandle, uint8_t * pBuffer, int nNbBytes
     do
     {
         sof_counter++;
+        gEseStats.sofPolls++;
         ret = -1;
         ret = phPalEse_read(pDevHandle, pBuffer, 2);
         if (ret < 0)
@@ -1114,6 +1557,7 @@ static int phNxpEse_readPacket(void *pDevHandle, uint8_t * pBuffer, int nNbBytes
         }
         else
         {
+            gEseStats.framesRx++;
             ret = (total_count + (nNbBytesToRead+1));
         }
    }
@@ -1158,6 +1602,7 @@ ESESTATUS phNxpEse_WriteFrame(uint32_t data_len, const uint8_t *p_data)
     else
     {
         status = ESESTATUS_SUCCESS;
+        gEseStats.framesTx++;
         PH_PAL_ESE_PRINT_PACKET_TX(nxpese_ctxt.p_cmd_data,nxpese_ctxt.cmd_len);
     }
 
@@ -1180,6 +1625,106 @@ ESESTATUS phNxpEse_setIfsc(uint16_t IFSC_Size)
     return ESESTATUS_SUCCESS;
 }
 
+/******************************************************************************
+ * Function         phNxpEse_setFrameLog
+ *
+ * Description      This function turns the debug logs written for every frame
+ *                  (library, PAL and packet dumps) off for bulk transfers, the
+ *                  errors are kept. Turning them on restores the levels in use
+ *                  before.
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_setFrameLog(bool_t enable)
+{
+    static spi_log_level_t sSavedLevel;
+    static bool_t sSuppressed = FALSE;
+
+    if (!enable && !sSuppressed)
+    {
+        sSavedLevel = gLog_level;
+        if (gLog_level.eselib_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.eselib_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.pal_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.pal_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.spix_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.spix_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        if (gLog_level.spir_log_level > NXPLOG_LOG_ERROR_LOGLEVEL)
+            gLog_level.spir_log_level = NXPLOG_LOG_ERROR_LOGLEVEL;
+        sSuppressed = TRUE;
+    }
+    else if (enable && sSuppressed)
+    {
+        gLog_level.eselib_log_level = sSavedLevel.eselib_log_level;
+        gLog_level.pal_log_level = sSavedLevel.pal_log_level;
+        gLog_level.spix_log_level = sSavedLevel.spix_log_level;
+        gLog_level.spir_log_level = sSavedLevel.spir_log_level;
+        sSuppressed = FALSE;
+    }
+    return ESESTATUS_SUCCESS;
+}
+
+
+/******************************************************************************
+ * Function         phNxpEse_getStats
+ *
+ * Description      This function copies out and optionally clears the link
+ *                  counters, device calls included.
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_getStats(phNxpEse_Stats_t *pStats, bool_t reset)
+{
+#ifdef SPM_INTEGRATED
+    phNxpEse_SPM_Stats_t spmStats;
+#endif
+
+    phPalEse_getStats(&gEseStats.pal, reset);
+    phNxpEse_SelCache_getStats(&gEseStats.selectsElided, &gEseStats.selectsForwarded, reset);
+    phNxpEse_FrameCache_getStats(&gEseStats.framesCached, &gEseStats.framesEncoded, reset);
+#ifdef SPM_INTEGRATED
+    phNxpEse_SPM_GetStats(&spmStats, reset);
+    gEseStats.spmIoctls = spmStats.ioctls;
+    gEseStats.spmLeaseResumes = spmStats.leaseResumes;
+    gEseStats.spmLeaseRevokes = spmStats.leaseRevokes;
+    gEseStats.spmAccessWaitUs = spmStats.accessWaitUs;
+    gEseStats.spmMaxAccessWaitUs = spmStats.maxAccessWaitUs;
+    gEseStats.spmWarmups = spmStats.warmups;
+    gEseStats.spmWarmupsUsed = spmStats.warmupsUsed;
+    gEseStats.spmOnTimeUs = spmStats.onTimeUs;
+    gEseStats.spmIdleOnTimeUs = spmStats.idleOnTimeUs;
+#endif
+    if (NULL != pStats)
+    {
+        *pStats = gEseStats;
+    }
+    if (reset)
+    {
+        phNxpEse_memset(&gEseStats, 0x00, sizeof(gEseStats));
+    }
+    return ESESTATUS_SUCCESS;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_powerHint
+ *
+ * Description      This function passes the expected use of the Ese to the
+ *                  power policy
+ *
+ * Returns          Always return ESESTATUS_SUCCESS (0).
+ *
+ ******************************************************************************/
+ESESTATUS phNxpEse_powerHint(phNxpEse_pwrHint hint)
+{
+#ifdef SPM_INTEGRATED
+    phNxpEse_SPM_PolicyHint(hint);
+#else
+    (void)hint;
+#endif
+    return ESESTATUS_SUCCESS;
+}
 
 /******************************************************************************
  * Function         phNxpEse_Sleep
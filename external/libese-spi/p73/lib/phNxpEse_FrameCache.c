@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Encoded T=1 I-blocks of the last short unchained commands sent. A command
+ * sent again byte for byte reuses its block: only N(S) in the PCB and the
+ * LRC, which that bit flips, are patched, instead of copying the command in
+ * the frame buffer and computing the LRC over it once more.
+ */
+#include <string.h>
+#include <phNxpLog.h>
+#include <phNxpEse_FrameCache.h>
+#include <phNxpEseProto7816_3.h>
+
+#define PH_FRAMECACHE_PCB_NS    0x40
+
+typedef struct phNxpEse_FrameCacheEntry
+{
+    uint8_t inf_len;    /* 0 when free */
+    uint8_t frame[PH_PROTO_7816_HEADER_LEN + PH_FRAMECACHE_MAX_INF_LEN + PH_PROTO_7816_CRC_LEN];
+} phNxpEse_FrameCacheEntry_t;
+
+STATIC bool_t gFrameCacheEnabled = FALSE;
+STATIC phNxpEse_FrameCacheEntry_t gFrameCache[PH_FRAMECACHE_MAX_ENTRIES];
+STATIC uint8_t gFrameCacheNext = 0;
+STATIC uint32_t gFrameHits = 0;
+STATIC uint32_t gFrameMisses = 0;
+
+/******************************************************************************
+ * Function         phNxpEse_FrameCache_init
+ *
+ * Description      This function empties the cache and enables or disables it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_FrameCache_init(bool_t enable)
+{
+    gFrameCacheEnabled = enable;
+    memset(gFrameCache, 0x00, sizeof(gFrameCache));
+    gFrameCacheNext = 0;
+    NXPLOG_ESELIB_D("%s enable %d", __FUNCTION__, enable);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_FrameCache_getIframe
+ *
+ * Description      This function returns the unchained I-block carrying pInf
+ *                  with the send sequence number seqNo, from the cache or
+ *                  encoded in place of the oldest entry. The block is
+ *                  infLen + PH_PROTO_7816_HEADER_LEN + PH_PROTO_7816_CRC_LEN
+ *                  bytes and stays valid until the next call.
+ *
+ * Returns          The block, NULL if the cache is disabled or the command
+ *                  too long for it
+ *
+ ******************************************************************************/
+uint8_t *phNxpEse_FrameCache_getIframe(const uint8_t *pInf, uint32_t infLen, uint8_t seqNo)
+{
+    phNxpEse_FrameCacheEntry_t *pEntry;
+    uint8_t pcb_ns = PH_T1_PCB_I(seqNo, FALSE);
+    uint32_t i;
+
+    if ((FALSE == gFrameCacheEnabled) || (0 == infLen) || (infLen > PH_FRAMECACHE_MAX_INF_LEN))
+        return NULL;
+    for (i = 0; i < PH_FRAMECACHE_MAX_ENTRIES; i++)
+    {
+        pEntry = &gFrameCache[i];
+        if ((pEntry->inf_len == infLen) &&
+                (0 == memcmp(&pEntry->frame[PH_PROTO_7816_HEADER_LEN], pInf, infLen)))
+        {
+            if ((pEntry->frame[1] & PH_FRAMECACHE_PCB_NS) != pcb_ns)
+            {
+                pEntry->frame[1] ^= PH_FRAMECACHE_PCB_NS;
+                pEntry->frame[PH_PROTO_7816_HEADER_LEN + infLen] ^= PH_FRAMECACHE_PCB_NS;
+            }
+            gFrameHits++;
+            return pEntry->frame;
+        }
+    }
+
+    pEntry = &gFrameCache[gFrameCacheNext];
+    gFrameCacheNext = (uint8_t)((gFrameCacheNext + 1) % PH_FRAMECACHE_MAX_ENTRIES);
+    pEntry->inf_len = (uint8_t)infLen;
+    phNxpEseT1_buildBlock(pEntry->frame, pcb_ns, pInf, infLen);
+    gFrameMisses++;
+    return pEntry->frame;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_FrameCache_getStats
+ *
+ * Description      This function copies out and optionally clears the count
+ *                  of I-blocks sent from the cache and encoded into it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_FrameCache_getStats(uint32_t *pHits, uint32_t *pMisses, bool_t reset)
+{
+    if (NULL != pHits)
+        *pHits = gFrameHits;
+    if (NULL != pMisses)
+        *pMisses = gFrameMisses;
+    if (reset)
+    {
+        gFrameHits = 0;
+        gFrameMisses = 0;
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _PHNXPESE_FRAMECACHE_H_
+#define _PHNXPESE_FRAMECACHE_H_
+#include <phNxpEse_Internal.h>
+
+/* Distinct fixed commands kept encoded */
+#define PH_FRAMECACHE_MAX_ENTRIES    8
+/* Short commands only: SELECT by AID, GET STATUS, GET DATA and alike */
+#define PH_FRAMECACHE_MAX_INF_LEN    32
+
+void phNxpEse_FrameCache_init(bool_t enable);
+uint8_t *phNxpEse_FrameCache_getIframe(const uint8_t *pInf, uint32_t infLen, uint8_t seqNo);
+void phNxpEse_FrameCache_getStats(uint32_t *pHits, uint32_t *pMisses, bool_t reset);
+
+#endif /* _PHNXPESE_FRAMECACHE_H_ */
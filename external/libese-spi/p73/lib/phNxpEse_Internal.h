@@ -87,6 +87,9 @@ typedef struct phNxpEse_Context
     uint8_t pwr_scheme;
     phNxpEse_initParams initParams;
     phNxpEse_SecureTimer_t secureTimerParams;
+    uint64_t openTimeUs;        /* start of phNxpEse_open, for the time to the first APDU */
+    bool_t warmOpen;            /* the session found the Ese powered */
+    bool_t firstApduPending;
 } phNxpEse_Context_t;
 
 /* Timeout value to wait for response from
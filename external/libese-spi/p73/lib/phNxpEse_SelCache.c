@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Remembers, per logical channel, the last SELECT by AID that succeeded and
+ * the response it got, so that the same SELECT sent again while the applet
+ * is still selected can be answered without going to the eSE.
+ */
+#include <string.h>
+#include <phNxpLog.h>
+#include <phNxpEse_SelCache.h>
+
+#define PH_SELCACHE_INS_SELECT          0xA4
+#define PH_SELCACHE_INS_MANAGE_CHANNEL  0x70
+#define PH_SELCACHE_P1_BY_AID           0x04
+
+typedef struct phNxpEse_SelCacheEntry
+{
+    bool_t valid;
+    uint8_t cmd_len;
+    uint8_t cmd[PH_SELCACHE_MAX_CMD_LEN];
+    uint16_t rsp_len;
+    uint8_t rsp[PH_SELCACHE_MAX_RSP_LEN];
+} phNxpEse_SelCacheEntry_t;
+
+STATIC bool_t gSelCacheEnabled = FALSE;
+STATIC phNxpEse_SelCacheEntry_t gSelCache[PH_SELCACHE_MAX_CHANNELS];
+STATIC uint32_t gSelElided = 0;
+STATIC uint32_t gSelForwarded = 0;
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_getChannel
+ *
+ * Description      This function returns the logical channel coded in CLA
+ *
+ * Returns          Channel number, 0 to PH_SELCACHE_MAX_CHANNELS - 1
+ *
+ ******************************************************************************/
+STATIC uint8_t phNxpEse_SelCache_getChannel(uint8_t cla)
+{
+    if (cla & 0x40)
+        return (uint8_t)(4 + (cla & 0x0F));
+    return (uint8_t)(cla & 0x03);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_isCacheable
+ *
+ * Description      This function checks that the command is a short SELECT
+ *                  by AID of the first or only occurrence, the only SELECT
+ *                  whose response does not depend on what was selected before
+ *
+ * Returns          TRUE if the response can be kept, FALSE otherwise
+ *
+ ******************************************************************************/
+STATIC bool_t phNxpEse_SelCache_isCacheable(const uint8_t *pCmd, uint32_t cmdLen)
+{
+    if ((cmdLen < 6) || (cmdLen > PH_SELCACHE_MAX_CMD_LEN) ||
+            (pCmd[0] & 0x80) || (pCmd[1] != PH_SELCACHE_INS_SELECT) ||
+            (pCmd[2] != PH_SELCACHE_P1_BY_AID) || (pCmd[3] & 0x03))
+        return FALSE;
+    /* Lc and the AID, with or without Le */
+    return ((pCmd[4] > 0) && ((cmdLen == 5U + pCmd[4]) || (cmdLen == 6U + pCmd[4])))
+            ? TRUE : FALSE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_init
+ *
+ * Description      This function enables or disables the cache, emptying it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SelCache_init(bool_t enable)
+{
+    gSelCacheEnabled = enable;
+    phNxpEse_SelCache_invalidate();
+    NXPLOG_ESELIB_D("%s enable %d", __FUNCTION__, enable);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_isEnabled
+ *
+ * Description      This function tells whether the commands have to be
+ *                  passed to the cache
+ *
+ * Returns          TRUE if enabled, FALSE otherwise
+ *
+ ******************************************************************************/
+bool_t phNxpEse_SelCache_isEnabled(void)
+{
+    return gSelCacheEnabled;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_invalidate
+ *
+ * Description      This function forgets the selection of every channel, to
+ *                  be called whenever the eSE or its interface is reset,
+ *                  powered down or left in an unknown state
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SelCache_invalidate(void)
+{
+    uint8_t channel;
+
+    for (channel = 0; channel < PH_SELCACHE_MAX_CHANNELS; channel++)
+    {
+        gSelCache[channel].valid = FALSE;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_lookup
+ *
+ * Description      This function checks whether pCmd repeats the SELECT that
+ *                  selected the current applet of its channel
+ *
+ * Returns          TRUE with the response kept for it in ppRsp and pRspLen,
+ *                  FALSE if the command has to be sent
+ *
+ ******************************************************************************/
+bool_t phNxpEse_SelCache_lookup(const uint8_t *pCmd, uint32_t cmdLen,
+        const uint8_t **ppRsp, uint32_t *pRspLen)
+{
+    phNxpEse_SelCacheEntry_t *pEntry;
+
+    if ((FALSE == gSelCacheEnabled) || (FALSE == phNxpEse_SelCache_isCacheable(pCmd, cmdLen)))
+        return FALSE;
+    pEntry = &gSelCache[phNxpEse_SelCache_getChannel(pCmd[0])];
+    if ((FALSE == pEntry->valid) || (pEntry->cmd_len != cmdLen) ||
+            (0 != memcmp(pEntry->cmd, pCmd, cmdLen)))
+        return FALSE;
+    *ppRsp = pEntry->rsp;
+    *pRspLen = pEntry->rsp_len;
+    gSelElided++;
+    NXPLOG_ESELIB_D("%s SELECT answered from the cache", __FUNCTION__);
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_update
+ *
+ * Description      This function follows the selection state of the channel
+ *                  of a command that was sent. pRsp ends with SW1 SW2 and
+ *                  holds the complete response when bRspComplete is TRUE.
+ *                  pCmd may be the 4 header bytes only of a long command.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SelCache_update(const uint8_t *pCmd, uint32_t cmdLen,
+        const uint8_t *pRsp, uint32_t rspLen, bool_t bRspComplete)
+{
+    phNxpEse_SelCacheEntry_t *pEntry;
+    uint8_t sw1;
+
+    if (FALSE == gSelCacheEnabled)
+        return;
+    if ((cmdLen < 4) || (rspLen < 2))
+    {
+        phNxpEse_SelCache_invalidate();
+        return;
+    }
+    pEntry = &gSelCache[phNxpEse_SelCache_getChannel(pCmd[0])];
+    sw1 = pRsp[rspLen - 2];
+    if (PH_SELCACHE_INS_MANAGE_CHANNEL == pCmd[1])
+    {
+        /* channels opened or closed, the numbers may be reused */
+        phNxpEse_SelCache_invalidate();
+    }
+    else if (PH_SELCACHE_INS_SELECT == pCmd[1])
+    {
+        gSelForwarded++;
+        pEntry->valid = FALSE;
+        if ((TRUE == bRspComplete) && (rspLen <= PH_SELCACHE_MAX_RSP_LEN) &&
+                (0x90 == sw1) && (0x00 == pRsp[rspLen - 1]) &&
+                (TRUE == phNxpEse_SelCache_isCacheable(pCmd, cmdLen)))
+        {
+            phNxpEse_memcpy(pEntry->cmd, pCmd, cmdLen);
+            pEntry->cmd_len = (uint8_t)cmdLen;
+            phNxpEse_memcpy(pEntry->rsp, pRsp, rspLen);
+            pEntry->rsp_len = (uint16_t)rspLen;
+            pEntry->valid = TRUE;
+        }
+    }
+    else if ((0x90 != sw1) && (0x61 != sw1))
+    {
+        /* the applet may have been deselected, on error or warning */
+        pEntry->valid = FALSE;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SelCache_getStats
+ *
+ * Description      This function copies out and optionally clears the count
+ *                  of SELECT commands answered from the cache and sent
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SelCache_getStats(uint32_t *pElided, uint32_t *pForwarded, bool_t reset)
+{
+    if (NULL != pElided)
+        *pElided = gSelElided;
+    if (NULL != pForwarded)
+        *pForwarded = gSelForwarded;
+    if (reset)
+    {
+        gSelElided = 0;
+        gSelForwarded = 0;
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _PHNXPESE_SELCACHE_H_
+#define _PHNXPESE_SELCACHE_H_
+#include <phNxpEse_Internal.h>
+
+/* Basic channel, 3 further channels in the first CLA coding and 16 in the second */
+#define PH_SELCACHE_MAX_CHANNELS     20
+/* Short SELECT by AID: header, Lc, AID of up to 16 bytes and Le */
+#define PH_SELCACHE_MAX_CMD_LEN      22
+/* Short response: 256 bytes of FCI and SW1 SW2 */
+#define PH_SELCACHE_MAX_RSP_LEN      258
+
+void phNxpEse_SelCache_init(bool_t enable);
+bool_t phNxpEse_SelCache_isEnabled(void);
+void phNxpEse_SelCache_invalidate(void);
+bool_t phNxpEse_SelCache_lookup(const uint8_t *pCmd, uint32_t cmdLen,
+        const uint8_t **ppRsp, uint32_t *pRspLen);
+void phNxpEse_SelCache_update(const uint8_t *pCmd, uint32_t cmdLen,
+        const uint8_t *pRsp, uint32_t rspLen, bool_t bRspComplete);
+void phNxpEse_SelCache_getStats(uint32_t *pElided, uint32_t *pForwarded, bool_t reset);
+
+#endif /* _PHNXPESE_SELCACHE_H_ */
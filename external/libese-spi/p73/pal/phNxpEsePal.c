@@ -31,6 +31,15 @@
 #include <phEseStatus.h>
 #include <string.h>
 #include <phNxpConfig.h>
+#ifdef ESE_PAL_SIM_INCLUDED
+#include <phNxpEsePal_sim.h>
+#endif
+#ifdef ESE_FAULT_INJECTION_INCLUDED
+#include <phNxpEsePal_fault.h>
+#endif
+#ifdef ESE_PAL_TRACE_INCLUDED
+#include <phNxpEsePal_trace.h>
+#endif
 
 /*!
  * \brief Normal mode header length
@@ -45,9 +54,17 @@
  */
 #define SEND_PACKET_SOF             0x5A
 /*!
- * \brief To enable SPI interface for ESE communication
+ * \brief To enable SPI interface for ESE communication, host builds
+ *        run against the simulated eSE instead
  */
+#ifndef ESE_PAL_SIM_INCLUDED
 #define SPI_ENABLED                 1
+#endif
+
+static int phPalEse_dev_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead);
+static int phPalEse_dev_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite);
+
+static phPalEse_Stats_t gPalStats;
 /*******************************************************************************
 **
 ** Function         phPalEse_close
@@ -63,7 +80,20 @@ void phPalEse_close(void *pDevHandle)
 {
     if (NULL != pDevHandle)
     {
-#ifdef SPI_ENABLED
+#ifdef ESE_FAULT_INJECTION_INCLUDED
+        phPalEse_fault_reset();
+#endif
+#ifdef ESE_PAL_TRACE_INCLUDED
+        phPalEse_trace_recordClose();
+        if (phPalEse_trace_getMode() == PH_PALESE_TRACE_MODE_REPLAY)
+        {
+            phPalEse_trace_replayClose(pDevHandle);
+            return;
+        }
+#endif
+#ifdef ESE_PAL_SIM_INCLUDED
+        phPalEse_sim_close(pDevHandle);
+#elif defined(SPI_ENABLED)
         phPalEse_spi_close(pDevHandle);
 #else
     /* RFU */
@@ -88,10 +118,29 @@ void phPalEse_close(void *pDevHandle)
 ESESTATUS phPalEse_open_and_configure(pphPalEse_Config_t pConfig)
 {
     ESESTATUS status = ESESTATUS_FAILED;
-#ifdef SPI_ENABLED
-    status = phPalEse_spi_open_and_configure(pConfig);
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_loadConfig();
+    if (phPalEse_trace_getMode() == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        status = phPalEse_trace_replayOpen(pConfig);
+    }
+    else
+#endif
+    {
+#ifdef ESE_PAL_SIM_INCLUDED
+        status = phPalEse_sim_open_and_configure(pConfig);
+#elif defined(SPI_ENABLED)
+        status = phPalEse_spi_open_and_configure(pConfig);
 #else
     /* RFU */
+#endif
+    }
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_recordOpen(status);
+#endif
+#ifdef ESE_FAULT_INJECTION_INCLUDED
+    phPalEse_fault_reset();
+    phPalEse_fault_loadConfig();
 #endif
     return status;
 }
@@ -113,10 +162,16 @@ ESESTATUS phPalEse_open_and_configure(pphPalEse_Config_t pConfig)
 int phPalEse_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead)
 {
     int ret = -1;
-#ifdef SPI_ENABLED
-    ret = phPalEse_spi_read(pDevHandle, pBuffer, nNbBytesToRead);
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_recordReadStart();
+#endif
+#ifdef ESE_FAULT_INJECTION_INCLUDED
+    ret = phPalEse_fault_read(pDevHandle, pBuffer, nNbBytesToRead, phPalEse_dev_read);
 #else
-    /* RFU */
+    ret = phPalEse_dev_read(pDevHandle, pBuffer, nNbBytesToRead);
+#endif
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_recordRead(pBuffer, nNbBytesToRead, ret);
 #endif
     return ret;
 }
@@ -144,11 +199,84 @@ int phPalEse_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite)
     {
         return -1;
     }
-#ifdef SPI_ENABLED
-    numWrote = phPalEse_spi_write(pDevHandle, pBuffer, nNbBytesToWrite);
+#ifdef ESE_FAULT_INJECTION_INCLUDED
+    numWrote = phPalEse_fault_write(pDevHandle, pBuffer, nNbBytesToWrite, phPalEse_dev_write);
 #else
-    /* RFU */
+    numWrote = phPalEse_dev_write(pDevHandle, pBuffer, nNbBytesToWrite);
+#endif
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_recordWrite(pBuffer, nNbBytesToWrite, numWrote);
+#endif
+    return numWrote;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_dev_read
+**
+** Description      Reads from the device port selected at build time
+**
+** Returns          numRead   - number of successfully read bytes
+**                  -1        - read operation failure
+**
+*******************************************************************************/
+static int phPalEse_dev_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead)
+{
+    int ret = -1;
+    gPalStats.readCalls++;
+#ifdef ESE_PAL_TRACE_INCLUDED
+    if (phPalEse_trace_getMode() == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        ret = phPalEse_trace_replayRead(pDevHandle, pBuffer, nNbBytesToRead);
+    }
+    else
+#endif
+    {
+#ifdef ESE_PAL_SIM_INCLUDED
+        ret = phPalEse_sim_read(pDevHandle, pBuffer, nNbBytesToRead);
+#elif defined(SPI_ENABLED)
+        ret = phPalEse_spi_read(pDevHandle, pBuffer, nNbBytesToRead);
+#else
+        /* RFU */
+#endif
+    }
+    if (ret > 0)
+        gPalStats.bytesRead += ret;
+    return ret;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_dev_write
+**
+** Description      Writes to the device port selected at build time
+**
+** Returns          numWrote   - number of successfully written bytes
+**                  -1         - write operation failure
+**
+*******************************************************************************/
+static int phPalEse_dev_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite)
+{
+    int numWrote = 0;
+    gPalStats.writeCalls++;
+#ifdef ESE_PAL_TRACE_INCLUDED
+    if (phPalEse_trace_getMode() == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        numWrote = phPalEse_trace_replayWrite(pDevHandle, pBuffer, nNbBytesToWrite);
+    }
+    else
 #endif
+    {
+#ifdef ESE_PAL_SIM_INCLUDED
+        numWrote = phPalEse_sim_write(pDevHandle, pBuffer, nNbBytesToWrite);
+#elif defined(SPI_ENABLED)
+        numWrote = phPalEse_spi_write(pDevHandle, pBuffer, nNbBytesToWrite);
+#else
+        /* RFU */
+#endif
+    }
+    if (numWrote > 0)
+        gPalStats.bytesWritten += numWrote;
     return numWrote;
 }
 
@@ -174,10 +302,22 @@ int phPalEse_ioctl(phPalEse_ControlCode_t eControlCode, void *pDevHandle, long l
     {
         return -1;
     }
-#ifdef SPI_ENABLED
+    gPalStats.ioctlCalls++;
+#ifdef ESE_PAL_TRACE_INCLUDED
+    if (phPalEse_trace_getMode() == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        return phPalEse_trace_replayIoctl(eControlCode, pDevHandle, level);
+    }
+#endif
+#ifdef ESE_PAL_SIM_INCLUDED
+    ret = phPalEse_sim_ioctl(eControlCode, pDevHandle, level);
+#elif defined(SPI_ENABLED)
     ret = phPalEse_spi_ioctl(eControlCode, pDevHandle, level);
 #else
     /* RFU */
+#endif
+#ifdef ESE_PAL_TRACE_INCLUDED
+    phPalEse_trace_recordIoctl(eControlCode, level, ret);
 #endif
     return ret;
 }
@@ -225,10 +365,35 @@ void phPalEse_print_packet(const char *pString, const uint8_t *p_data,
 *******************************************************************************/
 void phPalEse_sleep(long usec)
 {
+#ifdef ESE_PAL_SIM_INCLUDED
+    phPalEse_sim_sleep(usec);
+#else
     usleep(usec);
+#endif
     return;
 }
 
+/*******************************************************************************
+**
+** Function         phPalEse_getStats
+**
+** Description      Copies out and optionally clears the device access counters
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_getStats(phPalEse_Stats_t *pStats, bool_t reset)
+{
+    if (NULL != pStats)
+    {
+        *pStats = gPalStats;
+    }
+    if (reset)
+    {
+        memset(&gPalStats, 0x00, sizeof(gPalStats));
+    }
+}
+
 /**
  * \ingroup eSe_PAL
  * \brief This function updates destination buffer with val
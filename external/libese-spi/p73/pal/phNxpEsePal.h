@@ -78,6 +78,20 @@ typedef struct phPalEse_Config
     /*!< Device handle output */
 } phPalEse_Config_t,*pphPalEse_Config_t;    /* pointer to phPalEse_Config_t */
 
+/*!
+ * \ingroup eSe_PAL
+ *
+ * \brief Device access counters, one call is one syscall on the target
+ */
+typedef struct phPalEse_Stats
+{
+    uint32_t readCalls;
+    uint32_t writeCalls;
+    uint32_t ioctlCalls;
+    uint32_t bytesRead;
+    uint32_t bytesWritten;
+} phPalEse_Stats_t;
+
 /* Function declarations */
 /**
  * \ingroup eSe_PAL
@@ -168,6 +182,18 @@ void phPalEse_print_packet(const char *pString, const uint8_t *p_data,
  */
 void phPalEse_sleep(long usec);
 
+/**
+ * \ingroup eSe_PAL
+ * \brief Copies out and optionally clears the device access counters
+ *
+ * \param[out]   pStats         - counters, may be NULL to only clear them
+ * \param[in]    reset          - TRUE to clear the counters after reading
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_getStats(phPalEse_Stats_t *pStats, bool_t reset);
+
 /**
  * \ingroup eSe_PAL
  * \brief This function updates destination buffer with val
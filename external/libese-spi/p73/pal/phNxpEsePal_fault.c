@@ -0,0 +1,498 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * T=1 link fault injector
+ *
+ * Sits between phPalEse_read/phPalEse_write and the device port. Frames
+ * read from the eSE are fetched whole on their SOF poll, optionally
+ * corrupted and then served to the caller from a staging buffer, so the
+ * injector works the same on top of the SPI and the simulated port.
+ *
+ */
+#include <string.h>
+
+#include <phNxpLog.h>
+#include <phNxpEsePal_fault.h>
+#include <phEseStatus.h>
+#include <phNxpConfig.h>
+
+#define FAULT_RECV_PACKET_SOF       0xA5
+#define FAULT_HEADER_LEN            3
+#define FAULT_MAX_FRAME_LEN         (FAULT_HEADER_LEN + 0xFF + 1)
+#define FAULT_PCB_TYPE_MASK         0xC0
+#define FAULT_PCB_R_BLOCK           0x80
+/*!
+ * \brief Undefined PCBs used for the bad PCB fault: an undefined S-block
+ *        and an R-block with reserved error bits
+ */
+#define FAULT_PCB_BAD_S             0xFF
+#define FAULT_PCB_BAD_R             0x83
+/*!
+ * \brief S(WTX request), its response and the injected frame
+ */
+#define FAULT_PCB_WTX_REQ           0xC3
+#define FAULT_PCB_WTX_RSP           0xE3
+
+typedef enum
+{
+    FAULT_NONE,
+    FAULT_RX_LRC,
+    FAULT_RX_DROP_ACK,
+    FAULT_RX_WTX,
+    FAULT_RX_BAD_PCB,
+    FAULT_RX_TRUNCATE,
+    FAULT_TX_LRC,
+    FAULT_TX_DROP
+} phPalEse_FaultType_t;
+
+typedef struct phPalEse_FaultCntx
+{
+    bool_t enabled;
+    uint32_t prng;
+    uint8_t frame[FAULT_MAX_FRAME_LEN];   /* frame being served to the caller */
+    int frameLen;
+    int servePos;
+    uint8_t held[FAULT_MAX_FRAME_LEN];    /* frame held back behind an injected WTX */
+    int heldLen;
+    bool_t wtxPending;                     /* swallow the next S(WTX response) */
+} phPalEse_FaultCntx_t;
+
+static phPalEse_FaultConfig_t gFaultConfig;
+static phPalEse_FaultStats_t gFaultStats;
+static phPalEse_FaultCntx_t gFaultCntx;
+
+static uint8_t phPalEse_fault_computeLrc(const uint8_t *pFrame, int frameLen);
+static uint32_t phPalEse_fault_draw(void);
+static phPalEse_FaultType_t phPalEse_fault_pickRx(uint8_t pcb);
+static phPalEse_FaultType_t phPalEse_fault_pickTx(void);
+static int phPalEse_fault_stageFrame(void *pDevHandle, uint8_t *pPoll, int pollLen,
+        pphPalEse_Fault_IoFn_t pfnRead);
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_configure
+**
+** Description      Sets the fault mix and re-seeds the generator
+**
+** Parameters       pFaultConfig - fault mix, NULL disables injection
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_fault_configure(const phPalEse_FaultConfig_t *pFaultConfig)
+{
+    phPalEse_fault_reset();
+    memset(&gFaultConfig, 0x00, sizeof(gFaultConfig));
+    gFaultCntx.enabled = FALSE;
+    if (NULL != pFaultConfig)
+    {
+        gFaultConfig = *pFaultConfig;
+        gFaultCntx.enabled = ((gFaultConfig.rxLrcRate | gFaultConfig.rxDropAckRate |
+                gFaultConfig.rxWtxRate | gFaultConfig.rxBadPcbRate | gFaultConfig.rxTruncateRate |
+                gFaultConfig.txLrcRate | gFaultConfig.txDropRate) != 0) ? TRUE : FALSE;
+    }
+    /* xorshift state must never be zero */
+    gFaultCntx.prng = (gFaultConfig.seed != 0) ? gFaultConfig.seed : 0x2545F491;
+    NXPLOG_PAL_D("%s enabled %d seed 0x%x", __FUNCTION__, gFaultCntx.enabled, gFaultConfig.seed);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_loadConfig
+**
+** Description      Loads the fault mix from the config file
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_fault_loadConfig(void)
+{
+#ifdef ESE_DEBUG_UTILS_INCLUDED
+    unsigned long num = 0;
+    phPalEse_FaultConfig_t faultConfig;
+
+    if ((GetNxpNumValue(NAME_NXP_FAULT_INJECTION, &num, sizeof(num)) == 0) || (num != 1))
+    {
+        return;
+    }
+    memset(&faultConfig, 0x00, sizeof(faultConfig));
+    if (GetNxpNumValue(NAME_NXP_FAULT_SEED, &num, sizeof(num)))
+        faultConfig.seed = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_RX_LRC_RATE, &num, sizeof(num)))
+        faultConfig.rxLrcRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_RX_DROP_ACK_RATE, &num, sizeof(num)))
+        faultConfig.rxDropAckRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_RX_WTX_RATE, &num, sizeof(num)))
+        faultConfig.rxWtxRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_RX_BAD_PCB_RATE, &num, sizeof(num)))
+        faultConfig.rxBadPcbRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_RX_TRUNCATE_RATE, &num, sizeof(num)))
+        faultConfig.rxTruncateRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_TX_LRC_RATE, &num, sizeof(num)))
+        faultConfig.txLrcRate = num;
+    if (GetNxpNumValue(NAME_NXP_FAULT_TX_DROP_RATE, &num, sizeof(num)))
+        faultConfig.txDropRate = num;
+    NXPLOG_PAL_D("%s fault injection enabled from config", __FUNCTION__);
+    phPalEse_fault_configure(&faultConfig);
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_reset
+**
+** Description      Drops any staged or held frame
+**
+** Parameters       None
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_fault_reset(void)
+{
+    gFaultCntx.frameLen = 0;
+    gFaultCntx.servePos = 0;
+    gFaultCntx.heldLen = 0;
+    gFaultCntx.wtxPending = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_getStats
+**
+** Description      Copies out and optionally clears the injector counters
+**
+** Parameters       pStats - counters
+**                  reset  - TRUE to clear after reading
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_fault_getStats(phPalEse_FaultStats_t *pStats, bool_t reset)
+{
+    if (NULL != pStats)
+    {
+        *pStats = gFaultStats;
+    }
+    if (reset)
+    {
+        memset(&gFaultStats, 0x00, sizeof(gFaultStats));
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_read
+**
+** Description      Reads through the fault injector
+**
+** Parameters       pDevHandle     - valid device handle
+**                  pBuffer        - buffer for read data
+**                  nNbBytesToRead - number of bytes requested to be read
+**                  pfnRead        - underlying device read
+**
+** Returns          numRead   - number of successfully read bytes
+**                  -1        - read operation failure
+**
+*******************************************************************************/
+int phPalEse_fault_read(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToRead,
+        pphPalEse_Fault_IoFn_t pfnRead)
+{
+    int ret;
+    int avail;
+
+    if (!gFaultCntx.enabled)
+    {
+        return pfnRead(pDevHandle, pBuffer, nNbBytesToRead);
+    }
+
+    if (gFaultCntx.servePos >= gFaultCntx.frameLen)
+    {
+        /* Nothing staged: this is a SOF poll */
+        if ((gFaultCntx.heldLen > 0) && !gFaultCntx.wtxPending)
+        {
+            memcpy(gFaultCntx.frame, gFaultCntx.held, gFaultCntx.heldLen);
+            gFaultCntx.frameLen = gFaultCntx.heldLen;
+            gFaultCntx.servePos = 0;
+            gFaultCntx.heldLen = 0;
+        }
+        else
+        {
+            ret = pfnRead(pDevHandle, pBuffer, nNbBytesToRead);
+            if ((ret < 2) || ((pBuffer[0] != FAULT_RECV_PACKET_SOF) &&
+                    (pBuffer[1] != FAULT_RECV_PACKET_SOF)))
+            {
+                return ret;
+            }
+            if (phPalEse_fault_stageFrame(pDevHandle, pBuffer, ret, pfnRead) <= 0)
+            {
+                /* Frame dropped: the caller keeps polling */
+                memset(pBuffer, 0x00, nNbBytesToRead);
+                return nNbBytesToRead;
+            }
+            /* The poll bytes are served, the rest follows from the staging buffer */
+            return ret;
+        }
+    }
+
+    avail = gFaultCntx.frameLen - gFaultCntx.servePos;
+    if (avail > nNbBytesToRead)
+    {
+        avail = nNbBytesToRead;
+    }
+    memcpy(pBuffer, &gFaultCntx.frame[gFaultCntx.servePos], avail);
+    gFaultCntx.servePos += avail;
+    if (avail < nNbBytesToRead)
+    {
+        /* Reading past the frame end clocks out idle bytes */
+        memset(&pBuffer[avail], 0x00, nNbBytesToRead - avail);
+    }
+    return nNbBytesToRead;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_write
+**
+** Description      Writes through the fault injector
+**
+** Parameters       pDevHandle      - valid device handle
+**                  pBuffer         - frame to write
+**                  nNbBytesToWrite - number of bytes to write
+**                  pfnWrite        - underlying device write
+**
+** Returns          numWrote  - number of successfully written bytes
+**                  -1        - write operation failure
+**
+*******************************************************************************/
+int phPalEse_fault_write(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToWrite,
+        pphPalEse_Fault_IoFn_t pfnWrite)
+{
+    uint8_t frame[FAULT_MAX_FRAME_LEN];
+
+    if (!gFaultCntx.enabled)
+    {
+        return pfnWrite(pDevHandle, pBuffer, nNbBytesToWrite);
+    }
+
+    gFaultStats.txFrames++;
+    if (gFaultCntx.wtxPending)
+    {
+        gFaultCntx.wtxPending = FALSE;
+        if ((nNbBytesToWrite > 1) && (pBuffer[1] == FAULT_PCB_WTX_RSP))
+        {
+            /* Answer to the injected WTX, the card never asked for it */
+            NXPLOG_PAL_D("%s WTX response swallowed", __FUNCTION__);
+            return nNbBytesToWrite;
+        }
+        /* Host moved on, the held frame is stale */
+        gFaultCntx.heldLen = 0;
+    }
+    gFaultCntx.frameLen = 0;
+    gFaultCntx.servePos = 0;
+
+    switch (phPalEse_fault_pickTx())
+    {
+    case FAULT_TX_DROP:
+        gFaultStats.txDrop++;
+        NXPLOG_PAL_D("%s drop Tx frame pcb 0x%x", __FUNCTION__, pBuffer[1]);
+        return nNbBytesToWrite;
+    case FAULT_TX_LRC:
+        if ((nNbBytesToWrite > 0) && (nNbBytesToWrite <= (int)sizeof(frame)))
+        {
+            gFaultStats.txLrc++;
+            memcpy(frame, pBuffer, nNbBytesToWrite);
+            frame[nNbBytesToWrite - 1] ^= 0xFF;
+            NXPLOG_PAL_D("%s corrupt Tx LRC pcb 0x%x", __FUNCTION__, pBuffer[1]);
+            return pfnWrite(pDevHandle, frame, nNbBytesToWrite);
+        }
+        break;
+    default:
+        break;
+    }
+    return pfnWrite(pDevHandle, pBuffer, nNbBytesToWrite);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_stageFrame
+**
+** Description      Completes the frame whose SOF was found by the poll, applies
+**                  an Rx fault and arms the staging buffer. The first pollLen
+**                  bytes of the staged frame are copied back to pPoll.
+**
+** Returns          length of the staged frame, 0 if the frame was dropped
+**
+*******************************************************************************/
+static int phPalEse_fault_stageFrame(void *pDevHandle, uint8_t *pPoll, int pollLen,
+        pphPalEse_Fault_IoFn_t pfnRead)
+{
+    uint8_t *pFrame = gFaultCntx.frame;
+    int pos;
+    int len;
+    int cut;
+
+    pFrame[0] = FAULT_RECV_PACKET_SOF;
+    if (pPoll[0] == FAULT_RECV_PACKET_SOF)
+    {
+        pFrame[1] = pPoll[1];
+        pos = 2;
+    }
+    else
+    {
+        pos = 1;
+    }
+    if (pfnRead(pDevHandle, &pFrame[pos], FAULT_HEADER_LEN - pos) < 0)
+    {
+        return -1;
+    }
+    len = pFrame[2];
+    if (pfnRead(pDevHandle, &pFrame[FAULT_HEADER_LEN], len + 1) < 0)
+    {
+        return -1;
+    }
+    gFaultCntx.frameLen = FAULT_HEADER_LEN + len + 1;
+    gFaultCntx.servePos = 0;
+    gFaultStats.rxFrames++;
+
+    switch (phPalEse_fault_pickRx(pFrame[1]))
+    {
+    case FAULT_RX_LRC:
+        gFaultStats.rxLrc++;
+        pFrame[gFaultCntx.frameLen - 1] ^= 0xFF;
+        break;
+    case FAULT_RX_DROP_ACK:
+        gFaultStats.rxDropAck++;
+        NXPLOG_PAL_D("%s drop Rx R-block pcb 0x%x", __FUNCTION__, pFrame[1]);
+        gFaultCntx.frameLen = 0;
+        return 0;
+    case FAULT_RX_BAD_PCB:
+        gFaultStats.rxBadPcb++;
+        pFrame[1] = ((pFrame[1] & FAULT_PCB_TYPE_MASK) == FAULT_PCB_R_BLOCK) ?
+                FAULT_PCB_BAD_S : FAULT_PCB_BAD_R;
+        pFrame[gFaultCntx.frameLen - 1] =
+                phPalEse_fault_computeLrc(pFrame, gFaultCntx.frameLen - 1);
+        break;
+    case FAULT_RX_TRUNCATE:
+        gFaultStats.rxTruncate++;
+        cut = FAULT_HEADER_LEN + (int)(phPalEse_fault_draw() % (uint32_t)(len + 1));
+        memset(&pFrame[cut], 0x00, gFaultCntx.frameLen - cut);
+        break;
+    case FAULT_RX_WTX:
+        gFaultStats.rxWtx++;
+        memcpy(gFaultCntx.held, pFrame, gFaultCntx.frameLen);
+        gFaultCntx.heldLen = gFaultCntx.frameLen;
+        gFaultCntx.wtxPending = TRUE;
+        pFrame[1] = FAULT_PCB_WTX_REQ;
+        pFrame[2] = 0x01;
+        pFrame[3] = 0x01;
+        pFrame[4] = phPalEse_fault_computeLrc(pFrame, 4);
+        gFaultCntx.frameLen = 5;
+        break;
+    default:
+        break;
+    }
+    /* Keep the A5 PCB or 00 A5 alignment the caller saw */
+    if (pos == 2)
+    {
+        pPoll[1] = pFrame[1];
+    }
+    gFaultCntx.servePos = pos;
+    (void)pollLen;
+    return gFaultCntx.frameLen;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_pickRx / phPalEse_fault_pickTx
+**
+** Description      Draw one fault for the frame, rates are cumulative
+**
+** Returns          fault to apply, FAULT_NONE for a clean frame
+**
+*******************************************************************************/
+static phPalEse_FaultType_t phPalEse_fault_pickRx(uint8_t pcb)
+{
+    uint32_t r = phPalEse_fault_draw() % PH_PALESE_FAULT_RATE_SCALE;
+    uint32_t limit = 0;
+
+    if (r < (limit += gFaultConfig.rxLrcRate))
+        return FAULT_RX_LRC;
+    if (r < (limit += gFaultConfig.rxDropAckRate))
+        return ((pcb & FAULT_PCB_TYPE_MASK) == FAULT_PCB_R_BLOCK) ? FAULT_RX_DROP_ACK : FAULT_NONE;
+    if (r < (limit += gFaultConfig.rxWtxRate))
+        return (gFaultCntx.heldLen == 0) ? FAULT_RX_WTX : FAULT_NONE;
+    if (r < (limit += gFaultConfig.rxBadPcbRate))
+        return FAULT_RX_BAD_PCB;
+    if (r < (limit += gFaultConfig.rxTruncateRate))
+        return FAULT_RX_TRUNCATE;
+    return FAULT_NONE;
+}
+
+static phPalEse_FaultType_t phPalEse_fault_pickTx(void)
+{
+    uint32_t r = phPalEse_fault_draw() % PH_PALESE_FAULT_RATE_SCALE;
+    uint32_t limit = 0;
+
+    if (r < (limit += gFaultConfig.txLrcRate))
+        return FAULT_TX_LRC;
+    if (r < (limit += gFaultConfig.txDropRate))
+        return FAULT_TX_DROP;
+    return FAULT_NONE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_draw
+**
+** Description      xorshift32, deterministic for a given seed
+**
+** Returns          next pseudo random value
+**
+*******************************************************************************/
+static uint32_t phPalEse_fault_draw(void)
+{
+    uint32_t x = gFaultCntx.prng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gFaultCntx.prng = x;
+    return x;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_fault_computeLrc
+**
+** Description      LRC of a card frame, the SOF is not covered
+**
+** Returns          LRC value
+**
+*******************************************************************************/
+static uint8_t phPalEse_fault_computeLrc(const uint8_t *pFrame, int frameLen)
+{
+    uint8_t lrc = 0;
+    int i;
+
+    for (i = 1; i < frameLen; i++)
+    {
+        lrc ^= pFrame[i];
+    }
+    return lrc;
+}
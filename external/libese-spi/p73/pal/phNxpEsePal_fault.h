@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup eSe_PAL_Fault
+ * \brief Deterministic T=1 link fault injection at the PAL read/write boundary
+ * @{ */
+#ifndef _PHNXPESE_PAL_FAULT_H
+#define _PHNXPESE_PAL_FAULT_H
+
+/* Basic type definitions */
+#include <phEseTypes.h>
+#include <phNxpEsePal.h>
+
+/*!
+ * \brief Fault rates are expressed per million frames
+ */
+#define PH_PALESE_FAULT_RATE_SCALE      1000000UL
+
+/*!
+ * \ingroup eSe_PAL_Fault
+ *
+ * \brief Fault mix applied to the frames crossing the PAL.
+ *        Rx faults act on frames read from the eSE, Tx faults on frames
+ *        written to it. The Rx rates are cumulative and must not exceed
+ *        PH_PALESE_FAULT_RATE_SCALE, same for the Tx rates.
+ */
+typedef struct phPalEse_FaultConfig
+{
+    uint32_t seed;              /*!< PRNG seed, same seed and traffic give the same faults */
+    uint32_t rxLrcRate;         /*!< Flip the LRC of a received frame */
+    uint32_t rxDropAckRate;     /*!< Swallow a received R-block */
+    uint32_t rxWtxRate;         /*!< Insert an unsolicited S(WTX) request before a frame */
+    uint32_t rxBadPcbRate;      /*!< Replace the PCB by an undefined one (LRC kept valid) */
+    uint32_t rxTruncateRate;    /*!< Cut a received frame short, missing bytes read as 0x00 */
+    uint32_t txLrcRate;         /*!< Flip the LRC of a sent frame */
+    uint32_t txDropRate;        /*!< Lose a sent frame */
+} phPalEse_FaultConfig_t;
+
+/*!
+ * \ingroup eSe_PAL_Fault
+ *
+ * \brief Counters of the fault injector
+ */
+typedef struct phPalEse_FaultStats
+{
+    uint32_t rxFrames;          /*!< Frames read from the eSE */
+    uint32_t txFrames;          /*!< Frames written by the host */
+    uint32_t rxLrc;
+    uint32_t rxDropAck;
+    uint32_t rxWtx;
+    uint32_t rxBadPcb;
+    uint32_t rxTruncate;
+    uint32_t txLrc;
+    uint32_t txDrop;
+} phPalEse_FaultStats_t;
+
+/*!
+ * \brief Device access function the injector sits on top of
+ */
+typedef int (*pphPalEse_Fault_IoFn_t)(void *pDevHandle, uint8_t *pBuffer, int nNbBytes);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Sets the fault mix and re-seeds the generator. NULL or all
+ *        rates zero disables the injector.
+ *
+ * \param[in]    pFaultConfig   - fault mix
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_fault_configure(const phPalEse_FaultConfig_t *pFaultConfig);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Loads the fault mix from the NXP_FAULT_* config entries, if
+ *        NXP_FAULT_INJECTION is set to 1
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_fault_loadConfig(void);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Drops any frame held back by the injector, called on device open/close
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_fault_reset(void);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Copies out and optionally clears the injector counters
+ *
+ * \param[out]   pStats         - counters
+ * \param[in]    reset          - TRUE to clear the counters after reading
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_fault_getStats(phPalEse_FaultStats_t *pStats, bool_t reset);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Read through the injector. Each frame is fetched completely on
+ *        its SOF poll and served to the caller from a staging buffer.
+ *
+ * \param[in]    pDevHandle       - valid device handle
+ * \param[in]    pBuffer          - buffer for read data
+ * \param[in]    nNbBytesToRead   - number of bytes requested to be read
+ * \param[in]    pfnRead          - underlying device read
+ *
+ * \retval   numRead      - number of successfully read bytes.
+ * \retval      -1             - read operation failure
+ *
+*/
+int phPalEse_fault_read(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToRead,
+        pphPalEse_Fault_IoFn_t pfnRead);
+
+/**
+ * \ingroup eSe_PAL_Fault
+ * \brief Write through the injector. pBuffer is never modified.
+ *
+ * \param[in]    pDevHandle       - valid device handle
+ * \param[in]    pBuffer          - frame to write
+ * \param[in]    nNbBytesToWrite  - number of bytes to write
+ * \param[in]    pfnWrite         - underlying device write
+ *
+ * \retval  numWrote   - number of successfully written bytes
+ * \retval      -1         - write operation failure
+ *
+ */
+int phPalEse_fault_write(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToWrite,
+        pphPalEse_Fault_IoFn_t pfnWrite);
+/** @} */
+#endif  /*  _PHNXPESE_PAL_FAULT_H    */
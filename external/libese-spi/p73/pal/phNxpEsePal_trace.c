@@ -0,0 +1,996 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * PAL traffic capture and replay
+ *
+ * The recorder encodes every device access into a memory buffer which is
+ * only written to the trace file when full and at device close, so the
+ * cost on the transceive path is a timestamp and a memcpy.
+ *
+ * The replay port serves the recorded card side back to the stack. At the
+ * original time scale card data is served after as many empty SOF polls
+ * as were recorded, which reproduces the poll pattern whatever the speed
+ * of the host. At other scales it becomes readable at the scaled distance
+ * from the preceding host frame. Until then the polls read idle bytes as
+ * they would on the bus.
+ *
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <phNxpLog.h>
+#include <phNxpEsePal_trace.h>
+#include <phEseStatus.h>
+#include <string.h>
+#include <phNxpConfig.h>
+#ifdef ESE_PAL_SIM_INCLUDED
+#include <phNxpEsePal_sim.h>
+#endif
+
+/*!
+ * \brief Recorder buffer, flushed when the next record may not fit
+ */
+#define TRACE_BUF_LEN               (64 * 1024)
+#define TRACE_MAX_RECORD_HDR_LEN    64
+#define TRACE_PATH_LEN              256
+#define TRACE_RECV_PACKET_SOF       0xA5
+/*!
+ * \brief Reads following the SOF poll of a frame (header, then data and LRC)
+ */
+#define TRACE_FRAME_READS           2
+/*!
+ * \brief Dummy handle of the replay port
+ */
+#define TRACE_REPLAY_HANDLE         ((void *)(intptr_t)0x7E1A7)
+
+typedef struct phPalEse_TraceCntx
+{
+    phPalEse_TraceMode_t mode;
+    bool_t started;                 /* mode set through API or config, config not re-read */
+    /* recorder */
+    int fd;
+    uint8_t buf[TRACE_BUF_LEN];
+    uint32_t bufLen;
+    uint64_t lastUs;
+    uint64_t readStartUs;           /* card data is stamped with the start of its read */
+    uint32_t idleCount;
+    uint32_t idleLen;
+    uint64_t idleUs;
+    uint8_t frameReads;
+    /* replay */
+    phPalEse_Trace_t trace;
+    uint32_t timeScale;
+    uint64_t recUs;                 /* recorded time at the replay cursor */
+    uint64_t recWriteUs;            /* recorded time of the last host frame */
+    uint64_t replayWriteUs;         /* replay time of the last host frame */
+    uint32_t idleLeft;              /* recorded empty polls still to be served */
+    bool_t isOpen;
+} phPalEse_TraceCntx_t;
+
+static phPalEse_TraceCntx_t gTraceCntx;
+static phPalEse_TraceStats_t gTraceStats;
+
+static uint64_t phPalEse_trace_nowUs(void);
+static void phPalEse_trace_flush(void);
+static void phPalEse_trace_put(const uint8_t *pData, uint32_t len);
+static uint32_t phPalEse_trace_putVarint(uint8_t *pBuf, uint64_t value);
+static uint64_t phPalEse_trace_zigzag(int64_t value);
+static uint32_t phPalEse_trace_beginRecord(uint8_t *pBuf, phPalEse_TraceRecordType_t type, uint64_t nowUs);
+static void phPalEse_trace_flushIdle(void);
+static bool_t phPalEse_trace_getVarint(phPalEse_Trace_t *pTrace, uint64_t *pValue);
+static bool_t phPalEse_trace_peek(phPalEse_TraceRecord_t *pRecord, uint32_t *pNextPos);
+static void phPalEse_trace_consume(const phPalEse_TraceRecord_t *pRecord, uint32_t nextPos);
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_startRecord
+**
+** Description      Opens the trace file and arms the recorder
+**
+** Parameters       pPath - trace file
+**
+** Returns          ESESTATUS_SUCCESS or ESESTATUS_FAILED
+**
+*******************************************************************************/
+ESESTATUS phPalEse_trace_startRecord(const char *pPath)
+{
+    uint8_t header[PH_PALESE_TRACE_HEADER_LEN] = { 0 };
+
+    phPalEse_trace_stop();
+    gTraceCntx.fd = open(pPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (gTraceCntx.fd < 0)
+    {
+        NXPLOG_PAL_E("%s cannot create %s errno : %x", __FUNCTION__, pPath, errno);
+        return ESESTATUS_FAILED;
+    }
+    memcpy(header, PH_PALESE_TRACE_MAGIC, 4);
+    header[4] = PH_PALESE_TRACE_VERSION;
+    gTraceCntx.bufLen = 0;
+    gTraceCntx.idleCount = 0;
+    gTraceCntx.frameReads = 0;
+    gTraceCntx.lastUs = phPalEse_trace_nowUs();
+    phPalEse_trace_put(header, sizeof(header));
+    gTraceCntx.mode = PH_PALESE_TRACE_MODE_RECORD;
+    gTraceCntx.started = TRUE;
+    NXPLOG_PAL_D("%s recording to %s", __FUNCTION__, pPath);
+    return ESESTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_startReplay
+**
+** Description      Loads the trace and switches the PAL to the replay port
+**
+** Parameters       pPath     - trace file
+**                  timeScale - card latency in percent of the recorded one
+**
+** Returns          ESESTATUS_SUCCESS or ESESTATUS_FAILED
+**
+*******************************************************************************/
+ESESTATUS phPalEse_trace_startReplay(const char *pPath, uint32_t timeScale)
+{
+    phPalEse_trace_stop();
+    if (phPalEse_trace_load(pPath, &gTraceCntx.trace) != ESESTATUS_SUCCESS)
+    {
+        return ESESTATUS_FAILED;
+    }
+    gTraceCntx.timeScale = timeScale;
+    gTraceCntx.recUs = 0;
+    gTraceCntx.recWriteUs = 0;
+    gTraceCntx.replayWriteUs = phPalEse_trace_nowUs();
+    gTraceCntx.idleLeft = 0;
+    gTraceCntx.isOpen = FALSE;
+    gTraceCntx.mode = PH_PALESE_TRACE_MODE_REPLAY;
+    gTraceCntx.started = TRUE;
+    NXPLOG_PAL_D("%s replaying %s at %u%%", __FUNCTION__, pPath, timeScale);
+    return ESESTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_stop
+**
+** Description      Ends recording or replay
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_stop(void)
+{
+    if (gTraceCntx.mode == PH_PALESE_TRACE_MODE_RECORD)
+    {
+        phPalEse_trace_flushIdle();
+        phPalEse_trace_flush();
+        close(gTraceCntx.fd);
+        gTraceCntx.fd = -1;
+    }
+    else if (gTraceCntx.mode == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        phPalEse_trace_unload(&gTraceCntx.trace);
+    }
+    gTraceCntx.mode = PH_PALESE_TRACE_MODE_OFF;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_loadConfig
+**
+** Description      Starts the trace mode set in the config file
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_loadConfig(void)
+{
+#ifdef ESE_DEBUG_UTILS_INCLUDED
+    unsigned long num = 0;
+    unsigned long timeScale = PH_PALESE_TRACE_SCALE_ORIGINAL;
+    char path[TRACE_PATH_LEN];
+
+    if (gTraceCntx.started)
+    {
+        return;
+    }
+    gTraceCntx.started = TRUE;
+    if ((GetNxpNumValue(NAME_NXP_PAL_TRACE_MODE, &num, sizeof(num)) == 0) ||
+            (num == PH_PALESE_TRACE_MODE_OFF))
+    {
+        return;
+    }
+    memset(path, 0x00, sizeof(path));
+    if (GetNxpStrValue(NAME_NXP_PAL_TRACE_FILE, path, sizeof(path)) == 0)
+    {
+        NXPLOG_PAL_E("%s trace mode %lu without trace file", __FUNCTION__, num);
+        return;
+    }
+    if (num == PH_PALESE_TRACE_MODE_RECORD)
+    {
+        phPalEse_trace_startRecord(path);
+    }
+    else if (num == PH_PALESE_TRACE_MODE_REPLAY)
+    {
+        GetNxpNumValue(NAME_NXP_PAL_REPLAY_TIME_SCALE, &timeScale, sizeof(timeScale));
+        phPalEse_trace_startReplay(path, timeScale);
+    }
+#endif
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_getMode
+**
+** Description      Returns the current trace mode
+**
+** Returns          phPalEse_TraceMode_t
+**
+*******************************************************************************/
+phPalEse_TraceMode_t phPalEse_trace_getMode(void)
+{
+    return gTraceCntx.mode;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_getStats
+**
+** Description      Copies out and optionally clears the trace counters
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_getStats(phPalEse_TraceStats_t *pStats, bool_t reset)
+{
+    if (NULL != pStats)
+    {
+        *pStats = gTraceStats;
+    }
+    if (reset)
+    {
+        memset(&gTraceStats, 0x00, sizeof(gTraceStats));
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordOpen
+**
+** Description      Records a device open
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordOpen(ESESTATUS status)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint32_t len;
+
+    if (gTraceCntx.mode != PH_PALESE_TRACE_MODE_RECORD)
+    {
+        return;
+    }
+    gTraceCntx.frameReads = 0;
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_OPEN, phPalEse_trace_nowUs());
+    len += phPalEse_trace_putVarint(&hdr[len], status);
+    phPalEse_trace_put(hdr, len);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordClose
+**
+** Description      Records a device close and flushes the trace so that every
+**                  complete session is on file
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordClose(void)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint32_t len;
+
+    if (gTraceCntx.mode != PH_PALESE_TRACE_MODE_RECORD)
+    {
+        return;
+    }
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_CLOSE, phPalEse_trace_nowUs());
+    phPalEse_trace_put(hdr, len);
+    phPalEse_trace_flush();
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordReadStart
+**
+** Description      Stamps the start of a device read
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordReadStart(void)
+{
+    if (gTraceCntx.mode == PH_PALESE_TRACE_MODE_RECORD)
+    {
+        gTraceCntx.readStartUs = phPalEse_trace_nowUs();
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordRead
+**
+** Description      Records a device read. SOF polls which found no frame are
+**                  folded into a single IDLE record.
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordRead(const uint8_t *pBuffer, int nNbBytesToRead, int ret)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint64_t nowUs;
+    uint32_t len;
+    int i;
+
+    if (gTraceCntx.mode != PH_PALESE_TRACE_MODE_RECORD)
+    {
+        return;
+    }
+    nowUs = gTraceCntx.readStartUs;
+    if (gTraceCntx.frameReads == 0)
+    {
+        for (i = 0; i < ret; i++)
+        {
+            if (pBuffer[i] == TRACE_RECV_PACKET_SOF)
+                break;
+        }
+        if ((ret > 0) && (i == ret))
+        {
+            if ((gTraceCntx.idleCount > 0) && (gTraceCntx.idleLen != (uint32_t)nNbBytesToRead))
+            {
+                phPalEse_trace_flushIdle();
+            }
+            if (gTraceCntx.idleCount++ == 0)
+            {
+                gTraceCntx.idleLen = nNbBytesToRead;
+                gTraceCntx.idleUs = nowUs;
+            }
+            return;
+        }
+        if (ret > 0)
+        {
+            gTraceCntx.frameReads = TRACE_FRAME_READS;
+        }
+    }
+    else
+    {
+        gTraceCntx.frameReads--;
+    }
+    phPalEse_trace_flushIdle();
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_READ, nowUs);
+    len += phPalEse_trace_putVarint(&hdr[len], nNbBytesToRead);
+    len += phPalEse_trace_putVarint(&hdr[len], phPalEse_trace_zigzag(ret));
+    phPalEse_trace_put(hdr, len);
+    if (ret > 0)
+    {
+        phPalEse_trace_put(pBuffer, ret);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordWrite
+**
+** Description      Records a device write
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordWrite(const uint8_t *pBuffer, int nNbBytesToWrite, int ret)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint32_t len;
+
+    if (gTraceCntx.mode != PH_PALESE_TRACE_MODE_RECORD)
+    {
+        return;
+    }
+    phPalEse_trace_flushIdle();
+    gTraceCntx.frameReads = 0;
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_WRITE, phPalEse_trace_nowUs());
+    len += phPalEse_trace_putVarint(&hdr[len], nNbBytesToWrite);
+    len += phPalEse_trace_putVarint(&hdr[len], phPalEse_trace_zigzag(ret));
+    phPalEse_trace_put(hdr, len);
+    phPalEse_trace_put(pBuffer, nNbBytesToWrite);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_recordIoctl
+**
+** Description      Records an ioctl, with the SPM state for phPalEse_e_GetSPMStatus
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_recordIoctl(phPalEse_ControlCode_t eControlCode, long level, int ret)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint32_t len;
+    uint32_t value = 0;
+
+    if (gTraceCntx.mode != PH_PALESE_TRACE_MODE_RECORD)
+    {
+        return;
+    }
+    if (eControlCode == phPalEse_e_GetSPMStatus)
+    {
+        value = (uint32_t)*((int32_t *)level);
+        level = 0;
+    }
+    phPalEse_trace_flushIdle();
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_IOCTL, phPalEse_trace_nowUs());
+    len += phPalEse_trace_putVarint(&hdr[len], eControlCode);
+    len += phPalEse_trace_putVarint(&hdr[len], phPalEse_trace_zigzag(level));
+    len += phPalEse_trace_putVarint(&hdr[len], phPalEse_trace_zigzag(ret));
+    len += phPalEse_trace_putVarint(&hdr[len], value);
+    phPalEse_trace_put(hdr, len);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_replayOpen
+**
+** Description      Opens the replay port on the next recorded session
+**
+** Returns          recorded open status, ESESTATUS_INVALID_DEVICE if the trace
+**                  has no session left
+**
+*******************************************************************************/
+ESESTATUS phPalEse_trace_replayOpen(pphPalEse_Config_t pConfig)
+{
+    phPalEse_TraceRecord_t record;
+    uint32_t nextPos;
+
+    pConfig->pDevHandle = NULL;
+    while (phPalEse_trace_peek(&record, &nextPos))
+    {
+        phPalEse_trace_consume(&record, nextPos);
+        if (record.type == PH_PALESE_TRACE_OPEN)
+        {
+            if (record.ret == ESESTATUS_SUCCESS)
+            {
+                pConfig->pDevHandle = TRACE_REPLAY_HANDLE;
+                gTraceCntx.isOpen = TRUE;
+            }
+            gTraceCntx.recWriteUs = gTraceCntx.recUs;
+            gTraceCntx.replayWriteUs = phPalEse_trace_nowUs();
+            return (ESESTATUS)record.ret;
+        }
+        if (record.type == PH_PALESE_TRACE_READ)
+        {
+            gTraceStats.readsSkipped++;
+        }
+    }
+    NXPLOG_PAL_E("%s no recorded session left", __FUNCTION__);
+    return ESESTATUS_INVALID_DEVICE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_replayClose
+**
+** Description      Closes the replay port, skipping what is left of the session
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_replayClose(void *pDevHandle)
+{
+    phPalEse_TraceRecord_t record;
+    uint32_t nextPos;
+
+    UNUSED(pDevHandle);
+    while (phPalEse_trace_peek(&record, &nextPos))
+    {
+        if (record.type == PH_PALESE_TRACE_OPEN)
+        {
+            break;
+        }
+        phPalEse_trace_consume(&record, nextPos);
+        if (record.type == PH_PALESE_TRACE_CLOSE)
+        {
+            break;
+        }
+        if (record.type == PH_PALESE_TRACE_READ)
+        {
+            gTraceStats.readsSkipped++;
+        }
+    }
+    gTraceCntx.isOpen = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_replayRead
+**
+** Description      Serves the next recorded card data once due, idle bytes before
+**
+** Returns          number of bytes read
+**
+*******************************************************************************/
+int phPalEse_trace_replayRead(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToRead)
+{
+    phPalEse_TraceRecord_t record;
+    uint32_t nextPos;
+    uint64_t dueUs;
+    int len;
+
+    UNUSED(pDevHandle);
+    gTraceStats.readCalls++;
+    memset(pBuffer, 0x00, nNbBytesToRead);
+    if (!phPalEse_trace_peek(&record, &nextPos) || (record.type != PH_PALESE_TRACE_READ))
+    {
+        if (gTraceCntx.idleLeft > 0)
+        {
+            /* Recorded polls that timed out */
+            gTraceCntx.idleLeft--;
+        }
+        else
+        {
+            /* The new build reads more than the recorded one did */
+            gTraceStats.readUnderruns++;
+        }
+        return nNbBytesToRead;
+    }
+    if (gTraceCntx.timeScale == PH_PALESE_TRACE_SCALE_ORIGINAL)
+    {
+        if (gTraceCntx.idleLeft > 0)
+        {
+            gTraceCntx.idleLeft--;
+            return nNbBytesToRead;
+        }
+    }
+    else
+    {
+        dueUs = gTraceCntx.replayWriteUs +
+                ((gTraceCntx.recUs + record.deltaUs - gTraceCntx.recWriteUs) * gTraceCntx.timeScale) /
+                PH_PALESE_TRACE_SCALE_ORIGINAL;
+        if (phPalEse_trace_nowUs() < dueUs)
+        {
+            return nNbBytesToRead;
+        }
+    }
+    gTraceCntx.idleLeft = 0;
+    phPalEse_trace_consume(&record, nextPos);
+    if (record.ret <= 0)
+    {
+        return record.ret;
+    }
+    len = (record.ret < nNbBytesToRead) ? record.ret : nNbBytesToRead;
+    memcpy(pBuffer, record.pData, len);
+    return nNbBytesToRead;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_replayWrite
+**
+** Description      Matches the host frame against the next recorded one
+**
+** Returns          recorded return value of the write
+**
+*******************************************************************************/
+int phPalEse_trace_replayWrite(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToWrite)
+{
+    phPalEse_TraceRecord_t record;
+    uint32_t nextPos;
+
+    UNUSED(pDevHandle);
+    gTraceStats.writeCalls++;
+    while (phPalEse_trace_peek(&record, &nextPos) && (record.type == PH_PALESE_TRACE_READ))
+    {
+        /* The new build stopped reading before the recorded one did */
+        phPalEse_trace_consume(&record, nextPos);
+        gTraceStats.readsSkipped++;
+    }
+    gTraceCntx.replayWriteUs = phPalEse_trace_nowUs();
+    if (!phPalEse_trace_peek(&record, &nextPos) || (record.type != PH_PALESE_TRACE_WRITE))
+    {
+        gTraceCntx.idleLeft = 0;
+        gTraceStats.writeMismatches++;
+        gTraceCntx.recWriteUs = gTraceCntx.recUs;
+        return nNbBytesToWrite;
+    }
+    phPalEse_trace_consume(&record, nextPos);
+    gTraceCntx.recWriteUs = gTraceCntx.recUs;
+    gTraceCntx.idleLeft = 0;
+    if ((record.len != (uint32_t)nNbBytesToWrite) ||
+            (memcmp(record.pData, pBuffer, nNbBytesToWrite) != 0))
+    {
+        NXPLOG_PAL_D("%s host frame differs from the trace", __FUNCTION__);
+        gTraceStats.writeMismatches++;
+        return nNbBytesToWrite;
+    }
+    return record.ret;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_replayIoctl
+**
+** Description      Returns the recorded result of the next ioctl
+**
+** Returns          recorded return value, 0 for an unexpected ioctl
+**
+*******************************************************************************/
+int phPalEse_trace_replayIoctl(phPalEse_ControlCode_t eControlCode, void *pDevHandle, long level)
+{
+    phPalEse_TraceRecord_t record;
+    uint32_t nextPos;
+
+    UNUSED(pDevHandle);
+    gTraceStats.ioctlCalls++;
+    if (!phPalEse_trace_peek(&record, &nextPos) || (record.type != PH_PALESE_TRACE_IOCTL) ||
+            (record.code != (uint32_t)eControlCode))
+    {
+        gTraceStats.ioctlMismatches++;
+        if (eControlCode == phPalEse_e_GetSPMStatus)
+        {
+            *((int32_t *)level) = 0;
+        }
+        return 0;
+    }
+    phPalEse_trace_consume(&record, nextPos);
+    if (eControlCode == phPalEse_e_GetSPMStatus)
+    {
+        *((int32_t *)level) = (int32_t)record.value;
+    }
+    return record.ret;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_load
+**
+** Description      Reads a trace file in memory
+**
+** Returns          ESESTATUS_SUCCESS or ESESTATUS_FAILED
+**
+*******************************************************************************/
+ESESTATUS phPalEse_trace_load(const char *pPath, phPalEse_Trace_t *pTrace)
+{
+    struct stat st;
+    int fd;
+    ssize_t got;
+    uint32_t total = 0;
+
+    memset(pTrace, 0x00, sizeof(*pTrace));
+    fd = open(pPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        NXPLOG_PAL_E("%s cannot open %s errno : %x", __FUNCTION__, pPath, errno);
+        return ESESTATUS_FAILED;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < PH_PALESE_TRACE_HEADER_LEN))
+    {
+        close(fd);
+        return ESESTATUS_FAILED;
+    }
+    pTrace->pBuf = (uint8_t *)malloc(st.st_size);
+    if (pTrace->pBuf == NULL)
+    {
+        close(fd);
+        return ESESTATUS_FAILED;
+    }
+    while (total < (uint32_t)st.st_size)
+    {
+        got = read(fd, &pTrace->pBuf[total], st.st_size - total);
+        if (got <= 0)
+            break;
+        total += got;
+    }
+    close(fd);
+    if ((total != (uint32_t)st.st_size) || (memcmp(pTrace->pBuf, PH_PALESE_TRACE_MAGIC, 4) != 0) ||
+            (pTrace->pBuf[4] != PH_PALESE_TRACE_VERSION))
+    {
+        NXPLOG_PAL_E("%s %s is not a trace", __FUNCTION__, pPath);
+        phPalEse_trace_unload(pTrace);
+        return ESESTATUS_FAILED;
+    }
+    pTrace->len = total;
+    pTrace->pos = PH_PALESE_TRACE_HEADER_LEN;
+    return ESESTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_next
+**
+** Description      Decodes the record at the trace position and moves past it
+**
+** Returns          TRUE if a record was decoded
+**
+*******************************************************************************/
+bool_t phPalEse_trace_next(phPalEse_Trace_t *pTrace, phPalEse_TraceRecord_t *pRecord)
+{
+    uint64_t v1 = 0, v2 = 0, v3 = 0, v4 = 0;
+    uint32_t start = pTrace->pos;
+
+    memset(pRecord, 0x00, sizeof(*pRecord));
+    if ((pTrace->pBuf == NULL) || (pTrace->pos >= pTrace->len))
+    {
+        return FALSE;
+    }
+    pRecord->type = (phPalEse_TraceRecordType_t)pTrace->pBuf[pTrace->pos++];
+    if (!phPalEse_trace_getVarint(pTrace, &pRecord->deltaUs))
+    {
+        goto corrupted;
+    }
+    switch (pRecord->type)
+    {
+    case PH_PALESE_TRACE_OPEN:
+        if (!phPalEse_trace_getVarint(pTrace, &v1))
+            goto corrupted;
+        pRecord->ret = (int32_t)v1;
+        break;
+    case PH_PALESE_TRACE_CLOSE:
+        break;
+    case PH_PALESE_TRACE_WRITE:
+    case PH_PALESE_TRACE_READ:
+        if (!phPalEse_trace_getVarint(pTrace, &v1) || !phPalEse_trace_getVarint(pTrace, &v2))
+            goto corrupted;
+        pRecord->len = (uint32_t)v1;
+        pRecord->ret = (int32_t)((v2 >> 1) ^ -(int64_t)(v2 & 1));
+        v3 = (pRecord->type == PH_PALESE_TRACE_WRITE) ? pRecord->len :
+                ((pRecord->ret > 0) ? (uint64_t)pRecord->ret : 0);
+        if (v3 > (uint64_t)(pTrace->len - pTrace->pos))
+            goto corrupted;
+        pRecord->pData = &pTrace->pBuf[pTrace->pos];
+        pTrace->pos += (uint32_t)v3;
+        break;
+    case PH_PALESE_TRACE_IDLE:
+        if (!phPalEse_trace_getVarint(pTrace, &v1) || !phPalEse_trace_getVarint(pTrace, &v2))
+            goto corrupted;
+        pRecord->count = (uint32_t)v1;
+        pRecord->len = (uint32_t)v2;
+        break;
+    case PH_PALESE_TRACE_IOCTL:
+        if (!phPalEse_trace_getVarint(pTrace, &v1) || !phPalEse_trace_getVarint(pTrace, &v2) ||
+                !phPalEse_trace_getVarint(pTrace, &v3) || !phPalEse_trace_getVarint(pTrace, &v4))
+            goto corrupted;
+        pRecord->code = (uint32_t)v1;
+        pRecord->level = (int64_t)((v2 >> 1) ^ -(int64_t)(v2 & 1));
+        pRecord->ret = (int32_t)((v3 >> 1) ^ -(int64_t)(v3 & 1));
+        pRecord->value = (uint32_t)v4;
+        break;
+    default:
+        goto corrupted;
+    }
+    return TRUE;
+
+corrupted:
+    NXPLOG_PAL_E("%s corrupted record at offset %u", __FUNCTION__, start);
+    pTrace->pos = pTrace->len;
+    return FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_unload
+**
+** Description      Frees a loaded trace
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_trace_unload(phPalEse_Trace_t *pTrace)
+{
+    if (pTrace->pBuf != NULL)
+    {
+        free(pTrace->pBuf);
+    }
+    memset(pTrace, 0x00, sizeof(*pTrace));
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_peek
+**
+** Description      Decodes the next replay record without consuming it. IDLE
+**                  records only carry timing and are consumed on the way.
+**
+** Returns          TRUE if a record is available
+**
+*******************************************************************************/
+static bool_t phPalEse_trace_peek(phPalEse_TraceRecord_t *pRecord, uint32_t *pNextPos)
+{
+    phPalEse_Trace_t *pTrace = &gTraceCntx.trace;
+    uint32_t pos;
+
+    for (;;)
+    {
+        pos = pTrace->pos;
+        if (!phPalEse_trace_next(pTrace, pRecord))
+        {
+            return FALSE;
+        }
+        if (pRecord->type != PH_PALESE_TRACE_IDLE)
+        {
+            *pNextPos = pTrace->pos;
+            pTrace->pos = pos;
+            return TRUE;
+        }
+        gTraceCntx.recUs += pRecord->deltaUs;
+        gTraceCntx.idleLeft += pRecord->count;
+    }
+}
+
+static void phPalEse_trace_consume(const phPalEse_TraceRecord_t *pRecord, uint32_t nextPos)
+{
+    gTraceCntx.trace.pos = nextPos;
+    gTraceCntx.recUs += pRecord->deltaUs;
+    gTraceStats.records++;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_flushIdle
+**
+** Description      Emits the pending IDLE record
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_trace_flushIdle(void)
+{
+    uint8_t hdr[TRACE_MAX_RECORD_HDR_LEN];
+    uint32_t len;
+
+    if (gTraceCntx.idleCount == 0)
+    {
+        return;
+    }
+    len = phPalEse_trace_beginRecord(hdr, PH_PALESE_TRACE_IDLE, gTraceCntx.idleUs);
+    len += phPalEse_trace_putVarint(&hdr[len], gTraceCntx.idleCount);
+    len += phPalEse_trace_putVarint(&hdr[len], gTraceCntx.idleLen);
+    gTraceCntx.idleCount = 0;
+    phPalEse_trace_put(hdr, len);
+}
+
+static uint32_t phPalEse_trace_beginRecord(uint8_t *pBuf, phPalEse_TraceRecordType_t type, uint64_t nowUs)
+{
+    uint64_t deltaUs = (nowUs > gTraceCntx.lastUs) ? (nowUs - gTraceCntx.lastUs) : 0;
+
+    gTraceCntx.lastUs = nowUs;
+    gTraceStats.records++;
+    pBuf[0] = (uint8_t)type;
+    return 1 + phPalEse_trace_putVarint(&pBuf[1], deltaUs);
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_put
+**
+** Description      Appends to the recorder buffer, flushing it when full
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_trace_put(const uint8_t *pData, uint32_t len)
+{
+    uint32_t chunk;
+
+    gTraceStats.bytes += len;
+    while (len > 0)
+    {
+        if (gTraceCntx.bufLen == TRACE_BUF_LEN)
+        {
+            phPalEse_trace_flush();
+        }
+        chunk = TRACE_BUF_LEN - gTraceCntx.bufLen;
+        if (chunk > len)
+            chunk = len;
+        memcpy(&gTraceCntx.buf[gTraceCntx.bufLen], pData, chunk);
+        gTraceCntx.bufLen += chunk;
+        pData += chunk;
+        len -= chunk;
+    }
+}
+
+static void phPalEse_trace_flush(void)
+{
+    uint32_t done = 0;
+    ssize_t ret;
+
+    while ((gTraceCntx.fd >= 0) && (done < gTraceCntx.bufLen))
+    {
+        ret = write(gTraceCntx.fd, &gTraceCntx.buf[done], gTraceCntx.bufLen - done);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            NXPLOG_PAL_E("%s trace write failed errno : %x", __FUNCTION__, errno);
+            break;
+        }
+        done += ret;
+    }
+    gTraceCntx.bufLen = 0;
+}
+
+static uint32_t phPalEse_trace_putVarint(uint8_t *pBuf, uint64_t value)
+{
+    uint32_t len = 0;
+
+    while (value >= 0x80)
+    {
+        pBuf[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    pBuf[len++] = (uint8_t)value;
+    return len;
+}
+
+static uint64_t phPalEse_trace_zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static bool_t phPalEse_trace_getVarint(phPalEse_Trace_t *pTrace, uint64_t *pValue)
+{
+    uint64_t value = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+
+    do
+    {
+        if ((pTrace->pos >= pTrace->len) || (shift > 63))
+        {
+            return FALSE;
+        }
+        byte = pTrace->pBuf[pTrace->pos++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    *pValue = value;
+    return TRUE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_trace_nowUs
+**
+** Description      Time base of the trace, the simulated clock on host builds
+**
+** Returns          time in micro seconds
+**
+*******************************************************************************/
+static uint64_t phPalEse_trace_nowUs(void)
+{
+#ifdef ESE_PAL_SIM_INCLUDED
+    return phPalEse_sim_getTimeUs();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+#endif
+}
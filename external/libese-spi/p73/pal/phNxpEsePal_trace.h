@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup eSe_PAL_Trace
+ * \brief Capture and replay of the traffic crossing the PAL
+ *
+ * A trace is a header followed by records. Every record starts with its
+ * type and the time elapsed since the previous record in micro seconds,
+ * all integers are LEB128 varints (signed values zigzag encoded):
+ *
+ *   OPEN   status
+ *   CLOSE
+ *   WRITE  len ret data[len]
+ *   READ   len ret data[ret]
+ *   IDLE   count len           - count polls of len bytes without SOF
+ *   IOCTL  code level ret value
+ *
+ * @{ */
+#ifndef _PHNXPESE_PAL_TRACE_H
+#define _PHNXPESE_PAL_TRACE_H
+
+/* Basic type definitions */
+#include <phEseTypes.h>
+#include <phNxpEsePal.h>
+
+/*!
+ * \brief Trace file magic and format version
+ */
+#define PH_PALESE_TRACE_MAGIC           "ESET"
+#define PH_PALESE_TRACE_VERSION         0x01
+#define PH_PALESE_TRACE_HEADER_LEN      8
+/*!
+ * \brief Time scale meaning "as recorded", in percent
+ */
+#define PH_PALESE_TRACE_SCALE_ORIGINAL  100
+
+/*!
+ * \ingroup eSe_PAL_Trace
+ *
+ * \brief Trace record types
+ */
+typedef enum
+{
+    PH_PALESE_TRACE_OPEN = 0x01,
+    PH_PALESE_TRACE_CLOSE,
+    PH_PALESE_TRACE_WRITE,
+    PH_PALESE_TRACE_READ,
+    PH_PALESE_TRACE_IDLE,
+    PH_PALESE_TRACE_IOCTL
+} phPalEse_TraceRecordType_t;
+
+/*!
+ * \ingroup eSe_PAL_Trace
+ *
+ * \brief Trace mode, NXP_PAL_TRACE_MODE in the config file
+ */
+typedef enum
+{
+    PH_PALESE_TRACE_MODE_OFF = 0,
+    PH_PALESE_TRACE_MODE_RECORD,
+    PH_PALESE_TRACE_MODE_REPLAY
+} phPalEse_TraceMode_t;
+
+/*!
+ * \ingroup eSe_PAL_Trace
+ *
+ * \brief One decoded trace record. pData points into the loaded trace.
+ */
+typedef struct phPalEse_TraceRecord
+{
+    phPalEse_TraceRecordType_t type;
+    uint64_t deltaUs;           /*!< Time since the previous record */
+    uint32_t len;               /*!< WRITE/READ: requested length, IDLE: poll length */
+    int32_t ret;                /*!< Return value of the call, OPEN: status */
+    const uint8_t *pData;       /*!< WRITE/READ data */
+    uint32_t count;             /*!< IDLE: number of polls */
+    uint32_t code;              /*!< IOCTL: phPalEse_ControlCode_t */
+    int64_t level;              /*!< IOCTL: level, 0 when it carries a pointer */
+    uint32_t value;             /*!< IOCTL: value returned through the level pointer */
+} phPalEse_TraceRecord_t;
+
+/*!
+ * \ingroup eSe_PAL_Trace
+ *
+ * \brief A trace loaded in memory
+ */
+typedef struct phPalEse_Trace
+{
+    uint8_t *pBuf;
+    uint32_t len;
+    uint32_t pos;
+} phPalEse_Trace_t;
+
+/*!
+ * \ingroup eSe_PAL_Trace
+ *
+ * \brief Recorder and replay counters. The call counters match the
+ *        syscalls the same sequence issues on the device.
+ */
+typedef struct phPalEse_TraceStats
+{
+    uint32_t records;           /*!< Records written or consumed */
+    uint32_t bytes;             /*!< Trace bytes written */
+    uint32_t readCalls;
+    uint32_t writeCalls;
+    uint32_t ioctlCalls;
+    uint32_t writeMismatches;   /*!< Replay: host frame differs from the recorded one */
+    uint32_t ioctlMismatches;   /*!< Replay: unexpected ioctl */
+    uint32_t readUnderruns;     /*!< Replay: host read with no recorded card data left */
+    uint32_t readsSkipped;      /*!< Replay: recorded card data never read by the host */
+} phPalEse_TraceStats_t;
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Starts recording the PAL traffic into pPath, from the next device open
+ *
+ * \param[in]    pPath          - trace file, truncated
+ *
+ * \retval  ESESTATUS_SUCCESS on success, ESESTATUS_FAILED if the file can't be created
+ *
+ */
+ESESTATUS phPalEse_trace_startRecord(const char *pPath);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Loads pPath and serves the recorded card side instead of the device
+ *
+ * \param[in]    pPath          - trace file
+ * \param[in]    timeScale      - card latency in percent of the recorded one, 0 for none
+ *
+ * \retval  ESESTATUS_SUCCESS on success, ESESTATUS_FAILED if the trace can't be loaded
+ *
+ */
+ESESTATUS phPalEse_trace_startReplay(const char *pPath, uint32_t timeScale);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Flushes and closes the recording, or ends the replay
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_trace_stop(void);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Starts recording or replay from NXP_PAL_TRACE_MODE/NXP_PAL_TRACE_FILE,
+ *        if not already started through the API
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_trace_loadConfig(void);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Returns the current trace mode
+ *
+ * \retval   phPalEse_TraceMode_t
+ *
+ */
+phPalEse_TraceMode_t phPalEse_trace_getMode(void);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Copies out and optionally clears the trace counters
+ *
+ * \param[out]   pStats         - counters
+ * \param[in]    reset          - TRUE to clear the counters after reading
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_trace_getStats(phPalEse_TraceStats_t *pStats, bool_t reset);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Recorder hooks, called by the PAL after each device access.
+ *        They return at once when not recording. Reads are stamped with
+ *        phPalEse_trace_recordReadStart, when the card data was found.
+ *
+ */
+void phPalEse_trace_recordOpen(ESESTATUS status);
+void phPalEse_trace_recordReadStart(void);
+void phPalEse_trace_recordClose(void);
+void phPalEse_trace_recordRead(const uint8_t *pBuffer, int nNbBytesToRead, int ret);
+void phPalEse_trace_recordWrite(const uint8_t *pBuffer, int nNbBytesToWrite, int ret);
+void phPalEse_trace_recordIoctl(phPalEse_ControlCode_t eControlCode, long level, int ret);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Replay port, used by the PAL in place of the device in replay mode
+ *
+ */
+ESESTATUS phPalEse_trace_replayOpen(pphPalEse_Config_t pConfig);
+void phPalEse_trace_replayClose(void *pDevHandle);
+int phPalEse_trace_replayRead(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToRead);
+int phPalEse_trace_replayWrite(void *pDevHandle, uint8_t *pBuffer, int nNbBytesToWrite);
+int phPalEse_trace_replayIoctl(phPalEse_ControlCode_t eControlCode, void *pDevHandle, long level);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Loads a trace file in memory and checks its header
+ *
+ * \param[in]    pPath          - trace file
+ * \param[out]   pTrace         - loaded trace, positioned on the first record
+ *
+ * \retval  ESESTATUS_SUCCESS on success, ESESTATUS_FAILED otherwise
+ *
+ */
+ESESTATUS phPalEse_trace_load(const char *pPath, phPalEse_Trace_t *pTrace);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Decodes the next record of a loaded trace
+ *
+ * \param[in]    pTrace         - loaded trace
+ * \param[out]   pRecord        - decoded record
+ *
+ * \retval  TRUE if a record was decoded, FALSE at the end or on a corrupted record
+ *
+ */
+bool_t phPalEse_trace_next(phPalEse_Trace_t *pTrace, phPalEse_TraceRecord_t *pRecord);
+
+/**
+ * \ingroup eSe_PAL_Trace
+ * \brief Frees a loaded trace
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_trace_unload(phPalEse_Trace_t *pTrace);
+/** @} */
+#endif  /*  _PHNXPESE_PAL_TRACE_H    */
@@ -0,0 +1,823 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Simulated eSE port for host builds
+ *
+ * Emulates the card side of the T=1 link (I/R/S blocks, chaining, WTX,
+ * resynch/interface reset) and the SPM part of the driver, so that the
+ * complete stack above the PAL can be exercised without /dev/p73.
+ *
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <phNxpLog.h>
+#include <phNxpEsePal_sim.h>
+#include <phEseStatus.h>
+#include <string.h>
+
+/*!
+ * \brief Start of frame marker sent by the card
+ */
+#define SIM_RECV_PACKET_SOF         0xA5
+/*!
+ * \brief T=1 prologue (NAD/SOF, PCB, LEN) and epilogue (LRC) length
+ */
+#define SIM_HEADER_LEN              3
+#define SIM_LRC_LEN                 1
+#define SIM_MAX_FRAME_LEN           (SIM_HEADER_LEN + 0xFF + SIM_LRC_LEN)
+/*!
+ * \brief PCB coding
+ */
+#define SIM_PCB_I_NS                0x40
+#define SIM_PCB_I_MORE              0x20
+#define SIM_PCB_R_BLOCK             0x80
+#define SIM_PCB_R_NR                0x10
+#define SIM_PCB_R_PARITY_ERR        0x01
+#define SIM_PCB_R_OTHER_ERR         0x02
+#define SIM_PCB_S_BLOCK             0xC0
+#define SIM_PCB_S_RSP               0x20
+#define SIM_S_RESYNCH               0x00
+#define SIM_S_IFS                   0x01
+#define SIM_S_WTX                   0x03
+#define SIM_S_INTF_RESET            0x04
+#define SIM_S_END_OF_APDU           0x05
+/*!
+ * \brief Mirror of the SPM state bits reported by the ESE driver
+ */
+#define SIM_SPM_STATE_IDLE          0x0100
+#define SIM_SPM_STATE_WIRED         0x0200
+#define SIM_SPM_STATE_SPI           0x0400
+#define SIM_SPM_STATE_SPI_PRIO      0x1000
+#define SIM_SPM_STATE_JCOP_DWNLD    0x8000
+/*!
+ * \brief JCOP download states written by the SPM layer
+ */
+#define SIM_JCP_DWNLD_INIT          0x8010
+#define SIM_JCP_SPI_DWNLD_COMPLETE  0x8040
+#define SIM_JCP_DWP_DWNLD_COMPLETE  0x8080
+
+/*!
+ * \brief Simulated card context
+ */
+typedef struct phPalEse_SimCntx
+{
+    bool_t isOpen;
+    uint32_t spmState;
+    uint64_t virtualNs;                 /* simulated clock */
+    uint8_t sendSeqNo;                  /* N(S) of the next I-block sent by the card */
+    uint8_t recvSeqNo;                  /* N(S) expected in the next host I-block */
+    uint8_t wtxLeft;                    /* S(WTX) requests still to be sent for the current APDU */
+    uint32_t apduLen;
+    uint32_t rspLen;
+    uint32_t rspOffset;
+    uint8_t txFrame[SIM_MAX_FRAME_LEN]; /* last frame sent, kept for retransmission */
+    uint32_t txLen;
+    uint32_t txPos;
+    bool_t txPending;                   /* txFrame not yet completely clocked out */
+    uint64_t txReadyNs;                 /* time at which txFrame becomes visible */
+    uint8_t apdu[PH_PALESE_SIM_MAX_APDU_LEN];
+    uint8_t rsp[PH_PALESE_SIM_MAX_APDU_LEN];
+} phPalEse_SimCntx_t;
+
+/*!
+ * \brief INF of the S(WTX) request: one waiting time extension unit
+ */
+static const uint8_t gSimWtxInf[] = {0x01};
+
+static phPalEse_SimCntx_t gSimCntx;
+static phPalEse_SimStats_t gSimStats;
+static bool_t gSimWired = FALSE;        /* DWP session of the NFCC, outlives the device */
+static phPalEse_SimConfig_t gSimConfig = {
+    TRUE,
+    PH_PALESE_SIM_BYTE_TIME_NS,
+    PH_PALESE_SIM_FRAME_GUARD_US,
+    PH_PALESE_SIM_APDU_PROC_US,
+    0,
+    PH_PALESE_SIM_IFSD
+};
+
+static uint64_t phPalEse_sim_now(void);
+static uint8_t phPalEse_sim_computeLRC(const uint8_t *p_buff, uint32_t offset, uint32_t length);
+static void phPalEse_sim_resetLink(void);
+static void phPalEse_sim_queueFrame(uint8_t pcb, const uint8_t *p_inf, uint8_t len, uint32_t delayUs);
+static void phPalEse_sim_retransmit(void);
+static void phPalEse_sim_sendNextIblock(uint32_t delayUs);
+static void phPalEse_sim_processApdu(void);
+static void phPalEse_sim_handleIblock(uint8_t pcb, const uint8_t *p_inf, uint8_t len);
+static void phPalEse_sim_handleRblock(uint8_t pcb);
+static void phPalEse_sim_handleSblock(uint8_t pcb, const uint8_t *p_inf, uint8_t len);
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_now
+**
+** Description      Returns the current simulation time in nano seconds
+**
+** Returns          time in nano seconds
+**
+*******************************************************************************/
+static uint64_t phPalEse_sim_now(void)
+{
+    struct timespec ts;
+    if (gSimConfig.virtualTime)
+    {
+        return gSimCntx.virtualNs;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_computeLRC
+**
+** Description      XOR of p_buff[offset] .. p_buff[length - 1]
+**
+** Returns          LRC
+**
+*******************************************************************************/
+static uint8_t phPalEse_sim_computeLRC(const uint8_t *p_buff, uint32_t offset, uint32_t length)
+{
+    uint8_t lrc = 0;
+    uint32_t i;
+    for (i = offset; i < length; i++)
+    {
+        lrc ^= p_buff[i];
+    }
+    return lrc;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_resetLink
+**
+** Description      Resets the card side T=1 state as done on RESYNCH,
+**                  interface reset and power cycle
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_resetLink(void)
+{
+    gSimCntx.sendSeqNo = 0;
+    gSimCntx.recvSeqNo = 0;
+    gSimCntx.wtxLeft = 0;
+    gSimCntx.apduLen = 0;
+    gSimCntx.rspLen = 0;
+    gSimCntx.rspOffset = 0;
+    gSimCntx.txLen = 0;
+    gSimCntx.txPos = 0;
+    gSimCntx.txPending = FALSE;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_queueFrame
+**
+** Description      Builds a card frame and makes it readable by the host
+**                  after the card turnaround time plus delayUs
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_queueFrame(uint8_t pcb, const uint8_t *p_inf, uint8_t len, uint32_t delayUs)
+{
+    gSimCntx.txFrame[0] = SIM_RECV_PACKET_SOF;
+    gSimCntx.txFrame[1] = pcb;
+    gSimCntx.txFrame[2] = len;
+    if (len > 0)
+    {
+        memcpy(&gSimCntx.txFrame[SIM_HEADER_LEN], p_inf, len);
+    }
+    gSimCntx.txLen = SIM_HEADER_LEN + len + SIM_LRC_LEN;
+    gSimCntx.txFrame[gSimCntx.txLen - 1] = phPalEse_sim_computeLRC(gSimCntx.txFrame, 1,
+            gSimCntx.txLen - 1);
+    gSimCntx.txPos = 0;
+    gSimCntx.txPending = TRUE;
+    gSimCntx.txReadyNs = phPalEse_sim_now() +
+            ((uint64_t)(gSimConfig.frameGuardUs + delayUs) * 1000ULL);
+    gSimStats.framesTx++;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_retransmit
+**
+** Description      Makes the last sent frame readable again. An R-NACK is
+**                  sent instead if the card has not sent anything yet.
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_retransmit(void)
+{
+    if (0 == gSimCntx.txLen)
+    {
+        phPalEse_sim_queueFrame(SIM_PCB_R_BLOCK | SIM_PCB_R_OTHER_ERR |
+                (gSimCntx.recvSeqNo ? SIM_PCB_R_NR : 0), NULL, 0, 0);
+        return;
+    }
+    gSimCntx.txPos = 0;
+    gSimCntx.txPending = TRUE;
+    gSimCntx.txReadyNs = phPalEse_sim_now() + ((uint64_t)gSimConfig.frameGuardUs * 1000ULL);
+    gSimStats.retransmits++;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_sendNextIblock
+**
+** Description      Queues the next (possibly chained) part of the response
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_sendNextIblock(uint32_t delayUs)
+{
+    uint32_t remaining = gSimCntx.rspLen - gSimCntx.rspOffset;
+    uint8_t chunk = (remaining > gSimConfig.ifsd) ? gSimConfig.ifsd : (uint8_t)remaining;
+    uint8_t pcb = gSimCntx.sendSeqNo ? SIM_PCB_I_NS : 0x00;
+
+    if (remaining > chunk)
+    {
+        pcb |= SIM_PCB_I_MORE;
+    }
+    phPalEse_sim_queueFrame(pcb, &gSimCntx.rsp[gSimCntx.rspOffset], chunk, delayUs);
+    gSimCntx.rspOffset += chunk;
+    gSimCntx.sendSeqNo ^= 1;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_processApdu
+**
+** Description      Card application model: the response carries Le bytes
+**                  of data (short or extended coding) followed by 90 00.
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_processApdu(void)
+{
+    const uint8_t *p_apdu = gSimCntx.apdu;
+    uint32_t len = gSimCntx.apduLen;
+    uint32_t le = 0, lc = 0, i;
+
+    if (len == 5)
+    {
+        le = p_apdu[4] ? p_apdu[4] : 256;                   /* case 2S */
+    }
+    else if ((len > 5) && (p_apdu[4] != 0x00))
+    {
+        lc = p_apdu[4];
+        if (len == (6 + lc))
+            le = p_apdu[len - 1] ? p_apdu[len - 1] : 256;   /* case 4S */
+    }
+    else if ((len == 7) && (p_apdu[4] == 0x00))
+    {
+        le = (p_apdu[5] << 8) | p_apdu[6];                  /* case 2E */
+        if (0 == le)
+            le = 65536;
+    }
+    else if ((len > 7) && (p_apdu[4] == 0x00))
+    {
+        lc = (p_apdu[5] << 8) | p_apdu[6];
+        if (len == (9 + lc))                                /* case 4E */
+        {
+            le = (p_apdu[len - 2] << 8) | p_apdu[len - 1];
+            if (0 == le)
+                le = 65536;
+        }
+    }
+
+    for (i = 0; i < le; i++)
+    {
+        gSimCntx.rsp[i] = (uint8_t)(i ^ p_apdu[1]);
+    }
+    gSimCntx.rsp[le] = 0x90;
+    gSimCntx.rsp[le + 1] = 0x00;
+    gSimCntx.rspLen = le + 2;
+    gSimCntx.rspOffset = 0;
+    gSimCntx.apduLen = 0;
+    gSimStats.apdus++;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_handleIblock
+**
+** Description      Handles an I-block sent by the host
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_handleIblock(uint8_t pcb, const uint8_t *p_inf, uint8_t len)
+{
+    uint8_t seqNo = (pcb & SIM_PCB_I_NS) ? 1 : 0;
+    uint32_t wtxCount;
+
+    if (seqNo != gSimCntx.recvSeqNo)
+    {
+        /* Repeated block: our answer to it got lost, send it again */
+        phPalEse_sim_retransmit();
+        return;
+    }
+    gSimCntx.recvSeqNo ^= 1;
+    if ((gSimCntx.apduLen + len) <= sizeof(gSimCntx.apdu))
+    {
+        memcpy(&gSimCntx.apdu[gSimCntx.apduLen], p_inf, len);
+        gSimCntx.apduLen += len;
+    }
+    if (pcb & SIM_PCB_I_MORE)
+    {
+        phPalEse_sim_queueFrame(SIM_PCB_R_BLOCK | (gSimCntx.recvSeqNo ? SIM_PCB_R_NR : 0),
+                NULL, 0, 0);
+        return;
+    }
+    phPalEse_sim_processApdu();
+    gSimCntx.wtxLeft = gSimConfig.wtxPerApdu;
+    if (gSimCntx.wtxLeft > 0)
+    {
+        /* Processing time is split across the WTX requests */
+        wtxCount = gSimCntx.wtxLeft + 1;
+        phPalEse_sim_queueFrame(SIM_PCB_S_BLOCK | SIM_S_WTX, gSimWtxInf, 1,
+                gSimConfig.apduProcessingUs / wtxCount);
+    }
+    else
+    {
+        phPalEse_sim_sendNextIblock(gSimConfig.apduProcessingUs);
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_handleRblock
+**
+** Description      Handles an R-block sent by the host
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_handleRblock(uint8_t pcb)
+{
+    uint8_t seqNo = (pcb & SIM_PCB_R_NR) ? 1 : 0;
+
+    if ((0 == (pcb & (SIM_PCB_R_PARITY_ERR | SIM_PCB_R_OTHER_ERR))) &&
+        (gSimCntx.rspOffset < gSimCntx.rspLen) && (seqNo == gSimCntx.sendSeqNo))
+    {
+        /* Acknowledge of the last chained I-block */
+        phPalEse_sim_sendNextIblock(0);
+    }
+    else
+    {
+        phPalEse_sim_retransmit();
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_handleSblock
+**
+** Description      Handles an S-block sent by the host
+**
+** Returns          None
+**
+*******************************************************************************/
+static void phPalEse_sim_handleSblock(uint8_t pcb, const uint8_t *p_inf, uint8_t len)
+{
+    switch (pcb & 0x3F)
+    {
+    case SIM_S_RESYNCH:
+    case SIM_S_INTF_RESET:
+        phPalEse_sim_resetLink();
+        phPalEse_sim_queueFrame(pcb | SIM_PCB_S_RSP, NULL, 0, 0);
+        break;
+    case SIM_S_END_OF_APDU:
+        phPalEse_sim_queueFrame(pcb | SIM_PCB_S_RSP, NULL, 0, 0);
+        break;
+    case SIM_S_IFS:
+        phPalEse_sim_queueFrame(pcb | SIM_PCB_S_RSP, p_inf, len, 0);
+        break;
+    case (SIM_S_WTX | SIM_PCB_S_RSP):
+        if (gSimCntx.wtxLeft > 0)
+        {
+            gSimCntx.wtxLeft--;
+            if (gSimCntx.wtxLeft > 0)
+            {
+                phPalEse_sim_queueFrame(SIM_PCB_S_BLOCK | SIM_S_WTX, gSimWtxInf, 1,
+                        gSimConfig.apduProcessingUs / (gSimConfig.wtxPerApdu + 1));
+            }
+            else
+            {
+                phPalEse_sim_sendNextIblock(gSimConfig.apduProcessingUs / (gSimConfig.wtxPerApdu + 1));
+            }
+        }
+        /* An unsolicited WTX response is ignored */
+        break;
+    default:
+        NXPLOG_PAL_W("%s unsupported S-block 0x%x", __FUNCTION__, pcb);
+        phPalEse_sim_queueFrame(SIM_PCB_R_BLOCK | SIM_PCB_R_OTHER_ERR |
+                (gSimCntx.recvSeqNo ? SIM_PCB_R_NR : 0), NULL, 0, 0);
+        break;
+    }
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_close
+**
+** Description      Closes the simulated device
+**
+** Parameters       pDevHandle - device handle
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_close(void *pDevHandle)
+{
+    if (NULL != pDevHandle)
+    {
+        gSimCntx.isOpen = FALSE;
+    }
+    return;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_open_and_configure
+**
+** Description      Opens the simulated device
+**
+** Parameters       pConfig     - hardware information
+**
+** Returns          ESE status:
+**                  ESESTATUS_SUCCESS            - open_and_configure operation success
+**                  ESESTATUS_INVALID_DEVICE     - device already opened
+**
+*******************************************************************************/
+ESESTATUS phPalEse_sim_open_and_configure(pphPalEse_Config_t pConfig)
+{
+    uint64_t virtualNs = gSimCntx.virtualNs;
+
+    NXPLOG_PAL_D("Opening simulated port=%s\n", pConfig->pDevName);
+    if (gSimCntx.isOpen)
+    {
+        NXPLOG_PAL_E("%s : simulated eSE already opened", __FUNCTION__);
+        pConfig->pDevHandle = NULL;
+        return ESESTATUS_INVALID_DEVICE;
+    }
+    /* Keep the clock monotonic across sessions */
+    memset(&gSimCntx, 0x00, sizeof(gSimCntx));
+    gSimCntx.virtualNs = virtualNs;
+    gSimCntx.spmState = SIM_SPM_STATE_IDLE | (gSimWired ? SIM_SPM_STATE_WIRED : 0);
+    if ((0 == gSimConfig.ifsd) || (gSimConfig.ifsd > PH_PALESE_SIM_IFSD))
+    {
+        gSimConfig.ifsd = PH_PALESE_SIM_IFSD;
+    }
+    gSimCntx.isOpen = TRUE;
+    pConfig->pDevHandle = (void *)&gSimCntx;
+    return ESESTATUS_SUCCESS;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_read
+**
+** Description      Clocks out bytes of the pending card frame
+**
+** Parameters       pDevHandle       - valid device handle
+**                  pBuffer          - buffer for read data
+**                  nNbBytesToRead   - number of bytes requested to be read
+**
+** Returns          numRead   - number of successfully read bytes
+**                  -1        - read operation failure
+**
+*******************************************************************************/
+int phPalEse_sim_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead)
+{
+    int i;
+    bool_t visible;
+
+    if ((NULL == pDevHandle) || (NULL == pBuffer) || (nNbBytesToRead < 0))
+    {
+        return -1;
+    }
+    gSimStats.readCalls++;
+    visible = (gSimCntx.txPending && (phPalEse_sim_now() >= gSimCntx.txReadyNs)) ? TRUE : FALSE;
+    for (i = 0; i < nNbBytesToRead; i++)
+    {
+        if (visible && (gSimCntx.txPos < gSimCntx.txLen))
+        {
+            pBuffer[i] = gSimCntx.txFrame[gSimCntx.txPos++];
+        }
+        else
+        {
+            pBuffer[i] = 0x00;
+        }
+    }
+    if (visible && (gSimCntx.txPos >= gSimCntx.txLen))
+    {
+        gSimCntx.txPending = FALSE;
+    }
+    if (gSimConfig.virtualTime)
+    {
+        gSimCntx.virtualNs += (uint64_t)nNbBytesToRead * gSimConfig.byteTimeNs;
+    }
+    return nNbBytesToRead;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_write
+**
+** Description      Passes one host frame to the card model
+**
+** Parameters       pDevHandle       - valid device handle
+**                  pBuffer          - buffer for read data
+**                  nNbBytesToWrite  - number of bytes requested to be written
+**
+** Returns          numWrote   - number of successfully written bytes
+**                  -1         - write operation failure
+**
+*******************************************************************************/
+int phPalEse_sim_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite)
+{
+    uint8_t pcb, len;
+
+    if ((NULL == pDevHandle) || (NULL == pBuffer) || (nNbBytesToWrite <= 0))
+    {
+        return -1;
+    }
+    gSimStats.writeCalls++;
+    if (gSimConfig.virtualTime)
+    {
+        gSimCntx.virtualNs += (uint64_t)nNbBytesToWrite * gSimConfig.byteTimeNs;
+    }
+    if (0 == (gSimCntx.spmState & (SIM_SPM_STATE_SPI | SIM_SPM_STATE_SPI_PRIO)))
+    {
+        /* Card not powered, the frame is lost */
+        return nNbBytesToWrite;
+    }
+    gSimStats.framesRx++;
+    /* A new host frame discards whatever was not read yet */
+    gSimCntx.txPending = FALSE;
+
+    if ((nNbBytesToWrite < (SIM_HEADER_LEN + SIM_LRC_LEN)) ||
+        ((uint32_t)pBuffer[2] + SIM_HEADER_LEN + SIM_LRC_LEN != (uint32_t)nNbBytesToWrite) ||
+        (phPalEse_sim_computeLRC(pBuffer, 1, nNbBytesToWrite - 1) != pBuffer[nNbBytesToWrite - 1]))
+    {
+        gSimStats.lrcErrors++;
+        phPalEse_sim_queueFrame(SIM_PCB_R_BLOCK | SIM_PCB_R_PARITY_ERR |
+                (gSimCntx.recvSeqNo ? SIM_PCB_R_NR : 0), NULL, 0, 0);
+        return nNbBytesToWrite;
+    }
+    pcb = pBuffer[1];
+    len = pBuffer[2];
+    if (0 == (pcb & SIM_PCB_R_BLOCK))
+    {
+        phPalEse_sim_handleIblock(pcb, &pBuffer[SIM_HEADER_LEN], len);
+    }
+    else if (SIM_PCB_R_BLOCK == (pcb & SIM_PCB_S_BLOCK))
+    {
+        phPalEse_sim_handleRblock(pcb);
+    }
+    else
+    {
+        phPalEse_sim_handleSblock(pcb, &pBuffer[SIM_HEADER_LEN], len);
+    }
+    return nNbBytesToWrite;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_ioctl
+**
+** Description      Emulates the ioctls exposed by the p73 spi driver
+**
+** Parameters       pDevHandle     - valid device handle
+**                  level          - reset level
+**
+** Returns           0   - ioctl operation success
+**                  -1   - ioctl operation failure
+**
+*******************************************************************************/
+int phPalEse_sim_ioctl(phPalEse_ControlCode_t eControlCode, void *pDevHandle, long level)
+{
+    int ret = 0;
+    NXPLOG_PAL_D("phPalEse_sim_ioctl(), ioctl %x , level %lx", eControlCode, level);
+
+    if (NULL == pDevHandle)
+    {
+        return -1;
+    }
+    gSimStats.ioctlCalls++;
+    switch(eControlCode)
+    {
+    case phPalEse_e_ChipRst:
+        switch(level)
+        {
+        case 0: /* power disable */
+            gSimCntx.spmState &= ~(SIM_SPM_STATE_SPI | SIM_SPM_STATE_SPI_PRIO);
+            gSimCntx.spmState |= SIM_SPM_STATE_IDLE;
+            break;
+        case 1: /* power enable */
+            if (gSimCntx.spmState & SIM_SPM_STATE_WIRED)
+            {
+                errno = EBUSY;
+                ret = -1;
+                break;
+            }
+            gSimCntx.spmState &= ~SIM_SPM_STATE_IDLE;
+            gSimCntx.spmState |= SIM_SPM_STATE_SPI;
+            phPalEse_sim_resetLink();
+            break;
+        case 3: /* priority enable */
+            gSimCntx.spmState &= ~SIM_SPM_STATE_IDLE;
+            gSimCntx.spmState |= SIM_SPM_STATE_SPI_PRIO;
+            phPalEse_sim_resetLink();
+            break;
+        case 4: /* priority disable */
+            gSimCntx.spmState &= ~SIM_SPM_STATE_SPI_PRIO;
+            if (0 == (gSimCntx.spmState & SIM_SPM_STATE_SPI))
+                gSimCntx.spmState |= SIM_SPM_STATE_IDLE;
+            break;
+        case 2: /* power reset */
+        case 6: /* ISO reset */
+            phPalEse_sim_resetLink();
+            break;
+        default:
+            break;
+        }
+        break;
+
+    case phPalEse_e_GetSPMStatus:
+        *((int32_t *)level) = (int32_t)gSimCntx.spmState;
+        break;
+
+#if(NXP_ESE_JCOP_DWNLD_PROTECTION == TRUE)
+    case phPalEse_e_SetJcopDwnldState:
+        if (SIM_JCP_DWNLD_INIT == level)
+        {
+            gSimCntx.spmState |= SIM_SPM_STATE_JCOP_DWNLD;
+        }
+        else if ((SIM_JCP_SPI_DWNLD_COMPLETE == level) || (SIM_JCP_DWP_DWNLD_COMPLETE == level))
+        {
+            gSimCntx.spmState &= ~SIM_SPM_STATE_JCOP_DWNLD;
+        }
+        break;
+#endif
+    case phPalEse_e_ResetDevice:
+        phPalEse_sim_resetLink();
+        break;
+
+    default:
+        break;
+    }
+    return ret;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_sleep
+**
+** Description      This function  suspends execution of the calling thread for
+**                  (at least) usec microseconds, or advances the simulated
+**                  clock in virtual time mode
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_sleep(long usec)
+{
+    if (gSimConfig.virtualTime)
+    {
+        gSimCntx.virtualNs += (uint64_t)usec * 1000ULL;
+    }
+    else
+    {
+        usleep(usec);
+    }
+    return;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_getTimeUs
+**
+** Description      Returns the simulation time base in micro seconds
+**
+** Returns          time in micro seconds
+**
+*******************************************************************************/
+uint64_t phPalEse_sim_getTimeUs(void)
+{
+    return phPalEse_sim_now() / 1000ULL;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_setConfig
+**
+** Description      Updates the simulated card behaviour
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_setConfig(const phPalEse_SimConfig_t *pSimConfig)
+{
+    if (NULL == pSimConfig)
+    {
+        gSimConfig.virtualTime = TRUE;
+        gSimConfig.byteTimeNs = PH_PALESE_SIM_BYTE_TIME_NS;
+        gSimConfig.frameGuardUs = PH_PALESE_SIM_FRAME_GUARD_US;
+        gSimConfig.apduProcessingUs = PH_PALESE_SIM_APDU_PROC_US;
+        gSimConfig.wtxPerApdu = 0;
+        gSimConfig.ifsd = PH_PALESE_SIM_IFSD;
+    }
+    else
+    {
+        memcpy(&gSimConfig, pSimConfig, sizeof(gSimConfig));
+    }
+    return;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_getConfig
+**
+** Description      Copies out the simulated card behaviour
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_getConfig(phPalEse_SimConfig_t *pSimConfig)
+{
+    if (NULL != pSimConfig)
+    {
+        memcpy(pSimConfig, &gSimConfig, sizeof(gSimConfig));
+    }
+    return;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_getStats
+**
+** Description      Copies out the simulated card counters
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_getStats(phPalEse_SimStats_t *pStats, bool_t reset)
+{
+    if (NULL != pStats)
+    {
+        memcpy(pStats, &gSimStats, sizeof(gSimStats));
+    }
+    if (reset)
+    {
+        memset(&gSimStats, 0x00, sizeof(gSimStats));
+    }
+    return;
+}
+
+/*******************************************************************************
+**
+** Function         phPalEse_sim_setWired
+**
+** Description      Starts or ends a DWP session of the NFCC on the simulated
+**                  card
+**
+** Returns          None
+**
+*******************************************************************************/
+void phPalEse_sim_setWired(bool_t wired)
+{
+    gSimWired = wired;
+    if (wired)
+    {
+        gSimCntx.spmState |= SIM_SPM_STATE_WIRED;
+    }
+    else
+    {
+        gSimCntx.spmState &= ~SIM_SPM_STATE_WIRED;
+    }
+    return;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup eSe_PAL_Sim
+ * \brief PAL simulated eSE port, used to run the stack on a host without hardware
+ * @{ */
+#ifndef _PHNXPESE_PAL_SIM_H
+#define _PHNXPESE_PAL_SIM_H
+
+/* Basic type definitions */
+#include <phEseTypes.h>
+#include <phNxpEsePal.h>
+
+/*!
+ * \brief Maximum APDU (command or response) handled by the simulated eSE
+ */
+#define PH_PALESE_SIM_MAX_APDU_LEN      (65536 + 16)
+/*!
+ * \brief Default SPI transfer time per byte in nano seconds (8 bits @ 8MHz)
+ */
+#define PH_PALESE_SIM_BYTE_TIME_NS      1000
+/*!
+ * \brief Default card turnaround time per frame in micro seconds
+ */
+#define PH_PALESE_SIM_FRAME_GUARD_US    50
+/*!
+ * \brief Default card processing time per APDU in micro seconds
+ */
+#define PH_PALESE_SIM_APDU_PROC_US      2000
+/*!
+ * \brief Default max. information field sent by the card in one I-block
+ */
+#define PH_PALESE_SIM_IFSD              254
+
+/*!
+ * \ingroup eSe_PAL_Sim
+ *
+ * \brief Timing and behaviour model of the simulated eSE.
+ */
+typedef struct phPalEse_SimConfig
+{
+    bool_t virtualTime;         /*!< Advance a simulated clock instead of sleeping */
+    uint32_t byteTimeNs;        /*!< SPI transfer time per byte */
+    uint32_t frameGuardUs;      /*!< Card turnaround time before a frame is readable */
+    uint32_t apduProcessingUs;  /*!< Card processing time per APDU */
+    uint8_t wtxPerApdu;         /*!< Number of S(WTX) requests sent before each response */
+    uint8_t ifsd;               /*!< Max. INF length sent by the card per I-block */
+} phPalEse_SimConfig_t;
+
+/*!
+ * \ingroup eSe_PAL_Sim
+ *
+ * \brief Counters maintained by the simulated eSE.
+ */
+typedef struct phPalEse_SimStats
+{
+    uint32_t readCalls;         /*!< phPalEse_sim_read invocations */
+    uint32_t writeCalls;        /*!< phPalEse_sim_write invocations */
+    uint32_t ioctlCalls;        /*!< phPalEse_sim_ioctl invocations */
+    uint32_t framesRx;          /*!< Frames received from the host */
+    uint32_t framesTx;          /*!< Frames queued towards the host */
+    uint32_t lrcErrors;         /*!< Host frames rejected due to LRC/length error */
+    uint32_t retransmits;       /*!< Frames re-sent on R-NACK or repeated block */
+    uint32_t apdus;             /*!< APDUs processed */
+} phPalEse_SimStats_t;
+
+/* Function declarations */
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief This function is used to close the simulated ESE device
+ *
+ * \retval None
+ *
+*/
+void phPalEse_sim_close(void *pDevHandle);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Open and configure the simulated ESE device. The card is powered
+ *        off and its T=1 state is reset.
+ *
+ * \param[in]       pphPalEse_Config_t: Config to open the device
+ *
+ * \retval  ESESTATUS On Success ESESTATUS_SUCCESS else proper error code
+ *
+*/
+ESESTATUS phPalEse_sim_open_and_configure(pphPalEse_Config_t pConfig);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Clocks requested number of bytes out of the simulated ESE.
+ *        0x00 is returned while no frame is ready, as on the SPI bus.
+ *
+ * \param[in]    pDevHandle       - valid device handle
+**\param[in]    pBuffer          - buffer for read data
+**\param[in]    nNbBytesToRead   - number of bytes requested to be read
+ *
+ * \retval   numRead      - number of successfully read bytes.
+ * \retval      -1             - read operation failure
+ *
+*/
+int phPalEse_sim_read(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToRead);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Writes one complete T=1 frame into the simulated ESE
+ *
+ * \param[in]    pDevHandle               - valid device handle
+ * \param[in]    pBuffer                  - buffer to write
+ * \param[in]    nNbBytesToWrite          - number of bytes to write
+ *
+ * \retval  numWrote   - number of successfully written bytes
+ * \retval      -1         - write operation failure
+ *
+ */
+int phPalEse_sim_write(void *pDevHandle, uint8_t * pBuffer, int nNbBytesToWrite);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Emulates the ioctls of the ESE driver, including the SPM state
+ *
+ * \param[in]    eControlCode       - phPalEse_ControlCode_t for the respective configs
+ * \param[in]    pDevHandle         - valid device handle
+ * \param[in]    level              - reset level
+ *
+ * \retval    0   - ioctl operation success
+ * \retval   -1  - ioctl operation failure
+ *
+ */
+int phPalEse_sim_ioctl(phPalEse_ControlCode_t eControlCode, void *pDevHandle, long level);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Suspends the caller for usec micro seconds, or advances the
+ *        simulated clock when virtual time is enabled
+ *
+ * \param[in]    usec           - number of micro seconds to sleep
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_sim_sleep(long usec);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Returns the time base used by the simulation in micro seconds
+ *
+ * \retval   current time in micro seconds
+ *
+ */
+uint64_t phPalEse_sim_getTimeUs(void);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Sets the behaviour of the simulated ESE. NULL restores the defaults.
+ *        Takes effect on the next phPalEse_sim_open_and_configure.
+ *
+ * \param[in]    pSimConfig     - simulation parameters
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_sim_setConfig(const phPalEse_SimConfig_t *pSimConfig);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Copies out the current behaviour of the simulated ESE
+ *
+ * \param[out]   pSimConfig     - simulation parameters
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_sim_getConfig(phPalEse_SimConfig_t *pSimConfig);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Copies out and optionally clears the simulated ESE counters
+ *
+ * \param[out]   pStats         - counters
+ * \param[in]    reset          - TRUE to clear the counters after reading
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_sim_getStats(phPalEse_SimStats_t *pStats, bool_t reset);
+
+/**
+ * \ingroup eSe_PAL_Sim
+ * \brief Starts or ends a DWP session of the NFCC: the driver state reports
+ *        it and SPI power enable fails with EBUSY meanwhile
+ *
+ * \param[in]    wired          - TRUE while the NFCC uses the card
+ *
+ * \retval   void
+ *
+ */
+void phPalEse_sim_setWired(bool_t wired);
+/** @} */
+#endif  /*  _PHNXPESE_PAL_SIM_H    */
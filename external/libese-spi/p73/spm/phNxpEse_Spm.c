@@ -14,15 +14,22 @@
  * limitations under the License.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP of glibc host builds */
+#endif
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include "phNxpEse_Spm.h"
+#include "phNxpEse_SpmPolicy.h"
 #include <phNxpEse_Internal.h>
 #include <phNxpEsePal.h>
+#include <phNxpConfig.h>
 #include "NXP_ESE_FEATURES.h"
 
 #define debug
@@ -37,6 +44,290 @@
 /*********************** Global Variables *************************************/
 static void* pEseDeviceHandle = NULL;
 #define MAX_ESE_ACCESS_TIME_OUT_MS 2000 /*2 seconds*/
+#define SPM_LEASE_DEFAULT_POLL_MS  100
+/* Driver states in which the SPI access has to be given back */
+#if(NXP_ESE_JCOP_DWNLD_PROTECTION == TRUE)
+#define SPM_STATE_CONTENTION       (SPM_STATE_WIRED | SPM_STATE_DWNLD | SPM_STATE_JCOP_DWNLD)
+#else
+#define SPM_STATE_CONTENTION       (SPM_STATE_WIRED | SPM_STATE_DWNLD)
+#endif
+
+typedef enum
+{
+    SPM_LEASE_NONE = 0x00, /* SPI access not held */
+    SPM_LEASE_HELD,        /* held by the open session */
+    SPM_LEASE_PARKED       /* held after the session was closed, see phNxpEse_SPM_LeasePark */
+} phNxpEse_SPM_LeaseState_t;
+
+/* Access lease and shadow of the driver state. The shadow is only trusted
+ * while the access is held: the driver state then changes through the
+ * ioctls of this module, or comes with an error code. */
+typedef struct
+{
+    phNxpEse_SPM_LeaseState_t state;
+    uint64_t deadlineUs;
+    unsigned long leaseMs;
+    unsigned long pollMs;
+    bool_t reaperRunning;
+    bool_t shadowValid;
+    spm_state_t shadow;
+    bool_t warm;                /* parked by phNxpEse_SPM_LeaseWarm, no session used it yet */
+    bool_t claimed;             /* a session is opening or owns the device */
+    uint64_t poweredSinceUs;    /* start of the current power period, 0 when off */
+    uint64_t parkedSinceUs;
+} phNxpEse_SPM_Lease_t;
+
+static phNxpEse_SPM_Lease_t gSpmLease;
+static phNxpEse_SPM_Stats_t gSpmStats;
+/* Recursive: phNxpEse_SPM_ioctl and phNxpEse_SPM_GetState take it, and the
+ * lease thread and phNxpEse_SPM_LeaseWarm call them with it held. It is
+ * never held across a driver call made by a session. */
+static pthread_mutex_t gSpmLeaseLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static pthread_cond_t gSpmLeaseCond = PTHREAD_COND_INITIALIZER;
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_nowUs
+ *
+ * Description      This function returns the monotonic time
+ *
+ * Returns          Time in microseconds
+ *
+ ******************************************************************************/
+static uint64_t phNxpEse_SPM_nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_ioctl
+ *
+ * Description      This function issues a driver call and counts it
+ *
+ * Returns          Result of phPalEse_ioctl
+ *
+ ******************************************************************************/
+static int phNxpEse_SPM_ioctl(phPalEse_ControlCode_t eControlCode, long arg)
+{
+    void *pDevHandle;
+    int ret;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    gSpmStats.sessionIoctls++;
+    gSpmStats.ioctls++;
+    pDevHandle = pEseDeviceHandle;
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    ret = phPalEse_ioctl(eControlCode, pDevHandle, arg);
+    if (ret < 0)
+    {
+        /* the driver state moved under us */
+        pthread_mutex_lock(&gSpmLeaseLock);
+        gSpmLease.shadowValid = FALSE;
+        pthread_mutex_unlock(&gSpmLeaseLock);
+    }
+    return ret;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_setShadow
+ *
+ * Description      This function applies a power request that the driver
+ *                  accepted to the shadow state
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_setShadow(spm_power_t arg)
+{
+    uint32_t state = (uint32_t)gSpmLease.shadow;
+
+    switch (arg)
+    {
+    case SPM_POWER_ENABLE:
+        state = (state & ~SPM_STATE_IDLE) | SPM_STATE_SPI;
+        break;
+    case SPM_POWER_PRIO_ENABLE:
+        state = (state & ~SPM_STATE_IDLE) | SPM_STATE_SPI_PRIO;
+        break;
+    case SPM_POWER_PRIO_DISABLE:
+        state &= ~SPM_STATE_SPI_PRIO;
+        if (0 == (state & SPM_STATE_SPI))
+            state |= SPM_STATE_IDLE;
+        break;
+    case SPM_POWER_DISABLE:
+        state = (state & ~(SPM_STATE_SPI | SPM_STATE_SPI_PRIO)) | SPM_STATE_IDLE;
+        break;
+    default:
+        break;
+    }
+    gSpmLease.shadow = (spm_state_t)state;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_endSession
+ *
+ * Description      This function logs the driver calls of the session
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_endSession(const char *pHow)
+{
+    NXPLOG_ESELIB_D("%s : session %s after %u SPM ioctls", __FUNCTION__, pHow,
+            gSpmStats.sessionIoctls);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_powerAccount
+ *
+ * Description      This function accounts the power periods for the on time
+ *                  estimate
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_powerAccount(bool_t on)
+{
+    uint64_t now = phNxpEse_SPM_nowUs();
+
+    if ((TRUE == on) && (0 == gSpmLease.poweredSinceUs))
+    {
+        gSpmLease.poweredSinceUs = now;
+    }
+    else if ((FALSE == on) && (0 != gSpmLease.poweredSinceUs))
+    {
+        gSpmStats.onTimeUs += now - gSpmLease.poweredSinceUs;
+        gSpmLease.poweredSinceUs = 0;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_unparkLocked
+ *
+ * Description      This function ends the parked period of the lease.
+ *                  gSpmLeaseLock is held.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_unparkLocked(void)
+{
+    if (SPM_LEASE_PARKED == gSpmLease.state)
+    {
+        gSpmStats.idleOnTimeUs += phNxpEse_SPM_nowUs() - gSpmLease.parkedSinceUs;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_releaseLocked
+ *
+ * Description      This function gives a parked lease back to the driver and
+ *                  closes the device. gSpmLeaseLock is held.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_releaseLocked(void)
+{
+    phNxpEse_SPM_unparkLocked();
+    phNxpEse_SPM_powerAccount(FALSE);
+    if (phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, SPM_POWER_DISABLE) < 0)
+    {
+        NXPLOG_ESELIB_E("%s : power disable failed errno = 0x%x", __FUNCTION__, errno);
+    }
+    if (phNxpEse_SPM_RelAccess() != SPMSTATUS_SUCCESS)
+    {
+        NXPLOG_ESELIB_E("%s : phNxpEse_SPM_RelAccess failed", __FUNCTION__);
+    }
+    phPalEse_close(pEseDeviceHandle);
+    pEseDeviceHandle = NULL;
+    gSpmLease.state = SPM_LEASE_NONE;
+    gSpmLease.shadowValid = FALSE;
+    gSpmLease.warm = FALSE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_contendedLocked
+ *
+ * Description      This function asks the driver whether NFC/DWP wants the
+ *                  eSE and, if so, releases the parked lease.
+ *                  gSpmLeaseLock is held.
+ *
+ * Returns          TRUE if the lease was revoked, FALSE otherwise
+ *
+ ******************************************************************************/
+static bool_t phNxpEse_SPM_contendedLocked(void)
+{
+    int32_t state;
+
+    if (phNxpEse_SPM_ioctl(phPalEse_e_GetSPMStatus, (long)&state) < 0)
+    {
+        state = SPM_STATE_INVALID;
+    }
+    if ((SPM_STATE_INVALID == state) || (state & SPM_STATE_CONTENTION))
+    {
+        NXPLOG_ESELIB_D("%s : driver state 0x%x, lease revoked", __FUNCTION__, state);
+        gSpmStats.leaseRevokes++;
+        phNxpEse_SPM_releaseLocked();
+        phNxpEse_SPM_endSession("lease revoked");
+        return TRUE;
+    }
+    gSpmLease.shadow = (spm_state_t)state;
+    gSpmLease.shadowValid = TRUE;
+    return FALSE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_leaseReaper
+ *
+ * Description      This thread watches a parked lease: it releases it at its
+ *                  deadline, or as soon as the driver reports NFC/DWP
+ *                  activity, and exits once the lease is resumed or released
+ *
+ * Returns          NULL
+ *
+ ******************************************************************************/
+static void *phNxpEse_SPM_leaseReaper(void *arg)
+{
+    struct timespec ts;
+    uint64_t now, waitUs;
+    (void)arg;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    while (SPM_LEASE_PARKED == gSpmLease.state)
+    {
+        now = phNxpEse_SPM_nowUs();
+        if (now >= gSpmLease.deadlineUs)
+        {
+            gSpmStats.leaseExpiries++;
+            phNxpEse_SPM_releaseLocked();
+            phNxpEse_SPM_endSession("lease expired");
+            break;
+        }
+        if (TRUE == phNxpEse_SPM_contendedLocked())
+        {
+            break;
+        }
+
+        waitUs = gSpmLease.deadlineUs - now;
+        if (waitUs > ((uint64_t)gSpmLease.pollMs * 1000))
+            waitUs = (uint64_t)gSpmLease.pollMs * 1000;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += waitUs / 1000000;
+        ts.tv_nsec += (waitUs % 1000000) * 1000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&gSpmLeaseCond, &gSpmLeaseLock, &ts);
+    }
+    gSpmLease.reaperRunning = FALSE;
+    pthread_cond_broadcast(&gSpmLeaseCond);
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    return NULL;
+}
 
 /**
  * \addtogroup SPI_Power_Management
@@ -61,8 +352,14 @@ static void* pEseDeviceHandle = NULL;
 SPMSTATUS phNxpEse_SPM_Init(void *pDevHandle)
 {
     SPMSTATUS status = SPMSTATUS_SUCCESS;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
     pEseDeviceHandle = pDevHandle;
-    if (NULL == pEseDeviceHandle)
+    gSpmStats.sessionIoctls = 0;
+    /* other processes may have used the eSE since the last session */
+    gSpmLease.shadowValid = FALSE;
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    if (NULL == pDevHandle)
     {
         NXPLOG_ESELIB_E("%s : failed, device handle is null", __FUNCTION__);
         status = SPMSTATUS_FAILED;
@@ -82,26 +379,35 @@ SPMSTATUS phNxpEse_SPM_Init(void *pDevHandle)
  ******************************************************************************/
 SPMSTATUS phNxpEse_SPM_DeInit(void)
 {
-    pEseDeviceHandle = NULL;
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if (SPM_LEASE_PARKED != gSpmLease.state)
+    {
+        pEseDeviceHandle = NULL;
+        gSpmLease.claimed = FALSE;
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
     return SPMSTATUS_SUCCESS;
 }
 
 /******************************************************************************
- * Function         phNxpEse_SPM_ConfigPwr
+ * Function         phNxpEse_SPM_requestPwr
  *
- * Description      This function request to the nfc i2c driver
- *                  to enable/disable power to ese. This api should be called before
- *                  sending any apdu to ese/once apdu exchange is done.
+ * Description      This function sends a power request to the nfc i2c driver
+ *                  and maps its answer. pRet is the result of the request
+ *                  ioctl, -1 if it was not sent.
  *
  * Returns          On Success SPMSTATUS_SUCCESS else proper error code
  *
  ******************************************************************************/
-SPMSTATUS phNxpEse_SPM_ConfigPwr(spm_power_t arg)
+static SPMSTATUS phNxpEse_SPM_requestPwr(spm_power_t arg, int32_t *pRet)
 {
     int32_t ret = -1;
     SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
     spm_state_t current_spm_state = SPM_STATE_INVALID;
+    uint64_t accessStartUs = phNxpEse_SPM_nowUs();
+    uint64_t accessWaitUs;
 
+    *pRet = -1;
     if (SPM_POWER_ENABLE == arg)
     {
         if (phNxpEse_SPM_GetAccess(MAX_ESE_ACCESS_TIME_OUT_MS) != SPMSTATUS_SUCCESS)
@@ -110,7 +416,16 @@ SPMSTATUS phNxpEse_SPM_ConfigPwr(spm_power_t arg)
             return ESESTATUS_BUSY;
         }
     }
-    ret = phPalEse_ioctl(phPalEse_e_ChipRst, pEseDeviceHandle, arg);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, arg);
+    *pRet = ret;
+    if ((SPM_POWER_ENABLE == arg) || (SPM_POWER_PRIO_ENABLE == arg))
+    {
+        /* the driver holds the request while NFC/DWP uses the eSE */
+        accessWaitUs = phNxpEse_SPM_nowUs() - accessStartUs;
+        gSpmStats.accessWaitUs += accessWaitUs;
+        if (accessWaitUs > gSpmStats.maxAccessWaitUs)
+            gSpmStats.maxAccessWaitUs = accessWaitUs;
+    }
     switch(arg){
     case SPM_POWER_DISABLE:
     {
@@ -250,6 +565,76 @@ SPMSTATUS phNxpEse_SPM_ConfigPwr(spm_power_t arg)
     return wSpmStatus;
 }
 
+/******************************************************************************
+ * Function         phNxpEse_SPM_pwrDoneLocked
+ *
+ * Description      This function applies the outcome of a power request to
+ *                  the lease and the power accounting. gSpmLeaseLock is held.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_pwrDoneLocked(spm_power_t arg, int32_t ret, SPMSTATUS wSpmStatus)
+{
+    if ((ret >= 0) && (SPMSTATUS_SUCCESS == wSpmStatus))
+    {
+        phNxpEse_SPM_setShadow(arg);
+        if ((SPM_POWER_ENABLE == arg) || (SPM_POWER_PRIO_ENABLE == arg))
+        {
+            gSpmStats.accessGrants++;
+            gSpmLease.state = SPM_LEASE_HELD;
+            phNxpEse_SPM_powerAccount(TRUE);
+        }
+    }
+    if (SPM_POWER_DISABLE == arg)
+    {
+        phNxpEse_SPM_powerAccount(FALSE);
+        gSpmLease.state = SPM_LEASE_NONE;
+        gSpmLease.shadowValid = FALSE;
+        phNxpEse_SPM_endSession("closed");
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_configPwrLocked
+ *
+ * Description      phNxpEse_SPM_ConfigPwr with gSpmLeaseLock held
+ *
+ * Returns          On Success SPMSTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+static SPMSTATUS phNxpEse_SPM_configPwrLocked(spm_power_t arg)
+{
+    int32_t ret;
+    SPMSTATUS wSpmStatus = phNxpEse_SPM_requestPwr(arg, &ret);
+
+    phNxpEse_SPM_pwrDoneLocked(arg, ret, wSpmStatus);
+    return wSpmStatus;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_ConfigPwr
+ *
+ * Description      This function request to the nfc i2c driver
+ *                  to enable/disable power to ese. This api should be called before
+ *                  sending any apdu to ese/once apdu exchange is done.
+ *
+ * Returns          On Success SPMSTATUS_SUCCESS else proper error code
+ *
+ ******************************************************************************/
+SPMSTATUS phNxpEse_SPM_ConfigPwr(spm_power_t arg)
+{
+    int32_t ret;
+    SPMSTATUS wSpmStatus;
+
+    /* the driver may hold the request for MAX_ESE_ACCESS_TIME_OUT_MS, not the lease */
+    wSpmStatus = phNxpEse_SPM_requestPwr(arg, &ret);
+    pthread_mutex_lock(&gSpmLeaseLock);
+    phNxpEse_SPM_pwrDoneLocked(arg, ret, wSpmStatus);
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    return wSpmStatus;
+}
+
 /******************************************************************************
  * Function         phNxpEse_SPM_EnablePwr
  *
@@ -266,7 +651,7 @@ SPMSTATUS phNxpEse_SPM_EnablePwr(void)
     SPMSTATUS wSpmStatus = SPMSTATUS_SUCCESS;
     spm_state_t current_spm_state = SPM_STATE_INVALID;
 
-    ret = phPalEse_ioctl(phPalEse_e_ChipRst, pEseDeviceHandle, 1);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, 1);
     if(ret < 0)
     {
         NXPLOG_ESELIB_E("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -314,7 +699,7 @@ SPMSTATUS phNxpEse_SPM_DisablePwr(void)
 {
     int32_t ret = -1;
     SPMSTATUS status = SPMSTATUS_SUCCESS;
-    ret = phPalEse_ioctl(phPalEse_e_ChipRst, pEseDeviceHandle, 0);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, 0);
     if(ret < 0)
     {
         NXPLOG_ESELIB_E("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -338,7 +723,7 @@ SPMSTATUS phNxpEse_SPM_SetPwrScheme(long arg)
     SPMSTATUS status = SPMSTATUS_SUCCESS;
 
     NXPLOG_ESELIB_D("%s : Power scheme is set to  = 0x%ld", __FUNCTION__, arg);
-    ret = phPalEse_ioctl(phPalEse_e_SetPowerScheme, pEseDeviceHandle, arg);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_SetPowerScheme, arg);
     if(ret < 0)
     {
         NXPLOG_ESELIB_E("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -363,7 +748,7 @@ SPMSTATUS phNxpEse_SPM_DisablePwrControl(unsigned long arg)
     SPMSTATUS status = SPMSTATUS_SUCCESS;
 
     NXPLOG_ESELIB_D("%s : Inhibit power control is set to  = 0x%ld", __FUNCTION__, arg);
-    ret = phPalEse_ioctl(phPalEse_e_DisablePwrCntrl, pEseDeviceHandle, arg);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_DisablePwrCntrl, arg);
     if(ret < 0)
     {
         ALOGE("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -392,7 +777,16 @@ SPMSTATUS phNxpEse_SPM_GetState(spm_state_t *current_state)
         NXPLOG_ESELIB_E("%s : failed Invalid argument", __FUNCTION__);
         return SPMSTATUS_FAILED;
     }
-    ret = phPalEse_ioctl(phPalEse_e_GetSPMStatus, pEseDeviceHandle, (unsigned long )&ese_current_state);
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if ((SPM_LEASE_NONE != gSpmLease.state) && (TRUE == gSpmLease.shadowValid))
+    {
+        gSpmStats.shadowHits++;
+        *current_state = gSpmLease.shadow;
+        pthread_mutex_unlock(&gSpmLeaseLock);
+        return status;
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_GetSPMStatus, (long)&ese_current_state);
     if(ret < 0)
     {
         NXPLOG_ESELIB_E("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -401,6 +795,10 @@ SPMSTATUS phNxpEse_SPM_GetState(spm_state_t *current_state)
     else
     {
         *current_state = ese_current_state; /* Current ESE state */
+        pthread_mutex_lock(&gSpmLeaseLock);
+        gSpmLease.shadow = ese_current_state;
+        gSpmLease.shadowValid = TRUE;
+        pthread_mutex_unlock(&gSpmLeaseLock);
     }
 
     return status;
@@ -420,7 +818,11 @@ SPMSTATUS phNxpEse_SPM_SetJcopDwnldState(long arg)
     SPMSTATUS status = SPMSTATUS_SUCCESS;
 
     ALOGD("%s : phNxpEse_SPM_SetJcopDwnldState  = 0x%ld", __FUNCTION__, arg);
-    ret = phPalEse_ioctl(phPalEse_e_SetJcopDwnldState, pEseDeviceHandle, arg);
+    /* the download state is agreed with the DWP side asynchronously */
+    pthread_mutex_lock(&gSpmLeaseLock);
+    gSpmLease.shadowValid = FALSE;
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_SetJcopDwnldState, arg);
     if(ret < 0)
     {
         ALOGE("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -446,7 +848,7 @@ SPMSTATUS phNxpEse_SPM_ResetPwr(void)
     spm_state_t current_spm_state = SPM_STATE_INVALID;
 
     /* reset the ese */
-    ret = phPalEse_ioctl(phPalEse_e_ChipRst, pEseDeviceHandle, 2);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, 2);
     if(ret < 0)
     {
         NXPLOG_ESELIB_E("%s : failed errno = 0x%x", __FUNCTION__, errno);
@@ -498,7 +900,7 @@ SPMSTATUS phNxpEse_SPM_GetAccess(long timeout)
 #if((NFC_NXP_ESE_VER == JCOP_VER_3_1) || (NFC_NXP_ESE_VER == JCOP_VER_3_2))
     NXPLOG_TML_D("phTmlEse_get_ese_access(), timeout  %ld", timeout);
 
-    ret = phPalEse_ioctl(phPalEse_e_GetEseAccess, pEseDeviceHandle, timeout);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_GetEseAccess, timeout);
     if (ret < 0)
     {
         if (ret == -EBUSY)
@@ -528,7 +930,7 @@ SPMSTATUS phNxpEse_SPM_RelAccess(void)
 #if((NFC_NXP_ESE_VER == JCOP_VER_3_1) || (NFC_NXP_ESE_VER == JCOP_VER_3_2))
     NXPLOG_TML_D("phNxpEse_SPM_RelAccess(): enter");
 
-    ret = phPalEse_ioctl(phPalEse_e_ChipRst, pEseDeviceHandle, 5);
+    ret = phNxpEse_SPM_ioctl(phPalEse_e_ChipRst, 5);
     if (ret < 0)
     {
         status = SPMSTATUS_FAILED;
@@ -537,3 +939,280 @@ SPMSTATUS phNxpEse_SPM_RelAccess(void)
 #endif
     return status;
 }
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_parkLocked
+ *
+ * Description      This function parks the access of the session for leaseMs
+ *                  and makes sure the lease thread watches it.
+ *                  gSpmLeaseLock is held.
+ *
+ * Returns          TRUE if parked, FALSE otherwise
+ *
+ ******************************************************************************/
+static bool_t phNxpEse_SPM_parkLocked(unsigned long leaseMs)
+{
+    unsigned long pollMs = SPM_LEASE_DEFAULT_POLL_MS;
+    pthread_t reaper;
+    pthread_attr_t attr;
+
+    /* only a plain SPI session is kept, not a priority one */
+    if ((0 == leaseMs) || (SPM_LEASE_HELD != gSpmLease.state) || (NULL == pEseDeviceHandle) ||
+            (FALSE == gSpmLease.shadowValid) ||
+            ((gSpmLease.shadow & (SPM_STATE_SPI | SPM_STATE_SPI_PRIO)) != SPM_STATE_SPI))
+    {
+        return FALSE;
+    }
+    /* the driver has no contention event: the lease thread has to ask */
+    if (!GetNxpNumValue(NAME_NXP_ESE_SPM_LEASE_POLL_MS, &pollMs, sizeof(pollMs)) || (0 == pollMs))
+        pollMs = SPM_LEASE_DEFAULT_POLL_MS;
+    if (FALSE == gSpmLease.reaperRunning)
+    {
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (0 != pthread_create(&reaper, &attr, phNxpEse_SPM_leaseReaper, NULL))
+        {
+            /* nobody would give the access back */
+            NXPLOG_ESELIB_E("%s : no lease thread", __FUNCTION__);
+            pthread_attr_destroy(&attr);
+            return FALSE;
+        }
+        pthread_attr_destroy(&attr);
+        gSpmLease.reaperRunning = TRUE;
+    }
+    gSpmLease.leaseMs = leaseMs;
+    gSpmLease.pollMs = pollMs;
+    gSpmLease.parkedSinceUs = phNxpEse_SPM_nowUs();
+    gSpmLease.deadlineUs = gSpmLease.parkedSinceUs + ((uint64_t)leaseMs * 1000);
+    gSpmLease.state = SPM_LEASE_PARKED;
+    gSpmLease.claimed = FALSE;
+    pthread_cond_broadcast(&gSpmLeaseCond);
+    return TRUE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_LeasePark
+ *
+ * Description      This function keeps the device open and the SPI access
+ *                  held after the session is closed, for
+ *                  NXP_ESE_SPM_LEASE_MS or the time the power policy
+ *                  chooses
+ *
+ * Returns          TRUE if parked, FALSE if the session has to be closed
+ *
+ ******************************************************************************/
+bool_t phNxpEse_SPM_LeasePark(void)
+{
+    unsigned long leaseMs = 0;
+    bool_t parked = FALSE;
+
+    if (!GetNxpNumValue(NAME_NXP_ESE_SPM_LEASE_MS, &leaseMs, sizeof(leaseMs)))
+        leaseMs = 0;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    leaseMs = phNxpEse_SPM_PolicyHoldMs(leaseMs);
+    parked = phNxpEse_SPM_parkLocked(leaseMs);
+    if (TRUE == parked)
+    {
+        gSpmLease.warm = FALSE;
+        phNxpEse_SPM_endSession("parked");
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    return parked;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_LeaseWarm
+ *
+ * Description      This function powers the Ese up without session, as
+ *                  phNxpEse_open would, and parks the access for leaseMs
+ *
+ * Returns          SPMSTATUS_SUCCESS if parked, SPMSTATUS_FAILED otherwise
+ *
+ ******************************************************************************/
+SPMSTATUS phNxpEse_SPM_LeaseWarm(unsigned long leaseMs, long pwrScheme)
+{
+    phPalEse_Config_t tPalConfig;
+    spm_state_t current_spm_state = SPM_STATE_INVALID;
+    SPMSTATUS status = SPMSTATUS_FAILED;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if ((0 != leaseMs) && (SPM_LEASE_PARKED == gSpmLease.state))
+    {
+        /* already up, it only has to stay up longer */
+        if ((phNxpEse_SPM_nowUs() + ((uint64_t)leaseMs * 1000)) > gSpmLease.deadlineUs)
+        {
+            gSpmLease.deadlineUs = phNxpEse_SPM_nowUs() + ((uint64_t)leaseMs * 1000);
+        }
+        pthread_mutex_unlock(&gSpmLeaseLock);
+        return SPMSTATUS_SUCCESS;
+    }
+    /* A session owns the device. claimed is the open/close handshake with the
+     * session, always under gSpmLeaseLock: phNxpEse_SPM_LeaseRelease or
+     * phNxpEse_SPM_LeaseResume sets it before phNxpEse_open touches /dev/p73,
+     * and phNxpEse_SPM_DeInit or phNxpEse_SPM_LeasePark clears it once the
+     * session no longer uses its handle. In between, nothing here opens or
+     * powers the eSE. */
+    if ((0 == leaseMs) || (SPM_LEASE_NONE != gSpmLease.state) || (TRUE == gSpmLease.claimed))
+    {
+        pthread_mutex_unlock(&gSpmLeaseLock);
+        return SPMSTATUS_FAILED;
+    }
+    phNxpEse_memset(&tPalConfig, 0x00, sizeof(tPalConfig));
+    tPalConfig.pDevName = (int8_t *) "/dev/p73";
+    if (phPalEse_open_and_configure(&tPalConfig) != ESESTATUS_SUCCESS)
+    {
+        NXPLOG_ESELIB_E("%s : phPalEse_open_and_configure failed", __FUNCTION__);
+        pthread_mutex_unlock(&gSpmLeaseLock);
+        return SPMSTATUS_FAILED;
+    }
+    pEseDeviceHandle = tPalConfig.pDevHandle;
+    gSpmStats.sessionIoctls = 0;
+    gSpmLease.shadowValid = FALSE;
+    if ((phNxpEse_SPM_SetPwrScheme(pwrScheme) == SPMSTATUS_SUCCESS) &&
+            (phNxpEse_SPM_GetState(&current_spm_state) == SPMSTATUS_SUCCESS) &&
+            (0 == (current_spm_state & (SPM_STATE_SPI | SPM_STATE_SPI_PRIO | SPM_STATE_CONTENTION))) &&
+            (phNxpEse_SPM_configPwrLocked(SPM_POWER_ENABLE) == SPMSTATUS_SUCCESS))
+    {
+        phPalEse_ioctl(phPalEse_e_EnableLog, pEseDeviceHandle, 0);
+        phPalEse_ioctl(phPalEse_e_EnablePollMode, pEseDeviceHandle, 1);
+        gSpmStats.warmups++;
+        if (TRUE == phNxpEse_SPM_parkLocked(leaseMs))
+        {
+            gSpmLease.warm = TRUE;
+            phNxpEse_SPM_endSession("warmed up");
+            status = SPMSTATUS_SUCCESS;
+        }
+        else
+        {
+            phNxpEse_SPM_releaseLocked();
+        }
+    }
+    else
+    {
+        NXPLOG_ESELIB_D("%s : Ese not available, state 0x%x", __FUNCTION__, current_spm_state);
+        phPalEse_close(pEseDeviceHandle);
+        pEseDeviceHandle = NULL;
+        gSpmLease.shadowValid = FALSE;
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_LeaseResume
+ *
+ * Description      This function takes back a parked lease for a new session
+ *
+ * Returns          SPMSTATUS_SUCCESS if resumed, SPMSTATUS_FAILED otherwise
+ *
+ ******************************************************************************/
+SPMSTATUS phNxpEse_SPM_LeaseResume(void **ppDevHandle)
+{
+    SPMSTATUS status = SPMSTATUS_FAILED;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if ((SPM_LEASE_PARKED == gSpmLease.state) && (phNxpEse_SPM_nowUs() < gSpmLease.deadlineUs))
+    {
+        phNxpEse_SPM_unparkLocked();
+        gSpmLease.state = SPM_LEASE_HELD;
+        gSpmLease.claimed = TRUE;
+        gSpmStats.leaseResumes++;
+        if (TRUE == gSpmLease.warm)
+        {
+            gSpmStats.warmupsUsed++;
+            gSpmLease.warm = FALSE;
+        }
+        gSpmStats.sessionIoctls = 0;
+        *ppDevHandle = pEseDeviceHandle;
+        /* the reaper sees the lease is gone and exits */
+        pthread_cond_broadcast(&gSpmLeaseCond);
+        status = SPMSTATUS_SUCCESS;
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
+    return status;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_LeaseRelease
+ *
+ * Description      This function releases a parked lease at once, before a
+ *                  session opens the device
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_LeaseRelease(void)
+{
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if (SPM_LEASE_PARKED == gSpmLease.state)
+    {
+        phNxpEse_SPM_releaseLocked();
+        phNxpEse_SPM_endSession("lease released");
+        pthread_cond_broadcast(&gSpmLeaseCond);
+    }
+    /* no power up behind the back of the session until phNxpEse_SPM_DeInit */
+    gSpmLease.claimed = TRUE;
+    pthread_mutex_unlock(&gSpmLeaseLock);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_LeaseDrop
+ *
+ * Description      This function powers down a parked access at once, unless
+ *                  a session is about to use it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_LeaseDrop(void)
+{
+    pthread_mutex_lock(&gSpmLeaseLock);
+    if (SPM_LEASE_PARKED == gSpmLease.state)
+    {
+        phNxpEse_SPM_releaseLocked();
+        phNxpEse_SPM_endSession("lease dropped");
+        pthread_cond_broadcast(&gSpmLeaseCond);
+    }
+    pthread_mutex_unlock(&gSpmLeaseLock);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_GetStats
+ *
+ * Description      This function copies out and optionally clears the SPM
+ *                  counters
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_GetStats(phNxpEse_SPM_Stats_t *pStats, bool_t reset)
+{
+    uint64_t now;
+
+    pthread_mutex_lock(&gSpmLeaseLock);
+    /* the time of the current power period counts up to now */
+    now = phNxpEse_SPM_nowUs();
+    if (0 != gSpmLease.poweredSinceUs)
+    {
+        gSpmStats.onTimeUs += now - gSpmLease.poweredSinceUs;
+        gSpmLease.poweredSinceUs = now;
+    }
+    if (SPM_LEASE_PARKED == gSpmLease.state)
+    {
+        gSpmStats.idleOnTimeUs += now - gSpmLease.parkedSinceUs;
+        gSpmLease.parkedSinceUs = now;
+    }
+    if (NULL != pStats)
+    {
+        *pStats = gSpmStats;
+    }
+    if (reset)
+    {
+        uint32_t sessionIoctls = gSpmStats.sessionIoctls;
+        phNxpEse_memset(&gSpmStats, 0x00, sizeof(gSpmStats));
+        gSpmStats.sessionIoctls = sessionIoctls;
+    }
+    phNxpEse_SPM_PolicyGetStats(pStats, reset);
+    pthread_mutex_unlock(&gSpmLeaseLock);
+}
@@ -218,6 +218,90 @@ SPMSTATUS phNxpEse_SPM_SetPwrScheme(long arg);
 + *        SPMSTATUS_FAILED - if reset request is failed \n
 + */
 SPMSTATUS phNxpEse_SPM_DisablePwrControl(unsigned long arg);
+
+/**
+ * \brief SPM driver calls and access arbitration counters
+ */
+typedef struct phNxpEse_SPM_Stats
+{
+    uint32_t sessionIoctls; /*!< driver calls of the SPM since the session was opened */
+    uint32_t ioctls; /*!< driver calls of the SPM */
+    uint32_t accessGrants; /*!< SPI access obtained from the driver */
+    uint32_t leaseResumes; /*!< sessions opened on a parked lease, without driver call */
+    uint32_t leaseExpiries; /*!< parked leases released at the end of their time */
+    uint32_t leaseRevokes; /*!< parked leases released on NFC/DWP contention */
+    uint32_t shadowHits; /*!< state queries answered from the shadow state */
+    uint64_t accessWaitUs; /*!< time spent waiting for the driver to grant access */
+    uint64_t maxAccessWaitUs; /*!< longest of these waits */
+    uint32_t warmups; /*!< power ups without session, see phNxpEse_SPM_LeaseWarm */
+    uint32_t warmupsUsed; /*!< of these, the ones a session resumed */
+    uint64_t onTimeUs; /*!< time between power enable and disable */
+    uint64_t idleOnTimeUs; /*!< of it, the time parked without session */
+    uint32_t policyHolds; /*!< leases the power policy kept up to the next expected open */
+    uint32_t policyPowerDowns; /*!< leases it dropped with a power up scheduled instead */
+    uint32_t policyHints; /*!< hints of the clients */
+} phNxpEse_SPM_Stats_t;
+
+/**
+ * \brief This function keeps the device open and the SPI access held
+ * after the session is closed, for NXP_ESE_SPM_LEASE_MS or the time the
+ * power policy chooses, so that the next session opens without driver
+ * call. The lease is released earlier if the driver reports NFC/DWP
+ * activity.
+ *
+ * \retval TRUE if the lease is parked, the caller must then neither
+ *         disable the power nor close the device.
+ *         FALSE if the access has to be given back.
+ */
+bool_t phNxpEse_SPM_LeasePark(void);
+
+/**
+ * \brief This function powers the Ese up without session, as phNxpEse_open
+ * would, and parks the access for leaseMs so that the next session opens
+ * on it. A parked access is only kept longer. Nothing is done while a
+ * session is open.
+ *
+ * \param[in]       leaseMs time the access stays parked
+ * \param[in]       pwrScheme power scheme, see phNxpEse_SPM_SetPwrScheme
+ * \retval SPMSTATUS_SUCCESS if the access is parked,
+ *         SPMSTATUS_FAILED otherwise.
+ */
+SPMSTATUS phNxpEse_SPM_LeaseWarm(unsigned long leaseMs, long pwrScheme);
+
+/**
+ * \brief This function takes back a parked lease for a new session
+ *
+ * \param[out]      ppDevHandle device handle of the parked session
+ * \retval SPMSTATUS_SUCCESS if the lease was parked and is still valid,
+ *         SPMSTATUS_FAILED otherwise.
+ */
+SPMSTATUS phNxpEse_SPM_LeaseResume(void **ppDevHandle);
+
+/**
+ * \brief This function releases a parked lease at once: power disabled,
+ * access released and device closed. Called before a session opens the
+ * device, no power up is done behind its back until phNxpEse_SPM_DeInit.
+ *
+ * \retval None
+ */
+void phNxpEse_SPM_LeaseRelease(void);
+
+/**
+ * \brief This function releases a parked lease at once, as
+ * phNxpEse_SPM_LeaseRelease, outside of any session.
+ *
+ * \retval None
+ */
+void phNxpEse_SPM_LeaseDrop(void);
+
+/**
+ * \brief This function copies out and optionally clears the SPM counters
+ *
+ * \param[out]      pStats counters, may be NULL to only clear them
+ * \param[in]       reset TRUE to clear the counters
+ * \retval None
+ */
+void phNxpEse_SPM_GetStats(phNxpEse_SPM_Stats_t *pStats, bool_t reset);
 #if(NXP_ESE_JCOP_DWNLD_PROTECTION == TRUE)
 /******************************************************************************
  * Function         phNxpEse_SPM_SetJcopDwnldState
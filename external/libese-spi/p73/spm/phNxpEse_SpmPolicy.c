@@ -0,0 +1,388 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SPM power policy
+ *
+ * Learns, for each kind of client, the period at which normal sessions are
+ * opened, as a smoothed mean and mean deviation of the time between two
+ * opens. When a session closes and the next one is expected soon enough,
+ * the access is parked until then; when it is expected later, the Ese is
+ * powered down at once and powered up again by the policy thread just
+ * before. Hints of the clients power the Ese up or down at once.
+ *
+ * Only the PN67T and PN80T legacy schemes power the Ese with the SPI
+ * access. With an external PMU the Ese is powered anyway and the policy
+ * leaves the lease time as configured.
+ */
+#include <pthread.h>
+#include <time.h>
+#include <phNxpEse_Internal.h>
+#include <phNxpConfig.h>
+#include "phNxpEse_SpmPolicy.h"
+
+#define SPM_POLICY_MIN_SAMPLES          3
+/* opens further apart belong to different usages */
+#define SPM_POLICY_MAX_PERIOD_US        (3600ULL * 1000000ULL)
+#define SPM_POLICY_DEFAULT_MAX_HOLD_MS  1000
+#define SPM_POLICY_DEFAULT_LEAD_MS      30
+#define SPM_POLICY_DEFAULT_HINT_HOLD_MS 3000
+
+/* Open period of one kind of client */
+typedef struct
+{
+    uint64_t lastOpenUs;
+    uint64_t periodUs;          /* smoothed time between opens, gain 1/8 */
+    uint64_t devUs;             /* smoothed deviation from it, gain 1/4 */
+    uint32_t samples;
+} phNxpEse_SPM_PolicyModel_t;
+
+typedef struct
+{
+    bool_t enabled;
+    unsigned long maxHoldMs;
+    unsigned long leadMs;
+    unsigned long hintHoldMs;
+    long pwrScheme;
+    phNxpEse_clientType clientType;     /* kind of client of the last session */
+    phNxpEse_SPM_PolicyModel_t model[ESE_CLIENT_MAX];
+    uint64_t warmAtUs;                  /* scheduled power up, 0 for none */
+    unsigned long warmHoldMs;
+    bool_t hintPending;
+    bool_t threadRunning;
+    uint32_t holds;
+    uint32_t powerDowns;
+    uint32_t hints;
+} phNxpEse_SPM_Policy_t;
+
+static phNxpEse_SPM_Policy_t gSpmPolicy;
+static pthread_mutex_t gSpmPolicyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gSpmPolicyCond = PTHREAD_COND_INITIALIZER;
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_policyNowUs
+ *
+ * Description      This function returns the monotonic time
+ *
+ * Returns          Time in microseconds
+ *
+ ******************************************************************************/
+static uint64_t phNxpEse_SPM_policyNowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_policyReadConfig
+ *
+ * Description      This function reads the policy settings, and the power
+ *                  scheme as long as no session has reported it.
+ *                  gSpmPolicyLock is held.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_policyReadConfig(void)
+{
+    unsigned long num = 0;
+
+    gSpmPolicy.enabled = (GetNxpNumValue(NAME_NXP_ESE_PWR_POLICY, &num, sizeof(num)) && (num != 0));
+    if (!GetNxpNumValue(NAME_NXP_ESE_PWR_MAX_HOLD_MS, &gSpmPolicy.maxHoldMs, sizeof(gSpmPolicy.maxHoldMs)))
+        gSpmPolicy.maxHoldMs = SPM_POLICY_DEFAULT_MAX_HOLD_MS;
+    if (!GetNxpNumValue(NAME_NXP_ESE_PWR_WARM_LEAD_MS, &gSpmPolicy.leadMs, sizeof(gSpmPolicy.leadMs)))
+        gSpmPolicy.leadMs = SPM_POLICY_DEFAULT_LEAD_MS;
+    if (!GetNxpNumValue(NAME_NXP_ESE_PWR_HINT_HOLD_MS, &gSpmPolicy.hintHoldMs, sizeof(gSpmPolicy.hintHoldMs)))
+        gSpmPolicy.hintHoldMs = SPM_POLICY_DEFAULT_HINT_HOLD_MS;
+    /* a hint can come before the first open, read it as phNxpEse_init does */
+    if (0 == gSpmPolicy.pwrScheme)
+    {
+#if defined(ESE_DEBUG_UTILS_INCLUDED) && (NXP_POWER_SCHEME_SUPPORT == TRUE)
+        if (GetNxpNumValue(NAME_NXP_POWER_SCHEME, &num, sizeof(num)))
+            gSpmPolicy.pwrScheme = (long)num;
+        else
+#endif
+            gSpmPolicy.pwrScheme = PN67T_POWER_SCHEME;
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_policyCanWarm
+ *
+ * Description      This function tells whether powering the Ese ahead of use
+ *                  saves anything with the current power scheme. An unknown
+ *                  scheme may be the external PMU one, so it never does.
+ *                  gSpmPolicyLock is held.
+ *
+ * Returns          TRUE if it does
+ *
+ ******************************************************************************/
+static bool_t phNxpEse_SPM_policyCanWarm(void)
+{
+    return (gSpmPolicy.enabled && ((PN67T_POWER_SCHEME == gSpmPolicy.pwrScheme) ||
+            (PN80T_LEGACY_SCHEME == gSpmPolicy.pwrScheme))) ? TRUE : FALSE;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_policyThread
+ *
+ * Description      This thread powers the Ese up when a hint asks for it or
+ *                  when a scheduled power up is due
+ *
+ * Returns          NULL
+ *
+ ******************************************************************************/
+static void *phNxpEse_SPM_policyThread(void *arg)
+{
+    struct timespec ts;
+    unsigned long holdMs;
+    long pwrScheme;
+    uint64_t now, waitUs;
+    (void)arg;
+
+    pthread_mutex_lock(&gSpmPolicyLock);
+    while ((TRUE == gSpmPolicy.hintPending) || (0 != gSpmPolicy.warmAtUs))
+    {
+        now = phNxpEse_SPM_policyNowUs();
+        if ((TRUE == gSpmPolicy.hintPending) ||
+                ((0 != gSpmPolicy.warmAtUs) && (now >= gSpmPolicy.warmAtUs)))
+        {
+            holdMs = gSpmPolicy.hintPending ? gSpmPolicy.hintHoldMs : gSpmPolicy.warmHoldMs;
+            pwrScheme = gSpmPolicy.pwrScheme;
+            gSpmPolicy.hintPending = FALSE;
+            gSpmPolicy.warmAtUs = 0;
+            pthread_mutex_unlock(&gSpmPolicyLock);
+            if (phNxpEse_SPM_LeaseWarm(holdMs, pwrScheme) == SPMSTATUS_SUCCESS)
+            {
+                NXPLOG_ESELIB_D("%s : Ese powered up for %lu ms", __FUNCTION__, holdMs);
+            }
+            pthread_mutex_lock(&gSpmPolicyLock);
+            continue;
+        }
+        waitUs = gSpmPolicy.warmAtUs - now;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += waitUs / 1000000;
+        ts.tv_nsec += (waitUs % 1000000) * 1000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&gSpmPolicyCond, &gSpmPolicyLock, &ts);
+    }
+    gSpmPolicy.threadRunning = FALSE;
+    pthread_mutex_unlock(&gSpmPolicyLock);
+    return NULL;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_policyKick
+ *
+ * Description      This function makes the policy thread look at a new hint
+ *                  or schedule. gSpmPolicyLock is held.
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+static void phNxpEse_SPM_policyKick(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+
+    if (TRUE == gSpmPolicy.threadRunning)
+    {
+        pthread_cond_broadcast(&gSpmPolicyCond);
+        return;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (0 == pthread_create(&thread, &attr, phNxpEse_SPM_policyThread, NULL))
+    {
+        gSpmPolicy.threadRunning = TRUE;
+    }
+    else
+    {
+        NXPLOG_ESELIB_E("%s : no policy thread", __FUNCTION__);
+        gSpmPolicy.hintPending = FALSE;
+        gSpmPolicy.warmAtUs = 0;
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_PolicyOnOpen
+ *
+ * Description      This function updates the open period of the kind of
+ *                  client with the open of a normal session
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_PolicyOnOpen(phNxpEse_clientType clientType, long pwrScheme, bool_t warm)
+{
+    phNxpEse_SPM_PolicyModel_t *pModel;
+    uint64_t now = phNxpEse_SPM_policyNowUs();
+    uint64_t sampleUs, errUs;
+
+    if ((clientType < ESE_CLIENT_DEFAULT) || (clientType >= ESE_CLIENT_MAX))
+        clientType = ESE_CLIENT_DEFAULT;
+    pthread_mutex_lock(&gSpmPolicyLock);
+    phNxpEse_SPM_policyReadConfig();
+    gSpmPolicy.pwrScheme = pwrScheme;
+    gSpmPolicy.clientType = clientType;
+    /* the session is there, a power up still scheduled is of no use */
+    gSpmPolicy.warmAtUs = 0;
+    pModel = &gSpmPolicy.model[clientType];
+    sampleUs = now - pModel->lastOpenUs;
+    if ((0 == pModel->lastOpenUs) || (sampleUs > SPM_POLICY_MAX_PERIOD_US))
+    {
+        pModel->samples = 0;
+    }
+    else if (0 == pModel->samples++)
+    {
+        pModel->periodUs = sampleUs;
+        pModel->devUs = sampleUs / 2;
+    }
+    else
+    {
+        errUs = (sampleUs > pModel->periodUs) ? (sampleUs - pModel->periodUs) : (pModel->periodUs - sampleUs);
+        pModel->periodUs = pModel->periodUs - (pModel->periodUs / 8) + (sampleUs / 8);
+        pModel->devUs = pModel->devUs - (pModel->devUs / 4) + (errUs / 4);
+    }
+    pModel->lastOpenUs = now;
+    NXPLOG_ESELIB_D("%s : client %d %s, period %llu us dev %llu us", __FUNCTION__, clientType,
+            warm ? "warm" : "cold", (unsigned long long)pModel->periodUs,
+            (unsigned long long)pModel->devUs);
+    pthread_mutex_unlock(&gSpmPolicyLock);
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_PolicyHoldMs
+ *
+ * Description      This function chooses the lease time of the closing
+ *                  session from the expected time of the next open
+ *
+ * Returns          Lease time in ms, 0 to power down
+ *
+ ******************************************************************************/
+unsigned long phNxpEse_SPM_PolicyHoldMs(unsigned long defaultMs)
+{
+    phNxpEse_SPM_PolicyModel_t *pModel;
+    uint64_t now = phNxpEse_SPM_policyNowUs();
+    uint64_t nextOpenUs, marginUs, holdUs;
+    unsigned long holdMs = defaultMs;
+
+    pthread_mutex_lock(&gSpmPolicyLock);
+    pModel = &gSpmPolicy.model[gSpmPolicy.clientType];
+    /* a pattern is only trusted once its deviation is small against it */
+    if ((FALSE == phNxpEse_SPM_policyCanWarm()) || (pModel->samples < SPM_POLICY_MIN_SAMPLES) ||
+            ((pModel->devUs * 4) >= pModel->periodUs))
+    {
+        pthread_mutex_unlock(&gSpmPolicyLock);
+        return holdMs;
+    }
+    nextOpenUs = pModel->lastOpenUs + pModel->periodUs;
+    marginUs = (2 * pModel->devUs) + ((uint64_t)gSpmPolicy.leadMs * 1000);
+    if ((nextOpenUs + marginUs) > now)
+    {
+        holdUs = nextOpenUs + marginUs - now;
+        if (holdUs <= ((uint64_t)gSpmPolicy.maxHoldMs * 1000))
+        {
+            /* stay up through the next open */
+            holdMs = (unsigned long)((holdUs + 999) / 1000);
+            gSpmPolicy.holds++;
+        }
+        else
+        {
+            /* down now, up again just before the next open */
+            holdMs = 0;
+            gSpmPolicy.warmAtUs = ((nextOpenUs - marginUs) > now) ? (nextOpenUs - marginUs) : now;
+            gSpmPolicy.warmHoldMs = (unsigned long)((2 * marginUs) / 1000);
+            gSpmPolicy.powerDowns++;
+            phNxpEse_SPM_policyKick();
+        }
+    }
+    pthread_mutex_unlock(&gSpmPolicyLock);
+    return holdMs;
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_PolicyHint
+ *
+ * Description      This function powers the Ese up in the background or
+ *                  down at once, as the client expects to use it
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_PolicyHint(phNxpEse_pwrHint hint)
+{
+    bool_t drop = FALSE;
+
+    pthread_mutex_lock(&gSpmPolicyLock);
+    phNxpEse_SPM_policyReadConfig();
+    if (TRUE == gSpmPolicy.enabled)
+    {
+        gSpmPolicy.hints++;
+        if (ESE_PWR_HINT_ACTIVE == hint)
+        {
+            if (TRUE == phNxpEse_SPM_policyCanWarm())
+            {
+                gSpmPolicy.hintPending = TRUE;
+                phNxpEse_SPM_policyKick();
+            }
+        }
+        else
+        {
+            gSpmPolicy.hintPending = FALSE;
+            gSpmPolicy.warmAtUs = 0;
+            drop = TRUE;
+        }
+    }
+    pthread_mutex_unlock(&gSpmPolicyLock);
+    if (TRUE == drop)
+    {
+        phNxpEse_SPM_LeaseDrop();
+    }
+}
+
+/******************************************************************************
+ * Function         phNxpEse_SPM_PolicyGetStats
+ *
+ * Description      This function copies out and optionally clears the policy
+ *                  counters
+ *
+ * Returns          None
+ *
+ ******************************************************************************/
+void phNxpEse_SPM_PolicyGetStats(phNxpEse_SPM_Stats_t *pStats, bool_t reset)
+{
+    pthread_mutex_lock(&gSpmPolicyLock);
+    if (NULL != pStats)
+    {
+        pStats->policyHolds = gSpmPolicy.holds;
+        pStats->policyPowerDowns = gSpmPolicy.powerDowns;
+        pStats->policyHints = gSpmPolicy.hints;
+    }
+    if (reset)
+    {
+        gSpmPolicy.holds = 0;
+        gSpmPolicy.powerDowns = 0;
+        gSpmPolicy.hints = 0;
+    }
+    pthread_mutex_unlock(&gSpmPolicyLock);
+}
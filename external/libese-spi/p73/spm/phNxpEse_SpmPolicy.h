@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * \addtogroup SPI_Power_Management
+ *
+ * @{ */
+
+#ifndef _PHNXPESE_SPMPOLICY_H
+#define _PHNXPESE_SPMPOLICY_H
+
+#include <phNxpEse_Api.h>
+#include "phNxpEse_Spm.h"
+
+/**
+ * \brief This function feeds the open of a normal session to the power
+ * policy, which learns from it when the next one of the same kind of
+ * client is due.
+ *
+ * \param[in]       clientType kind of client, see phNxpEse_clientType
+ * \param[in]       pwrScheme power scheme of the session
+ * \param[in]       warm TRUE if the session found the Ese powered
+ * \retval None
+ */
+void phNxpEse_SPM_PolicyOnOpen(phNxpEse_clientType clientType, long pwrScheme, bool_t warm);
+
+/**
+ * \brief This function decides how long the access of the closing session
+ * is kept powered. When the next session is expected within
+ * NXP_ESE_PWR_MAX_HOLD_MS it stays up until then, when it is expected later
+ * the Ese is powered down at once and a power up is scheduled just before.
+ * Called with the SPM lease lock held.
+ *
+ * \param[in]       defaultMs lease time of NXP_ESE_SPM_LEASE_MS
+ * \retval Lease time in ms, 0 to power down
+ */
+unsigned long phNxpEse_SPM_PolicyHoldMs(unsigned long defaultMs);
+
+/**
+ * \brief This function applies a hint of the client, see phNxpEse_powerHint
+ *
+ * \param[in]       hint expected use of the Ese
+ * \retval None
+ */
+void phNxpEse_SPM_PolicyHint(phNxpEse_pwrHint hint);
+
+/**
+ * \brief This function copies out and optionally clears the counters of
+ * the power policy into the SPM counters
+ *
+ * \param[out]      pStats SPM counters, may be NULL to only clear them
+ * \param[in]       reset TRUE to clear the counters
+ * \retval None
+ */
+void phNxpEse_SPM_PolicyGetStats(phNxpEse_SPM_Stats_t *pStats, bool_t reset);
+
+#endif  /*  _PHNXPESE_SPMPOLICY_H    */
+/** @} */
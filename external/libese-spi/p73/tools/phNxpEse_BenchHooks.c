@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The T=1 and ISO 7816-4 layers keep their frame handling static. They are
+ * compiled here, in the benchmark's own translation unit, with the frame
+ * writes routed through a switchable sink so that frame building can be
+ * timed without the PAL underneath.
+ */
+#define phNxpEse_WriteFrame phNxpEseBench_WriteFrame
+#include "../lib/phNxpEseProto7816_3.c"
+#undef phNxpEse_WriteFrame
+#include "../lib/phNxpEse_Apdu_Api.c"
+
+#include "phNxpEse_BenchHooks.h"
+
+ESESTATUS phNxpEse_WriteFrame(uint32_t data_len, const uint8_t *p_data);
+
+static bool_t gFrameSink = FALSE;
+static uint32_t gSinkFrames = 0;
+
+ESESTATUS phNxpEseBench_WriteFrame(uint32_t data_len, const uint8_t *p_data)
+{
+    if (gFrameSink)
+    {
+        gSinkFrames++;
+        return ESESTATUS_SUCCESS;
+    }
+    return phNxpEse_WriteFrame(data_len, p_data);
+}
+
+void phNxpEseBench_setFrameSink(bool_t enable)
+{
+    gFrameSink = enable;
+}
+
+uint32_t phNxpEseBench_getSinkFrames(void)
+{
+    return gSinkFrames;
+}
+
+void phNxpEseBench_resetProto(void)
+{
+    phNxpEseProto7816_ResetProtoParams();
+}
+
+uint8_t phNxpEseBench_computeLRC(uint8_t *p_buff, uint32_t offset, uint32_t length)
+{
+    return phNxpEseT1_computeLrc(p_buff, offset, length);
+}
+
+bool_t phNxpEseBench_checkLRC(uint32_t data_len, uint8_t *p_data)
+{
+    return phNxpEseProto7816_CheckLRC(data_len, p_data);
+}
+
+bool_t phNxpEseBench_sendIframe(uint8_t *p_data, uint32_t data_len, bool_t isChained)
+{
+    iFrameInfo_t iFrameData;
+
+    phNxpEse_memset(&iFrameData, 0x00, sizeof(iFrameData));
+    iFrameData.isChained = isChained;
+    iFrameData.p_data = p_data;
+    iFrameData.sendDataLen = data_len;
+    iFrameData.totalDataLen = data_len;
+    return phNxpEseProto7816_SendIframe(iFrameData);
+}
+
+bool_t phNxpEseBench_sendRframe(bool_t nack)
+{
+    return phNxpEseProto7816_sendRframe(nack ? RNACK : RACK);
+}
+
+bool_t phNxpEseBench_sendSframe(uint32_t sFrameType)
+{
+    sFrameInfo_t sFrameData;
+
+    sFrameData.sFrameType = (sFrameTypes_t)sFrameType;
+    return phNxpEseProto7816_SendSFrame(sFrameData);
+}
+
+bool_t phNxpEseBench_decodeFrame(uint8_t *p_data, uint32_t data_len)
+{
+    return phNxpEseProto7816_DecodeFrame(p_data, data_len);
+}
+
+/* The allocating framer the transceive path used before the encoder */
+ESESTATUS phNxpEseBench_frameCmd(pphNxpEse_7816_cpdu_t pCmd, uint8_t **pcmd_data,
+        uint32_t *cmd_len)
+{
+    phNxpEse_7816_CmdLayout_t cmdLayout;
+    uint8_t *pbuff = NULL;
+    ESESTATUS status;
+
+    status = phNxpEse_7816_EncodeCmd(pCmd, &cmdLayout);
+    if (ESESTATUS_SUCCESS != status)
+    {
+        return status;
+    }
+    pbuff = (uint8_t *)phNxpEse_calloc(cmdLayout.total_len, sizeof(uint8_t));
+    if (pbuff == NULL)
+    {
+        return ESESTATUS_INSUFFICIENT_RESOURCES;
+    }
+    phNxpEse_7816_CmdSource(&cmdLayout, pbuff, 0, cmdLayout.total_len);
+    *cmd_len = cmdLayout.total_len;
+    *pcmd_data = pbuff;
+    return ESESTATUS_SUCCESS;
+}
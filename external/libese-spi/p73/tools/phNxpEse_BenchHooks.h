@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Entry points into the internal functions of the T=1 and ISO 7816-4
+ * layers, for the host micro benchmarks only. phNxpEse_BenchHooks.c
+ * builds those layers in its own translation unit, so the benchmark
+ * must not link them a second time.
+ */
+#ifndef _PHNXPESE_BENCH_HOOKS_H
+#define _PHNXPESE_BENCH_HOOKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <phEseTypes.h>
+#include <phNxpEse_Apdu_Api.h>
+
+/*
+ * When set, the frames built by the protocol are counted and dropped
+ * instead of being written to the PAL.
+ */
+void phNxpEseBench_setFrameSink(bool_t enable);
+uint32_t phNxpEseBench_getSinkFrames(void);
+
+void phNxpEseBench_resetProto(void);
+uint8_t phNxpEseBench_computeLRC(uint8_t *p_buff, uint32_t offset, uint32_t length);
+bool_t phNxpEseBench_checkLRC(uint32_t data_len, uint8_t *p_data);
+bool_t phNxpEseBench_sendIframe(uint8_t *p_data, uint32_t data_len, bool_t isChained);
+bool_t phNxpEseBench_sendRframe(bool_t nack);
+bool_t phNxpEseBench_sendSframe(uint32_t sFrameType);
+bool_t phNxpEseBench_decodeFrame(uint8_t *p_data, uint32_t data_len);
+ESESTATUS phNxpEseBench_frameCmd(pphNxpEse_7816_cpdu_t pCmd, uint8_t **pcmd_data,
+        uint32_t *cmd_len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _PHNXPESE_BENCH_HOOKS_H */
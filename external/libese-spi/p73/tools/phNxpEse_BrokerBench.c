@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Broker benchmark
+ *
+ * Runs the same APDU from one or more clients, first with direct calls to
+ * phNxpEse_Transceive serialized by a mutex, then through a broker running
+ * in a thread of the same process, each client with its own connection.
+ * Reports throughput, latency percentiles and CPU time per APDU of both.
+ * The simulated card answers without delay unless -p is given, so that
+ * the cost of the broker is not hidden behind the card.
+ *
+ * usage: ese_broker_bench [-n apdus] [-c clients] [-l lc] [-e le] [-p card_us] [-o csv|text]
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <phNxpEse_Api.h>
+#include <phNxpEse_Broker.h>
+#ifdef ESE_PAL_SIM_INCLUDED
+#include <phNxpEsePal_sim.h>
+#endif
+
+#define BENCH_MAX_CLIENTS       PH_BROKER_MAX_CLIENTS
+#define BENCH_DEFAULT_APDUS     10000
+
+typedef struct
+{
+    const char *pSocketPath;
+    const uint8_t *pCmd;
+    uint32_t cmdLen;
+    uint32_t apdus;
+    uint64_t *pLatency;
+    uint32_t failures;
+} bench_client_t;
+
+static pthread_mutex_t gLinkLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t bench_nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static uint64_t bench_cpuUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static int bench_cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void *bench_directClient(void *arg)
+{
+    bench_client_t *pClient = (bench_client_t *)arg;
+    phNxpEse_data cmd;
+    phNxpEse_data rsp;
+    uint64_t t0;
+    uint32_t i;
+
+    for (i = 0; i < pClient->apdus; i++)
+    {
+        cmd.len = pClient->cmdLen;
+        cmd.p_data = (uint8_t *)pClient->pCmd;
+        memset(&rsp, 0x00, sizeof(rsp));
+        t0 = bench_nowUs();
+        pthread_mutex_lock(&gLinkLock);
+        if (phNxpEse_Transceive(&cmd, &rsp) != ESESTATUS_SUCCESS)
+            pClient->failures++;
+        pthread_mutex_unlock(&gLinkLock);
+        pClient->pLatency[i] = bench_nowUs() - t0;
+        if (rsp.p_data != NULL)
+            phNxpEse_free(rsp.p_data);
+    }
+    return NULL;
+}
+
+static void *bench_brokerClient(void *arg)
+{
+    bench_client_t *pClient = (bench_client_t *)arg;
+    phNxpEseBroker_Client_t *pConn;
+    static __thread uint8_t rsp[PH_BROKER_MAX_APDU_LEN];
+    uint32_t rspLen;
+    uint64_t t0;
+    uint32_t i;
+
+    pConn = phNxpEseBroker_connect(pClient->pSocketPath);
+    if (pConn == NULL)
+    {
+        pClient->failures = pClient->apdus;
+        return NULL;
+    }
+    for (i = 0; i < pClient->apdus; i++)
+    {
+        t0 = bench_nowUs();
+        if (phNxpEseBroker_transceive(pConn, pClient->pCmd, pClient->cmdLen,
+                rsp, sizeof(rsp), &rspLen) != ESESTATUS_SUCCESS)
+            pClient->failures++;
+        pClient->pLatency[i] = bench_nowUs() - t0;
+    }
+    phNxpEseBroker_disconnect(pConn);
+    return NULL;
+}
+
+typedef struct
+{
+    const char *pSocketPath;
+    int stopFd;
+} bench_broker_t;
+
+static void *bench_broker(void *arg)
+{
+    bench_broker_t *pBroker = (bench_broker_t *)arg;
+    phNxpEseBroker_run(pBroker->pSocketPath, pBroker->stopFd);
+    return NULL;
+}
+
+static int bench_run(const char *pMode, void *(*pClientFn)(void *), bench_client_t *pTemplate,
+        uint32_t numClients, uint32_t n, uint64_t *pLatency, int csv)
+{
+    bench_client_t clients[BENCH_MAX_CLIENTS];
+    pthread_t tids[BENCH_MAX_CLIENTS];
+    uint64_t start, elapsedUs, cpu0, cpuUs;
+    uint32_t i, failures = 0, offset = 0;
+
+    cpu0 = bench_cpuUs();
+    start = bench_nowUs();
+    for (i = 0; i < numClients; i++)
+    {
+        clients[i] = *pTemplate;
+        clients[i].apdus = (n / numClients) + ((i < (n % numClients)) ? 1 : 0);
+        clients[i].pLatency = &pLatency[offset];
+        offset += clients[i].apdus;
+        pthread_create(&tids[i], NULL, pClientFn, &clients[i]);
+    }
+    for (i = 0; i < numClients; i++)
+    {
+        pthread_join(tids[i], NULL);
+        failures += clients[i].failures;
+    }
+    elapsedUs = bench_nowUs() - start;
+    cpuUs = bench_cpuUs() - cpu0;
+    if (elapsedUs == 0)
+        elapsedUs = 1;
+    qsort(pLatency, n, sizeof(uint64_t), bench_cmpU64);
+    if (csv)
+    {
+        printf("%s,%u,%u,%u,%.1f,%llu,%llu,%llu,%.2f\n", pMode, numClients, n, failures,
+                (n * 1000000.0) / elapsedUs,
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[n - 1], (double)cpuUs / n);
+    }
+    else
+    {
+        printf("%s: %u apdus, %u failed, %u client(s)\n", pMode, n, failures, numClients);
+        printf("  throughput %.1f apdus/s\n", (n * 1000000.0) / elapsedUs);
+        printf("  latency us p50 %llu p99 %llu max %llu\n",
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[n - 1]);
+        printf("  cpu %.2f us/apdu\n", (double)cpuUs / n);
+    }
+    return (int)failures;
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-n apdus] [-c clients] [-l lc] [-e le] [-p card_us] [-o csv|text]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    char socketPath[64];
+    bench_client_t client;
+    bench_broker_t broker;
+    pthread_t brokerTid;
+    phNxpEse_initParams initParams;
+    uint8_t *pCmd;
+    uint64_t *pLatency;
+    uint64_t one = 1;
+    uint32_t n = BENCH_DEFAULT_APDUS;
+    uint32_t numClients = 1;
+    uint32_t lc = 16;
+    uint32_t le = 16;
+    uint32_t cardUs = 0;
+    uint32_t cmdLen = 0, i;
+    int failures = 0;
+    int csv = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:l:e:p:o:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': n = strtoul(optarg, NULL, 0); break;
+        case 'c': numClients = strtoul(optarg, NULL, 0); break;
+        case 'l': lc = strtoul(optarg, NULL, 0); break;
+        case 'e': le = strtoul(optarg, NULL, 0); break;
+        case 'p': cardUs = strtoul(optarg, NULL, 0); break;
+        case 'o': csv = (strcmp(optarg, "text") != 0); break;
+        default: bench_usage(argv[0]); return 2;
+        }
+    }
+    if ((n == 0) || (numClients == 0) || (numClients > BENCH_MAX_CLIENTS) || (lc > 255) || (le > 256))
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    pCmd = (uint8_t *)malloc(5 + lc + 1);
+    pLatency = (uint64_t *)calloc(n, sizeof(uint64_t));
+    if ((pCmd == NULL) || (pLatency == NULL))
+        return 1;
+    /* short case 3 or 4 APDU, the simulated card answers Le bytes */
+    pCmd[cmdLen++] = 0x80;
+    pCmd[cmdLen++] = 0xCA;
+    pCmd[cmdLen++] = 0x00;
+    pCmd[cmdLen++] = 0x00;
+    if (lc > 0)
+    {
+        pCmd[cmdLen++] = (uint8_t)lc;
+        for (i = 0; i < lc; i++)
+            pCmd[cmdLen++] = (uint8_t)i;
+    }
+    pCmd[cmdLen++] = (uint8_t)le;
+
+#ifdef ESE_PAL_SIM_INCLUDED
+    {
+        phPalEse_SimConfig_t simConfig;
+        phPalEse_sim_setConfig(NULL);
+        phPalEse_sim_getConfig(&simConfig);
+        /* clients run in parallel, the time has to be real */
+        simConfig.virtualTime = FALSE;
+        simConfig.byteTimeNs = 0;
+        simConfig.frameGuardUs = 0;
+        simConfig.apduProcessingUs = cardUs;
+        phPalEse_sim_setConfig(&simConfig);
+    }
+#endif
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+            (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+    {
+        fprintf(stderr, "eSE open/init failed\n");
+        phNxpEse_close();
+        return 1;
+    }
+
+    memset(&client, 0x00, sizeof(client));
+    client.pCmd = pCmd;
+    client.cmdLen = cmdLen;
+    if (csv)
+        printf("mode,clients,apdus,failures,apdus_per_s,p50_us,p99_us,max_us,cpu_us_per_apdu\n");
+    failures += bench_run("direct", bench_directClient, &client, numClients, n, pLatency, csv);
+
+    snprintf(socketPath, sizeof(socketPath), "/tmp/ese_broker_bench.%d", (int)getpid());
+    broker.pSocketPath = socketPath;
+    broker.stopFd = eventfd(0, EFD_CLOEXEC);
+    client.pSocketPath = socketPath;
+    if ((broker.stopFd < 0) || (pthread_create(&brokerTid, NULL, bench_broker, &broker) != 0))
+    {
+        failures++;
+    }
+    else
+    {
+        /* the socket exists once the broker listens */
+        for (i = 0; (i < 1000) && (access(socketPath, F_OK) != 0); i++)
+            usleep(1000);
+        failures += bench_run("broker", bench_brokerClient, &client, numClients, n, pLatency, csv);
+        if (write(broker.stopFd, &one, sizeof(one)) < 0) {}
+        pthread_join(brokerTid, NULL);
+        close(broker.stopFd);
+    }
+
+    phNxpEse_deInit();
+    phNxpEse_close();
+    free(pCmd);
+    free(pLatency);
+    return (failures == 0) ? 0 : 1;
+}
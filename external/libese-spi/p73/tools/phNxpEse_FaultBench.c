@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * T=1 recovery benchmark
+ *
+ * Runs the same APDU workload over the simulated eSE under a set of fault
+ * profiles and reports goodput, retries per APDU and latency percentiles.
+ * Time is the simulated clock, so results are reproducible for a given
+ * seed and comparable across builds.
+ *
+ * usage: ese_fault_bench [-n apdus] [-c cmdlen] [-r rsplen] [-s seed]
+ *                        [-p profile|all] [-o csv|text] [-w trace]
+ *
+ * -w records the PAL traffic of the selected profile for ese_replay.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <phNxpEse_Api.h>
+#include <phNxpEsePal_sim.h>
+#include <phNxpEsePal_fault.h>
+#ifdef ESE_PAL_TRACE_INCLUDED
+#include <phNxpEsePal_trace.h>
+#endif
+
+#define BENCH_DEFAULT_APDUS         1000
+#define BENCH_DEFAULT_CMD_LEN       261
+#define BENCH_DEFAULT_RSP_LEN       256
+#define BENCH_DEFAULT_SEED          0x1234
+
+typedef struct
+{
+    const char *name;
+    phPalEse_FaultConfig_t fault;   /* seed is filled in at run time */
+} bench_profile_t;
+
+typedef struct
+{
+    uint32_t apdus;
+    uint32_t failures;
+    uint64_t bytes;
+    uint64_t elapsedUs;
+    uint32_t txFrames;
+    uint32_t rxFrames;
+    uint32_t faults;
+    uint64_t p50Us;
+    uint64_t p99Us;
+    uint64_t p999Us;
+    uint64_t maxUs;
+} bench_result_t;
+
+/* Rates per million frames: seed, rxLrc, rxDropAck, rxWtx, rxBadPcb, rxTruncate, txLrc, txDrop */
+static const bench_profile_t gProfiles[] = {
+    { "clean",    { 0,      0,     0,     0,     0,     0,     0,     0 } },
+    { "lrc",      { 0,  20000,     0,     0,     0,     0, 20000,     0 } },
+    { "drop_ack", { 0,      0, 50000,     0,     0,     0,     0,     0 } },
+    { "wtx",      { 0,      0,     0, 50000,     0,     0,     0,     0 } },
+    { "bad_pcb",  { 0,      0,     0,     0, 20000,     0,     0,     0 } },
+    { "truncate", { 0,      0,     0,     0,     0, 20000,     0,     0 } },
+    { "tx_drop",  { 0,      0,     0,     0,     0,     0,     0, 10000 } },
+    { "mixed",    { 0,   5000,  5000,  5000,  5000,  5000,  5000,  2000 } },
+};
+#define BENCH_NUM_PROFILES  (sizeof(gProfiles) / sizeof(gProfiles[0]))
+
+static int bench_cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_buildApdu(uint8_t *pApdu, uint32_t *pLen, uint32_t cmdLen, uint32_t rspLen)
+{
+    uint32_t dataLen = (cmdLen > 5) ? (cmdLen - 5) : 0;
+    uint32_t i;
+    uint32_t len = 0;
+
+    pApdu[len++] = 0x80;
+    pApdu[len++] = 0xCA;
+    pApdu[len++] = 0x00;
+    pApdu[len++] = 0x00;
+    if ((dataLen > 255) || (rspLen > 256))
+    {
+        /* Extended length case 4E */
+        pApdu[len++] = 0x00;
+        pApdu[len++] = (uint8_t)(dataLen >> 8);
+        pApdu[len++] = (uint8_t)dataLen;
+        for (i = 0; i < dataLen; i++)
+            pApdu[len++] = (uint8_t)i;
+        pApdu[len++] = (uint8_t)(rspLen >> 8);
+        pApdu[len++] = (uint8_t)rspLen;
+    }
+    else
+    {
+        if (dataLen > 0)
+        {
+            pApdu[len++] = (uint8_t)dataLen;
+            for (i = 0; i < dataLen; i++)
+                pApdu[len++] = (uint8_t)i;
+        }
+        pApdu[len++] = (uint8_t)rspLen;
+    }
+    *pLen = len;
+}
+
+static int bench_run(const bench_profile_t *pProfile, uint32_t seed, uint32_t numApdus,
+        uint32_t cmdLen, uint32_t rspLen, bench_result_t *pResult)
+{
+    static uint8_t apdu[PH_PALESE_SIM_MAX_APDU_LEN];
+    phNxpEse_initParams initParams;
+    phNxpEse_data cmd;
+    phNxpEse_data rsp;
+    phPalEse_FaultConfig_t fault = pProfile->fault;
+    phPalEse_FaultStats_t faultStats;
+    phPalEse_SimStats_t simStats;
+    uint64_t *pLatency;
+    uint64_t start, t0, t1;
+    uint32_t apduLen = 0;
+    uint32_t i;
+
+    memset(pResult, 0x00, sizeof(*pResult));
+    pLatency = (uint64_t *)calloc(numApdus, sizeof(uint64_t));
+    if (pLatency == NULL)
+        return -1;
+
+    bench_buildApdu(apdu, &apduLen, cmdLen, rspLen);
+    fault.seed = seed;
+    phPalEse_sim_setConfig(NULL);
+    phPalEse_fault_configure(NULL);
+
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+            (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+    {
+        fprintf(stderr, "%s: eSE open/init failed\n", pProfile->name);
+        free(pLatency);
+        return -1;
+    }
+    /* Faults only apply to the measured exchanges */
+    phPalEse_fault_configure(&fault);
+    phPalEse_fault_getStats(NULL, TRUE);
+    phPalEse_sim_getStats(NULL, TRUE);
+
+    start = phPalEse_sim_getTimeUs();
+    for (i = 0; i < numApdus; i++)
+    {
+        cmd.len = apduLen;
+        cmd.p_data = apdu;
+        memset(&rsp, 0x00, sizeof(rsp));
+        t0 = phPalEse_sim_getTimeUs();
+        if (phNxpEse_Transceive(&cmd, &rsp) == ESESTATUS_SUCCESS)
+        {
+            pResult->bytes += cmd.len + rsp.len;
+        }
+        else
+        {
+            pResult->failures++;
+            phNxpEse_reset();
+        }
+        t1 = phPalEse_sim_getTimeUs();
+        pLatency[i] = t1 - t0;
+        if (rsp.p_data != NULL)
+            phNxpEse_free(rsp.p_data);
+    }
+    pResult->elapsedUs = phPalEse_sim_getTimeUs() - start;
+    phPalEse_fault_getStats(&faultStats, TRUE);
+    phPalEse_sim_getStats(&simStats, TRUE);
+    phPalEse_fault_configure(NULL);
+
+    phNxpEse_deInit();
+    phNxpEse_close();
+
+    pResult->apdus = numApdus;
+    /* Frames lost on the way to the card still cost a transmission */
+    pResult->txFrames = simStats.framesRx + faultStats.txDrop;
+    pResult->rxFrames = simStats.framesTx;
+    pResult->faults = faultStats.rxLrc + faultStats.rxDropAck + faultStats.rxWtx +
+            faultStats.rxBadPcb + faultStats.rxTruncate + faultStats.txLrc + faultStats.txDrop;
+    qsort(pLatency, numApdus, sizeof(uint64_t), bench_cmpU64);
+    pResult->p50Us = pLatency[(numApdus * 50) / 100];
+    pResult->p99Us = pLatency[(numApdus * 99) / 100];
+    pResult->p999Us = pLatency[(numApdus * 999) / 1000];
+    pResult->maxUs = pLatency[numApdus - 1];
+    free(pLatency);
+    return 0;
+}
+
+static void bench_usage(const char *prog)
+{
+    size_t i;
+    fprintf(stderr, "usage: %s [-n apdus] [-c cmdlen] [-r rsplen] [-s seed] [-p profile|all] [-o csv|text]"
+#ifdef ESE_PAL_TRACE_INCLUDED
+            " [-w trace]"
+#endif
+            "\n"
+            "profiles:", prog);
+    for (i = 0; i < BENCH_NUM_PROFILES; i++)
+        fprintf(stderr, " %s", gProfiles[i].name);
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t numApdus = BENCH_DEFAULT_APDUS;
+    uint32_t cmdLen = BENCH_DEFAULT_CMD_LEN;
+    uint32_t rspLen = BENCH_DEFAULT_RSP_LEN;
+    uint32_t seed = BENCH_DEFAULT_SEED;
+    const char *profile = "all";
+    const char *pTracePath = NULL;
+    int csv = 1;
+    double cleanFramesPerApdu = 0;
+    bench_result_t result;
+    size_t i;
+    int opt;
+    int ran = 0;
+
+    while ((opt = getopt(argc, argv, "n:c:r:s:p:o:w:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': numApdus = strtoul(optarg, NULL, 0); break;
+        case 'c': cmdLen = strtoul(optarg, NULL, 0); break;
+        case 'r': rspLen = strtoul(optarg, NULL, 0); break;
+        case 's': seed = strtoul(optarg, NULL, 0); break;
+        case 'p': profile = optarg; break;
+        case 'o': csv = (strcmp(optarg, "text") != 0); break;
+        case 'w': pTracePath = optarg; break;
+        default: bench_usage(argv[0]); return 2;
+        }
+    }
+    if ((numApdus == 0) || (cmdLen < 4) || (cmdLen > 65535 + 9) || (rspLen > 65536))
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+
+    if (csv)
+        printf("profile,apdus,failures,goodput_Bps,frames_per_apdu,retries_per_apdu,faults,p50_us,p99_us,p999_us,max_us\n");
+    for (i = 0; i < BENCH_NUM_PROFILES; i++)
+    {
+        double framesPerApdu, retriesPerApdu, goodput;
+        /* The clean run is the baseline for the retry count */
+        if ((i != 0) && strcmp(profile, "all") && strcmp(profile, gProfiles[i].name))
+            continue;
+#ifdef ESE_PAL_TRACE_INCLUDED
+        if ((pTracePath != NULL) && !strcmp(profile, gProfiles[i].name) &&
+                (phPalEse_trace_startRecord(pTracePath) != ESESTATUS_SUCCESS))
+            return 1;
+#endif
+        if (bench_run(&gProfiles[i], seed, numApdus, cmdLen, rspLen, &result) != 0)
+            return 1;
+#ifdef ESE_PAL_TRACE_INCLUDED
+        phPalEse_trace_stop();
+#endif
+        framesPerApdu = (double)(result.txFrames + result.rxFrames) / result.apdus;
+        if (i == 0)
+            cleanFramesPerApdu = framesPerApdu;
+        if ((i == 0) && strcmp(profile, "all") && strcmp(profile, gProfiles[i].name))
+            continue;
+        retriesPerApdu = framesPerApdu - cleanFramesPerApdu;
+        goodput = result.elapsedUs ? (double)result.bytes * 1000000.0 / result.elapsedUs : 0;
+        if (csv)
+        {
+            printf("%s,%u,%u,%.0f,%.3f,%.3f,%u,%llu,%llu,%llu,%llu\n", gProfiles[i].name,
+                    result.apdus, result.failures, goodput, framesPerApdu, retriesPerApdu,
+                    result.faults, (unsigned long long)result.p50Us,
+                    (unsigned long long)result.p99Us, (unsigned long long)result.p999Us,
+                    (unsigned long long)result.maxUs);
+        }
+        else
+        {
+            printf("%-9s apdus %u failed %u goodput %.0f B/s frames/apdu %.3f retries/apdu %.3f"
+                    " faults %u latency us p50 %llu p99 %llu p99.9 %llu max %llu\n",
+                    gProfiles[i].name, result.apdus, result.failures, goodput, framesPerApdu,
+                    retriesPerApdu, result.faults, (unsigned long long)result.p50Us,
+                    (unsigned long long)result.p99Us, (unsigned long long)result.p999Us,
+                    (unsigned long long)result.maxUs);
+        }
+        ran++;
+    }
+    if (ran == 0)
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host micro benchmarks of the T=1, data manager, ISO 7816-4 and config
+ * lookup hot paths.
+ *
+ * Frame building runs against the frame sink of phNxpEse_BenchHooks.c,
+ * the end to end transceive against the simulated eSE in virtual time,
+ * so every figure is CPU spent in the stack. The frame benchmarks also
+ * report insnPerFrame, the instructions retired per frame where the host
+ * has a hardware counter. For regression gating run
+ * with --benchmark_format=json (or --benchmark_out=<file>) and compare
+ * two runs with the Google Benchmark compare.py tool.
+ */
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include <benchmark/benchmark.h>
+
+/* CEseConfig is private to the config module, build it here to reach it */
+#include "../utils/phNxpConfig.cpp"
+
+extern "C" {
+#include <phNxpEse_Api.h>
+#include <phNxpEseT1.h>
+#include <phNxpEseProto7816_3.h>
+#include <phNxpEse_FrameCache.h>
+#include <phNxpEsePal_sim.h>
+}
+#include <phNxpEseBench_InsnCounter.h>
+#include "phNxpEse_BenchHooks.h"
+
+#define BENCH_NAD_CARD      0xA5
+#define BENCH_PCB_I_NS      0x40
+#define BENCH_PCB_I_MORE    0x20
+#define BENCH_PCB_R_ACK_N1  0x90
+#define BENCH_PCB_S_RSP     0xE0
+#define BENCH_MAX_INF       254
+
+/* Card frame: [NAD PCB LEN INF LRC], LRC over PCB..INF like the card computes it */
+static uint32_t bench_buildCardFrame(uint8_t *pFrame, uint8_t pcb, uint32_t infLen)
+{
+    uint32_t i;
+
+    pFrame[0] = BENCH_NAD_CARD;
+    pFrame[1] = pcb;
+    pFrame[2] = (uint8_t)infLen;
+    for (i = 0; i < infLen; i++)
+        pFrame[3 + i] = (uint8_t)i;
+    pFrame[3 + infLen] = phNxpEseBench_computeLRC(pFrame, 1, 3 + infLen);
+    return infLen + 4;
+}
+
+static void bench_drainData(void)
+{
+    uint32_t len = 0;
+    uint8_t *pData = NULL;
+
+    if ((phNxpEseT1_getRxData(&len, &pData) == ESESTATUS_SUCCESS) && (pData != NULL))
+        phNxpEse_free(pData);
+}
+
+/******************************** T=1 LRC ***********************************/
+
+static void BM_ComputeLRC(benchmark::State& state)
+{
+    uint8_t frame[BENCH_MAX_INF + 4];
+    uint32_t len = bench_buildCardFrame(frame, 0x00, state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_computeLRC(frame, 0, len - 1));
+    state.SetBytesProcessed(state.iterations() * (len - 1));
+}
+BENCHMARK(BM_ComputeLRC)->Arg(0)->Arg(16)->Arg(64)->Arg(BENCH_MAX_INF);
+
+static void BM_CheckLRC(benchmark::State& state)
+{
+    uint8_t frame[BENCH_MAX_INF + 4];
+    uint32_t len = bench_buildCardFrame(frame, 0x00, state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_checkLRC(len, frame));
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_CheckLRC)->Arg(0)->Arg(16)->Arg(64)->Arg(BENCH_MAX_INF);
+
+/***************************** T=1 frame build *******************************/
+
+/* cache set: the same command over and over, as sent from the frame cache */
+static void BM_BuildIframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t inf[BENCH_MAX_INF];
+
+    memset(inf, 0x5A, sizeof(inf));
+    phNxpEseBench_resetProto();
+    phNxpEse_FrameCache_init(state.range(2) ? TRUE : FALSE);
+    phNxpEseBench_setFrameSink(TRUE);
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_sendIframe(inf, state.range(0), state.range(1)));
+    insn.report(state, state.iterations());
+    phNxpEseBench_setFrameSink(FALSE);
+    phNxpEse_FrameCache_init(FALSE);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildIframe)->ArgNames({"inf", "chained", "cache"})
+    ->Args({1, 0, 0})->Args({16, 0, 0})->Args({64, 0, 0})->Args({BENCH_MAX_INF, 0, 0})
+    ->Args({BENCH_MAX_INF, 1, 0})->Args({1, 0, 1})->Args({16, 0, 1})->Args({32, 0, 1});
+
+static void BM_BuildRframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+
+    phNxpEseBench_resetProto();
+    phNxpEseBench_setFrameSink(TRUE);
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_sendRframe(state.range(0)));
+    insn.report(state, state.iterations());
+    phNxpEseBench_setFrameSink(FALSE);
+}
+BENCHMARK(BM_BuildRframe)->ArgName("nack")->Arg(0)->Arg(1);
+
+static void BM_BuildSframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+
+    phNxpEseBench_resetProto();
+    phNxpEseBench_setFrameSink(TRUE);
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_sendSframe(state.range(0)));
+    insn.report(state, state.iterations());
+    phNxpEseBench_setFrameSink(FALSE);
+}
+BENCHMARK(BM_BuildSframe)->ArgName("type")
+    ->Arg(RESYNCH_REQ)->Arg(INTF_RESET_REQ)->Arg(PROP_END_APDU_REQ)->Arg(WTX_RSP);
+
+/***************************** T=1 frame decode ******************************/
+
+/* I-blocks alternate N(S) so that each one is accepted as a new block */
+static void BM_DecodeIframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t frames[2][BENCH_MAX_INF + 4];
+    uint8_t more = state.range(1) ? BENCH_PCB_I_MORE : 0x00;
+    uint32_t len = bench_buildCardFrame(frames[0], more, state.range(0));
+    uint32_t ns = 0;
+
+    bench_buildCardFrame(frames[1], BENCH_PCB_I_NS | more, state.range(0));
+    phNxpEseBench_resetProto();
+    insn.resume();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(phNxpEseBench_decodeFrame(frames[ns], len));
+        ns ^= 1;
+        insn.pause();
+        state.PauseTiming();
+        bench_drainData();
+        state.ResumeTiming();
+        insn.resume();
+    }
+    insn.report(state, state.iterations());
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_DecodeIframe)->ArgNames({"inf", "chained"})
+    ->Args({2, 0})->Args({64, 0})->Args({BENCH_MAX_INF, 0})->Args({BENCH_MAX_INF, 1});
+
+static void BM_DecodeRframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t frame[4];
+    uint32_t len = bench_buildCardFrame(frame, BENCH_PCB_R_ACK_N1, 0);
+
+    phNxpEseBench_resetProto();
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_decodeFrame(frame, len));
+    insn.report(state, state.iterations());
+}
+BENCHMARK(BM_DecodeRframe);
+
+static void BM_DecodeSframe(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t frame[4];
+    uint32_t len = bench_buildCardFrame(frame, BENCH_PCB_S_RSP | (state.range(0) & 0x1F), 0);
+
+    phNxpEseBench_resetProto();
+    insn.resume();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(phNxpEseBench_decodeFrame(frame, len));
+    insn.report(state, state.iterations());
+}
+BENCHMARK(BM_DecodeSframe)->ArgName("type")->Arg(RESYNCH_RSP)->Arg(IFSC_RES)->Arg(ABORT_RES);
+
+/****************************** Reassembly ***********************************/
+
+/* Reassembly of a response chained over N I-blocks */
+static void BM_RxReassemble(benchmark::State& state)
+{
+    phNxpEseBench_InsnCounter insn;
+    uint8_t inf[BENCH_MAX_INF];
+    int64_t frames = state.range(0);
+    int64_t i;
+
+    memset(inf, 0xA5, sizeof(inf));
+    insn.resume();
+    for (auto _ : state)
+    {
+        for (i = 0; i < frames; i++)
+            phNxpEseT1_storeRxData(sizeof(inf), inf);
+        bench_drainData();
+    }
+    insn.report(state, state.iterations() * frames);
+    state.SetBytesProcessed(state.iterations() * frames * sizeof(inf));
+}
+BENCHMARK(BM_RxReassemble)->ArgName("frames")->RangeMultiplier(2)->Range(1, 128);
+
+/****************************** ISO 7816-4 ***********************************/
+
+static void BM_7816FrameCmd(benchmark::State& state)
+{
+    static uint8_t data[1024];
+    phNxpEse_7816_cpdu_t cpdu;
+    uint8_t *pCmd = NULL;
+    uint32_t cmdLen = 0;
+
+    memset(&cpdu, 0x00, sizeof(cpdu));
+    cpdu.cla = 0x80;
+    cpdu.ins = 0xCA;
+    cpdu.lc = state.range(0);
+    cpdu.pdata = data;
+    cpdu.cpdu_type = (cpdu.lc > 255) ? 1 : 0;
+    cpdu.le_type = (cpdu.lc > 255) ? 2 : 1;
+    for (auto _ : state)
+    {
+        if (phNxpEseBench_frameCmd(&cpdu, &pCmd, &cmdLen) == ESESTATUS_SUCCESS)
+            phNxpEse_free(pCmd);
+    }
+    state.SetBytesProcessed(state.iterations() * cmdLen);
+}
+BENCHMARK(BM_7816FrameCmd)->ArgName("lc")->Arg(0)->Arg(16)->Arg(255)->Arg(1024);
+
+/* Whole stack down to the simulated card, CPU time only (virtual card time) */
+static void BM_7816Transceive(benchmark::State& state)
+{
+    static uint8_t data[1024];
+    static uint8_t rsp[1024];
+    phNxpEse_initParams initParams;
+    phNxpEse_7816_cpdu_t cpdu;
+    phNxpEse_7816_rpdu_t rpdu;
+
+    phPalEse_sim_setConfig(NULL);
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = ESE_MODE_NORMAL;
+    if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+            (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+    {
+        phNxpEse_close();
+        state.SkipWithError("eSE open/init failed");
+        return;
+    }
+    memset(&cpdu, 0x00, sizeof(cpdu));
+    cpdu.cla = 0x80;
+    cpdu.ins = 0xCA;
+    cpdu.lc = state.range(0);
+    cpdu.pdata = data;
+    cpdu.cpdu_type = (cpdu.lc > 255) ? 1 : 0;
+    cpdu.le_type = (cpdu.lc > 255) ? 2 : 1;
+    /* rpdu.pdata is not bounds checked, keep Le well below its size */
+    cpdu.le = 32;
+    for (auto _ : state)
+    {
+        memset(&rpdu, 0x00, sizeof(rpdu));
+        rpdu.pdata = rsp;
+        rpdu.len = sizeof(rsp);
+        if (phNxpEse_7816_Transceive(&cpdu, &rpdu) != ESESTATUS_SUCCESS)
+        {
+            state.SkipWithError("transceive failed");
+            break;
+        }
+    }
+    phNxpEse_deInit();
+    phNxpEse_close();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_7816Transceive)->ArgName("lc")->Arg(16)->Arg(255)->Arg(1024);
+
+/****************************** Config lookup ********************************/
+
+static const char *const gBenchConfigNames[] =
+{
+    NAME_NXPLOG_EXTNS_LOGLEVEL, NAME_NXPLOG_ESELIB_LOGLEVEL, NAME_NXPLOG_SPIX_LOGLEVEL,
+    NAME_NXPLOG_SPIR_LOGLEVEL, NAME_NXPLOG_FWDNLD_LOGLEVEL, NAME_NXPLOG_TML_LOGLEVEL,
+    NAME_NXP_JCOPDL_AT_BOOT_ENABLE, NAME_NXP_WTX_COUNT_VALUE, NAME_NXP_MAX_RSP_TIMEOUT,
+    NAME_NXP_POWER_SCHEME, NAME_NXP_SOF_WRITE, NAME_NXP_TP_MEASUREMENT,
+    NAME_NXP_SPI_INTF_RST_ENABLE, NAME_NXP_MAX_RNACK_RETRY,
+};
+
+/* Replaces the loaded settings with the known keys padded to 'count' entries */
+static void bench_fillConfig(uint32_t count)
+{
+    CEseConfig& rConfig = CEseConfig::GetInstance();
+    uint32_t known = sizeof(gBenchConfigNames) / sizeof(gBenchConfigNames[0]);
+    char name[32];
+    uint32_t i;
+
+    rConfig.clean();
+    for (i = 0; i < known; i++)
+        rConfig.push_back(new CEseParam(gBenchConfigNames[i], i));
+    for (i = known; i < count; i++)
+    {
+        snprintf(name, sizeof(name), "NXP_BENCH_KEY_%04u", i);
+        rConfig.push_back(new CEseParam(name, i));
+    }
+    std::sort(rConfig.begin(), rConfig.end(),
+            [](const CEseParam *a, const CEseParam *b) { return *a < *b; });
+}
+
+static void BM_ConfigFind(benchmark::State& state)
+{
+    CEseConfig& rConfig = CEseConfig::GetInstance();
+    /* first, last and absent keys in sort order */
+    static const char *const keys[] = { NAME_NXPLOG_ESELIB_LOGLEVEL, NAME_NXP_WTX_COUNT_VALUE, "ZZZ" };
+    const char *pKey = keys[state.range(1)];
+
+    bench_fillConfig(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(rConfig.find(pKey));
+}
+BENCHMARK(BM_ConfigFind)->ArgNames({"entries", "key"})
+    ->ArgsProduct({{16, 64, 256}, {0, 1, 2}});
+
+static void BM_GetNxpNumValue(benchmark::State& state)
+{
+    unsigned long value = 0;
+
+    bench_fillConfig(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GetNxpNumValue(NAME_NXP_WTX_COUNT_VALUE, &value, sizeof(value)));
+}
+BENCHMARK(BM_GetNxpNumValue)->ArgName("entries")->Arg(16)->Arg(256);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * PAL trace replay
+ *
+ * Rebuilds the APDU sequence of every session found in a PAL trace from
+ * the host I-blocks, then drives the current stack with it while the PAL
+ * serves the recorded card side. Reports CPU time, device calls and
+ * latency per APDU, and how far the new build diverged from the trace.
+ *
+ * usage: ese_replay -f trace [-t timescale%] [-i iterations] [-o csv|text]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <phNxpEse_Api.h>
+#include <phNxpEsePal_trace.h>
+#ifdef ESE_PAL_SIM_INCLUDED
+#include <phNxpEsePal_sim.h>
+#endif
+
+#define REPLAY_MAX_SESSIONS         256
+#define REPLAY_MAX_APDU_LEN         (65536 + 16)
+#define REPLAY_PCB_I_MASK           0x80
+#define REPLAY_PCB_I_NS             0x40
+#define REPLAY_PCB_I_MORE           0x20
+#define REPLAY_PCB_S_RESYNCH_REQ    0xC0
+#define REPLAY_PCB_S_INTF_RST_REQ   0xC4
+
+typedef struct
+{
+    uint32_t len;
+    uint8_t *pData;
+} replay_apdu_t;
+
+typedef struct
+{
+    phNxpEse_initMode initMode;
+    uint32_t numApdus;
+    replay_apdu_t *pApdus;
+} replay_session_t;
+
+static replay_session_t gSessions[REPLAY_MAX_SESSIONS];
+static uint32_t gNumSessions;
+
+static uint64_t replay_nowUs(void)
+{
+#ifdef ESE_PAL_SIM_INCLUDED
+    return phPalEse_sim_getTimeUs();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+#endif
+}
+
+static uint64_t replay_cpuUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static int replay_cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int replay_addApdu(replay_session_t *pSession, const uint8_t *pData, uint32_t len)
+{
+    replay_apdu_t *pApdus = (replay_apdu_t *)realloc(pSession->pApdus,
+            (pSession->numApdus + 1) * sizeof(replay_apdu_t));
+    if (pApdus == NULL)
+        return -1;
+    pSession->pApdus = pApdus;
+    pApdus[pSession->numApdus].pData = (uint8_t *)malloc(len);
+    if (pApdus[pSession->numApdus].pData == NULL)
+        return -1;
+    memcpy(pApdus[pSession->numApdus].pData, pData, len);
+    pApdus[pSession->numApdus].len = len;
+    pSession->numApdus++;
+    return 0;
+}
+
+/*
+ * Host I-blocks carry the APDUs. A block repeating the N(S) of the last
+ * accepted one is a retransmission; resynch and interface reset restart
+ * the sequence at N(S)=0.
+ */
+static int replay_extract(const char *pPath)
+{
+    static uint8_t apdu[REPLAY_MAX_APDU_LEN];
+    phPalEse_Trace_t trace;
+    phPalEse_TraceRecord_t record;
+    replay_session_t *pSession = NULL;
+    uint32_t apduLen = 0;
+    uint8_t lastNs = 1;
+    bool_t sawIframe = FALSE;
+    uint8_t pcb, len;
+
+    if (phPalEse_trace_load(pPath, &trace) != ESESTATUS_SUCCESS)
+        return -1;
+    while (phPalEse_trace_next(&trace, &record))
+    {
+        if (record.type == PH_PALESE_TRACE_OPEN)
+        {
+            if (gNumSessions == REPLAY_MAX_SESSIONS)
+                break;
+            pSession = &gSessions[gNumSessions++];
+            pSession->initMode = ESE_MODE_OSU;
+            apduLen = 0;
+            lastNs = 1;
+            sawIframe = FALSE;
+            continue;
+        }
+        if ((pSession == NULL) || (record.type != PH_PALESE_TRACE_WRITE) || (record.len < 4))
+            continue;
+        pcb = record.pData[1];
+        len = record.pData[2];
+        if ((pcb == REPLAY_PCB_S_RESYNCH_REQ) || (pcb == REPLAY_PCB_S_INTF_RST_REQ))
+        {
+            if ((pcb == REPLAY_PCB_S_INTF_RST_REQ) && !sawIframe)
+                pSession->initMode = ESE_MODE_NORMAL;
+            lastNs = 1;
+            apduLen = 0;
+            continue;
+        }
+        if ((pcb & REPLAY_PCB_I_MASK) || ((uint32_t)len + 4 > record.len))
+            continue;
+        sawIframe = TRUE;
+        if (((pcb & REPLAY_PCB_I_NS) ? 1 : 0) == lastNs)
+            continue;
+        lastNs ^= 1;
+        if (apduLen + len > sizeof(apdu))
+        {
+            apduLen = 0;
+            continue;
+        }
+        memcpy(&apdu[apduLen], &record.pData[3], len);
+        apduLen += len;
+        if (!(pcb & REPLAY_PCB_I_MORE))
+        {
+            if (replay_addApdu(pSession, apdu, apduLen) != 0)
+                break;
+            apduLen = 0;
+        }
+    }
+    phPalEse_trace_unload(&trace);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *pPath = NULL;
+    uint32_t timeScale = PH_PALESE_TRACE_SCALE_ORIGINAL;
+    uint32_t iterations = 1;
+    uint32_t totalApdus = 0;
+    uint32_t failures = 0;
+    uint32_t it, s, a, n = 0;
+    int csv = 1;
+    int opt;
+    uint64_t *pLatency;
+    uint64_t cpu0, cpuUs, t0;
+    phNxpEse_initParams initParams;
+    phNxpEse_data cmd;
+    phNxpEse_data rsp;
+    phPalEse_TraceStats_t stats;
+
+    while ((opt = getopt(argc, argv, "f:t:i:o:h")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f': pPath = optarg; break;
+        case 't': timeScale = strtoul(optarg, NULL, 0); break;
+        case 'i': iterations = strtoul(optarg, NULL, 0); break;
+        case 'o': csv = (strcmp(optarg, "text") != 0); break;
+        default: pPath = NULL; optind = argc; break;
+        }
+    }
+    if ((pPath == NULL) || (iterations == 0))
+    {
+        fprintf(stderr, "usage: %s -f trace [-t timescale%%] [-i iterations] [-o csv|text]\n", argv[0]);
+        return 2;
+    }
+    if (replay_extract(pPath) != 0)
+    {
+        fprintf(stderr, "cannot load trace %s\n", pPath);
+        return 1;
+    }
+    for (s = 0; s < gNumSessions; s++)
+        totalApdus += gSessions[s].numApdus;
+    pLatency = (uint64_t *)calloc(totalApdus * iterations + 1, sizeof(uint64_t));
+    if (pLatency == NULL)
+        return 1;
+
+    phPalEse_trace_getStats(NULL, TRUE);
+    cpu0 = replay_cpuUs();
+    for (it = 0; it < iterations; it++)
+    {
+        if (phPalEse_trace_startReplay(pPath, timeScale) != ESESTATUS_SUCCESS)
+            return 1;
+        for (s = 0; s < gNumSessions; s++)
+        {
+            initParams.initMode = gSessions[s].initMode;
+            if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+                    (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+            {
+                failures += gSessions[s].numApdus;
+                phNxpEse_close();
+                continue;
+            }
+            for (a = 0; a < gSessions[s].numApdus; a++)
+            {
+                cmd.len = gSessions[s].pApdus[a].len;
+                cmd.p_data = gSessions[s].pApdus[a].pData;
+                memset(&rsp, 0x00, sizeof(rsp));
+                t0 = replay_nowUs();
+                if (phNxpEse_Transceive(&cmd, &rsp) != ESESTATUS_SUCCESS)
+                    failures++;
+                pLatency[n++] = replay_nowUs() - t0;
+                if (rsp.p_data != NULL)
+                    phNxpEse_free(rsp.p_data);
+            }
+            phNxpEse_deInit();
+            phNxpEse_close();
+        }
+        phPalEse_trace_stop();
+    }
+    cpuUs = replay_cpuUs() - cpu0;
+    phPalEse_trace_getStats(&stats, TRUE);
+
+    if (n == 0)
+    {
+        fprintf(stderr, "no APDU found in %s\n", pPath);
+        return 1;
+    }
+    qsort(pLatency, n, sizeof(uint64_t), replay_cmpU64);
+    if (csv)
+    {
+        printf("sessions,apdus,failures,cpu_us_per_apdu,reads_per_apdu,writes_per_apdu,ioctls,"
+                "write_mismatches,ioctl_mismatches,read_underruns,reads_skipped,p50_us,p99_us,max_us\n");
+        printf("%u,%u,%u,%.2f,%.2f,%.2f,%u,%u,%u,%u,%u,%llu,%llu,%llu\n", gNumSessions, n, failures,
+                (double)cpuUs / n, (double)stats.readCalls / n, (double)stats.writeCalls / n,
+                stats.ioctlCalls, stats.writeMismatches, stats.ioctlMismatches,
+                stats.readUnderruns, stats.readsSkipped,
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[n - 1]);
+    }
+    else
+    {
+        printf("sessions %u apdus %u failed %u\n", gNumSessions, n, failures);
+        printf("cpu %.2f us/apdu, reads %.2f/apdu, writes %.2f/apdu, ioctls %u\n",
+                (double)cpuUs / n, (double)stats.readCalls / n, (double)stats.writeCalls / n,
+                stats.ioctlCalls);
+        printf("divergence: write mismatches %u, ioctl mismatches %u, read underruns %u, reads skipped %u\n",
+                stats.writeMismatches, stats.ioctlMismatches, stats.readUnderruns, stats.readsSkipped);
+        printf("latency us p50 %llu p99 %llu max %llu\n",
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[n - 1]);
+    }
+    free(pLatency);
+    return 0;
+}
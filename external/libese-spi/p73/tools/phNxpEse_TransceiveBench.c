@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * End to end transceive benchmark
+ *
+ * Opens the eSE, runs the APDU mix of a workload file through
+ * phNxpEse_Transceive from one or more threads, closes it and reports
+ * throughput, latency percentiles, device calls and SOF polls per APDU
+ * and CPU time. The target build runs against the device, the host
+ * build against the simulated eSE (virtual time with a single thread).
+ *
+ * usage: ese_transceive_bench -w workload [-n apdus] [-t threads] [-o csv|text] [-s]
+ *
+ * -s receives the responses through phNxpEse_TransceiveStream.
+ *
+ * Workload file, one setting per line, '#' starts a comment:
+ *
+ *   name        <text>
+ *   apdus       <total number of transceives>
+ *   threads     <client threads sharing the session>
+ *   think_us    <pause of each client after its response>
+ *   ifsc        <phNxpEse_setIfsc value, 0 keeps the default>
+ *   init_mode   normal | osu
+ *   seed        <APDU mix seed>
+ *   sim_processing_us, sim_wtx  <simulated card only>
+ *   apdu        <weight> <CLA INS P1 P2 as 8 hex digits> <Lc> <Le | ->
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <phNxpEse_Api.h>
+#ifdef ESE_PAL_SIM_INCLUDED
+#include <phNxpEsePal_sim.h>
+#endif
+
+#define BENCH_MAX_MIX           32
+#define BENCH_MAX_THREADS       16
+#define BENCH_MAX_LC            65535
+#define BENCH_MAX_LE            65536
+#define BENCH_LE_ABSENT         (-1)
+#define BENCH_DEFAULT_APDUS     1000
+#define BENCH_DEFAULT_SEED      0x1234
+
+typedef struct
+{
+    uint32_t weight;
+    uint32_t lc;
+    int32_t le;
+    uint8_t *pApdu;
+    uint32_t len;
+} bench_apdu_t;
+
+typedef struct
+{
+    char name[64];
+    uint32_t apdus;
+    uint32_t threads;
+    uint32_t thinkUs;
+    uint32_t ifsc;
+    uint32_t seed;
+    phNxpEse_initMode initMode;
+    uint32_t simProcessingUs;
+    uint32_t simWtx;
+    uint32_t numMix;
+    uint32_t totalWeight;
+    bench_apdu_t mix[BENCH_MAX_MIX];
+} bench_workload_t;
+
+typedef struct
+{
+    const bench_workload_t *pWorkload;
+    uint32_t apdus;
+    uint32_t seed;
+    uint64_t *pLatency;
+    uint32_t failures;
+    uint64_t bytes;
+} bench_client_t;
+
+static pthread_mutex_t gLinkLock = PTHREAD_MUTEX_INITIALIZER;
+static int gStream = 0;
+
+static uint64_t bench_nowUs(void)
+{
+#ifdef ESE_PAL_SIM_INCLUDED
+    return phPalEse_sim_getTimeUs();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+#endif
+}
+
+static uint64_t bench_cpuUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static int bench_cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* ISO 7816-4 case 1..4, extended length when Lc or Le don't fit in a byte */
+static int bench_buildApdu(bench_apdu_t *pApdu, const uint8_t *pHeader)
+{
+    bool_t extended = (pApdu->lc > 255) || (pApdu->le > 256);
+    uint32_t len = 0;
+    uint32_t i;
+    uint8_t *p = (uint8_t *)malloc(4 + 3 + pApdu->lc + 3);
+
+    if (p == NULL)
+        return -1;
+    memcpy(p, pHeader, 4);
+    len = 4;
+    if (pApdu->lc > 0)
+    {
+        if (extended)
+        {
+            p[len++] = 0x00;
+            p[len++] = (uint8_t)(pApdu->lc >> 8);
+        }
+        p[len++] = (uint8_t)pApdu->lc;
+        for (i = 0; i < pApdu->lc; i++)
+            p[len++] = (uint8_t)i;
+    }
+    if (pApdu->le != BENCH_LE_ABSENT)
+    {
+        if (extended)
+        {
+            if (pApdu->lc == 0)
+                p[len++] = 0x00;
+            p[len++] = (uint8_t)(pApdu->le >> 8);
+        }
+        p[len++] = (uint8_t)pApdu->le;
+    }
+    pApdu->pApdu = p;
+    pApdu->len = len;
+    return 0;
+}
+
+static int bench_parseApdu(bench_workload_t *pWorkload, const char *pArgs)
+{
+    bench_apdu_t *pApdu;
+    char header[16];
+    char le[16];
+    uint8_t hdr[4];
+    unsigned int weight, lc, i;
+
+    if (pWorkload->numMix == BENCH_MAX_MIX)
+        return -1;
+    if ((sscanf(pArgs, "%u %15s %u %15s", &weight, header, &lc, le) != 4) ||
+            (strlen(header) != 8) || (lc > BENCH_MAX_LC) || (weight == 0))
+        return -1;
+    for (i = 0; i < 4; i++)
+    {
+        unsigned int b;
+        if (sscanf(&header[i * 2], "%2x", &b) != 1)
+            return -1;
+        hdr[i] = (uint8_t)b;
+    }
+    pApdu = &pWorkload->mix[pWorkload->numMix];
+    pApdu->weight = weight;
+    pApdu->lc = lc;
+    pApdu->le = (le[0] == '-') ? BENCH_LE_ABSENT : (int32_t)strtoul(le, NULL, 0);
+    if (pApdu->le > BENCH_MAX_LE)
+        return -1;
+    if (bench_buildApdu(pApdu, hdr) != 0)
+        return -1;
+    pWorkload->totalWeight += weight;
+    pWorkload->numMix++;
+    return 0;
+}
+
+static int bench_loadWorkload(const char *pPath, bench_workload_t *pWorkload)
+{
+    FILE *fp = fopen(pPath, "r");
+    char line[256];
+    char key[32];
+    int lineNo = 0;
+    int skip;
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "cannot open workload %s\n", pPath);
+        return -1;
+    }
+    memset(pWorkload, 0x00, sizeof(*pWorkload));
+    snprintf(pWorkload->name, sizeof(pWorkload->name), "%s", pPath);
+    pWorkload->apdus = BENCH_DEFAULT_APDUS;
+    pWorkload->threads = 1;
+    pWorkload->seed = BENCH_DEFAULT_SEED;
+    pWorkload->initMode = ESE_MODE_NORMAL;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char *pHash = strchr(line, '#');
+        const char *pArgs;
+        int ok = 1;
+
+        lineNo++;
+        if (pHash != NULL)
+            *pHash = '\0';
+        if (sscanf(line, "%31s%n", key, &skip) != 1)
+            continue;
+        pArgs = line + skip;
+        if (!strcmp(key, "name"))
+            ok = (sscanf(pArgs, "%63s", pWorkload->name) == 1);
+        else if (!strcmp(key, "apdus"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->apdus) == 1);
+        else if (!strcmp(key, "threads"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->threads) == 1);
+        else if (!strcmp(key, "think_us"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->thinkUs) == 1);
+        else if (!strcmp(key, "ifsc"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->ifsc) == 1);
+        else if (!strcmp(key, "seed"))
+            ok = (sscanf(pArgs, "%i", (int *)&pWorkload->seed) == 1);
+        else if (!strcmp(key, "sim_processing_us"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->simProcessingUs) == 1);
+        else if (!strcmp(key, "sim_wtx"))
+            ok = (sscanf(pArgs, "%u", &pWorkload->simWtx) == 1);
+        else if (!strcmp(key, "init_mode"))
+        {
+            char mode[16];
+            ok = (sscanf(pArgs, "%15s", mode) == 1);
+            if (ok && !strcmp(mode, "osu"))
+                pWorkload->initMode = ESE_MODE_OSU;
+            else if (ok && strcmp(mode, "normal"))
+                ok = 0;
+        }
+        else if (!strcmp(key, "apdu"))
+            ok = (bench_parseApdu(pWorkload, pArgs) == 0);
+        else
+            ok = 0;
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%d: invalid line\n", pPath, lineNo);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    if (pWorkload->numMix == 0)
+    {
+        fprintf(stderr, "%s: no apdu in workload\n", pPath);
+        return -1;
+    }
+    return 0;
+}
+
+static const bench_apdu_t *bench_pick(const bench_workload_t *pWorkload, uint32_t *pSeed)
+{
+    uint32_t r = (uint32_t)rand_r((unsigned int *)pSeed) % pWorkload->totalWeight;
+    uint32_t i;
+
+    for (i = 0; i < pWorkload->numMix - 1; i++)
+    {
+        if (r < pWorkload->mix[i].weight)
+            break;
+        r -= pWorkload->mix[i].weight;
+    }
+    return &pWorkload->mix[i];
+}
+
+static ESESTATUS bench_rspSink(void *pContext, const uint8_t *pData, uint32_t len, bool_t last)
+{
+    (void)pData;
+    (void)last;
+    *(uint32_t *)pContext += len;
+    return ESESTATUS_SUCCESS;
+}
+
+/* Clients share the session like the HAL clients do, one exchange at a time */
+static void *bench_client(void *arg)
+{
+    bench_client_t *pClient = (bench_client_t *)arg;
+    const bench_workload_t *pWorkload = pClient->pWorkload;
+    phNxpEse_data cmd;
+    phNxpEse_data rsp;
+    ESESTATUS status;
+    uint64_t t0;
+    uint32_t i;
+
+    for (i = 0; i < pClient->apdus; i++)
+    {
+        const bench_apdu_t *pApdu = bench_pick(pWorkload, &pClient->seed);
+
+        cmd.len = pApdu->len;
+        cmd.p_data = pApdu->pApdu;
+        memset(&rsp, 0x00, sizeof(rsp));
+        t0 = bench_nowUs();
+        pthread_mutex_lock(&gLinkLock);
+        if (gStream)
+            status = phNxpEse_TransceiveStream(&cmd, bench_rspSink, &rsp.len);
+        else
+            status = phNxpEse_Transceive(&cmd, &rsp);
+        if (status == ESESTATUS_SUCCESS)
+            pClient->bytes += cmd.len + rsp.len;
+        else
+            pClient->failures++;
+        pthread_mutex_unlock(&gLinkLock);
+        pClient->pLatency[i] = bench_nowUs() - t0;
+        if (rsp.p_data != NULL)
+            phNxpEse_free(rsp.p_data);
+        if (pWorkload->thinkUs > 0)
+            phNxpEse_Sleep(pWorkload->thinkUs);
+    }
+    return NULL;
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s -w workload [-n apdus] [-t threads] [-o csv|text] [-s]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    static bench_workload_t workload;
+    bench_client_t clients[BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_THREADS];
+    const char *pPath = NULL;
+    uint32_t numApdus = 0;
+    uint32_t numThreads = 0;
+    uint32_t failures = 0;
+    uint64_t bytes = 0;
+    uint64_t *pLatency;
+    uint64_t start, elapsedUs, cpu0, cpuUs;
+    uint32_t i, n, offset = 0;
+    phNxpEse_initParams initParams;
+    phNxpEse_Stats_t stats;
+    uint32_t syscalls;
+    int csv = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:n:t:o:sh")) != -1)
+    {
+        switch (opt)
+        {
+        case 'w': pPath = optarg; break;
+        case 'n': numApdus = strtoul(optarg, NULL, 0); break;
+        case 't': numThreads = strtoul(optarg, NULL, 0); break;
+        case 'o': csv = (strcmp(optarg, "text") != 0); break;
+        case 's': gStream = 1; break;
+        default: bench_usage(argv[0]); return 2;
+        }
+    }
+    if ((pPath == NULL) || (bench_loadWorkload(pPath, &workload) != 0))
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    if (numApdus > 0)
+        workload.apdus = numApdus;
+    if (numThreads > 0)
+        workload.threads = numThreads;
+    if ((workload.apdus == 0) || (workload.threads == 0) || (workload.threads > BENCH_MAX_THREADS))
+    {
+        bench_usage(argv[0]);
+        return 2;
+    }
+    n = workload.apdus;
+    pLatency = (uint64_t *)calloc(n, sizeof(uint64_t));
+    if (pLatency == NULL)
+        return 1;
+
+#ifdef ESE_PAL_SIM_INCLUDED
+    {
+        phPalEse_SimConfig_t simConfig;
+        phPalEse_sim_setConfig(NULL);
+        phPalEse_sim_getConfig(&simConfig);
+        /* A shared simulated clock can't model concurrent clients */
+        simConfig.virtualTime = (workload.threads == 1);
+        if (workload.simProcessingUs > 0)
+            simConfig.apduProcessingUs = workload.simProcessingUs;
+        simConfig.wtxPerApdu = (uint8_t)workload.simWtx;
+        phPalEse_sim_setConfig(&simConfig);
+    }
+#endif
+    memset(&initParams, 0x00, sizeof(initParams));
+    initParams.initMode = workload.initMode;
+    if ((phNxpEse_open(initParams) != ESESTATUS_SUCCESS) ||
+            (phNxpEse_init(initParams) != ESESTATUS_SUCCESS))
+    {
+        fprintf(stderr, "%s: eSE open/init failed\n", workload.name);
+        phNxpEse_close();
+        free(pLatency);
+        return 1;
+    }
+    if (workload.ifsc > 0)
+        phNxpEse_setIfsc((uint16_t)workload.ifsc);
+
+    phNxpEse_getStats(NULL, TRUE);
+    cpu0 = bench_cpuUs();
+    start = bench_nowUs();
+    for (i = 0; i < workload.threads; i++)
+    {
+        memset(&clients[i], 0x00, sizeof(clients[i]));
+        clients[i].pWorkload = &workload;
+        clients[i].apdus = (n / workload.threads) + ((i < (n % workload.threads)) ? 1 : 0);
+        clients[i].seed = workload.seed + i;
+        clients[i].pLatency = &pLatency[offset];
+        offset += clients[i].apdus;
+    }
+    if (workload.threads == 1)
+    {
+        bench_client(&clients[0]);
+    }
+    else
+    {
+        for (i = 0; i < workload.threads; i++)
+            pthread_create(&tids[i], NULL, bench_client, &clients[i]);
+        for (i = 0; i < workload.threads; i++)
+            pthread_join(tids[i], NULL);
+    }
+    elapsedUs = bench_nowUs() - start;
+    cpuUs = bench_cpuUs() - cpu0;
+    phNxpEse_getStats(&stats, TRUE);
+
+    phNxpEse_deInit();
+    phNxpEse_close();
+
+    for (i = 0; i < workload.threads; i++)
+    {
+        failures += clients[i].failures;
+        bytes += clients[i].bytes;
+    }
+    if (elapsedUs == 0)
+        elapsedUs = 1;
+    syscalls = stats.pal.readCalls + stats.pal.writeCalls + stats.pal.ioctlCalls;
+    qsort(pLatency, n, sizeof(uint64_t), bench_cmpU64);
+    if (csv)
+    {
+        printf("workload,threads,apdus,failures,apdus_per_s,bytes_per_s,p50_us,p99_us,p999_us,max_us,"
+                "syscalls_per_apdu,sof_polls_per_apdu,frames_per_apdu,cpu_us,cpu_us_per_apdu\n");
+        printf("%s,%u,%u,%u,%.1f,%.1f,%llu,%llu,%llu,%llu,%.2f,%.2f,%.2f,%llu,%.2f\n",
+                workload.name, workload.threads, n, failures,
+                (n * 1000000.0) / elapsedUs, (bytes * 1000000.0) / elapsedUs,
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[(n * 999) / 1000],
+                (unsigned long long)pLatency[n - 1],
+                (double)syscalls / n, (double)stats.sofPolls / n,
+                (double)(stats.framesTx + stats.framesRx) / n,
+                (unsigned long long)cpuUs, (double)cpuUs / n);
+    }
+    else
+    {
+        printf("%s: %u apdus, %u failed, %u thread(s)\n", workload.name, n, failures, workload.threads);
+        printf("throughput %.1f apdus/s, %.1f bytes/s\n",
+                (n * 1000000.0) / elapsedUs, (bytes * 1000000.0) / elapsedUs);
+        printf("latency us p50 %llu p99 %llu p999 %llu max %llu\n",
+                (unsigned long long)pLatency[(n * 50) / 100],
+                (unsigned long long)pLatency[(n * 99) / 100],
+                (unsigned long long)pLatency[(n * 999) / 1000],
+                (unsigned long long)pLatency[n - 1]);
+        printf("per apdu: %.2f syscalls (%.2f reads, %.2f writes, %.2f ioctls), %.2f SOF polls, %.2f frames\n",
+                (double)syscalls / n, (double)stats.pal.readCalls / n,
+                (double)stats.pal.writeCalls / n, (double)stats.pal.ioctlCalls / n,
+                (double)stats.sofPolls / n, (double)(stats.framesTx + stats.framesRx) / n);
+        printf("cpu %llu us, %.2f us/apdu\n", (unsigned long long)cpuUs, (double)cpuUs / n);
+    }
+    for (i = 0; i < workload.numMix; i++)
+        free(workload.mix[i].pApdu);
+    free(pLatency);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+# JCOP OS download: the update flow opens the session in OSU mode, raises
+# the host IFSC to 254 and streams LOAD blocks back to back.
+name        jcop_download
+init_mode   osu
+ifsc        254
+threads     1
+think_us    0
+apdus       2000
+# weight  CLA INS P1 P2  Lc   Le
+apdu 1    80E80000       240  -
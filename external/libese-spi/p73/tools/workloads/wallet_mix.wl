@@ -0,0 +1,12 @@
+# Payment/wallet style traffic: SELECTs, short GET DATA, medium and
+# chained responses, several clients sharing the session.
+name        wallet_mix
+init_mode   normal
+threads     2
+think_us    500
+apdus       2000
+# weight  CLA INS P1 P2  Lc   Le
+apdu 4    00A40400       16   256
+apdu 6    80CA9F7F       0    32
+apdu 3    80E20000       128  -
+apdu 1    80CB0000       5    1024
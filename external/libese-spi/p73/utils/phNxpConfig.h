@@ -66,5 +66,27 @@ void resetNxpConfig(void);
 #define NAME_NXP_TP_MEASUREMENT      "NXP_TP_MEASUREMENT"
 #define NAME_NXP_SPI_INTF_RST_ENABLE "NXP_SPI_INTF_RST_ENABLE"
 #define NAME_NXP_MAX_RNACK_RETRY     "NXP_MAX_RNACK_RETRY"
+#define NAME_NXP_FAULT_INJECTION            "NXP_FAULT_INJECTION"
+#define NAME_NXP_FAULT_SEED                 "NXP_FAULT_SEED"
+#define NAME_NXP_FAULT_RX_LRC_RATE          "NXP_FAULT_RX_LRC_RATE"
+#define NAME_NXP_FAULT_RX_DROP_ACK_RATE     "NXP_FAULT_RX_DROP_ACK_RATE"
+#define NAME_NXP_FAULT_RX_WTX_RATE          "NXP_FAULT_RX_WTX_RATE"
+#define NAME_NXP_FAULT_RX_BAD_PCB_RATE      "NXP_FAULT_RX_BAD_PCB_RATE"
+#define NAME_NXP_FAULT_RX_TRUNCATE_RATE     "NXP_FAULT_RX_TRUNCATE_RATE"
+#define NAME_NXP_FAULT_TX_LRC_RATE          "NXP_FAULT_TX_LRC_RATE"
+#define NAME_NXP_FAULT_TX_DROP_RATE         "NXP_FAULT_TX_DROP_RATE"
+#define NAME_NXP_PAL_TRACE_MODE             "NXP_PAL_TRACE_MODE"
+#define NAME_NXP_PAL_TRACE_FILE             "NXP_PAL_TRACE_FILE"
+#define NAME_NXP_PAL_REPLAY_TIME_SCALE      "NXP_PAL_REPLAY_TIME_SCALE"
+#define NAME_NXP_AUTO_GET_RESPONSE          "NXP_AUTO_GET_RESPONSE"
+#define NAME_NXP_AUTO_GET_RESPONSE_MAX      "NXP_AUTO_GET_RESPONSE_MAX"
+#define NAME_NXP_SELECT_CACHE               "NXP_SELECT_CACHE"
+#define NAME_NXP_T1_FRAME_CACHE             "NXP_T1_FRAME_CACHE"
+#define NAME_NXP_ESE_SPM_LEASE_MS           "NXP_ESE_SPM_LEASE_MS"
+#define NAME_NXP_ESE_SPM_LEASE_POLL_MS      "NXP_ESE_SPM_LEASE_POLL_MS"
+#define NAME_NXP_ESE_PWR_POLICY             "NXP_ESE_PWR_POLICY"
+#define NAME_NXP_ESE_PWR_MAX_HOLD_MS        "NXP_ESE_PWR_MAX_HOLD_MS"
+#define NAME_NXP_ESE_PWR_WARM_LEAD_MS       "NXP_ESE_PWR_WARM_LEAD_MS"
+#define NAME_NXP_ESE_PWR_HINT_HOLD_MS       "NXP_ESE_PWR_HINT_HOLD_MS"
 #endif
 #endif
@@ -32,6 +32,12 @@ LOCAL_SRC_FILES += NativeEseManager.cpp \
     NativeEseAla.cpp \
     SpiJniUtil.cpp \
     SpiChannel.cpp \
+    SpiChannelPool.cpp \
+    SpiDataCache.cpp \
+    SpiTransceiveSlot.cpp \
+    SpiApduScheduler.cpp \
+    SpiJcopDownload.cpp \
+    SpiScriptExec.cpp \
     Mutex.cpp \
     CondVar.cpp
 
@@ -86,3 +92,11 @@ LOCAL_CFLAGS += -DNFC_NXP_ESE_VER=$(JCOP_VER_4_0)
 
 #LOCAL_CFLAGS += -DISO7816_4_APDU_PARSER_ENABLE
 include $(BUILD_SHARED_LIBRARY)
+
+# Compiler of the Loader Service scripts run by SpiScriptExec.cpp
+include $(CLEAR_VARS)
+LOCAL_MODULE := ese_spi_script_compiler
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := SpiScriptCompiler.cpp
+LOCAL_CFLAGS += -Wall -Wextra
+include $(BUILD_HOST_EXECUTABLE)
@@ -16,6 +16,8 @@
 #include "SpiJniUtil.h"
 #include "SyncEvent.h"
 #include "SpiChannel.h"
+#include "SpiDataCache.h"
+#include "SpiScriptExec.h"
 #include <ScopedPrimitiveArray.h>
 
 extern "C"
@@ -42,12 +44,14 @@ namespace android
 {
 
 static bool sRfEnabled;
+static scriptExecStats_t sScriptStats;
 jbyteArray eSEManager_lsExecuteScript(JNIEnv* e, jobject o, jstring src, jstring dest, jbyteArray);
 jbyteArray eSEManager_lsGetVersion(JNIEnv* e, jobject o);
 int eSEManager_doAppletLoadApplet(JNIEnv* e, jobject o, jstring choice, jbyteArray);
 int eSEManager_GetAppletsList(JNIEnv* e, jobject o, jobjectArray list);
 jbyteArray eSEManager_GetCertificateKey(JNIEnv* e, jobject);
 int eSEManager_getLSConfigVer(JNIEnv* e, jobject o);
+jlongArray eSEManager_lsGetExecStats(JNIEnv* e, jobject o);
 const char    *gNativeNfcAlaClassName = "com/nxp/ese/dhimpl/NativeEseAla";
 extern bool          gJcopDwnldinProgress;
 extern IChannel_t Dwp;
@@ -138,7 +142,9 @@ int eSEManager_doAppletLoadApplet(JNIEnv* e, jobject o, jstring name, jbyteArray
             ScopedByteArrayRO bytes(e, data);
             uint8_t* buf = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
             size_t bufLen = bytes.size();
+            DataCache_invalidate();
             wStatus = ALA_Start(choice, buf, bufLen);
+            DataCache_invalidate();
         }
         stat = ALA_DeInit();
         if(choice != NULL)
@@ -181,6 +187,8 @@ jbyteArray eSEManager_lsExecuteScript(JNIEnv* e, jobject o, jstring name, jstrin
     IChannel_t Dwp;
     bool stat = false;
     const char *choice = NULL;
+    UINT64 startUs, startCpuUs;
+    INT16 handle;
 
     gJcopDwnldinProgress = true;
     if(Spichannel_init(&Dwp, LDR_SRVCE)!= true)
@@ -188,6 +196,31 @@ jbyteArray eSEManager_lsExecuteScript(JNIEnv* e, jobject o, jstring name, jstrin
         ALOGV ("%s: exit; Client already in-use status =0x%X", __FUNCTION__,wStatus);
         return result;
     }
+    choice = e->GetStringUTFChars(name, 0);
+    if((choice != NULL) && ScriptExec_isCompiled(choice))
+    {
+        /* compiled script: sent as it is, no ALA parsing */
+        destpath = e->GetStringUTFChars(dest, 0);
+        handle = Dwp.open();
+        if(handle != EE_ERROR_OPEN_FAIL)
+        {
+            DataCache_invalidate();
+            ScriptExec_run(choice, destpath, &resSW[2], &sScriptStats);
+            DataCache_invalidate();
+            Dwp.close(handle);
+        }
+        result = e->NewByteArray(lsExecuteResponseSize);
+        if (result != NULL)
+        {
+            e->SetByteArrayRegion(result, 0, lsExecuteResponseSize, (jbyte *) resSW);
+        }
+        gJcopDwnldinProgress = false;
+        if(destpath != NULL)
+            e->ReleaseStringUTFChars(dest, destpath);
+        e->ReleaseStringUTFChars(name, choice);
+        ALOGV ("%s: exit; SW %02X%02X", __FUNCTION__, resSW[2], resSW[3]);
+        return result;
+    }
     wStatus = ALA_Init(&Dwp);
     if(wStatus != STATUS_SUCCESS)
     {
@@ -198,12 +231,21 @@ jbyteArray eSEManager_lsExecuteScript(JNIEnv* e, jobject o, jstring name, jstrin
         destpath = e->GetStringUTFChars(dest, 0);
         ALOGE("destpath= %s", destpath);
         ALOGE("%s: start Applet load applet", __FUNCTION__);
-        choice = e->GetStringUTFChars(name, 0);
         ALOGE("choice= %s", choice);
         ScopedByteArrayRO bytes(e, data);
         uint8_t* buf = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(&bytes[0]));
         size_t bufLen = bytes.size();
+        DataCache_invalidate();
+        startUs = ScriptExec_nowUs();
+        startCpuUs = ScriptExec_cpuUs();
         wStatus = ALA_Start(choice,destpath, buf, bufLen,resSW);
+        /* parsing and execution are not told apart by ALA_Start */
+        memset(&sScriptStats, 0x00, sizeof(sScriptStats));
+        sScriptStats.cpuUs = ScriptExec_cpuUs() - startCpuUs;
+        sScriptStats.wallUs = ScriptExec_nowUs() - startUs;
+        ALOGI("%s: ALA script, %llu us CPU, %llu ms", __FUNCTION__, sScriptStats.cpuUs,
+                sScriptStats.wallUs / 1000);
+        DataCache_invalidate();
 
        /*copy results back to java*/
        result = e->NewByteArray(lsExecuteResponseSize);
@@ -245,8 +287,19 @@ jbyteArray eSEManager_GetCertificateKey(JNIEnv* e, jobject)
     const INT32 recvBufferMaxSize = 256;
     UINT8 recvBuffer [recvBufferMaxSize];
     INT32 recvBufferActualSize = 0;
-    jbyteArray result = e->NewByteArray(0);
+    UINT32 generation = DataCache_getGeneration();
+    jbyteArray result = NULL;
 
+    if(DataCache_get(DATA_CACHE_CERTIFICATE_KEY, recvBuffer, recvBufferMaxSize, recvBufferActualSize))
+    {
+        result = e->NewByteArray(recvBufferActualSize);
+        if (result != NULL)
+        {
+            e->SetByteArrayRegion(result, 0, recvBufferActualSize, (jbyte *) recvBuffer);
+        }
+        return result;
+    }
+    result = e->NewByteArray(0);
     if(Spichannel_init(&Dwp, LDR_SRVCE) != true)
     {
         ALOGV("%s: exit: recv len=%ld", __FUNCTION__, recvBufferActualSize);
@@ -261,6 +314,8 @@ jbyteArray eSEManager_GetCertificateKey(JNIEnv* e, jobject)
     {
         ALOGE("%s: start Get reference Certificate Key", __FUNCTION__);
         wStatus = ALA_GetCertificateKey(recvBuffer, &recvBufferActualSize);
+        if(wStatus == STATUS_SUCCESS)
+            DataCache_put(DATA_CACHE_CERTIFICATE_KEY, recvBuffer, recvBufferActualSize, generation);
     }
 
     /*copy results back to java*/
@@ -298,8 +353,21 @@ jbyteArray eSEManager_lsGetVersion(JNIEnv* e, jobject)
     bool stat = false;
     const INT32 recvBufferMaxSize = 4;
     UINT8 recvBuffer [recvBufferMaxSize];
-    jbyteArray result = e->NewByteArray(0);
+    INT32 recvBufferActualSize = 0;
+    UINT32 generation = DataCache_getGeneration();
+    jbyteArray result = NULL;
 
+    if(DataCache_get(DATA_CACHE_LS_VERSION, recvBuffer, recvBufferMaxSize, recvBufferActualSize) &&
+            (recvBufferActualSize == recvBufferMaxSize))
+    {
+        result = e->NewByteArray(recvBufferMaxSize);
+        if (result != NULL)
+        {
+            e->SetByteArrayRegion(result, 0, recvBufferMaxSize, (jbyte *) recvBuffer);
+        }
+        return result;
+    }
+    result = e->NewByteArray(0);
     if(Spichannel_init(&Dwp, LDR_SRVCE) != true)
     {
         ALOGV("%s: exit: recv len=%ld", __FUNCTION__, recvBufferMaxSize);
@@ -316,6 +384,8 @@ jbyteArray eSEManager_lsGetVersion(JNIEnv* e, jobject)
     {
         ALOGE("%s: start Get reference Certificate Key", __FUNCTION__);
         wStatus = ALA_lsGetVersion(recvBuffer);
+        if(wStatus == STATUS_SUCCESS)
+            DataCache_put(DATA_CACHE_LS_VERSION, recvBuffer, recvBufferMaxSize, generation);
     }
     gJcopDwnldinProgress = false;
 
@@ -352,9 +422,22 @@ jbyteArray eSEManager_lsGetAppletStatus(JNIEnv* e, jobject)
     bool stat = false;
     const INT32 recvBufferMaxSize = 2;
     UINT8 recvBuffer [recvBufferMaxSize]={0x63,0x40};
+    INT32 recvBufferActualSize = 0;
+    UINT32 generation = DataCache_getGeneration();
     IChannel_t Dwp;
-    jbyteArray result = e->NewByteArray(0);
+    jbyteArray result = NULL;
 
+    if(DataCache_get(DATA_CACHE_LS_APPLET_STATUS, recvBuffer, recvBufferMaxSize, recvBufferActualSize) &&
+            (recvBufferActualSize == recvBufferMaxSize))
+    {
+        result = e->NewByteArray(recvBufferMaxSize);
+        if (result != NULL)
+        {
+            e->SetByteArrayRegion(result, 0, recvBufferMaxSize, (jbyte *) recvBuffer);
+        }
+        return result;
+    }
+    result = e->NewByteArray(0);
     if(Spichannel_init(&Dwp, LDR_SRVCE) != true)
     {
         ALOGV("%s: exit: recv len=%ld", __FUNCTION__, recvBufferMaxSize);
@@ -371,6 +454,8 @@ jbyteArray eSEManager_lsGetAppletStatus(JNIEnv* e, jobject)
         ALOGE("%s: start Get reference Certificate Key", __FUNCTION__);
         wStatus = ALA_lsGetAppletStatus(recvBuffer);
         gJcopDwnldinProgress = false;
+        if(wStatus == STATUS_SUCCESS)
+            DataCache_put(DATA_CACHE_LS_APPLET_STATUS, recvBuffer, recvBufferMaxSize, generation);
     }
 
     ALOGV ("%s: lsGetAppletStatus values %x %x", __FUNCTION__, recvBuffer[0], recvBuffer[1]);
@@ -405,8 +490,16 @@ jbyteArray eSEManager_lsGetStatus(JNIEnv* e, jobject)
     ESESTATUS wStatus = STATUS_FAILED;
     const INT32 recvBufferMaxSize = 2;
     UINT8 recvBuffer [recvBufferMaxSize] = {0x63,0x40};
+    INT32 recvBufferActualSize = 0;
+    UINT32 generation = DataCache_getGeneration();
 
-    wStatus = ALA_lsGetStatus(recvBuffer);
+    if(!DataCache_get(DATA_CACHE_LS_STATUS, recvBuffer, recvBufferMaxSize, recvBufferActualSize) ||
+            (recvBufferActualSize != recvBufferMaxSize))
+    {
+        wStatus = ALA_lsGetStatus(recvBuffer);
+        if(wStatus == STATUS_SUCCESS)
+            DataCache_put(DATA_CACHE_LS_STATUS, recvBuffer, recvBufferMaxSize, generation);
+    }
 
     ALOGV ("%s: lsGetStatus values %x %x", __FUNCTION__, recvBuffer[0], recvBuffer[1]);
 
@@ -451,6 +544,35 @@ jint eSEManager_getLSConfigVer(JNIEnv* e, jobject o)
     return ls_version;
 }
 
+/*******************************************************************************
+**
+** Function:        eSEManager_lsGetExecStats
+**
+** Description:     Cost of the last Loader Service script executed.
+**                  e: JVM environment.
+**                  o: Java object.
+**
+** Returns:         1 if it was a compiled script, APDUs sent, CPU time reading
+**                  the script in us, CPU time in us, wall-clock time in us;
+**                  -1 for what ALA_Start does not tell.
+**
+*******************************************************************************/
+jlongArray eSEManager_lsGetExecStats(JNIEnv* e, jobject o)
+{
+    (void)o;
+    jlong values[5];
+
+    values[0] = sScriptStats.compiled ? 1 : 0;
+    values[1] = sScriptStats.compiled ? (jlong)sScriptStats.apdus : -1;
+    values[2] = sScriptStats.compiled ? (jlong)sScriptStats.parseCpuUs : -1;
+    values[3] = (jlong)sScriptStats.cpuUs;
+    values[4] = (jlong)sScriptStats.wallUs;
+    jlongArray result = e->NewLongArray(5);
+    if(result != NULL)
+        e->SetLongArrayRegion(result, 0, 5, values);
+    return result;
+}
+
 /*****************************************************************************
  **
  ** Description:     JNI functions
@@ -468,7 +590,9 @@ static JNINativeMethod gMethods[] =
     {"doLsGetAppletStatus","()[B",
                  (void *)eSEManager_lsGetAppletStatus},
     {"doGetLSConfigVersion", "()I",
-                 (void*)eSEManager_getLSConfigVer}
+                 (void*)eSEManager_getLSConfigVer},
+    {"doLsGetExecStats", "()[J",
+                 (void*)eSEManager_lsGetExecStats}
 #else
     {"GetAppletsList", "([Ljava/lang/String;)I",
                 (void *)eSEManager_GetAppletsList},
@@ -31,6 +31,11 @@
 #include <IChannel.h>
 #include <JcDnld.h>
 #include "SpiChannel.h"
+#include "SpiChannelPool.h"
+#include "SpiDataCache.h"
+#include "SpiTransceiveSlot.h"
+#include "SpiApduScheduler.h"
+#include "SpiJcopDownload.h"
 
 #ifdef ESE_NFC_SYNCHRONIZATION
 #include <linux/ese-nfc-sync.h>
@@ -84,14 +89,14 @@ JavaVM * g_vm;
 jobject g_obj;
 jmethodID g_mid;
 ese_jni_native_data* mNativeData = NULL;
-SyncEvent     sTransceiveEvent;  //fevent for Set_Config....
-uint8_t*      sTransceiveData = NULL;
-uint32_t      sTransceiveDataLen = 0;
 jmethodID     gCachedEseManagerListeners;
 const char    *gNativeEseManagerClassName = "com/nxp/ese/dhimpl/NativeEseManager";
 bool          gJcopDwnldinProgress = false;
 #if(NXP_ESE_CHIP_TYPE == P61)
 static void          eseStackCallback (ESESTATUS status, phNxpEseP61_data* eventData);
+/* doInitialize opened a priority session, its APDUs and its close go through
+ * the priority calls so that a normal session it preempted is resumed */
+static bool          gPrioSession = false;
 #endif
 
 ESESTATUS EseNfcSyncInit(void);
@@ -113,23 +118,87 @@ void eseStackCB(ESESTATUS status, phNxpEseP61_data* eventData)
 {
     eseStackCallback (status, eventData);
 }
+
+/**
+ * \ingroup spi_package
+ * \brief Send an APDU of the session opened by doInitialize.
+ *
+ * \param[in]       uint16_t
+ * \param[in]       const uint8_t *
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+ */
+ESESTATUS eseTransceive(uint16_t data_len, const uint8_t *p_data)
+{
+    if(gPrioSession)
+        return phNxpEseP61_PrioTransceive(data_len, p_data);
+    return phNxpEseP61_Transceive(data_len, p_data);
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Close the session opened by doInitialize.
+ *
+ * \retval ESESTATUS_SUCCESS On Success ESESTATUS_SUCCESS else proper error code
+ *
+ */
+ESESTATUS eseClose()
+{
+    if(gPrioSession)
+    {
+        gPrioSession = false;
+        return phNxpEseP61_closePrioSession();
+    }
+    return phNxpEseP61_close();
+}
+#endif
+#if(NXP_ESE_CHIP_TYPE == P73)
+/**
+ * \ingroup spi_package
+ * \brief Kind of client of the power policy for a scheduling class.
+ *
+ * \param[in]       jint scheduling class, one of NativeEseManager.SCHED_CLASS_*
+ *
+ * \retval Client type, ESE_CLIENT_DEFAULT for an unknown class.
+ *
+ */
+static phNxpEse_clientType nativeEseManager_clientType(jint schedClass)
+{
+    switch(schedClass)
+    {
+    case SCHED_CLASS_PAYMENT:
+        return ESE_CLIENT_WALLET;
+    case SCHED_CLASS_TRANSIT:
+        return ESE_CLIENT_TRANSIT;
+    case SCHED_CLASS_SYNC:
+    case SCHED_CLASS_OSU:
+        return ESE_CLIENT_SERVICE;
+    default:
+        return ESE_CLIENT_DEFAULT;
+    }
+}
 #endif
+
 /**
  * \ingroup spi_package
  * \brief Open ESE
  *
  * \param[in]       JNIEnv*
  * \param[in]       jobject
+ * \param[in]       jint timeout of a priority session, 9999 for a normal one
+ * \param[in]       jint scheduling class of the caller, one of
+ *                  NativeEseManager.SCHED_CLASS_*
  *
  * \retval True if ok.
  *
  */
 
-static jboolean nativeEseManager_doInitialize(JNIEnv *e, jobject obj, jint timeout)
+static jboolean nativeEseManager_doInitialize(JNIEnv *e, jobject obj, jint timeout, jint schedClass)
 {
     (void)e;
     (void)obj;
-    ALOGV ("%s: enter...timeout=%d\n", __FUNCTION__, timeout);
+    ALOGV ("%s: enter...timeout=%d class=%d\n", __FUNCTION__, timeout, schedClass);
     ESESTATUS status = ESESTATUS_SUCCESS;
     BOOLEAN returnStatus = true;
 #if(NXP_ESE_CHIP_TYPE == P61)
@@ -140,6 +209,9 @@ static jboolean nativeEseManager_doInitialize(JNIEnv *e, jobject obj, jint timeo
 #if(NXP_ESE_CHIP_TYPE == P73)
     phNxpEse_initParams initParams;
     memset(&initParams,0x00,sizeof(phNxpEse_initParams));
+    initParams.clientType = nativeEseManager_clientType(schedClass);
+#else
+    (void)schedClass;
 #endif
 
 #ifdef ISO7816_4_APDU_PARSER_ENABLE
@@ -162,6 +234,7 @@ static jboolean nativeEseManager_doInitialize(JNIEnv *e, jobject obj, jint timeo
     {
 #if(NXP_ESE_CHIP_TYPE == P61)
     status = phNxpEseP61_openPrioSession(eseStackCallback, timeout, initParams);
+    gPrioSession = (status == ESESTATUS_SUCCESS);
 #elif(NXP_ESE_CHIP_TYPE == P73)
     status = phNxpEse_openPrioSession(initParams);
 #endif
@@ -181,6 +254,7 @@ static jboolean nativeEseManager_doInitialize(JNIEnv *e, jobject obj, jint timeo
         initParams.initMode = ESE_MODE_NORMAL;
         status = phNxpEse_init(initParams);
 #endif
+        ChannelPool_init();
     }
     if(status != ESESTATUS_SUCCESS)
     {
@@ -211,9 +285,12 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
 {
     ALOGV ("%s: enter", __FUNCTION__);
     uint8_t* buf = NULL;
-    uint8_t *temp_buff = NULL;
     uint32_t data_index = 0;
     uint32_t le_size = 0;
+    uint32_t rsp_size = 0;
+#if(NXP_ESE_CHIP_TYPE == P73)
+    uint32_t max_rsp_len = 0;
+#endif
     ESESTATUS status = ESESTATUS_SUCCESS;
     // get input buffer and length from java call
     ScopedByteArrayRO bytes(e, data);
@@ -342,35 +419,30 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
 
     if (pCmd.lc > 0)
     {
-        pCmd.pdata = (uint8_t *)malloc(pCmd.lc * sizeof(uint8_t));
-        if (pCmd.pdata == NULL)
-        {
-            ALOGV("Memory allocation failed \n");
-            return NULL;
-        }
-        memcpy(&pCmd.pdata[0], &buf[data_index], pCmd.lc);
+        /* the data field is read in place from the java array */
+        pCmd.pdata = &buf[data_index];
     }
-    if(pCmd.le_type == 0 || pCmd.le_type == 1)
+    rsp_size = (pCmd.le_type == 0 || pCmd.le_type == 1) ? 256 : pCmd.le;
+#if(NXP_ESE_CHIP_TYPE == P73)
+    /* 61xx pieces are appended by the library, up to its cap */
+    if (phNxpEse_7816_getAutoResponse(&max_rsp_len) && (max_rsp_len > rsp_size))
     {
-        ALOGV("Allocating 256 res buff");
-        pRsp.pdata = (uint8_t *)malloc(sizeof(char) * 256);
-        if(pRsp.pdata == NULL)
-        {
-             ALOGV("Memory allocation failed \n");
-             return NULL;
-        }
+        rsp_size = max_rsp_len;
     }
-    else
+#endif
+    /* room for SW1 SW2 after the data, so that the array is built in place */
+    ALOGV("Allocating %d res buff", rsp_size);
+    pRsp.pdata = (uint8_t *)malloc(sizeof(char) * (rsp_size + 2));
+    if(pRsp.pdata == NULL)
     {
-        ALOGV("Allocating %d res buff", pCmd.le);
-        pRsp.pdata = (uint8_t *)malloc(sizeof(char) * pCmd.le);
-        if(pRsp.pdata == NULL)
-        {
-            ALOGV("Memory allocation failed \n");
-            return NULL;
-        }
+        ALOGV("Memory allocation failed \n");
+        return NULL;
     }
+#if(NXP_ESE_CHIP_TYPE == P73)
+    pRsp.len = rsp_size;
+#else
     pRsp.len = 0;
+#endif
     ALOGV("cla = 0x%x , ins = 0x%x , p1 = 0x%x, p2 = 0x%x , lc =0x%x, cpdu_type= 0x%x, le_type= 0x%x, le = 0x%x"
             ,pCmd.cla, pCmd.ins, pCmd.p1, pCmd.p2, pCmd.lc, pCmd.cpdu_type, pCmd.le_type, pCmd.le);
 #if(NXP_ESE_CHIP_TYPE == P61)
@@ -381,23 +453,13 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
     if (status == ESESTATUS_SUCCESS)
     {
         ALOGV ("%s: phNxpEse_7816_Transceive Success pRsp.len %d", __FUNCTION__, pRsp.len);
-        temp_buff = (uint8_t *)malloc((pRsp.len + 2) * sizeof(uint8_t));
-        if (temp_buff == NULL)
-        {
-            ALOGE ("%s: Failed to allocate java byte array", __FUNCTION__);
-            return NULL;
-        }
-        if(pRsp.len > 0)
-        {
-            memcpy(&temp_buff[0], &pRsp.pdata[0], pRsp.len);
-        }
         ALOGV("pRsp.sw1 = 0x%x, pRsp.sw2 = 0x%x, pRsp.len %d", pRsp.sw1, pRsp.sw2, pRsp.len);
-        temp_buff[pRsp.len] = pRsp.sw1;
-        temp_buff[pRsp.len + 1] = pRsp.sw2;
+        pRsp.pdata[pRsp.len] = pRsp.sw1;
+        pRsp.pdata[pRsp.len + 1] = pRsp.sw2;
         result.reset(e->NewByteArray(pRsp.len + 2));
         if (result.get() != NULL)
         {
-            e->SetByteArrayRegion(result.get(), 0, (pRsp.len + 2), (jbyte *) &temp_buff[0]);
+            e->SetByteArrayRegion(result.get(), 0, (pRsp.len + 2), (jbyte *) &pRsp.pdata[0]);
         }
         else
             ALOGE ("%s: Failed to allocate java byte array", __FUNCTION__);
@@ -405,15 +467,12 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
     else
     {
         ALOGE ("%s: phNxpEse_7816_Transceive Failed", __FUNCTION__);
-        return NULL;
     }
 
-    ALOGV ("%s: status: %d , sTransceiveDataLen :%d", __FUNCTION__,status , sTransceiveDataLen);
-
-    if (temp_buff != NULL)
-        free (temp_buff);
+    ALOGV ("%s: status: %d", __FUNCTION__,status);
 
-    temp_buff = NULL;
+    free (pRsp.pdata);
+    pRsp.pdata = NULL;
     ALOGV ("%s: Exit", __FUNCTION__);
     return result.release();
 }
@@ -443,36 +502,28 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
     ScopedLocalRef<jbyteArray> result(e, NULL);
 
 #if(NXP_ESE_CHIP_TYPE == P61)
-    SyncEventGuard guard (sTransceiveEvent);
-    status = phNxpEseP61_Transceive(bufLen, buf);
+    transceiveSlot_t* pSlot = TransceiveSlot_acquire();
+    if(pSlot == NULL)
+        return NULL;
+    status = eseTransceive(bufLen, buf);
     if (status == ESESTATUS_SUCCESS)
-        sTransceiveEvent.wait ();
+        TransceiveSlot_wait(pSlot);
     else
         ALOGE ("%s: phNxpEseP61_Transceive Failed", __FUNCTION__);
 
-    ALOGV ("%s: status: %d , sTransceiveDataLen :%d", __FUNCTION__,status , sTransceiveDataLen);
+    ALOGV ("%s: request %lu status: %d , rspLen :%lu", __FUNCTION__, pSlot->requestId, status, pSlot->rspLen);
 
-    if(sTransceiveDataLen != 0)
-    {
-        result.reset(e->NewByteArray(sTransceiveDataLen));
-    }
-    else
+    if((status == ESESTATUS_SUCCESS) && (pSlot->rspLen != 0))
     {
-        ALOGV ("%s: TransceiveDataLen: %d", __FUNCTION__,sTransceiveDataLen);
-        return NULL;
-    }
-    if (result.get() != NULL)
-    {
-        e->SetByteArrayRegion(result.get(), 0, sTransceiveDataLen, (jbyte *) sTransceiveData);
+        result.reset(e->NewByteArray(pSlot->rspLen));
+        if (result.get() != NULL)
+        {
+            e->SetByteArrayRegion(result.get(), 0, pSlot->rspLen, (jbyte *) pSlot->rsp);
+        }
+        else
+            ALOGE ("%s: Failed to allocate java byte array", __FUNCTION__);
     }
-    else
-        ALOGE ("%s: Failed to allocate java byte array", __FUNCTION__);
-
-    if (sTransceiveData != NULL)
-        free (sTransceiveData);
-
-    sTransceiveData = NULL;
-    sTransceiveDataLen = 0;
+    TransceiveSlot_release(pSlot);
 #elif(NXP_ESE_CHIP_TYPE == P73)
     status = phNxpEse_Transceive(&pCmd, &pRsp);
     if (status == ESESTATUS_SUCCESS)
@@ -512,6 +563,112 @@ static jbyteArray nativeEseManager_doTransceive(JNIEnv *e, jobject obj, jbyteArr
     return result.release();
 }
 #endif
+
+#if(NXP_ESE_CHIP_TYPE == P73)
+typedef struct direct_rsp
+{
+    uint8_t* buf;
+    uint32_t maxLen;
+    uint32_t len;
+}directRsp_t;
+
+/**
+ * \ingroup spi_package
+ * \brief Response sink of doTransceiveDirect, appends to the java buffer.
+ *
+ * \retval ESESTATUS_SUCCESS, ESESTATUS_BUFFER_TOO_SMALL when the buffer is full.
+ *
+ */
+static ESESTATUS directRspSink(void *pContext, const uint8_t *pData, uint32_t len, bool_t last)
+{
+    (void)last;
+    directRsp_t* pRsp = (directRsp_t*)pContext;
+
+    if(len > (pRsp->maxLen - pRsp->len))
+        return ESESTATUS_BUFFER_TOO_SMALL;
+    memcpy(&pRsp->buf[pRsp->len], pData, len);
+    pRsp->len += len;
+    return ESESTATUS_SUCCESS;
+}
+#endif
+
+/**
+ * \ingroup spi_package
+ * \brief Send raw data from a direct ByteBuffer; receive the response into
+ *        a direct ByteBuffer owned by the caller. Both buffers are used from
+ *        their start, position and limit are left alone. No java array is
+ *        created and the command is not copied.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jobject direct ByteBuffer holding the command
+ * \param[in]       jint command length
+ * \param[in]       jobject direct ByteBuffer receiving the response
+ *
+ * \retval Response length, -1 on error or if the response does not fit.
+ *
+ */
+static jint nativeEseManager_doTransceiveDirect(JNIEnv *e, jobject obj, jobject cmd,
+        jint cmdLen, jobject rsp)
+{
+    (void)obj;
+    ESESTATUS status = ESESTATUS_FAILED;
+    uint8_t* cmdBuf = NULL;
+    uint8_t* rspBuf = NULL;
+    jlong cmdCapacity = 0;
+    jlong rspCapacity = 0;
+    jint rspLen = -1;
+    ALOGV ("%s: enter", __FUNCTION__);
+
+    if((cmd == NULL) || (rsp == NULL))
+        return -1;
+    cmdBuf = (uint8_t*)e->GetDirectBufferAddress(cmd);
+    rspBuf = (uint8_t*)e->GetDirectBufferAddress(rsp);
+    cmdCapacity = e->GetDirectBufferCapacity(cmd);
+    rspCapacity = e->GetDirectBufferCapacity(rsp);
+    if((cmdBuf == NULL) || (rspBuf == NULL) || (cmdLen <= 0) || (cmdLen > cmdCapacity))
+    {
+        ALOGE ("%s: not a direct buffer or bad length", __FUNCTION__);
+        return -1;
+    }
+
+#if(NXP_ESE_CHIP_TYPE == P61)
+    if(cmdLen > 0xFFFF)
+        return -1;
+    transceiveSlot_t* pSlot = TransceiveSlot_acquire();
+    if(pSlot == NULL)
+        return -1;
+    status = eseTransceive((uint16_t)cmdLen, cmdBuf);
+    if (status == ESESTATUS_SUCCESS)
+        TransceiveSlot_wait(pSlot);
+    else
+        ALOGE ("%s: phNxpEseP61_Transceive Failed", __FUNCTION__);
+    /* the P61 library hands the response over in eseStackCallback */
+    if((status == ESESTATUS_SUCCESS) && (pSlot->status == ESESTATUS_SUCCESS) &&
+            (pSlot->rspLen != 0) && (pSlot->rspLen <= rspCapacity))
+    {
+        memcpy(rspBuf, pSlot->rsp, pSlot->rspLen);
+        rspLen = pSlot->rspLen;
+    }
+    TransceiveSlot_release(pSlot);
+#elif(NXP_ESE_CHIP_TYPE == P73)
+    phNxpEse_data pCmd;
+    directRsp_t directRsp;
+    pCmd.p_data = cmdBuf;
+    pCmd.len = cmdLen;
+    directRsp.buf = rspBuf;
+    directRsp.maxLen = (rspCapacity > 0xFFFFFFFFLL) ? 0xFFFFFFFFU : (uint32_t)rspCapacity;
+    directRsp.len = 0;
+    status = phNxpEse_TransceiveStream(&pCmd, directRspSink, &directRsp);
+    if (status == ESESTATUS_SUCCESS)
+        rspLen = directRsp.len;
+    else
+        ALOGE ("%s: phNxpEse_TransceiveStream Failed 0x%x", __FUNCTION__, status);
+#endif
+    ALOGV ("%s: Exit, rspLen %d", __FUNCTION__, rspLen);
+    return rspLen;
+}
+
 /**
  * \ingroup spi_package
  * \brief Start Download
@@ -536,25 +693,39 @@ static int nativeEseManager_doStartDownload(JNIEnv *e, jobject obj)
 
     if(Spichannel_init(&swp, JCP_SRVCE))
     {
+        DataCache_invalidate();
 
+        if(JcopDwnld_isConfigured())
+        {
+            /* image streamed by the download engine instead of the JCOP loader,
+             * from where an interrupted download of it stopped */
+            status = JcopDwnld_resume(&swp) ? STATUS_SUCCESS : STATUS_FAILED;
+            if(status != STATUS_SUCCESS)
+            {
+                ALOGE("%s: JcopDwnld_resume failed", __FUNCTION__);
+            }
+        }
+        else
+        {
 #if(NXP_ESE_CHIP_TYPE == P61)
-        phNxpEseP61_setIfsc(IFSC_JCOPDWNLD);
+            phNxpEseP61_setIfsc(IFSC_JCOPDWNLD);
 #elif(NXP_ESE_CHIP_TYPE == P73)
-        phNxpEse_setIfsc(IFSC_JCOPDWNLD);
+            phNxpEse_setIfsc(IFSC_JCOPDWNLD);
 #endif
-        status = JCDNLD_Init(&swp);
-        if(status != STATUS_SUCCESS)
-        {
-            ALOGE("%s: JCDND initialization failed", __FUNCTION__);
-        }else
-        {
-            status = JCDNLD_StartDownload();
-            if(status != ESESTATUS_SUCCESS)
+            status = JCDNLD_Init(&swp);
+            if(status != STATUS_SUCCESS)
+            {
+                ALOGE("%s: JCDND initialization failed", __FUNCTION__);
+            }else
             {
-                ALOGE("%s: JCDNLD_StartDownload failed", __FUNCTION__);
+                status = JCDNLD_StartDownload();
+                if(status != ESESTATUS_SUCCESS)
+                {
+                    ALOGE("%s: JCDNLD_StartDownload failed", __FUNCTION__);
+                }
             }
+            stat = JCDNLD_DeInit();
         }
-        stat = JCDNLD_DeInit();
 #if(NXP_ESE_CHIP_TYPE == P61)
         phNxpEseP61_setIfsc(IFSC_NONJCOPDWNLD);
 #elif(NXP_ESE_CHIP_TYPE == P73)
@@ -562,6 +733,10 @@ static int nativeEseManager_doStartDownload(JNIEnv *e, jobject obj)
 #endif
         Spichannel_Deinit(JCP_SRVCE);
     }
+    /* the OS update closes the logical channels */
+    ChannelPool_reset();
+    ApduSched_resetChannels();
+    DataCache_invalidate();
     gJcopDwnldinProgress = false;
     ALOGV ("%s: Exit; status =0x%X", __FUNCTION__,status);
     return status;
@@ -643,6 +818,8 @@ static jboolean nativeEseManager_doDeinitialize(JNIEnv *e, jobject obj)
         /*Release the handle so that other clients can use*/
         mHandle = DEFAULT;
     }
+    ChannelPool_reset();
+    ApduSched_resetChannels();
 #if(NXP_ESE_CHIP_TYPE == P73)
     if(status != phNxpEse_deInit())
     {
@@ -652,7 +829,7 @@ static jboolean nativeEseManager_doDeinitialize(JNIEnv *e, jobject obj)
     {
 #endif
     #if(NXP_ESE_CHIP_TYPE == P61)
-        if(status  != phNxpEseP61_close())
+        if(status  != eseClose())
     #elif(NXP_ESE_CHIP_TYPE == P73)
         if(status  != phNxpEse_close())
     #endif
@@ -684,6 +861,9 @@ static jboolean nativeEseManager_doReset(JNIEnv *e, jobject obj)
     ESESTATUS status = ESESTATUS_SUCCESS;
     BOOLEAN returnStatus = true;
     ALOGV ("%s: enter", __FUNCTION__);
+    ChannelPool_reset();
+    ApduSched_resetChannels();
+    DataCache_invalidate();
 #if(NXP_ESE_CHIP_TYPE == P61)
     if(status != phNxpEseP61_reset())
 #elif(NXP_ESE_CHIP_TYPE == P73)
@@ -715,6 +895,9 @@ static jboolean nativeEseManager_doChipReset(JNIEnv *e, jobject obj)
     ESESTATUS status = ESESTATUS_SUCCESS;
     BOOLEAN returnStatus = true;
     ALOGV ("%s: enter", __FUNCTION__);
+    ChannelPool_reset();
+    ApduSched_resetChannels();
+    DataCache_invalidate();
     if(status != phNxpEse_chipReset())
     {
         returnStatus = false;
@@ -744,11 +927,300 @@ static void nativeEseManager_doAbort(JNIEnv *e, jobject obj)
     (void)obj;
 
     ALOGV ("%s: enter; Status:ESESTATUS_ABORTED", __FUNCTION__);
-    SyncEventGuard guard (sTransceiveEvent);
-    sTransceiveEvent.notifyOne();
+    TransceiveSlot_abort();
     ALOGV ("%s: exit", __FUNCTION__);
 }
 
+/**
+ * \ingroup spi_package
+ * \brief Lease a logical channel with the applet selected.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jbyteArray AID of the applet
+ *
+ * \retval Channel number followed by the SELECT response, the channel number
+ *         is 0 when the applet could not be selected. NULL on other errors.
+ *
+ */
+static jbyteArray nativeEseManager_doLeaseChannel(JNIEnv *e, jobject obj, jbyteArray aid)
+{
+    (void)obj;
+    UINT8 rsp[1 + CHANNEL_POOL_MAX_RSP_LEN];
+    INT32 rspLen = 0;
+    INT16 channel;
+    ALOGV ("%s: enter", __FUNCTION__);
+
+    if(aid == NULL)
+        return NULL;
+    ScopedByteArrayRO bytes(e, aid);
+    channel = ChannelPool_lease(reinterpret_cast<const UINT8*>(&bytes[0]), bytes.size(),
+            &rsp[1], CHANNEL_POOL_MAX_RSP_LEN, rspLen);
+    if((channel == EE_ERROR_OPEN_FAIL) && (rspLen == 0))
+    {
+        ALOGE ("%s: no channel", __FUNCTION__);
+        return NULL;
+    }
+    rsp[0] = (channel == EE_ERROR_OPEN_FAIL) ? 0 : (UINT8)channel;
+    jbyteArray result = e->NewByteArray(rspLen + 1);
+    if(result != NULL)
+    {
+        e->SetByteArrayRegion(result, 0, rspLen + 1, (jbyte *)rsp);
+    }
+    ALOGV ("%s: exit, channel %d", __FUNCTION__, rsp[0]);
+    return result;
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Give back a channel leased with doLeaseChannel.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jint channel number
+ *
+ * \retval True if the channel was leased.
+ *
+ */
+static jboolean nativeEseManager_doReleaseChannel(JNIEnv *e, jobject obj, jint channel)
+{
+    (void)e;
+    (void)obj;
+    ALOGV ("%s: channel %d", __FUNCTION__, channel);
+    return ChannelPool_release((INT16)channel) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Register a client of the APDU scheduler.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jint scheduling class, one of NativeEseManager.SCHED_CLASS_*
+ *
+ * \retval Client id, -1 if the class is unknown or all ids are taken.
+ *
+ */
+static jint nativeEseManager_doRegisterSchedClient(JNIEnv *e, jobject obj, jint schedClass)
+{
+    (void)e;
+    (void)obj;
+    ALOGV ("%s: class %d", __FUNCTION__, schedClass);
+    return ApduSched_register((apduSchedClass_t)schedClass);
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Unregister a client of the APDU scheduler, its queued APDUs fail.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jint client id
+ *
+ */
+static void nativeEseManager_doUnregisterSchedClient(JNIEnv *e, jobject obj, jint client)
+{
+    (void)e;
+    (void)obj;
+    ALOGV ("%s: client %d", __FUNCTION__, client);
+    ApduSched_unregister(client);
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Send an APDU once the scheduler grants the eSE to the client.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       jint client id
+ * \param[in]       jbyteArray command
+ * \param[in]       jint max. time in queue in ms, 0 for no limit
+ *
+ * \retval Response data, NULL on error or timeout.
+ *
+ */
+static jbyteArray nativeEseManager_doScheduledTransceive(JNIEnv *e, jobject obj, jint client,
+        jbyteArray data, jint timeout)
+{
+    (void)obj;
+    INT32 rspLen = 0;
+    UINT8* rsp;
+    jbyteArray result = NULL;
+
+    if(data == NULL)
+        return NULL;
+    ScopedByteArrayRO bytes(e, data);
+    rsp = (UINT8*)malloc(APDU_SCHED_MAX_RSP_LEN);
+    if(rsp == NULL)
+        return NULL;
+    if(ApduSched_transceive(client, const_cast<UINT8*>(reinterpret_cast<const UINT8*>(&bytes[0])),
+            bytes.size(), rsp, APDU_SCHED_MAX_RSP_LEN, rspLen, timeout) && (rspLen > 0))
+    {
+        result = e->NewByteArray(rspLen);
+        if(result != NULL)
+            e->SetByteArrayRegion(result, 0, rspLen, (jbyte *)rsp);
+        else
+            ALOGE ("%s: Failed to allocate java byte array", __FUNCTION__);
+    }
+    free(rsp);
+    return result;
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Queueing delay of the scheduler classes.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ *
+ * \retval For each class in SCHED_CLASS_* order: APDUs sent, total and max.
+ *         time queued in us, APDUs queued now.
+ *
+ */
+static jlongArray nativeEseManager_doGetSchedStats(JNIEnv *e, jobject obj)
+{
+    (void)obj;
+    apduSchedStats_t stats[SCHED_CLASS_MAX];
+    jlong values[SCHED_CLASS_MAX * 4];
+    int i;
+
+    ApduSched_getStats(stats);
+    for(i = 0; i < SCHED_CLASS_MAX; i++)
+    {
+        values[(i * 4) + 0] = (jlong)stats[i].jobs;
+        values[(i * 4) + 1] = (jlong)stats[i].totalWaitUs;
+        values[(i * 4) + 2] = (jlong)stats[i].maxWaitUs;
+        values[(i * 4) + 3] = (jlong)stats[i].queued;
+    }
+    jlongArray result = e->NewLongArray(SCHED_CLASS_MAX * 4);
+    if(result != NULL)
+        e->SetLongArrayRegion(result, 0, SCHED_CLASS_MAX * 4, values);
+    return result;
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Progress of the running or of the last JCOP OS download done by the
+ *        download engine.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ *
+ * \retval Image size, image bytes done, APDU bytes sent, APDUs sent, elapsed
+ *         time in us, throughput in KB/s, 1 while running, image bytes
+ *         skipped by a resume, segments committed.
+ *
+ */
+static jlongArray nativeEseManager_doGetJcopDownloadProgress(JNIEnv *e, jobject obj)
+{
+    (void)obj;
+    jcopDwnldProgress_t progress;
+    jlong values[9];
+
+    JcopDwnld_getProgress(&progress);
+    values[0] = (jlong)progress.imageBytes;
+    values[1] = (jlong)progress.doneBytes;
+    values[2] = (jlong)progress.apduBytes;
+    values[3] = (jlong)progress.apdus;
+    values[4] = (jlong)progress.elapsedUs;
+    values[5] = (jlong)progress.kbPerSec;
+    values[6] = progress.running ? 1 : 0;
+    values[7] = (jlong)progress.resumedBytes;
+    values[8] = (jlong)progress.segments;
+    jlongArray result = e->NewLongArray(9);
+    if(result != NULL)
+        e->SetLongArrayRegion(result, 0, 9, values);
+    return result;
+}
+
+#if(NXP_ESE_CHIP_TYPE != P61)
+/**
+ * \ingroup spi_package
+ * \brief Tells the power policy of the library what use of the eSE to expect.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ * \param[in]       hint POWER_HINT_ACTIVE or POWER_HINT_IDLE
+ *
+ * \retval None
+ *
+ */
+static void nativeEseManager_doPowerHint(JNIEnv *e, jobject obj, jint hint)
+{
+    (void)e;
+    (void)obj;
+    ALOGV("%s: hint %d", __FUNCTION__, hint);
+    phNxpEse_powerHint((hint == ESE_PWR_HINT_ACTIVE) ? ESE_PWR_HINT_ACTIVE : ESE_PWR_HINT_IDLE);
+}
+
+/**
+ * \ingroup spi_package
+ * \brief Latency and energy side of the power policy.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ *
+ * \retval Cold and warm sessions, total time from open to the first APDU of
+ *         each in us, max of that time in us, speculative power ups and the
+ *         ones used, estimated on time and idle on time in us.
+ *
+ */
+static jlongArray nativeEseManager_doGetPowerStats(JNIEnv *e, jobject obj)
+{
+    (void)obj;
+    phNxpEse_Stats_t stats;
+    jlong values[9];
+
+    phNxpEse_getStats(&stats, FALSE);
+    values[0] = (jlong)stats.sessionsCold;
+    values[1] = (jlong)stats.sessionsWarm;
+    values[2] = (jlong)stats.ttfaColdUs;
+    values[3] = (jlong)stats.ttfaWarmUs;
+    values[4] = (jlong)stats.ttfaMaxUs;
+    values[5] = (jlong)stats.spmWarmups;
+    values[6] = (jlong)stats.spmWarmupsUsed;
+    values[7] = (jlong)stats.spmOnTimeUs;
+    values[8] = (jlong)stats.spmIdleOnTimeUs;
+    jlongArray result = e->NewLongArray(9);
+    if(result != NULL)
+        e->SetLongArrayRegion(result, 0, 9, values);
+    return result;
+}
+#endif
+
+#if(NXP_ESE_CHIP_TYPE == P61)
+/**
+ * \ingroup spi_package
+ * \brief Preemption of normal sessions by the priority sessions.
+ *
+ * \param[in]       JNIEnv*
+ * \param[in]       jobject
+ *
+ * \retval Normal sessions parked, priority requests refused after
+ *         NXP_ESE_PRIO_MAX_WAIT_MS, parked sessions resumed, total and max
+ *         wait for the block boundary in us.
+ *
+ */
+static jlongArray nativeEseManager_doGetPrioStats(JNIEnv *e, jobject obj)
+{
+    (void)obj;
+    phNxpEseP61_prioStats stats;
+    jlong values[5];
+
+    if(phNxpEseP61_getPrioStats(&stats, FALSE) != ESESTATUS_SUCCESS)
+        return NULL;
+    values[0] = (jlong)stats.preemptions;
+    values[1] = (jlong)stats.waitTimeouts;
+    values[2] = (jlong)stats.resumes;
+    values[3] = (jlong)stats.totalWaitUs;
+    values[4] = (jlong)stats.maxWaitUs;
+    jlongArray result = e->NewLongArray(5);
+    if(result != NULL)
+        e->SetLongArrayRegion(result, 0, 5, values);
+    return result;
+}
+#endif
+
 static jboolean nativeEseManager_doDisablePwrCntrl(JNIEnv *e, jobject obj, jboolean required)
 {
     ESESTATUS status = ESESTATUS_SUCCESS;
@@ -887,17 +1359,29 @@ static jboolean nativeEseManager_initNativeStruct(JNIEnv* e, jobject o)
 
 static JNINativeMethod methods[] = {
 
-        {"doInitialize", "(I)Z", (void*)nativeEseManager_doInitialize },
+        {"doInitialize", "(II)Z", (void*)nativeEseManager_doInitialize },
         {"doDeinitialize", "()Z", (void*)nativeEseManager_doDeinitialize },
         {"doTransceive", "([B)[B", (void*)nativeEseManager_doTransceive },
+        {"doTransceiveDirect", "(Ljava/nio/ByteBuffer;ILjava/nio/ByteBuffer;)I", (void*)nativeEseManager_doTransceiveDirect },
         {"doReset", "()Z", (void*)nativeEseManager_doReset },
         {"doChipReset", "()Z", (void*)nativeEseManager_doChipReset },
         {"initializeNativeStructure", "()Z", (void*)nativeEseManager_initNativeStruct},
         {"doStartJcopDownload", "()I", (void*)nativeEseManager_doStartDownload},
         {"doAbort", "()V", (void*)nativeEseManager_doAbort},
+        {"doLeaseChannel", "([B)[B", (void*)nativeEseManager_doLeaseChannel},
+        {"doReleaseChannel", "(I)Z", (void*)nativeEseManager_doReleaseChannel},
+        {"doRegisterSchedClient", "(I)I", (void*)nativeEseManager_doRegisterSchedClient},
+        {"doUnregisterSchedClient", "(I)V", (void*)nativeEseManager_doUnregisterSchedClient},
+        {"doScheduledTransceive", "(I[BI)[B", (void*)nativeEseManager_doScheduledTransceive},
+        {"doGetSchedStats", "()[J", (void*)nativeEseManager_doGetSchedStats},
+        {"doGetJcopDownloadProgress", "()[J", (void*)nativeEseManager_doGetJcopDownloadProgress},
         {"doDisablePowerControl", "(Z)Z", (void*)nativeEseManager_doDisablePwrCntrl},
 #if(NXP_ESE_CHIP_TYPE != P61)
         {"doGetSeTimer", "()[B", (void*)nativeEseManager_doGetSeTimer},
+        {"doPowerHint", "(I)V", (void*)nativeEseManager_doPowerHint},
+        {"doGetPowerStats", "()[J", (void*)nativeEseManager_doGetPowerStats},
+#else
+        {"doGetPrioStats", "()[J", (void*)nativeEseManager_doGetPrioStats},
 #endif
         {"doGetSeInterface", "(I)I", (void*)nativeEseManager_doGetSeInterface},
         {"doCheckJcopDlAtBoot", "()Z", (void*)nativeEseManager_doCheckJcopDlAtBoot}
@@ -926,7 +1410,6 @@ static void eseStackCallback (ESESTATUS status, phNxpEse_data* eventData)
     ALOGV("%s: event= %u", __FUNCTION__, status);
     JNIEnv* e = NULL;
     ScopedAttach attach(mNativeData->vm, &e);
-    sTransceiveDataLen = 0;
     if (e == NULL)
     {
         ALOGE ("%s: jni env is null", __FUNCTION__);
@@ -938,24 +1421,15 @@ static void eseStackCallback (ESESTATUS status, phNxpEse_data* eventData)
     {
         if(eventData != NULL){
             ALOGV ("%s: Status:ESESTATUS_SUCCESS", __FUNCTION__);
-            if (eventData->len)
-            {
-                if (NULL == (sTransceiveData = (uint8_t *) malloc (eventData->len)))
-                {
-                    ALOGV ("%s: memory allocation error", __FUNCTION__);
-                }
-                else
-                {
-                    memcpy (sTransceiveData, eventData->p_data, sTransceiveDataLen = eventData->len);
-                }
-            }
+            /* the response is copied out before the waiting request is woken */
+            TransceiveSlot_complete(status, eventData->p_data, eventData->len);
             if (gJcopDwnldinProgress == false)
                 e->CallVoidMethod (mNativeData->manager, android::gCachedEseManagerListeners, 0);
         }
-#if(NXP_ESE_CHIP_TYPE == P61)
-        SyncEventGuard guard (sTransceiveEvent);
-        sTransceiveEvent.notifyOne();
-#endif
+        else
+        {
+            TransceiveSlot_complete(status, NULL, 0);
+        }
         break;
     }
 
@@ -963,8 +1437,7 @@ static void eseStackCallback (ESESTATUS status, phNxpEse_data* eventData)
     {
         ALOGV ("%s: Status:ESESTATUS_FAILED", __FUNCTION__);
         e->CallVoidMethod (mNativeData->manager, android::gCachedEseManagerListeners, 1);
-        SyncEventGuard guard (sTransceiveEvent);
-        sTransceiveEvent.notifyOne();
+        TransceiveSlot_complete(status, NULL, 0);
         break;
     }
 
@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Shares the eSE between several registered clients, one APDU at a time.
+ * Every client has a FIFO of APDUs, each one sent by the thread that queued
+ * it once the scheduler grants it the eSE. Payment and transit APDUs go
+ * before all the others; the other classes share the eSE in proportion to
+ * their weight (self-clocked fair queuing on the command length). Any
+ * client can be overtaken between two of its APDUs, long running jobs such
+ * as an OS update included.
+ * A logical channel belongs to the last client that used it until it is
+ * closed or left idle for NXP_SPI_SCHED_AFFINITY_MS, the APDUs of other
+ * clients on that channel wait meanwhile.
+ */
+#include <string.h>
+#include <time.h>
+#include <log/log.h>
+#include "SpiApduScheduler.h"
+#include "Mutex.h"
+#include "CondVar.h"
+
+extern "C"
+{
+#include "phNxpConfig.h"
+}
+
+#define NAME_NXP_SPI_SCHED_AFFINITY_MS   "NXP_SPI_SCHED_AFFINITY_MS"
+
+#define APDU_SCHED_DEFAULT_AFFINITY_MS   100
+#define APDU_SCHED_INS_MANAGE_CHANNEL    0x70
+#define APDU_SCHED_RSP_COST              64   /* response and framing, in command bytes */
+#define APDU_SCHED_WEIGHT_SCALE          1024
+#define APDU_SCHED_NO_CLIENT             (-1)
+
+typedef struct apdu_sched_job
+{
+    struct apdu_sched_job* next;
+    CondVar cond;
+    UINT8  channel;
+    UINT64 finish;    /* virtual finish tag */
+    UINT64 queuedAt;
+    bool   granted;
+    bool   cancelled;
+}apduSchedJob_t;
+
+typedef struct apdu_sched_client
+{
+    bool   active;
+    apduSchedClass_t cls;
+    UINT64 lastFinish;
+    apduSchedJob_t* head;
+    apduSchedJob_t* tail;
+}apduSchedClient_t;
+
+typedef struct apdu_sched_binding
+{
+    INT32  owner;
+    UINT64 lastUseUs;
+}apduSchedBinding_t;
+
+static const UINT32 sClassWeight[SCHED_CLASS_MAX] = { 4, 4, 4, 2, 1 };
+static const UINT8 sClassTier[SCHED_CLASS_MAX] = { 0, 0, 1, 1, 1 };
+
+static Mutex sSchedMutex;
+static apduSchedClient_t sClients[APDU_SCHED_MAX_CLIENTS];
+static apduSchedBinding_t sBindings[APDU_SCHED_MAX_CHANNELS];
+static apduSchedStats_t sStats[SCHED_CLASS_MAX];
+static UINT64 sVirtualTime = 0;
+static bool sBusy = false;
+static unsigned long sAffinityMs = APDU_SCHED_DEFAULT_AFFINITY_MS;
+
+/*******************************************************************************
+**
+** Function:        ApduSched_nowUs
+**
+** Description:     Monotonic time
+**
+** Returns:         Time in microseconds.
+**
+*******************************************************************************/
+static UINT64 ApduSched_nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((UINT64)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_channel
+**
+** Description:     Logical channel of a command, from its CLA byte
+**
+** Returns:         Channel number.
+**
+*******************************************************************************/
+static UINT8 ApduSched_channel(UINT8 cla)
+{
+    if(cla & 0x40)
+        return (UINT8)(4 + (cla & 0x0F));
+    return (UINT8)(cla & 0x03);
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_eligible
+**
+** Description:     Checks that the channel of the job is not held by another
+**                  client
+**
+** Returns:         True if the job can be sent.
+**
+*******************************************************************************/
+static bool ApduSched_eligible(INT32 client, const apduSchedJob_t* pJob, UINT64 now)
+{
+    const apduSchedBinding_t* pBinding = &sBindings[pJob->channel];
+
+    return (pBinding->owner == APDU_SCHED_NO_CLIENT) || (pBinding->owner == client) ||
+           ((now - pBinding->lastUseUs) >= ((UINT64)sAffinityMs * 1000));
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_dispatchLocked
+**
+** Description:     Grants the eSE, if idle, to the first queued job of the
+**                  highest tier with the smallest finish tag
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void ApduSched_dispatchLocked()
+{
+    apduSchedClient_t* pClient;
+    apduSchedJob_t* pJob;
+    UINT64 now, waitUs;
+    INT32 best = APDU_SCHED_NO_CLIENT;
+    INT32 i;
+
+    if(sBusy)
+        return;
+    now = ApduSched_nowUs();
+    for(i = 0; i < APDU_SCHED_MAX_CLIENTS; i++)
+    {
+        pClient = &sClients[i];
+        if(!pClient->active || (pClient->head == NULL) || !ApduSched_eligible(i, pClient->head, now))
+            continue;
+        if((best == APDU_SCHED_NO_CLIENT) ||
+           (sClassTier[pClient->cls] < sClassTier[sClients[best].cls]) ||
+           ((sClassTier[pClient->cls] == sClassTier[sClients[best].cls]) &&
+            (pClient->head->finish < sClients[best].head->finish)))
+        {
+            best = i;
+        }
+    }
+    if(best == APDU_SCHED_NO_CLIENT)
+        return;
+    pClient = &sClients[best];
+    pJob = pClient->head;
+    pClient->head = pJob->next;
+    if(pClient->head == NULL)
+        pClient->tail = NULL;
+    pJob->next = NULL;
+    /* the virtual time follows the job in service */
+    sVirtualTime = pJob->finish;
+    sBindings[pJob->channel].owner = best;
+    sBindings[pJob->channel].lastUseUs = now;
+
+    waitUs = now - pJob->queuedAt;
+    sStats[pClient->cls].jobs++;
+    sStats[pClient->cls].totalWaitUs += waitUs;
+    if(waitUs > sStats[pClient->cls].maxWaitUs)
+        sStats[pClient->cls].maxWaitUs = waitUs;
+    sStats[pClient->cls].queued--;
+
+    sBusy = true;
+    pJob->granted = true;
+    pJob->cond.notifyOne();
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_unqueueLocked
+**
+** Description:     Takes a job that was not granted out of its client FIFO
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void ApduSched_unqueueLocked(apduSchedClient_t* pClient, apduSchedJob_t* pJob)
+{
+    apduSchedJob_t** ppJob = &pClient->head;
+    apduSchedJob_t* pPrev = NULL;
+
+    while((*ppJob != NULL) && (*ppJob != pJob))
+    {
+        pPrev = *ppJob;
+        ppJob = &(*ppJob)->next;
+    }
+    if(*ppJob == NULL)
+        return;
+    *ppJob = pJob->next;
+    if(pClient->tail == pJob)
+        pClient->tail = pPrev;
+    sStats[pClient->cls].queued--;
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_init
+**
+** Description:     Forgets all the clients and reads the configuration
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ApduSched_init()
+{
+    AutoMutex lock(sSchedMutex);
+    unsigned long num = 0;
+    INT32 i;
+
+    memset(sClients, 0x00, sizeof(sClients));
+    memset(sStats, 0x00, sizeof(sStats));
+    for(i = 0; i < APDU_SCHED_MAX_CHANNELS; i++)
+    {
+        sBindings[i].owner = APDU_SCHED_NO_CLIENT;
+        sBindings[i].lastUseUs = 0;
+    }
+    sVirtualTime = 0;
+    sBusy = false;
+    sAffinityMs = APDU_SCHED_DEFAULT_AFFINITY_MS;
+    if(GetNxpNumValue(NAME_NXP_SPI_SCHED_AFFINITY_MS, &num, sizeof(num)))
+        sAffinityMs = num;
+    ALOGV("%s: channel affinity %lu ms", __FUNCTION__, sAffinityMs);
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_resetChannels
+**
+** Description:     Forgets the channel owners, to be called once the eSE
+**                  has closed its logical channels
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ApduSched_resetChannels()
+{
+    AutoMutex lock(sSchedMutex);
+    INT32 i;
+
+    for(i = 0; i < APDU_SCHED_MAX_CHANNELS; i++)
+        sBindings[i].owner = APDU_SCHED_NO_CLIENT;
+    ApduSched_dispatchLocked();
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_register
+**
+** Description:     Adds a client of the given class
+**
+** Returns:         Client id, -1 if all are taken.
+**
+*******************************************************************************/
+INT32 ApduSched_register(apduSchedClass_t cls)
+{
+    AutoMutex lock(sSchedMutex);
+    INT32 i;
+
+    if((cls < SCHED_CLASS_PAYMENT) || (cls >= SCHED_CLASS_MAX))
+        return APDU_SCHED_NO_CLIENT;
+    for(i = 0; i < APDU_SCHED_MAX_CLIENTS; i++)
+    {
+        if(!sClients[i].active)
+        {
+            memset(&sClients[i], 0x00, sizeof(sClients[i]));
+            sClients[i].active = true;
+            sClients[i].cls = cls;
+            /* a new client starts at the current virtual time, not before */
+            sClients[i].lastFinish = sVirtualTime;
+            ALOGV("%s: client %d class %d", __FUNCTION__, i, cls);
+            return i;
+        }
+    }
+    ALOGE("%s: too many clients", __FUNCTION__);
+    return APDU_SCHED_NO_CLIENT;
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_unregister
+**
+** Description:     Removes the client, its queued APDUs fail and its logical
+**                  channels are free for the others
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ApduSched_unregister(INT32 client)
+{
+    AutoMutex lock(sSchedMutex);
+    apduSchedClient_t* pClient;
+    apduSchedJob_t* pJob;
+    INT32 i;
+
+    if((client < 0) || (client >= APDU_SCHED_MAX_CLIENTS) || !sClients[client].active)
+        return;
+    pClient = &sClients[client];
+    while((pJob = pClient->head) != NULL)
+    {
+        pClient->head = pJob->next;
+        pJob->next = NULL;
+        pJob->cancelled = true;
+        sStats[pClient->cls].queued--;
+        pJob->cond.notifyOne();
+    }
+    pClient->tail = NULL;
+    pClient->active = false;
+    for(i = 0; i < APDU_SCHED_MAX_CHANNELS; i++)
+    {
+        if(sBindings[i].owner == client)
+            sBindings[i].owner = APDU_SCHED_NO_CLIENT;
+    }
+    ApduSched_dispatchLocked();
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_transceive
+**
+** Description:     Queues the command, waits for the eSE to be granted and
+**                  sends it. timeoutMillisec bounds the time spent queued,
+**                  0 waits as long as needed.
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool ApduSched_transceive(INT32 client, UINT8* xmitBuffer, INT32 xmitBufferSize,
+                          UINT8* recvBuffer, INT32 recvBufferMaxSize,
+                          INT32& recvBufferActualSize, INT32 timeoutMillisec)
+{
+    apduSchedClient_t* pClient;
+    apduSchedJob_t job;
+    UINT64 start, deadline = 0, now;
+    long waitMs;
+    bool stat;
+
+    recvBufferActualSize = 0;
+    if((client < 0) || (client >= APDU_SCHED_MAX_CLIENTS) || (xmitBuffer == NULL) ||
+       (xmitBufferSize < 4))
+        return false;
+
+    sSchedMutex.lock();
+    pClient = &sClients[client];
+    if(!pClient->active)
+    {
+        sSchedMutex.unlock();
+        return false;
+    }
+    job.next = NULL;
+    job.channel = ApduSched_channel(xmitBuffer[0]);
+    job.granted = false;
+    job.cancelled = false;
+    job.queuedAt = start = ApduSched_nowUs();
+    if(timeoutMillisec > 0)
+        deadline = start + ((UINT64)timeoutMillisec * 1000);
+    if(pClient->lastFinish < sVirtualTime)
+        pClient->lastFinish = sVirtualTime;
+    job.finish = pClient->lastFinish +
+        (((UINT64)(xmitBufferSize + APDU_SCHED_RSP_COST) * APDU_SCHED_WEIGHT_SCALE) /
+         sClassWeight[pClient->cls]);
+    pClient->lastFinish = job.finish;
+    if(pClient->tail != NULL)
+        pClient->tail->next = &job;
+    else
+        pClient->head = &job;
+    pClient->tail = &job;
+    sStats[pClient->cls].queued++;
+
+    ApduSched_dispatchLocked();
+    while(!job.granted && !job.cancelled)
+    {
+        /* woken when granted, or to look again once a channel owner may
+         * have gone idle */
+        waitMs = (long)sAffinityMs + 1;
+        if(deadline != 0)
+        {
+            now = ApduSched_nowUs();
+            if(now >= deadline)
+            {
+                ALOGE("%s: client %d timed out in queue", __FUNCTION__, client);
+                ApduSched_unqueueLocked(pClient, &job);
+                sSchedMutex.unlock();
+                return false;
+            }
+            if((long)((deadline - now + 999) / 1000) < waitMs)
+                waitMs = (long)((deadline - now + 999) / 1000);
+        }
+        job.cond.wait(sSchedMutex, waitMs);
+        ApduSched_dispatchLocked();
+    }
+    sSchedMutex.unlock();
+    if(job.cancelled)
+        return false;
+
+    stat = transceive(xmitBuffer, xmitBufferSize, recvBuffer, recvBufferMaxSize,
+                      recvBufferActualSize, 0);
+
+    sSchedMutex.lock();
+    sBindings[job.channel].lastUseUs = ApduSched_nowUs();
+    if(stat && (xmitBuffer[1] == APDU_SCHED_INS_MANAGE_CHANNEL) && (xmitBuffer[2] == 0x80))
+    {
+        /* channel closed, P2 names it unless it is the one of the CLA byte */
+        UINT8 closed = (xmitBuffer[3] != 0) ? xmitBuffer[3] : job.channel;
+        if(closed < APDU_SCHED_MAX_CHANNELS)
+            sBindings[closed].owner = APDU_SCHED_NO_CLIENT;
+    }
+    sBusy = false;
+    ApduSched_dispatchLocked();
+    sSchedMutex.unlock();
+    return stat;
+}
+
+/*******************************************************************************
+**
+** Function:        ApduSched_getStats
+**
+** Description:     Copies the queueing statistics of every class
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ApduSched_getStats(apduSchedStats_t stats[SCHED_CLASS_MAX])
+{
+    AutoMutex lock(sSchedMutex);
+    memcpy(stats, sStats, sizeof(sStats));
+}
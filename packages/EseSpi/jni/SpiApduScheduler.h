@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPIAPDUSCHEDULER_H_
+#define SPIAPDUSCHEDULER_H_
+
+#include "SpiChannel.h"
+
+#define APDU_SCHED_MAX_CLIENTS   8
+#define APDU_SCHED_MAX_CHANNELS  20
+#define APDU_SCHED_MAX_RSP_LEN   (65536 + 2)
+
+/* Values are shared with NativeEseManager.SCHED_CLASS_* */
+typedef enum apdu_sched_class
+{
+    SCHED_CLASS_PAYMENT = 0x00,  /* served before the classes below */
+    SCHED_CLASS_TRANSIT,
+    SCHED_CLASS_DEFAULT,         /* shares the eSE by weight with the ones below */
+    SCHED_CLASS_SYNC,
+    SCHED_CLASS_OSU,
+    SCHED_CLASS_MAX
+}apduSchedClass_t;
+
+/* Queueing delay of the APDUs of one class */
+typedef struct apdu_sched_stats
+{
+    UINT64 jobs;
+    UINT64 totalWaitUs;
+    UINT64 maxWaitUs;
+    UINT64 queued;
+}apduSchedStats_t;
+
+void ApduSched_init();
+void ApduSched_resetChannels();
+INT32 ApduSched_register(apduSchedClass_t cls);
+void ApduSched_unregister(INT32 client);
+bool ApduSched_transceive(INT32 client, UINT8* xmitBuffer, INT32 xmitBufferSize,
+                          UINT8* recvBuffer, INT32 recvBufferMaxSize,
+                          INT32& recvBufferActualSize, INT32 timeoutMillisec);
+void ApduSched_getStats(apduSchedStats_t stats[SCHED_CLASS_MAX]);
+
+#endif /* SPIAPDUSCHEDULER_H_ */
@@ -17,6 +17,7 @@
 #include "SpiChannel.h"
 #include <log/log.h>
 #include "SyncEvent.h"
+#include "SpiTransceiveSlot.h"
 
 extern "C"
 {
@@ -34,12 +35,11 @@ extern "C"
 
 namespace android
 {
-   extern SyncEvent     sTransceiveEvent;  // event for Set_Config....
-   extern uint8_t*      sTransceiveData;
-   extern uint32_t      sTransceiveDataLen;
    extern BOOLEAN       isIntialized();
 #if(NXP_ESE_CHIP_TYPE == P61)
    extern void          eseStackCB(ESESTATUS status, phNxpEseP61_data *eventData);
+   extern ESESTATUS     eseTransceive(uint16_t data_len, const uint8_t *p_data);
+   extern ESESTATUS     eseClose();
 #elif(NXP_ESE_CHIP_TYPE == P73)
    extern void          eseStackCB(ESESTATUS status, phNxpEse_data *eventData);
 #endif
@@ -47,6 +47,42 @@ namespace android
 bool spiChannelForceClose = false;
 INT16 mHandle = DEFAULT;
 
+#if(NXP_ESE_CHIP_TYPE == P61)
+/*******************************************************************************
+**
+** Function:        channelTransceive
+**
+** Description:     Sends an APDU of the channel. The channel of the JNI session
+**                  follows it into a priority session, the other clients keep
+**                  their normal session.
+**
+** Returns:         ESESTATUS_SUCCESS if ok.
+**
+*******************************************************************************/
+static ESESTATUS channelTransceive(UINT16 dataLen, const UINT8* pData)
+{
+    if(mHandle == SPI_SRVCE)
+        return android::eseTransceive(dataLen, pData);
+    return phNxpEseP61_Transceive(dataLen, pData);
+}
+
+/*******************************************************************************
+**
+** Function:        channelClose
+**
+** Description:     Closes the session of the channel, see channelTransceive
+**
+** Returns:         ESESTATUS_SUCCESS if ok.
+**
+*******************************************************************************/
+static ESESTATUS channelClose()
+{
+    if(mHandle == SPI_SRVCE)
+        return android::eseClose();
+    return phNxpEseP61_close();
+}
+#endif
+
 /*******************************************************************************
 **
 ** Function:        open
@@ -127,7 +163,7 @@ bool close(INT16 clientType)
 #endif
         {
     #if(NXP_ESE_CHIP_TYPE == P61)
-            phNxpEseP61_close();
+            channelClose();
     #elif(NXP_ESE_CHIP_TYPE == P73)
             phNxpEse_close();
     #endif
@@ -171,22 +207,25 @@ bool transceive (UINT8* xmitBuffer, INT32 xmitBufferSize, UINT8* recvBuffer,
     pCmd.len = xmitBufferSize;
 #endif
 
-    SyncEventGuard guard (android::sTransceiveEvent);
 #if(NXP_ESE_CHIP_TYPE == P61)
-    status = phNxpEseP61_Transceive(xmitBufferSize, xmitBuffer);
+    transceiveSlot_t* pSlot = TransceiveSlot_acquire();
+    if(pSlot == NULL)
+        return stat;
+    status = channelTransceive(xmitBufferSize, xmitBuffer);
     if (status == ESESTATUS_SUCCESS)
-        android::sTransceiveEvent.wait ();
+        TransceiveSlot_wait(pSlot);
      else
          ALOGE ("%s: phNxpEseP61_Transceive Failed", __FUNCTION__);
 
-    recvBufferActualSize = android::sTransceiveDataLen;
+    recvBufferActualSize = (status == ESESTATUS_SUCCESS) ? pSlot->rspLen : 0;
 
-    if(recvBufferActualSize > 0)
+    if((recvBufferActualSize > 0) && (recvBufferActualSize <= recvBufferMaxSize))
     {
-        ALOGV("%s: recvBuffLen=0x0%x", fn, android::sTransceiveDataLen);
-        memcpy (recvBuffer, android::sTransceiveData, recvBufferActualSize);
+        ALOGV("%s: recvBuffLen=0x0%x", fn, recvBufferActualSize);
+        memcpy (recvBuffer, pSlot->rsp, recvBufferActualSize);
         stat = true;
     }
+    TransceiveSlot_release(pSlot);
 #elif(NXP_ESE_CHIP_TYPE == P73)
     status = phNxpEse_Transceive(&pCmd, &pRsp);
     if (status == ESESTATUS_SUCCESS)
@@ -196,7 +235,7 @@ bool transceive (UINT8* xmitBuffer, INT32 xmitBufferSize, UINT8* recvBuffer,
 
     recvBufferActualSize = pRsp.len;
 
-    if(recvBufferActualSize > 0)
+    if((recvBufferActualSize > 0) && (recvBufferActualSize <= recvBufferMaxSize))
     {
         ALOGV("%s: recvBuffLen=0x0%x", fn, recvBufferActualSize);
         memcpy (recvBuffer, pRsp.p_data, recvBufferActualSize);
@@ -214,6 +253,93 @@ bool transceive (UINT8* xmitBuffer, INT32 xmitBufferSize, UINT8* recvBuffer,
     return stat;
 }
 
+#if(NXP_ESE_CHIP_TYPE == P73)
+/* Largest response of a batched command, extended Le and status word */
+#define SPI_BATCH_MAX_RSP_LEN   (65536 + 2)
+
+static UINT8 sBatchRsp[SPI_BATCH_MAX_RSP_LEN];
+
+/*******************************************************************************
+**
+** Function:        batchRspSink
+**
+** Description:     Gathers the response of a batched command in sBatchRsp,
+**                  pContext being its length so far
+**
+** Returns:         ESESTATUS_SUCCESS, ESESTATUS_FAILED if it does not fit.
+**
+*******************************************************************************/
+static ESESTATUS batchRspSink(void* pContext, const uint8_t* pData, uint32_t len, bool_t last)
+{
+    INT32* pLen = (INT32*)pContext;
+    (void)last;
+
+    if((*pLen + len) > sizeof(sBatchRsp))
+        return ESESTATUS_FAILED;
+    memcpy(&sBatchRsp[*pLen], pData, len);
+    *pLen += len;
+    return ESESTATUS_SUCCESS;
+}
+#endif
+
+/*******************************************************************************
+**
+** Function:        transceiveBatch
+**
+** Description:     Sends count commands back to back, each answer handed to
+**                  pRspCb without being copied out nor allocated, and stops
+**                  at the first one not answering its status word
+**
+** Returns:         Number of commands that answered their status word.
+**
+*******************************************************************************/
+INT32 transceiveBatch(const spiBatchApdu_t* pApdus, INT32 count, spiBatchRspCb_t pRspCb,
+                      void* pContext)
+{
+    ESESTATUS status;
+    const UINT8* rsp;
+    INT32 rspLen;
+    INT32 done;
+    UINT16 sw;
+
+    if(spiChannelForceClose == true)
+        return 0;
+    for(done = 0; done < count; done++)
+    {
+        const spiBatchApdu_t* pApdu = &pApdus[done];
+#if(NXP_ESE_CHIP_TYPE == P61)
+        transceiveSlot_t* pSlot = TransceiveSlot_acquire();
+        if(pSlot == NULL)
+            break;
+        status = channelTransceive(pApdu->cmdLen, pApdu->cmd);
+        if(status == ESESTATUS_SUCCESS)
+            TransceiveSlot_wait(pSlot);
+        rsp = pSlot->rsp;
+        rspLen = (status == ESESTATUS_SUCCESS) ? pSlot->rspLen : 0;
+#elif(NXP_ESE_CHIP_TYPE == P73)
+        phNxpEse_data cmd;
+        cmd.len = pApdu->cmdLen;
+        cmd.p_data = pApdu->cmd;
+        rspLen = 0;
+        status = phNxpEse_TransceiveStream(&cmd, batchRspSink, &rspLen);
+        rsp = sBatchRsp;
+#endif
+        sw = (rspLen >= 2) ? (UINT16)((rsp[rspLen - 2] << 8) | rsp[rspLen - 1]) : 0;
+        if((rspLen > 0) && (pRspCb != NULL))
+            pRspCb(pContext, done, rsp, rspLen);
+#if(NXP_ESE_CHIP_TYPE == P61)
+        TransceiveSlot_release(pSlot);
+#endif
+        if((status != ESESTATUS_SUCCESS) || (rspLen < 2) ||
+                ((sw & pApdu->swMask) != (pApdu->sw & pApdu->swMask)))
+        {
+            ALOGE("%s: command %d of %d answered %04X", __FUNCTION__, done, count, sw);
+            break;
+        }
+    }
+    return done;
+}
+
 /*******************************************************************************
 **
 ** Function:        doeSE_Reset
@@ -44,6 +44,21 @@ bool close(INT16 mHandle);
 bool transceive (UINT8* xmitBuffer, INT32 xmitBufferSize, UINT8* recvBuffer,
                  INT32 recvBufferMaxSize, INT32& recvBufferActualSize, INT32 timeoutMillisec);
 
+/* One command of transceiveBatch, with the status word it has to answer */
+typedef struct spi_batch_apdu
+{
+    UINT8* cmd;
+    INT32  cmdLen;
+    UINT16 sw;
+    UINT16 swMask;   /* bits of sw compared */
+}spiBatchApdu_t;
+
+/* Response of the command index of the batch, valid for the call only */
+typedef void (*spiBatchRspCb_t)(void* pContext, INT32 index, const UINT8* rsp, INT32 rspLen);
+
+INT32 transceiveBatch(const spiBatchApdu_t* pApdus, INT32 count, spiBatchRspCb_t pRspCb,
+                      void* pContext);
+
 void doeSE_Reset();
 #if(NXP_ESE_CHIP_TYPE == P73)
 void doeSE_JcopDownLoadReset();
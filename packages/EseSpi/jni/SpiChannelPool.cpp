@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Logical channels kept open, with their applet selected, between the
+ * clients of the SPI session. A client leases a channel for an AID instead
+ * of opening one with MANAGE CHANNEL and selecting the applet, and gives it
+ * back instead of closing it. The channels only live as long as the eSE is
+ * not reset or powered down, see ChannelPool_reset.
+ */
+#include <string.h>
+#include <log/log.h>
+#include "SpiChannelPool.h"
+#include "Mutex.h"
+
+extern "C"
+{
+#include "phNxpConfig.h"
+}
+
+#define NAME_NXP_SPI_CHANNEL_POOL_SIZE   "NXP_SPI_CHANNEL_POOL_SIZE"
+#define NAME_NXP_SPI_CHANNEL_POOL_RESET  "NXP_SPI_CHANNEL_POOL_RESET"
+
+#define CHANNEL_POOL_INS_SELECT          0xA4
+#define CHANNEL_POOL_INS_MANAGE_CHANNEL  0x70
+#define CHANNEL_POOL_TIMEOUT             0
+
+typedef struct channel_pool_entry
+{
+    bool  open;
+    bool  leased;
+    bool  dirty;  /* leased since the applet was selected */
+    UINT8 aidLen;
+    UINT8 aid[CHANNEL_POOL_MAX_AID_LEN];
+    INT32 rspLen;
+    UINT8 rsp[CHANNEL_POOL_MAX_RSP_LEN];
+}channelPoolEntry_t;
+
+static Mutex sPoolMutex;
+static channelPoolEntry_t sPool[CHANNEL_POOL_MAX_CHANNELS + 1];
+static unsigned long sPoolSize = 0;
+static channelPoolReset_t sPoolReset = POOL_RESET_RESELECT;
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_cla
+**
+** Description:     CLA byte of the interindustry commands on the channel
+**
+** Returns:         CLA byte.
+**
+*******************************************************************************/
+static UINT8 ChannelPool_cla(INT16 channel)
+{
+    if(channel < 4)
+        return (UINT8)channel;
+    return (UINT8)(0x40 | (channel - 4));
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_select
+**
+** Description:     Selects the applet on the channel and keeps the response
+**
+** Returns:         True if the applet answered 9000.
+**
+*******************************************************************************/
+static bool ChannelPool_select(INT16 channel, const UINT8* aid, INT32 aidLen)
+{
+    channelPoolEntry_t* pEntry = &sPool[channel];
+    UINT8 cmd[5 + CHANNEL_POOL_MAX_AID_LEN + 1];
+    INT32 cmdLen = 0;
+
+    cmd[cmdLen++] = ChannelPool_cla(channel);
+    cmd[cmdLen++] = CHANNEL_POOL_INS_SELECT;
+    cmd[cmdLen++] = 0x04;
+    cmd[cmdLen++] = 0x00;
+    cmd[cmdLen++] = (UINT8)aidLen;
+    memcpy(&cmd[cmdLen], aid, aidLen);
+    cmdLen += aidLen;
+    cmd[cmdLen++] = 0x00;
+
+    pEntry->aidLen = 0;
+    pEntry->rspLen = 0;
+    if(!transceive(cmd, cmdLen, pEntry->rsp, sizeof(pEntry->rsp), pEntry->rspLen,
+            CHANNEL_POOL_TIMEOUT) || (pEntry->rspLen < 2))
+    {
+        ALOGE("%s: SELECT on channel %d failed", __FUNCTION__, channel);
+        pEntry->rspLen = 0;
+        return false;
+    }
+    pEntry->dirty = false;
+    if((pEntry->rsp[pEntry->rspLen - 2] != 0x90) || (pEntry->rsp[pEntry->rspLen - 1] != 0x00))
+    {
+        ALOGE("%s: SELECT on channel %d returned %02X%02X", __FUNCTION__, channel,
+                pEntry->rsp[pEntry->rspLen - 2], pEntry->rsp[pEntry->rspLen - 1]);
+        return false;
+    }
+    memcpy(pEntry->aid, aid, aidLen);
+    pEntry->aidLen = (UINT8)aidLen;
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_openChannel
+**
+** Description:     Opens a logical channel with MANAGE CHANNEL
+**
+** Returns:         Channel number, 0 if none could be opened.
+**
+*******************************************************************************/
+static INT16 ChannelPool_openChannel()
+{
+    UINT8 cmd[] = {0x00, CHANNEL_POOL_INS_MANAGE_CHANNEL, 0x00, 0x00, 0x01};
+    UINT8 rsp[3];
+    INT32 rspLen = 0;
+
+    if(!transceive(cmd, sizeof(cmd), rsp, sizeof(rsp), rspLen, CHANNEL_POOL_TIMEOUT) ||
+            (rspLen != 3) || (rsp[1] != 0x90) || (rsp[2] != 0x00) ||
+            (rsp[0] == 0) || (rsp[0] > CHANNEL_POOL_MAX_CHANNELS))
+    {
+        ALOGE("%s: MANAGE CHANNEL open failed", __FUNCTION__);
+        return 0;
+    }
+    memset(&sPool[rsp[0]], 0x00, sizeof(sPool[rsp[0]]));
+    sPool[rsp[0]].open = true;
+    return rsp[0];
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_closeChannel
+**
+** Description:     Closes the logical channel with MANAGE CHANNEL
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void ChannelPool_closeChannel(INT16 channel)
+{
+    UINT8 cmd[] = {ChannelPool_cla(channel), CHANNEL_POOL_INS_MANAGE_CHANNEL, 0x80, (UINT8)channel};
+    UINT8 rsp[2];
+    INT32 rspLen = 0;
+
+    if(!transceive(cmd, sizeof(cmd), rsp, sizeof(rsp), rspLen, CHANNEL_POOL_TIMEOUT))
+    {
+        ALOGE("%s: MANAGE CHANNEL close of %d failed", __FUNCTION__, channel);
+    }
+    memset(&sPool[channel], 0x00, sizeof(sPool[channel]));
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_init
+**
+** Description:     Reads the pool size and reset policy from the config file
+**                  and forgets the channels
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ChannelPool_init()
+{
+    unsigned long num = 0;
+    AutoMutex lock(sPoolMutex);
+
+    if(!GetNxpNumValue(NAME_NXP_SPI_CHANNEL_POOL_SIZE, &num, sizeof(num)))
+        num = 0;
+    sPoolSize = (num > CHANNEL_POOL_MAX_CHANNELS) ? CHANNEL_POOL_MAX_CHANNELS : num;
+    if(GetNxpNumValue(NAME_NXP_SPI_CHANNEL_POOL_RESET, &num, sizeof(num)) &&
+            (num <= POOL_RESET_CLOSE))
+        sPoolReset = (channelPoolReset_t)num;
+    memset(sPool, 0x00, sizeof(sPool));
+    ALOGV("%s: size %lu reset %d", __FUNCTION__, sPoolSize, sPoolReset);
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_reset
+**
+** Description:     Forgets the channels, to be called when the eSE closes
+**                  them: reset, power down, end of the SPI session or JCOP
+**                  download
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void ChannelPool_reset()
+{
+    AutoMutex lock(sPoolMutex);
+    memset(sPool, 0x00, sizeof(sPool));
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_lease
+**
+** Description:     Leases a channel with the applet selected. An idle channel
+**                  with the applet already selected is preferred, then an
+**                  idle channel on which the applet is selected, then a
+**                  newly opened channel.
+**
+** Returns:         Channel number, EE_ERROR_OPEN_FAIL if the applet could not
+**                  be selected. selectRsp holds the SELECT response.
+**
+*******************************************************************************/
+INT16 ChannelPool_lease(const UINT8* aid, INT32 aidLen, UINT8* selectRsp,
+                        INT32 selectRspMaxSize, INT32& selectRspActualSize)
+{
+    static const char fn [] = "ChannelPool_lease";
+    AutoMutex lock(sPoolMutex);
+    INT16 channel = 0;
+    INT16 idle = 0;
+    bool selected = false;
+    INT16 i;
+
+    selectRspActualSize = 0;
+    if((aid == NULL) || (aidLen <= 0) || (aidLen > CHANNEL_POOL_MAX_AID_LEN))
+        return EE_ERROR_OPEN_FAIL;
+    for(i = 1; i <= CHANNEL_POOL_MAX_CHANNELS; i++)
+    {
+        if(!sPool[i].open || sPool[i].leased)
+            continue;
+        if((sPool[i].aidLen == aidLen) && !memcmp(sPool[i].aid, aid, aidLen))
+        {
+            channel = i;
+            break;
+        }
+        if(idle == 0)
+            idle = i;
+    }
+    if(channel != 0)
+    {
+        ALOGV("%s: channel %d reused", fn, channel);
+        if(sPool[channel].dirty && (sPoolReset == POOL_RESET_RESELECT))
+            selected = ChannelPool_select(channel, aid, aidLen);
+        else
+            selected = true;
+    }
+    else if(idle != 0)
+    {
+        ALOGV("%s: channel %d reselected", fn, idle);
+        channel = idle;
+        selected = ChannelPool_select(channel, aid, aidLen);
+    }
+    else
+    {
+        channel = ChannelPool_openChannel();
+        if(channel == 0)
+            return EE_ERROR_OPEN_FAIL;
+        selected = ChannelPool_select(channel, aid, aidLen);
+    }
+    /* the SELECT response is returned even when it is an error */
+    if(sPool[channel].rspLen <= selectRspMaxSize)
+    {
+        memcpy(selectRsp, sPool[channel].rsp, sPool[channel].rspLen);
+        selectRspActualSize = sPool[channel].rspLen;
+    }
+    if(!selected)
+    {
+        /* a channel left without applet is not kept */
+        ChannelPool_closeChannel(channel);
+        return EE_ERROR_OPEN_FAIL;
+    }
+    sPool[channel].leased = true;
+    sPool[channel].dirty = true;
+    return channel;
+}
+
+/*******************************************************************************
+**
+** Function:        ChannelPool_release
+**
+** Description:     Gives the channel back. It is kept open while the pool
+**                  holds less than NXP_SPI_CHANNEL_POOL_SIZE idle channels,
+**                  otherwise it is closed.
+**
+** Returns:         True if the channel was leased.
+**
+*******************************************************************************/
+bool ChannelPool_release(INT16 channel)
+{
+    AutoMutex lock(sPoolMutex);
+    unsigned long idleCount = 0;
+    INT16 i;
+
+    if((channel <= 0) || (channel > CHANNEL_POOL_MAX_CHANNELS) || !sPool[channel].leased)
+        return false;
+    sPool[channel].leased = false;
+    for(i = 1; i <= CHANNEL_POOL_MAX_CHANNELS; i++)
+    {
+        if((i != channel) && sPool[i].open && !sPool[i].leased)
+            idleCount++;
+    }
+    if((sPoolReset == POOL_RESET_CLOSE) || (idleCount >= sPoolSize))
+    {
+        ChannelPool_closeChannel(channel);
+    }
+    return true;
+}
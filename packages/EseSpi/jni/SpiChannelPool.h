@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPICHANNELPOOL_H_
+#define SPICHANNELPOOL_H_
+
+#include "SpiChannel.h"
+
+/* Logical channels 1 to 19, the basic channel is never pooled */
+#define CHANNEL_POOL_MAX_CHANNELS   19
+#define CHANNEL_POOL_MAX_AID_LEN    16
+#define CHANNEL_POOL_MAX_RSP_LEN    258
+
+/* What is done to a released channel before it is leased again */
+typedef enum channel_pool_reset
+{
+    POOL_RESET_NONE = 0x00,  /* leased as left by the previous client */
+    POOL_RESET_RESELECT,     /* applet selected again on the next lease */
+    POOL_RESET_CLOSE         /* closed on release, channels are not kept */
+}channelPoolReset_t;
+
+void ChannelPool_init();
+void ChannelPool_reset();
+INT16 ChannelPool_lease(const UINT8* aid, INT32 aidLen, UINT8* selectRsp,
+                        INT32 selectRspMaxSize, INT32& selectRspActualSize);
+bool ChannelPool_release(INT16 channel);
+
+#endif /* SPICHANNELPOOL_H_ */
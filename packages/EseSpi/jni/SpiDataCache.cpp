@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Answers of the Loader Service queries that only change when the content
+ * of the eSE changes. Every entry carries the generation it was read in;
+ * the generation is bumped by LS script execution, JCOP download and eSE
+ * reset, which invalidates all entries at once. With NXP_SPI_DATA_CACHE_FILE
+ * set, the cache is kept in that file across restarts of the service.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <log/log.h>
+#include "SpiDataCache.h"
+#include "Mutex.h"
+
+extern "C"
+{
+#include "phNxpConfig.h"
+}
+
+#define NAME_NXP_SPI_DATA_CACHE_FILE  "NXP_SPI_DATA_CACHE_FILE"
+
+#define DATA_CACHE_FILE_MAGIC    0x45534443 /* "ESDC" */
+#define DATA_CACHE_FILE_VERSION  1
+#define DATA_CACHE_MAX_PATH      256
+
+typedef struct data_cache_entry
+{
+    UINT32 generation;
+    UINT16 len;
+    UINT8  valid;
+    UINT8  data[DATA_CACHE_MAX_LEN];
+}dataCacheEntry_t;
+
+typedef struct data_cache_file
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT32 generation;
+    dataCacheEntry_t entries[DATA_CACHE_KEY_COUNT];
+}dataCacheFile_t;
+
+static Mutex sCacheMutex;
+static dataCacheFile_t sCache;
+static char sCachePath[DATA_CACHE_MAX_PATH];
+
+/*******************************************************************************
+**
+** Function:        DataCache_save
+**
+** Description:     Writes the cache to NXP_SPI_DATA_CACHE_FILE, through a
+**                  temporary file so that a crash never leaves half of it
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void DataCache_save()
+{
+    char tmpPath[DATA_CACHE_MAX_PATH + 4];
+    FILE* fp;
+    bool stat = false;
+
+    if(sCachePath[0] == '\0')
+        return;
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", sCachePath);
+    fp = fopen(tmpPath, "wb");
+    if(fp == NULL)
+    {
+        ALOGE("%s: cannot create %s", __FUNCTION__, tmpPath);
+        return;
+    }
+    stat = (fwrite(&sCache, sizeof(sCache), 1, fp) == 1);
+    if(fclose(fp) != 0)
+        stat = false;
+    if(!stat || (rename(tmpPath, sCachePath) != 0))
+    {
+        ALOGE("%s: cannot write %s", __FUNCTION__, sCachePath);
+        remove(tmpPath);
+    }
+}
+
+/*******************************************************************************
+**
+** Function:        DataCache_init
+**
+** Description:     Empties the cache, then loads NXP_SPI_DATA_CACHE_FILE when
+**                  it is configured and was written by this version
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void DataCache_init()
+{
+    AutoMutex lock(sCacheMutex);
+    FILE* fp;
+
+    memset(&sCache, 0x00, sizeof(sCache));
+    sCache.magic = DATA_CACHE_FILE_MAGIC;
+    sCache.version = DATA_CACHE_FILE_VERSION;
+    memset(sCachePath, 0x00, sizeof(sCachePath));
+    if(!GetNxpStrValue(NAME_NXP_SPI_DATA_CACHE_FILE, sCachePath, sizeof(sCachePath)))
+    {
+        sCachePath[0] = '\0';
+        return;
+    }
+    fp = fopen(sCachePath, "rb");
+    if(fp == NULL)
+        return;
+    if((fread(&sCache, sizeof(sCache), 1, fp) != 1) ||
+            (sCache.magic != DATA_CACHE_FILE_MAGIC) || (sCache.version != DATA_CACHE_FILE_VERSION))
+    {
+        ALOGE("%s: %s ignored", __FUNCTION__, sCachePath);
+        memset(&sCache, 0x00, sizeof(sCache));
+        sCache.magic = DATA_CACHE_FILE_MAGIC;
+        sCache.version = DATA_CACHE_FILE_VERSION;
+    }
+    fclose(fp);
+    ALOGV("%s: generation %u loaded", __FUNCTION__, sCache.generation);
+}
+
+/*******************************************************************************
+**
+** Function:        DataCache_get
+**
+** Description:     Copies the answer kept for the query, if it was read in
+**                  the current generation
+**
+** Returns:         True if found.
+**
+*******************************************************************************/
+bool DataCache_get(dataCacheKey_t key, UINT8* buffer, INT32 bufferMaxSize, INT32& bufferActualSize)
+{
+    AutoMutex lock(sCacheMutex);
+    dataCacheEntry_t* pEntry;
+
+    if(key >= DATA_CACHE_KEY_COUNT)
+        return false;
+    pEntry = &sCache.entries[key];
+    if(!pEntry->valid || (pEntry->generation != sCache.generation) ||
+            (pEntry->len > bufferMaxSize))
+        return false;
+    memcpy(buffer, pEntry->data, pEntry->len);
+    bufferActualSize = pEntry->len;
+    ALOGV("%s: key %d from the cache", __FUNCTION__, key);
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        DataCache_put
+**
+** Description:     Keeps the answer of the query. generation is the one read
+**                  with DataCache_getGeneration before the query was sent,
+**                  an answer that raced with an invalidation is dropped.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void DataCache_put(dataCacheKey_t key, const UINT8* buffer, INT32 bufferSize, UINT32 generation)
+{
+    AutoMutex lock(sCacheMutex);
+    dataCacheEntry_t* pEntry;
+
+    if((key >= DATA_CACHE_KEY_COUNT) || (bufferSize < 0) || (bufferSize > DATA_CACHE_MAX_LEN) ||
+            (generation != sCache.generation))
+        return;
+    pEntry = &sCache.entries[key];
+    memcpy(pEntry->data, buffer, bufferSize);
+    pEntry->len = (UINT16)bufferSize;
+    pEntry->generation = generation;
+    pEntry->valid = 1;
+    DataCache_save();
+}
+
+/*******************************************************************************
+**
+** Function:        DataCache_invalidate
+**
+** Description:     Starts a new generation, to be called whenever the content
+**                  of the eSE may have changed: LS script execution, JCOP
+**                  download, eSE reset
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void DataCache_invalidate()
+{
+    AutoMutex lock(sCacheMutex);
+
+    sCache.generation++;
+    DataCache_save();
+}
+
+/*******************************************************************************
+**
+** Function:        DataCache_getGeneration
+**
+** Description:     Current generation, to be passed to DataCache_put
+**
+** Returns:         Generation.
+**
+*******************************************************************************/
+UINT32 DataCache_getGeneration()
+{
+    AutoMutex lock(sCacheMutex);
+
+    return sCache.generation;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPIDATACACHE_H_
+#define SPIDATACACHE_H_
+
+#include "SpiChannel.h"
+
+#define DATA_CACHE_MAX_LEN  256
+
+/* Queries answered from the cache, the values are stored in the cache file */
+typedef enum data_cache_key
+{
+    DATA_CACHE_LS_VERSION = 0x00,
+    DATA_CACHE_LS_STATUS,
+    DATA_CACHE_LS_APPLET_STATUS,
+    DATA_CACHE_CERTIFICATE_KEY,
+    DATA_CACHE_KEY_COUNT
+}dataCacheKey_t;
+
+void DataCache_init();
+bool DataCache_get(dataCacheKey_t key, UINT8* buffer, INT32 bufferMaxSize, INT32& bufferActualSize);
+void DataCache_put(dataCacheKey_t key, const UINT8* buffer, INT32 bufferSize, UINT32 generation);
+void DataCache_invalidate();
+UINT32 DataCache_getGeneration();
+
+#endif /* SPIDATACACHE_H_ */
@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streams a JCOP OS image to the eSE. The image named by NXP_JCOP_DWNLD_IMAGE
+ * is a script of command APDUs in hex, one per line, blank lines and lines
+ * starting with '#' or '%' are skipped. The file is memory mapped and a
+ * producer thread parses the next APDUs into a small queue while the caller
+ * sends the current one, so parsing never waits on the eSE nor the eSE on
+ * parsing. Every APDU has to answer 9000, the first other status word stops
+ * the download. Frames go out with the NXP_JCOP_DWNLD_IFSC information field
+ * and without the per frame debug logs of the library.
+ *
+ * A comment line "%%SEGMENT" starts a segment of the script: the APDUs from
+ * there on can be sent again after an interruption, once the eSE is back in
+ * the state reached by the previous segments. It may carry that state, as
+ * the hex answer expected to NXP_JCOP_DWNLD_STATE_APDU. When all the APDUs
+ * before a segment are acknowledged, the count of APDUs done, the place of
+ * the segment and a hash of the image are written to the checkpoint file of
+ * NXP_JCOP_DWNLD_CHECKPOINT, and JcopDwnld_resume continues from there.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <log/log.h>
+#include "SpiJcopDownload.h"
+#include "Mutex.h"
+#include "CondVar.h"
+
+extern "C"
+{
+#include "phNxpConfig.h"
+#if(NXP_ESE_CHIP_TYPE == P61)
+#include "phNxpEseHal_Api.h"
+#elif(NXP_ESE_CHIP_TYPE == P73)
+#include "phNxpEse_Api.h"
+#else
+#error "Define chip type macro"
+#endif
+}
+
+#define NAME_NXP_JCOP_DWNLD_IMAGE   "NXP_JCOP_DWNLD_IMAGE"
+#define NAME_NXP_JCOP_DWNLD_IFSC    "NXP_JCOP_DWNLD_IFSC"
+#define NAME_NXP_JCOP_DWNLD_CHECKPOINT  "NXP_JCOP_DWNLD_CHECKPOINT"
+#define NAME_NXP_JCOP_DWNLD_STATE_APDU  "NXP_JCOP_DWNLD_STATE_APDU"
+
+#define JCOP_DWNLD_MAX_PATH         256
+#define JCOP_DWNLD_DEFAULT_IFSC     254   /* largest information field the library sends */
+#define JCOP_DWNLD_QUEUE_DEPTH      8
+#define JCOP_DWNLD_MAX_APDU_LEN     (4 + 3 + 65535 + 2)
+#define JCOP_DWNLD_MAX_RSP_LEN      (1024 + 2)
+#define JCOP_DWNLD_TIMEOUT_MS       2000
+#define JCOP_DWNLD_PROGRESS_STEP    10    /* percent of the image between progress logs */
+#define JCOP_DWNLD_MAX_STATE_LEN    64
+#define JCOP_DWNLD_SEGMENT_TAG      "SEGMENT"
+
+#define JCOP_DWNLD_CKPT_MAGIC       0x4A434B50 /* "JCKP" */
+#define JCOP_DWNLD_CKPT_VERSION     1
+
+/* One parsed command APDU, the buffers are kept from one APDU to the next */
+typedef struct jcop_dwnld_apdu
+{
+    UINT8* buf;
+    INT32  cap;
+    INT32  len;
+    size_t start;  /* image offset of its line */
+    size_t end;    /* image offset after its line */
+    UINT32 line;
+    UINT32 index;  /* APDUs of the image before it */
+    bool   segStart;
+    INT32  stateLen;
+    UINT8  state[JCOP_DWNLD_MAX_STATE_LEN];
+}jcopDwnldApdu_t;
+
+/* Last committed segment, as written to the checkpoint file */
+typedef struct jcop_dwnld_checkpoint
+{
+    UINT32 magic;
+    UINT32 version;
+    UINT64 imageBytes;
+    UINT64 imageHash;
+    UINT64 offset;    /* image offset of the first APDU of the segment */
+    UINT32 line;      /* image lines before it */
+    UINT32 apdus;     /* APDUs acknowledged before it */
+    UINT32 segments;  /* segments committed */
+    UINT32 stateLen;
+    UINT8  state[JCOP_DWNLD_MAX_STATE_LEN];
+}jcopDwnldCheckpoint_t;
+
+static Mutex sDwnldMutex;
+static CondVar sSpaceCond;
+static CondVar sDataCond;
+static jcopDwnldApdu_t sQueue[JCOP_DWNLD_QUEUE_DEPTH];
+static INT32 sHead = 0;
+static INT32 sCount = 0;
+static bool sParseDone = false;
+static bool sParseError = false;
+static bool sAbort = false;
+static const char* sImage = NULL;
+static size_t sImageLen = 0;
+static jcopDwnldProgress_t sProgress;
+static jcopDwnldCheckpoint_t sCheckpoint;
+static char sCheckpointPath[JCOP_DWNLD_MAX_PATH];
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_nowUs
+**
+** Description:     Monotonic time
+**
+** Returns:         Time in microseconds.
+**
+*******************************************************************************/
+static UINT64 JcopDwnld_nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((UINT64)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_hexValue
+**
+** Description:     Value of a hex digit
+**
+** Returns:         0 to 15, -1 if not a hex digit.
+**
+*******************************************************************************/
+static INT32 JcopDwnld_hexValue(char c)
+{
+    if((c >= '0') && (c <= '9'))
+        return c - '0';
+    if((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    if((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_hexToBytes
+**
+** Description:     Converts len characters of hex digits, blanks allowed
+**                  between them, into at most cap bytes of out
+**
+** Returns:         Number of bytes, -1 if not hex or longer than cap.
+**
+*******************************************************************************/
+static INT32 JcopDwnld_hexToBytes(const char* s, size_t len, UINT8* out, INT32 cap)
+{
+    INT32 high = -1;
+    INT32 count = 0;
+    size_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        INT32 value = JcopDwnld_hexValue(s[i]);
+        if(value < 0)
+        {
+            if((s[i] == ' ') || (s[i] == '\t') || (s[i] == '\r'))
+                continue;
+            return -1;
+        }
+        if(high < 0)
+        {
+            high = value;
+        }
+        else
+        {
+            if(count == cap)
+                return -1;
+            out[count++] = (UINT8)((high << 4) | value);
+            high = -1;
+        }
+    }
+    return (high < 0) ? count : -1;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_hash
+**
+** Description:     FNV-1a hash of the image, to tell whether a checkpoint was
+**                  written for it
+**
+** Returns:         The hash.
+**
+*******************************************************************************/
+static UINT64 JcopDwnld_hash(const char* image, size_t len)
+{
+    UINT64 hash = 0xCBF29CE484222325ULL;
+    size_t i;
+
+    for(i = 0; i < len; i++)
+    {
+        hash ^= (UINT8)image[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_parseNext
+**
+** Description:     Parses the next APDU of the image from *pPos into pApdu,
+**                  growing its buffer when needed
+**
+** Returns:         1 if an APDU was parsed, 0 at the end of the image,
+**                  -1 on a malformed line.
+**
+*******************************************************************************/
+static INT32 JcopDwnld_parseNext(size_t* pPos, UINT32* pLine, UINT32* pIndex,
+        jcopDwnldApdu_t* pApdu)
+{
+    size_t pos = *pPos;
+    INT32 len;
+
+    pApdu->segStart = false;
+    pApdu->stateLen = 0;
+    while(pos < sImageLen)
+    {
+        const char* line = &sImage[pos];
+        const char* eol = (const char*)memchr(line, '\n', sImageLen - pos);
+        size_t lineLen = (eol != NULL) ? (size_t)(eol - line) : (sImageLen - pos);
+        size_t start = pos;
+        size_t i = 0;
+
+        pos += lineLen + ((eol != NULL) ? 1 : 0);
+        (*pLine)++;
+        while((i < lineLen) && ((line[i] == ' ') || (line[i] == '\t') || (line[i] == '\r')))
+            i++;
+        if(i == lineLen)
+            continue;
+        if((line[i] == '#') || (line[i] == '%'))
+        {
+            while((i < lineLen) && ((line[i] == '#') || (line[i] == '%') || (line[i] == ' ')))
+                i++;
+            if(((lineLen - i) < strlen(JCOP_DWNLD_SEGMENT_TAG)) ||
+                    (strncasecmp(&line[i], JCOP_DWNLD_SEGMENT_TAG,
+                    strlen(JCOP_DWNLD_SEGMENT_TAG)) != 0))
+                continue;
+            i += strlen(JCOP_DWNLD_SEGMENT_TAG);
+            len = JcopDwnld_hexToBytes(&line[i], lineLen - i, pApdu->state,
+                    JCOP_DWNLD_MAX_STATE_LEN);
+            if(len < 0)
+            {
+                ALOGE("%s: line %lu is not a segment state", __FUNCTION__, *pLine);
+                return -1;
+            }
+            pApdu->segStart = true;
+            pApdu->stateLen = len;
+            continue;
+        }
+        if(((lineLen - i) / 2) > JCOP_DWNLD_MAX_APDU_LEN)
+        {
+            ALOGE("%s: line %lu too long", __FUNCTION__, *pLine);
+            return -1;
+        }
+        if((INT32)((lineLen - i) / 2) > pApdu->cap)
+        {
+            UINT8* buf = (UINT8*)realloc(pApdu->buf, (lineLen - i) / 2);
+            if(buf == NULL)
+                return -1;
+            pApdu->buf = buf;
+            pApdu->cap = (INT32)((lineLen - i) / 2);
+        }
+        len = JcopDwnld_hexToBytes(&line[i], lineLen - i, pApdu->buf, pApdu->cap);
+        if(len < 4)
+        {
+            ALOGE("%s: line %lu is not an APDU", __FUNCTION__, *pLine);
+            return -1;
+        }
+        pApdu->len = len;
+        pApdu->start = start;
+        pApdu->end = pos;
+        pApdu->line = *pLine;
+        pApdu->index = (*pIndex)++;
+        *pPos = pos;
+        return 1;
+    }
+    *pPos = pos;
+    return 0;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_saveCheckpoint
+**
+** Description:     Writes sCheckpoint to the checkpoint file, through a
+**                  temporary file synced to storage so that a power loss
+**                  leaves either the previous checkpoint or this one
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void JcopDwnld_saveCheckpoint()
+{
+    char tmpPath[JCOP_DWNLD_MAX_PATH + 4];
+    FILE* fp;
+    bool stat = false;
+
+    if(sCheckpointPath[0] == '\0')
+        return;
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", sCheckpointPath);
+    fp = fopen(tmpPath, "wb");
+    if(fp == NULL)
+    {
+        ALOGE("%s: cannot create %s", __FUNCTION__, tmpPath);
+        return;
+    }
+    stat = (fwrite(&sCheckpoint, sizeof(sCheckpoint), 1, fp) == 1) && (fflush(fp) == 0) &&
+            (fsync(fileno(fp)) == 0);
+    if(fclose(fp) != 0)
+        stat = false;
+    if(!stat || (rename(tmpPath, sCheckpointPath) != 0))
+    {
+        ALOGE("%s: cannot write %s", __FUNCTION__, sCheckpointPath);
+        remove(tmpPath);
+    }
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_loadCheckpoint
+**
+** Description:     Loads the checkpoint file into sCheckpoint if it was written
+**                  for the image of imageBytes bytes hashing to imageHash
+**
+** Returns:         True if the download can continue from it.
+**
+*******************************************************************************/
+static bool JcopDwnld_loadCheckpoint(UINT64 imageBytes, UINT64 imageHash)
+{
+    jcopDwnldCheckpoint_t checkpoint;
+    FILE* fp;
+    bool stat;
+
+    fp = fopen(sCheckpointPath, "rb");
+    if(fp == NULL)
+        return false;
+    stat = (fread(&checkpoint, sizeof(checkpoint), 1, fp) == 1);
+    fclose(fp);
+    if(!stat || (checkpoint.magic != JCOP_DWNLD_CKPT_MAGIC) ||
+            (checkpoint.version != JCOP_DWNLD_CKPT_VERSION) ||
+            (checkpoint.stateLen > JCOP_DWNLD_MAX_STATE_LEN) ||
+            (checkpoint.offset > imageBytes))
+    {
+        ALOGE("%s: %s ignored", __FUNCTION__, sCheckpointPath);
+        return false;
+    }
+    if((checkpoint.imageBytes != imageBytes) || (checkpoint.imageHash != imageHash))
+    {
+        ALOGI("%s: %s is of another image", __FUNCTION__, sCheckpointPath);
+        return false;
+    }
+    sCheckpoint = checkpoint;
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_checkCardState
+**
+** Description:     Sends NXP_JCOP_DWNLD_STATE_APDU and compares the answer of
+**                  the eSE with the state its checkpoint expects
+**
+** Returns:         True if the eSE is where the checkpoint left it, false
+**                  also when the checkpoint has no state to check it against.
+**
+*******************************************************************************/
+static bool JcopDwnld_checkCardState(IChannel_t* channel)
+{
+    UINT8 cmd[JCOP_DWNLD_MAX_STATE_LEN];
+    UINT8 rsp[JCOP_DWNLD_MAX_RSP_LEN];
+    long cmdLen = 0;
+    INT32 rspLen = 0;
+
+    /* resuming blind would send a segment on top of an unknown card state */
+    if(sCheckpoint.stateLen == 0)
+    {
+        ALOGE("%s: segment %lu has no state to check the eSE", __FUNCTION__,
+                sCheckpoint.segments);
+        return false;
+    }
+    if(!GetNxpByteArrayValue(NAME_NXP_JCOP_DWNLD_STATE_APDU, (char*)cmd, sizeof(cmd), &cmdLen) ||
+            (cmdLen < 4))
+    {
+        ALOGE("%s: no state APDU to check the eSE", __FUNCTION__);
+        return false;
+    }
+    if(!channel->transceive(cmd, (INT32)cmdLen, rsp, sizeof(rsp), rspLen, JCOP_DWNLD_TIMEOUT_MS) ||
+            (rspLen != (INT32)sCheckpoint.stateLen) ||
+            (memcmp(rsp, sCheckpoint.state, rspLen) != 0))
+    {
+        ALOGE("%s: eSE not in the state of segment %lu", __FUNCTION__, sCheckpoint.segments);
+        return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_producer
+**
+** Description:     Parses the image ahead of the sender, as long as the queue
+**                  has room
+**
+** Returns:         NULL.
+**
+*******************************************************************************/
+static void* JcopDwnld_producer(void* arg)
+{
+    (void)arg;
+    size_t pos = sCheckpoint.offset;
+    UINT32 line = sCheckpoint.line;
+    UINT32 index = sCheckpoint.apdus;
+    jcopDwnldApdu_t* pApdu;
+    INT32 result;
+
+    for(;;)
+    {
+        sDwnldMutex.lock();
+        while((sCount == JCOP_DWNLD_QUEUE_DEPTH) && !sAbort)
+            sSpaceCond.wait(sDwnldMutex);
+        if(sAbort)
+        {
+            sDwnldMutex.unlock();
+            break;
+        }
+        /* the slot after the queued ones is not seen by the sender until counted */
+        pApdu = &sQueue[(sHead + sCount) % JCOP_DWNLD_QUEUE_DEPTH];
+        sDwnldMutex.unlock();
+
+        result = JcopDwnld_parseNext(&pos, &line, &index, pApdu);
+
+        AutoMutex lock(sDwnldMutex);
+        if(result > 0)
+        {
+            sCount++;
+        }
+        else
+        {
+            sParseDone = true;
+            sParseError = (result < 0);
+        }
+        sDataCond.notifyOne();
+        if(result <= 0)
+            break;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_send
+**
+** Description:     Sends the queued APDUs as the producer parses them, until
+**                  the end of the image or the first failure
+**
+** Returns:         True if every APDU of the image answered 9000.
+**
+*******************************************************************************/
+static bool JcopDwnld_send(IChannel_t* channel)
+{
+    static UINT8 rsp[JCOP_DWNLD_MAX_RSP_LEN];
+    UINT64 startUs = JcopDwnld_nowUs();
+    UINT32 nextLog = JCOP_DWNLD_PROGRESS_STEP;
+    jcopDwnldApdu_t* pApdu;
+    INT32 rspLen = 0;
+    bool stat;
+
+    for(;;)
+    {
+        sDwnldMutex.lock();
+        while((sCount == 0) && !sParseDone)
+            sDataCond.wait(sDwnldMutex);
+        if(sCount == 0)
+        {
+            stat = !sParseError;
+            sDwnldMutex.unlock();
+            return stat;
+        }
+        pApdu = &sQueue[sHead];
+        sDwnldMutex.unlock();
+
+        if(pApdu->segStart && (pApdu->index > sCheckpoint.apdus))
+        {
+            /* every APDU before the segment is acknowledged */
+            sCheckpoint.offset = pApdu->start;
+            sCheckpoint.line = pApdu->line - 1;
+            sCheckpoint.apdus = pApdu->index;
+            sCheckpoint.segments++;
+            sCheckpoint.stateLen = pApdu->stateLen;
+            memcpy(sCheckpoint.state, pApdu->state, pApdu->stateLen);
+            JcopDwnld_saveCheckpoint();
+            sDwnldMutex.lock();
+            sProgress.segments = sCheckpoint.segments;
+            sDwnldMutex.unlock();
+        }
+
+        rspLen = 0;
+        stat = channel->transceive(pApdu->buf, pApdu->len, rsp, sizeof(rsp), rspLen,
+                JCOP_DWNLD_TIMEOUT_MS);
+        if(!stat || (rspLen < 2) || (rsp[rspLen - 2] != 0x90) || (rsp[rspLen - 1] != 0x00))
+        {
+            ALOGE("%s: APDU of line %lu failed, SW %02X%02X", __FUNCTION__, pApdu->line,
+                    (rspLen >= 2) ? rsp[rspLen - 2] : 0, (rspLen >= 2) ? rsp[rspLen - 1] : 0);
+            return false;
+        }
+
+        AutoMutex lock(sDwnldMutex);
+        sProgress.apdus++;
+        sProgress.apduBytes += pApdu->len;
+        sProgress.doneBytes = pApdu->end;
+        sProgress.elapsedUs = JcopDwnld_nowUs() - startUs;
+        if(sProgress.elapsedUs != 0)
+            sProgress.kbPerSec = (UINT32)((sProgress.apduBytes * 1000000ULL) /
+                    (sProgress.elapsedUs * 1024ULL));
+        if((sProgress.doneBytes * 100) >= ((UINT64)nextLog * sProgress.imageBytes))
+        {
+            ALOGI("%s: %llu%% %llu APDUs %lu KB/s", __FUNCTION__,
+                    (sProgress.doneBytes * 100) / sProgress.imageBytes, sProgress.apdus,
+                    sProgress.kbPerSec);
+            while((sProgress.doneBytes * 100) >= ((UINT64)nextLog * sProgress.imageBytes))
+                nextLog += JCOP_DWNLD_PROGRESS_STEP;
+        }
+        sHead = (sHead + 1) % JCOP_DWNLD_QUEUE_DEPTH;
+        sCount--;
+        sSpaceCond.notifyOne();
+    }
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_isConfigured
+**
+** Description:     Tells whether NXP_JCOP_DWNLD_IMAGE names an image, the OS
+**                  download is left to the JCOP loader otherwise
+**
+** Returns:         True if the engine is to be used.
+**
+*******************************************************************************/
+bool JcopDwnld_isConfigured()
+{
+    char path[JCOP_DWNLD_MAX_PATH];
+
+    return GetNxpStrValue(NAME_NXP_JCOP_DWNLD_IMAGE, path, sizeof(path)) && (path[0] != '\0');
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_run
+**
+** Description:     Downloads the image of NXP_JCOP_DWNLD_IMAGE over channel,
+**                  from its last committed segment when resume is set and the
+**                  checkpoint and the eSE allow it, from the start otherwise,
+**                  then resets the eSE to start the new OS
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+static bool JcopDwnld_run(IChannel_t* channel, bool resume)
+{
+    char path[JCOP_DWNLD_MAX_PATH];
+    unsigned long num = 0;
+    UINT16 ifsc = JCOP_DWNLD_DEFAULT_IFSC;
+    struct stat st;
+    pthread_t producer;
+    void* image = MAP_FAILED;
+    INT16 handle = EE_ERROR_OPEN_FAIL;
+    INT32 fd = -1;
+    INT32 i;
+    UINT64 imageHash = 0;
+    bool resumed = false;
+    bool stat = false;
+
+    if(!GetNxpStrValue(NAME_NXP_JCOP_DWNLD_IMAGE, path, sizeof(path)))
+        return false;
+    if(GetNxpNumValue(NAME_NXP_JCOP_DWNLD_IFSC, &num, sizeof(num)) && (num != 0) &&
+            (num <= JCOP_DWNLD_DEFAULT_IFSC))
+        ifsc = (UINT16)num;
+    if(!GetNxpStrValue(NAME_NXP_JCOP_DWNLD_CHECKPOINT, sCheckpointPath, sizeof(sCheckpointPath)))
+        sCheckpointPath[0] = '\0';
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size == 0))
+    {
+        ALOGE("%s: cannot open %s (errno=%d)", __FUNCTION__, path, errno);
+        goto clean_and_return;
+    }
+    image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(image == MAP_FAILED)
+    {
+        ALOGE("%s: cannot map %s (errno=%d)", __FUNCTION__, path, errno);
+        goto clean_and_return;
+    }
+
+    memset(&sCheckpoint, 0x00, sizeof(sCheckpoint));
+    if(sCheckpointPath[0] != '\0')
+    {
+        imageHash = JcopDwnld_hash((const char*)image, st.st_size);
+        resumed = resume && JcopDwnld_loadCheckpoint(st.st_size, imageHash);
+    }
+    madvise(image, st.st_size, MADV_SEQUENTIAL);
+
+    handle = channel->open();
+    if(handle == EE_ERROR_OPEN_FAIL)
+    {
+        ALOGE("%s: channel open failed", __FUNCTION__);
+        goto clean_and_return;
+    }
+#if(NXP_ESE_CHIP_TYPE == P61)
+    phNxpEseP61_setIfsc(ifsc);
+    phNxpEseP61_setFrameLog(FALSE);
+#elif(NXP_ESE_CHIP_TYPE == P73)
+    phNxpEse_setIfsc(ifsc);
+    phNxpEse_setFrameLog(FALSE);
+#endif
+    if(resumed && !JcopDwnld_checkCardState(channel))
+        resumed = false;
+    if(!resumed)
+    {
+        /* from the start, a checkpoint left would be of another download */
+        memset(&sCheckpoint, 0x00, sizeof(sCheckpoint));
+        if(sCheckpointPath[0] != '\0')
+            remove(sCheckpointPath);
+    }
+    sCheckpoint.magic = JCOP_DWNLD_CKPT_MAGIC;
+    sCheckpoint.version = JCOP_DWNLD_CKPT_VERSION;
+    sCheckpoint.imageBytes = st.st_size;
+    sCheckpoint.imageHash = imageHash;
+
+    sDwnldMutex.lock();
+    sImage = (const char*)image;
+    sImageLen = st.st_size;
+    sHead = 0;
+    sCount = 0;
+    sParseDone = false;
+    sParseError = false;
+    sAbort = false;
+    memset(&sProgress, 0x00, sizeof(sProgress));
+    sProgress.imageBytes = st.st_size;
+    sProgress.doneBytes = sCheckpoint.offset;
+    sProgress.resumedBytes = sCheckpoint.offset;
+    sProgress.segments = sCheckpoint.segments;
+    sProgress.running = true;
+    sDwnldMutex.unlock();
+    if(resumed)
+        ALOGI("%s: %s, %lld bytes, IFSC %u, resumed at segment %lu, line %lu, %lu APDUs done",
+                __FUNCTION__, path, (long long)st.st_size, ifsc, sCheckpoint.segments,
+                sCheckpoint.line + 1, sCheckpoint.apdus);
+    else
+        ALOGI("%s: %s, %lld bytes, IFSC %u", __FUNCTION__, path, (long long)st.st_size, ifsc);
+
+    if(pthread_create(&producer, NULL, JcopDwnld_producer, NULL) != 0)
+    {
+        ALOGE("%s: producer thread creation failed", __FUNCTION__);
+    }
+    else
+    {
+        stat = JcopDwnld_send(channel);
+        sDwnldMutex.lock();
+        sAbort = true;
+        sSpaceCond.notifyOne();
+        sDwnldMutex.unlock();
+        pthread_join(producer, NULL);
+    }
+
+#if(NXP_ESE_CHIP_TYPE == P61)
+    phNxpEseP61_setFrameLog(TRUE);
+#elif(NXP_ESE_CHIP_TYPE == P73)
+    phNxpEse_setFrameLog(TRUE);
+#endif
+    if(stat)
+    {
+        /* the checkpoint is kept on failure, for JcopDwnld_resume */
+        if(sCheckpointPath[0] != '\0')
+            remove(sCheckpointPath);
+        channel->doeSE_JcopDownLoadReset();
+    }
+    channel->close(handle);
+
+    sDwnldMutex.lock();
+    sProgress.running = false;
+    ALOGI("%s: %s, %llu APDUs, %llu bytes in %llu ms, %lu KB/s", __FUNCTION__,
+            stat ? "done" : "failed", sProgress.apdus, sProgress.apduBytes,
+            sProgress.elapsedUs / 1000, sProgress.kbPerSec);
+    sImage = NULL;
+    sImageLen = 0;
+    sDwnldMutex.unlock();
+
+clean_and_return:
+    for(i = 0; i < JCOP_DWNLD_QUEUE_DEPTH; i++)
+    {
+        free(sQueue[i].buf);
+        memset(&sQueue[i], 0x00, sizeof(sQueue[i]));
+    }
+    if(image != MAP_FAILED)
+        munmap(image, st.st_size);
+    if(fd >= 0)
+        close(fd);
+    return stat;
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_start
+**
+** Description:     Downloads the image of NXP_JCOP_DWNLD_IMAGE over channel
+**                  from its start, dropping any checkpoint
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool JcopDwnld_start(IChannel_t* channel)
+{
+    return JcopDwnld_run(channel, false);
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_resume
+**
+** Description:     Continues the download of NXP_JCOP_DWNLD_IMAGE from the
+**                  segment of NXP_JCOP_DWNLD_CHECKPOINT, when the checkpoint
+**                  is of this image and the eSE answers the state APDU as the
+**                  segment expects, from its start otherwise
+**
+** Returns:         True if ok.
+**
+*******************************************************************************/
+bool JcopDwnld_resume(IChannel_t* channel)
+{
+    return JcopDwnld_run(channel, true);
+}
+
+/*******************************************************************************
+**
+** Function:        JcopDwnld_getProgress
+**
+** Description:     Copies out the progress of the running or last download
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void JcopDwnld_getProgress(jcopDwnldProgress_t* pProgress)
+{
+    AutoMutex lock(sDwnldMutex);
+    *pProgress = sProgress;
+}
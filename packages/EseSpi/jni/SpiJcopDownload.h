@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPIJCOPDOWNLOAD_H_
+#define SPIJCOPDOWNLOAD_H_
+
+#include <IChannel.h>
+#include "SpiChannel.h"
+
+/* Progress of the running or of the last OS download */
+typedef struct jcop_dwnld_progress
+{
+    UINT64 imageBytes;   /* size of the image file */
+    UINT64 doneBytes;    /* image bytes of the APDUs acknowledged */
+    UINT64 apduBytes;    /* bytes of the APDUs acknowledged */
+    UINT64 apdus;
+    UINT64 elapsedUs;
+    UINT64 resumedBytes; /* image bytes skipped by a resume */
+    UINT32 kbPerSec;     /* apduBytes per second, in KB */
+    UINT32 segments;     /* segments committed to the checkpoint */
+    bool   running;
+}jcopDwnldProgress_t;
+
+bool JcopDwnld_isConfigured();
+bool JcopDwnld_start(IChannel_t* channel);
+bool JcopDwnld_resume(IChannel_t* channel);
+void JcopDwnld_getProgress(jcopDwnldProgress_t* pProgress);
+
+#endif /* SPIJCOPDOWNLOAD_H_ */
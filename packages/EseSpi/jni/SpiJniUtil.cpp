@@ -35,6 +35,9 @@
  ******************************************************************************/
 
 #include "SpiJniUtil.h"
+#include "SpiDataCache.h"
+#include "SpiTransceiveSlot.h"
+#include "SpiApduScheduler.h"
 
 #include <errno.h>
 #include <JNIHelp.h>
@@ -75,6 +78,9 @@ jint JNI_OnLoad (JavaVM *jvm, void *reserved)
         ALOGE("ERROR: registerNativeEseAla failed\n");
         return JNI_ERR;
     }
+    DataCache_init();
+    TransceiveSlot_init();
+    ApduSched_init();
     ALOGV ("%s: exit", __FUNCTION__);
     return JNI_VERSION_1_6;
 }
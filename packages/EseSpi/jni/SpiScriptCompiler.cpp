@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host tool compiling a Loader Service script into the format of
+ * SpiScriptImage.h, once at build time instead of at every execution:
+ *
+ *     ese_spi_script_compiler <script> <compiled script>
+ *
+ * The script has one command APDU in hex per line, blanks allowed between
+ * the digits, optionally followed by "=SSSS" for the status word expected
+ * (9000 when absent) and "/MMMM" for the bits of it compared. Blank lines
+ * and lines starting with '#' or '%' are skipped.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "SpiScriptImage.h"
+
+/*******************************************************************************
+**
+** Function:        Compiler_hexValue
+**
+** Description:     Value of a hex digit
+**
+** Returns:         0 to 15, -1 if not a hex digit.
+**
+*******************************************************************************/
+static int Compiler_hexValue(char c)
+{
+    if((c >= '0') && (c <= '9'))
+        return c - '0';
+    if((c >= 'A') && (c <= 'F'))
+        return c - 'A' + 10;
+    if((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+    return -1;
+}
+
+/*******************************************************************************
+**
+** Function:        Compiler_parseHex
+**
+** Description:     Appends the bytes of the hex digits of s, up to the first
+**                  character that is neither a digit nor a blank
+**
+** Returns:         Pointer to that character, NULL on an odd number of digits.
+**
+*******************************************************************************/
+static const char* Compiler_parseHex(const char* s, std::vector<uint8_t>& out)
+{
+    int high = -1;
+    int value;
+
+    for(; *s != '\0'; s++)
+    {
+        if((*s == ' ') || (*s == '\t') || (*s == '\r') || (*s == '\n'))
+            continue;
+        value = Compiler_hexValue(*s);
+        if(value < 0)
+            break;
+        if(high < 0)
+        {
+            high = value;
+        }
+        else
+        {
+            out.push_back((uint8_t)((high << 4) | value));
+            high = -1;
+        }
+    }
+    return (high < 0) ? s : NULL;
+}
+
+/*******************************************************************************
+**
+** Function:        Compiler_parseWord
+**
+** Description:     Parses the 4 hex digits of a status word or of its mask
+**
+** Returns:         Pointer after them, NULL if not a status word.
+**
+*******************************************************************************/
+static const char* Compiler_parseWord(const char* s, uint16_t* pWord)
+{
+    std::vector<uint8_t> bytes;
+
+    s = Compiler_parseHex(s, bytes);
+    if((s == NULL) || (bytes.size() != 2))
+        return NULL;
+    *pWord = (uint16_t)((bytes[0] << 8) | bytes[1]);
+    return s;
+}
+
+/*******************************************************************************
+**
+** Function:        Compiler_isApdu
+**
+** Description:     Checks the length of the command against its ISO 7816-4
+**                  case, short or extended
+**
+** Returns:         True if the command is well formed.
+**
+*******************************************************************************/
+static bool Compiler_isApdu(const std::vector<uint8_t>& apdu)
+{
+    size_t len = apdu.size();
+    size_t lc;
+
+    if(len < 4)
+        return false;
+    if((len == 4) || (len == 5))
+        return true;                          /* case 1, case 2 short */
+    if(apdu[4] != 0x00)
+    {
+        lc = apdu[4];
+        return (len == (5 + lc)) || (len == (6 + lc));  /* case 3, case 4 short */
+    }
+    if(len < 7)
+        return false;                         /* extended Lc or Le is cut short */
+    if(len == 7)
+        return true;                          /* case 2 extended */
+    lc = (apdu[5] << 8) | apdu[6];
+    return (lc != 0) && ((len == (7 + lc)) || (len == (9 + lc)));  /* case 3, case 4 extended */
+}
+
+/*******************************************************************************
+**
+** Function:        Compiler_cpuUs
+**
+** Description:     CPU time used by the process
+**
+** Returns:         Time in microseconds.
+**
+*******************************************************************************/
+static uint64_t Compiler_cpuUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function:        Compiler_compile
+**
+** Description:     Compiles the text script of fp into header and records
+**
+** Returns:         True if every line is valid.
+**
+*******************************************************************************/
+static bool Compiler_compile(FILE* fp, spiScriptHeader_t* pHeader, std::vector<uint8_t>& records)
+{
+    std::vector<uint8_t> apdu;
+    char* line = NULL;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    unsigned long lineNo = 0;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    bool stat = true;
+
+    memset(pHeader, 0x00, sizeof(*pHeader));
+    while((lineLen = getline(&line, &lineCap, fp)) >= 0)
+    {
+        spiScriptRecord_t record;
+        const char* p = line;
+        ssize_t i;
+
+        lineNo++;
+        for(i = 0; i < lineLen; i++)
+        {
+            hash ^= (uint8_t)line[i];
+            hash *= 0x100000001B3ULL;
+        }
+        while((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+            p++;
+        if((*p == '\0') || (*p == '#') || (*p == '%'))
+            continue;
+
+        apdu.clear();
+        record.sw = SPI_SCRIPT_SW_OK;
+        record.swMask = 0xFFFF;
+        p = Compiler_parseHex(p, apdu);
+        if((p != NULL) && (*p == '='))
+            p = Compiler_parseWord(p + 1, &record.sw);
+        if((p != NULL) && (*p == '/'))
+            p = Compiler_parseWord(p + 1, &record.swMask);
+        if((p == NULL) || (*p != '\0'))
+        {
+            fprintf(stderr, "line %lu: syntax error\n", lineNo);
+            stat = false;
+            continue;
+        }
+        if((apdu.size() > SPI_SCRIPT_MAX_APDU_LEN) || !Compiler_isApdu(apdu))
+        {
+            fprintf(stderr, "line %lu: not a command APDU\n", lineNo);
+            stat = false;
+            continue;
+        }
+
+        record.apduLen = (uint16_t)apdu.size();
+        record.line = (lineNo <= 0xFFFF) ? (uint16_t)lineNo : 0;
+        size_t offset = records.size();
+        records.resize(offset + SPI_SCRIPT_RECORD_SIZE(apdu.size()), 0x00);
+        memcpy(&records[offset], &record, sizeof(record));
+        memcpy(&records[offset + sizeof(record)], apdu.data(), apdu.size());
+        pHeader->apdus++;
+        if(apdu.size() > pHeader->maxApduLen)
+            pHeader->maxApduLen = apdu.size();
+    }
+    free(line);
+
+    pHeader->magic = SPI_SCRIPT_MAGIC;
+    pHeader->version = SPI_SCRIPT_VERSION;
+    pHeader->headerLen = sizeof(*pHeader);
+    pHeader->recordsLen = records.size();
+    pHeader->sourceHash = hash;
+    return stat && (pHeader->apdus != 0);
+}
+
+int main(int argc, char** argv)
+{
+    spiScriptHeader_t header;
+    std::vector<uint8_t> records;
+    char tmpPath[4096];
+    uint64_t startUs;
+    FILE* fp;
+    bool stat;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s <script> <compiled script>\n", argv[0]);
+        return 2;
+    }
+    fp = fopen(argv[1], "r");
+    if(fp == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    startUs = Compiler_cpuUs();
+    stat = Compiler_compile(fp, &header, records);
+    fclose(fp);
+    if(!stat)
+    {
+        fprintf(stderr, "%s: not compiled\n", argv[1]);
+        return 1;
+    }
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", argv[2]);
+    fp = fopen(tmpPath, "wb");
+    if(fp == NULL)
+    {
+        perror(tmpPath);
+        return 1;
+    }
+    stat = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+            (fwrite(records.data(), records.size(), 1, fp) == 1);
+    if(fclose(fp) != 0)
+        stat = false;
+    if(!stat || (rename(tmpPath, argv[2]) != 0))
+    {
+        perror(argv[2]);
+        remove(tmpPath);
+        return 1;
+    }
+    printf("%s: %u APDUs, %zu bytes, parsed in %llu us of CPU\n", argv[2], header.apdus,
+            sizeof(header) + records.size(), (unsigned long long)(Compiler_cpuUs() - startUs));
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Executes the Loader Service scripts compiled by ese_spi_script_compiler.
+ * The compiled script is memory mapped and its records are handed to
+ * transceiveBatch as they are, SCRIPT_EXEC_BATCH APDUs at a time, without
+ * any text to parse: the APDUs were validated when the script was compiled.
+ * The responses are written to the response file in hex, one per line.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <log/log.h>
+#include "SpiScriptExec.h"
+#include "SpiScriptImage.h"
+
+#define SCRIPT_EXEC_BATCH   16
+
+/* Where the responses of a batch go */
+typedef struct script_exec_rsp
+{
+    FILE* fp;
+    UINT8 sw[2];
+}scriptExecRsp_t;
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_nowUs
+**
+** Description:     Monotonic time
+**
+** Returns:         Time in microseconds.
+**
+*******************************************************************************/
+UINT64 ScriptExec_nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((UINT64)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_cpuUs
+**
+** Description:     CPU time used by the calling thread
+**
+** Returns:         Time in microseconds.
+**
+*******************************************************************************/
+UINT64 ScriptExec_cpuUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((UINT64)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_onRsp
+**
+** Description:     Keeps the status word of a response and writes the response
+**                  to the response file
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void ScriptExec_onRsp(void* pContext, INT32 index, const UINT8* rsp, INT32 rspLen)
+{
+    scriptExecRsp_t* pRsp = (scriptExecRsp_t*)pContext;
+    INT32 i;
+    (void)index;
+
+    if(rspLen >= 2)
+    {
+        pRsp->sw[0] = rsp[rspLen - 2];
+        pRsp->sw[1] = rsp[rspLen - 1];
+    }
+    if(pRsp->fp == NULL)
+        return;
+    for(i = 0; i < rspLen; i++)
+        fprintf(pRsp->fp, "%02X", rsp[i]);
+    fputc('\n', pRsp->fp);
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_checkRecords
+**
+** Description:     Walks the records of the compiled script image from pos to
+**                  end, before any of them is sent
+**
+** Returns:         True if exactly apdus records, none longer than
+**                  maxApduLen, fill the records area.
+**
+*******************************************************************************/
+static bool ScriptExec_checkRecords(const UINT8* image, size_t pos, size_t end, UINT32 apdus,
+        UINT32 maxApduLen)
+{
+    const spiScriptRecord_t* pRecord;
+
+    for(; apdus != 0; apdus--)
+    {
+        if((end - pos) < sizeof(spiScriptRecord_t))
+            return false;
+        pRecord = (const spiScriptRecord_t*)&image[pos];
+        if((pRecord->apduLen < 4) || (pRecord->apduLen > maxApduLen) ||
+                ((end - pos) < SPI_SCRIPT_RECORD_SIZE(pRecord->apduLen)))
+            return false;
+        pos += SPI_SCRIPT_RECORD_SIZE(pRecord->apduLen);
+    }
+    return pos == end;
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_isCompiled
+**
+** Description:     Tells whether path is a compiled script, to be run by
+**                  ScriptExec_run rather than by ALA_Start
+**
+** Returns:         True if the file starts with the compiled script magic.
+**
+*******************************************************************************/
+bool ScriptExec_isCompiled(const char* path)
+{
+    uint32_t magic = 0;
+    INT32 fd;
+    bool stat;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    stat = (read(fd, &magic, sizeof(magic)) == sizeof(magic)) && (magic == SPI_SCRIPT_MAGIC);
+    close(fd);
+    return stat;
+}
+
+/*******************************************************************************
+**
+** Function:        ScriptExec_run
+**
+** Description:     Sends the APDUs of the compiled script of path over the
+**                  opened channel, until the first one not answering the
+**                  status word it expects
+**
+** Returns:         True if all of them did, pSw is the status word of the
+**                  last response.
+**
+*******************************************************************************/
+bool ScriptExec_run(const char* path, const char* destPath, UINT8* pSw, scriptExecStats_t* pStats)
+{
+    spiBatchApdu_t batch[SCRIPT_EXEC_BATCH];
+    UINT16 lines[SCRIPT_EXEC_BATCH];
+    const spiScriptHeader_t* pHeader;
+    scriptExecRsp_t rsp;
+    struct stat st;
+    UINT8* image = (UINT8*)MAP_FAILED;
+    UINT64 startUs = ScriptExec_nowUs();
+    UINT64 startCpuUs = ScriptExec_cpuUs();
+    UINT64 cpuUs;
+    size_t pos = 0;
+    size_t end = 0;
+    UINT32 left = 0;
+    INT32 count;
+    INT32 done;
+    INT32 fd;
+    bool stat = false;
+
+    memset(pStats, 0x00, sizeof(*pStats));
+    pStats->compiled = true;
+    memset(&rsp, 0x00, sizeof(rsp));
+    rsp.sw[0] = pSw[0];
+    rsp.sw[1] = pSw[1];
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if((fd < 0) || (fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(spiScriptHeader_t)))
+    {
+        ALOGE("%s: cannot open %s (errno=%d)", __FUNCTION__, path, errno);
+        goto clean_and_return;
+    }
+    /* private and writable: the channel takes the commands as non const */
+    image = (UINT8*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(image == MAP_FAILED)
+    {
+        ALOGE("%s: cannot map %s (errno=%d)", __FUNCTION__, path, errno);
+        goto clean_and_return;
+    }
+    madvise(image, st.st_size, MADV_SEQUENTIAL);
+    pHeader = (const spiScriptHeader_t*)image;
+    if((pHeader->magic != SPI_SCRIPT_MAGIC) || (pHeader->version != SPI_SCRIPT_VERSION) ||
+            (pHeader->headerLen < sizeof(spiScriptHeader_t)) || ((pHeader->headerLen & 3) != 0) ||
+            (((UINT64)pHeader->headerLen + pHeader->recordsLen) > (UINT64)st.st_size))
+    {
+        ALOGE("%s: %s is not a compiled script of this version", __FUNCTION__, path);
+        goto clean_and_return;
+    }
+    pos = pHeader->headerLen;
+    end = pos + pHeader->recordsLen;
+    left = pHeader->apdus;
+    /* a bad record found half way would leave the card with part of the script */
+    if(!ScriptExec_checkRecords(image, pos, end, left, pHeader->maxApduLen))
+    {
+        ALOGE("%s: %s has malformed records", __FUNCTION__, path);
+        goto clean_and_return;
+    }
+
+    if((destPath != NULL) && (destPath[0] != '\0'))
+    {
+        rsp.fp = fopen(destPath, "w");
+        if(rsp.fp == NULL)
+            ALOGE("%s: cannot create %s", __FUNCTION__, destPath);
+    }
+
+    stat = true;
+    while(stat && (left != 0))
+    {
+        cpuUs = ScriptExec_cpuUs();
+        for(count = 0; (count < SCRIPT_EXEC_BATCH) && (left != 0); count++, left--)
+        {
+            const spiScriptRecord_t* pRecord = (const spiScriptRecord_t*)&image[pos];
+            batch[count].cmd = &image[pos + sizeof(spiScriptRecord_t)];
+            batch[count].cmdLen = pRecord->apduLen;
+            batch[count].sw = pRecord->sw;
+            batch[count].swMask = pRecord->swMask;
+            lines[count] = pRecord->line;
+            pos += SPI_SCRIPT_RECORD_SIZE(pRecord->apduLen);
+        }
+        pStats->parseCpuUs += ScriptExec_cpuUs() - cpuUs;
+
+        done = transceiveBatch(batch, count, ScriptExec_onRsp, &rsp);
+        pStats->apdus += (done < count) ? (done + 1) : done;
+        if(done < count)
+        {
+            ALOGE("%s: APDU of line %u answered %02X%02X", __FUNCTION__, lines[done],
+                    rsp.sw[0], rsp.sw[1]);
+            stat = false;
+        }
+    }
+
+    if((rsp.fp != NULL) && (fclose(rsp.fp) != 0))
+        ALOGE("%s: cannot write %s", __FUNCTION__, destPath);
+
+clean_and_return:
+    if(image != MAP_FAILED)
+        munmap(image, st.st_size);
+    if(fd >= 0)
+        close(fd);
+    pSw[0] = rsp.sw[0];
+    pSw[1] = rsp.sw[1];
+    pStats->cpuUs = ScriptExec_cpuUs() - startCpuUs;
+    pStats->wallUs = ScriptExec_nowUs() - startUs;
+    ALOGI("%s: %s %s, %llu APDUs, parse %llu us CPU, %llu us CPU, %llu ms", __FUNCTION__, path,
+            stat ? "done" : "failed", pStats->apdus, pStats->parseCpuUs, pStats->cpuUs,
+            pStats->wallUs / 1000);
+    return stat;
+}
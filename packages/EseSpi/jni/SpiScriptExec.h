@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPISCRIPTEXEC_H_
+#define SPISCRIPTEXEC_H_
+
+#include "SpiChannel.h"
+
+/* Cost of the last Loader Service script executed */
+typedef struct script_exec_stats
+{
+    bool   compiled;      /* run by ScriptExec_run rather than by ALA_Start */
+    UINT64 apdus;         /* APDUs sent, compiled scripts only */
+    UINT64 parseCpuUs;    /* CPU time reading the script, compiled scripts only */
+    UINT64 cpuUs;         /* CPU time of the whole execution */
+    UINT64 wallUs;        /* wall-clock time of the whole execution */
+}scriptExecStats_t;
+
+UINT64 ScriptExec_nowUs();
+UINT64 ScriptExec_cpuUs();
+bool ScriptExec_isCompiled(const char* path);
+bool ScriptExec_run(const char* path, const char* destPath, UINT8* pSw, scriptExecStats_t* pStats);
+
+#endif /* SPISCRIPTEXEC_H_ */
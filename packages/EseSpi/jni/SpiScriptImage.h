@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compiled Loader Service script, as written by ese_spi_script_compiler and
+ * executed by SpiScriptExec: a header, then one record per command APDU,
+ * each record aligned on 4 bytes and followed by the APDU bytes. Fields are
+ * little endian. The compiler checked every APDU against the ISO 7816-4
+ * cases, so the executor only checks that the records fit in the file.
+ */
+#ifndef SPISCRIPTIMAGE_H_
+#define SPISCRIPTIMAGE_H_
+
+#include <stdint.h>
+
+#define SPI_SCRIPT_MAGIC        0x42435345 /* "ESCB" */
+#define SPI_SCRIPT_VERSION      1
+#define SPI_SCRIPT_MAX_APDU_LEN 0xFFFF     /* apduLen of a record */
+#define SPI_SCRIPT_SW_OK        0x9000
+
+typedef struct spi_script_header
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerLen;   /* records start at this offset */
+    uint32_t apdus;
+    uint32_t recordsLen;  /* bytes of all the records */
+    uint32_t maxApduLen;
+    uint32_t reserved;
+    uint64_t sourceHash;  /* FNV-1a of the text script it was compiled from */
+}spiScriptHeader_t;
+
+typedef struct spi_script_record
+{
+    uint16_t apduLen;
+    uint16_t sw;          /* status word expected */
+    uint16_t swMask;      /* bits of sw compared, 0xFFFF for all */
+    uint16_t line;        /* line of the text script, 0 past 65535 */
+}spiScriptRecord_t;
+
+/* Size of a record and of its APDU, padding included */
+#define SPI_SCRIPT_RECORD_SIZE(apduLen) \
+    ((sizeof(spiScriptRecord_t) + (apduLen) + 3) & ~((size_t)3))
+
+#endif /* SPISCRIPTIMAGE_H_ */
@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Hand-off of the responses delivered by the stack callback to the thread
+ * that sent the request. Every request takes a slot tagged with its own
+ * request ID and sleeps on the eventfd of that slot. The requests are sent
+ * to the eSE one at a time in the order they took their slot, and the
+ * callback completes the request that was sent, so a callback arriving
+ * after its request was aborted is dropped instead of waking the next one.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <log/log.h>
+#include "SpiTransceiveSlot.h"
+#include "Mutex.h"
+
+static Mutex sSlotMutex;
+static transceiveSlot_t sSlots[TRANSCEIVE_SLOT_MAX];
+static transceiveSlot_t* sIssued = NULL;
+/* Completions the stack still owes to aborted requests, the last of which
+ * is sAbortedId. The stack runs one exchange at a time and completes each
+ * one it accepted, so these come before the one of the next request. */
+static UINT32 sAbortedOwed = 0;
+static UINT32 sAbortedId = 0;
+static UINT32 sNextRequestId = 0;
+static UINT32 sWakeupCount = 0;
+static long sWakeupMaxUs = 0;
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_signal
+**
+** Description:     Wakes the thread sleeping on the slot
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void TransceiveSlot_signal(transceiveSlot_t* pSlot)
+{
+    uint64_t one = 1;
+
+    if(write(pSlot->eventFd, &one, sizeof(one)) != sizeof(one))
+        ALOGE("%s: request %lu: %s", __FUNCTION__, pSlot->requestId, strerror(errno));
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_sleep
+**
+** Description:     Sleeps until the slot is signalled, the state has to be
+**                  checked again after it returns
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void TransceiveSlot_sleep(transceiveSlot_t* pSlot)
+{
+    struct pollfd pfd;
+    uint64_t count;
+
+    pfd.fd = pSlot->eventFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if((poll(&pfd, 1, -1) < 0) && (errno != EINTR))
+        ALOGE("%s: request %lu: %s", __FUNCTION__, pSlot->requestId, strerror(errno));
+    /* clears the counter, the eventfd is non blocking */
+    if(read(pSlot->eventFd, &count, sizeof(count)) < 0) {}
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_isNext
+**
+** Description:     Tells whether the queued slot may be sent: nothing is on
+**                  the eSE and no slot was queued before it
+**
+** Returns:         True if it is its turn.
+**
+*******************************************************************************/
+static bool TransceiveSlot_isNext(const transceiveSlot_t* pSlot)
+{
+    int i;
+
+    if(sIssued != NULL)
+        return false;
+    for(i = 0; i < TRANSCEIVE_SLOT_MAX; i++)
+    {
+        if((sSlots[i].state == SLOT_QUEUED) &&
+                ((INT32)(sSlots[i].requestId - pSlot->requestId) < 0))
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_wakeNext
+**
+** Description:     Wakes the oldest queued slot once the eSE is free
+**
+** Returns:         None.
+**
+*******************************************************************************/
+static void TransceiveSlot_wakeNext()
+{
+    transceiveSlot_t* pNext = NULL;
+    int i;
+
+    if(sIssued != NULL)
+        return;
+    for(i = 0; i < TRANSCEIVE_SLOT_MAX; i++)
+    {
+        if((sSlots[i].state == SLOT_QUEUED) &&
+                ((pNext == NULL) || ((INT32)(sSlots[i].requestId - pNext->requestId) < 0)))
+            pNext = &sSlots[i];
+    }
+    if(pNext != NULL)
+        TransceiveSlot_signal(pNext);
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_init
+**
+** Description:     Creates the eventfd and the response buffer of every slot
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void TransceiveSlot_init()
+{
+    AutoMutex lock(sSlotMutex);
+    int i;
+
+    for(i = 0; i < TRANSCEIVE_SLOT_MAX; i++)
+    {
+        memset(&sSlots[i], 0x00, sizeof(sSlots[i]));
+        sSlots[i].eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if(sSlots[i].eventFd < 0)
+            ALOGE("%s: eventfd: %s", __FUNCTION__, strerror(errno));
+        sSlots[i].rsp = (UINT8*)malloc(TRANSCEIVE_SLOT_INIT_RSP_LEN);
+        sSlots[i].rspMaxLen = (sSlots[i].rsp != NULL) ? TRANSCEIVE_SLOT_INIT_RSP_LEN : 0;
+    }
+    sIssued = NULL;
+    sAbortedOwed = 0;
+    sAbortedId = 0;
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_acquire
+**
+** Description:     Takes a slot for a new request and waits for the requests
+**                  queued before it to complete. The request is sent by the
+**                  caller once it returns, then TransceiveSlot_wait is called
+**                  if it was sent, TransceiveSlot_release in every case.
+**
+** Returns:         Slot, NULL if all slots are in use.
+**
+*******************************************************************************/
+transceiveSlot_t* TransceiveSlot_acquire()
+{
+    transceiveSlot_t* pSlot = NULL;
+    uint64_t count;
+    int i;
+
+    sSlotMutex.lock();
+    for(i = 0; i < TRANSCEIVE_SLOT_MAX; i++)
+    {
+        if((sSlots[i].state == SLOT_FREE) && (sSlots[i].eventFd >= 0))
+        {
+            pSlot = &sSlots[i];
+            break;
+        }
+    }
+    if(pSlot == NULL)
+    {
+        sSlotMutex.unlock();
+        ALOGE("%s: too many requests", __FUNCTION__);
+        return NULL;
+    }
+    /* a signal left by the previous owner of the slot is dropped */
+    if(read(pSlot->eventFd, &count, sizeof(count)) < 0) {}
+    if(++sNextRequestId == 0)
+        ++sNextRequestId;
+    pSlot->requestId = sNextRequestId;
+    pSlot->state = SLOT_QUEUED;
+    pSlot->sent = false;
+    pSlot->status = ESESTATUS_FAILED;
+    pSlot->rspLen = 0;
+    while(!TransceiveSlot_isNext(pSlot))
+    {
+        sSlotMutex.unlock();
+        TransceiveSlot_sleep(pSlot);
+        sSlotMutex.lock();
+    }
+    pSlot->state = SLOT_ISSUED;
+    sIssued = pSlot;
+    sSlotMutex.unlock();
+    ALOGV("%s: request %lu", __FUNCTION__, pSlot->requestId);
+    return pSlot;
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_wait
+**
+** Description:     Waits for the response of the request sent on the slot,
+**                  status, rsp and rspLen of the slot hold it on return
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void TransceiveSlot_wait(transceiveSlot_t* pSlot)
+{
+    struct timespec now;
+    long latencyUs;
+
+    sSlotMutex.lock();
+    pSlot->sent = true;
+    while(pSlot->state != SLOT_DONE)
+    {
+        sSlotMutex.unlock();
+        TransceiveSlot_sleep(pSlot);
+        sSlotMutex.lock();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    latencyUs = (now.tv_sec - pSlot->completedAt.tv_sec) * 1000000L +
+            (now.tv_nsec - pSlot->completedAt.tv_nsec) / 1000L;
+    sWakeupCount++;
+    if(latencyUs > sWakeupMaxUs)
+        sWakeupMaxUs = latencyUs;
+    sSlotMutex.unlock();
+    ALOGV("%s: request %lu woken after %ld us, max %ld us over %lu", __FUNCTION__,
+            pSlot->requestId, latencyUs, sWakeupMaxUs, sWakeupCount);
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_release
+**
+** Description:     Gives the slot back, also when the request could not be
+**                  sent, and lets the next request go
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void TransceiveSlot_release(transceiveSlot_t* pSlot)
+{
+    AutoMutex lock(sSlotMutex);
+
+    if(sIssued == pSlot)
+        sIssued = NULL;
+    /* aborted before it was sent, and the stack did not take it */
+    if((sAbortedOwed != 0) && (sAbortedId == pSlot->requestId) && !pSlot->sent)
+        sAbortedOwed--;
+    pSlot->state = SLOT_FREE;
+    TransceiveSlot_wakeNext();
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_complete
+**
+** Description:     Called from the stack callback, hands the response over to
+**                  the request on the eSE. Dropped when it answers an aborted
+**                  request, or when no request is waiting.
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void TransceiveSlot_complete(ESESTATUS status, const UINT8* data, UINT32 len)
+{
+    AutoMutex lock(sSlotMutex);
+    transceiveSlot_t* pSlot = sIssued;
+    UINT8* rsp;
+
+    if(sAbortedOwed != 0)
+    {
+        sAbortedOwed--;
+        ALOGE("%s: response of %lu bytes to an aborted request dropped, last aborted %lu",
+                __FUNCTION__, len, sAbortedId);
+        return;
+    }
+    if(pSlot == NULL)
+    {
+        ALOGE("%s: no request waiting, response of %lu bytes dropped", __FUNCTION__, len);
+        return;
+    }
+    pSlot->status = status;
+    pSlot->rspLen = 0;
+    if((data != NULL) && (len != 0))
+    {
+        if(len > pSlot->rspMaxLen)
+        {
+            /* kept for the next requests of the slot */
+            rsp = (UINT8*)realloc(pSlot->rsp, len);
+            if(rsp != NULL)
+            {
+                pSlot->rsp = rsp;
+                pSlot->rspMaxLen = len;
+            }
+        }
+        if(len <= pSlot->rspMaxLen)
+        {
+            memcpy(pSlot->rsp, data, len);
+            pSlot->rspLen = len;
+        }
+        else
+        {
+            ALOGE("%s: memory allocation error", __FUNCTION__);
+            pSlot->status = ESESTATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+    pSlot->state = SLOT_DONE;
+    clock_gettime(CLOCK_MONOTONIC, &pSlot->completedAt);
+    sIssued = NULL;
+    TransceiveSlot_signal(pSlot);
+    TransceiveSlot_wakeNext();
+}
+
+/*******************************************************************************
+**
+** Function:        TransceiveSlot_abort
+**
+** Description:     Completes the request on the eSE with ESESTATUS_FAILED,
+**                  its response is dropped when it comes
+**
+** Returns:         None.
+**
+*******************************************************************************/
+void TransceiveSlot_abort()
+{
+    AutoMutex lock(sSlotMutex);
+    transceiveSlot_t* pSlot = sIssued;
+
+    if(pSlot == NULL)
+        return;
+    ALOGV("%s: request %lu", __FUNCTION__, pSlot->requestId);
+    sAbortedOwed++;
+    sAbortedId = pSlot->requestId;
+    pSlot->status = ESESTATUS_FAILED;
+    pSlot->rspLen = 0;
+    pSlot->state = SLOT_DONE;
+    clock_gettime(CLOCK_MONOTONIC, &pSlot->completedAt);
+    sIssued = NULL;
+    TransceiveSlot_signal(pSlot);
+    TransceiveSlot_wakeNext();
+}
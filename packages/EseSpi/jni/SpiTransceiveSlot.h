@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2018 NXP Semiconductors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPITRANSCEIVESLOT_H_
+#define SPITRANSCEIVESLOT_H_
+
+#include <time.h>
+#include "SpiChannel.h"
+
+extern "C"
+{
+#if(NXP_ESE_CHIP_TYPE == P61)
+    #include "phNxpEseHal_Api.h"
+#elif(NXP_ESE_CHIP_TYPE == P73)
+    #include "phNxpEse_Api.h"
+#endif
+}
+
+/* Requests waiting for the eSE, the one being processed included */
+#define TRANSCEIVE_SLOT_MAX          4
+#define TRANSCEIVE_SLOT_INIT_RSP_LEN 258
+
+typedef enum transceive_slot_state
+{
+    SLOT_FREE = 0x00,
+    SLOT_QUEUED,   /* waiting for the requests before it */
+    SLOT_ISSUED,   /* sent, waiting for the stack callback */
+    SLOT_DONE      /* response or error delivered */
+}transceiveSlotState_t;
+
+/* Completion of one request, owns the response buffer */
+typedef struct transceive_slot
+{
+    UINT32 requestId;
+    transceiveSlotState_t state;
+    bool sent;     /* handed to the stack, TransceiveSlot_wait was called */
+    int eventFd;
+    ESESTATUS status;
+    UINT8* rsp;
+    UINT32 rspMaxLen;
+    UINT32 rspLen;
+    struct timespec completedAt;
+}transceiveSlot_t;
+
+void TransceiveSlot_init();
+transceiveSlot_t* TransceiveSlot_acquire();
+void TransceiveSlot_wait(transceiveSlot_t* pSlot);
+void TransceiveSlot_release(transceiveSlot_t* pSlot);
+void TransceiveSlot_complete(ESESTATUS status, const UINT8* data, UINT32 len);
+void TransceiveSlot_abort();
+
+#endif /* SPITRANSCEIVESLOT_H_ */
@@ -385,6 +385,11 @@ public class EseSpiService implements DeviceHost{
             }
         }
         boolean enableInternal(int timeout, IBinder b) {
+            /* the adapter does not tell the kind of client, the power policy sees a default one */
+            return enableInternal(timeout, NativeEseManager.SCHED_CLASS_DEFAULT, b);
+        }
+
+        boolean enableInternal(int timeout, int schedClass, IBinder b) {
             if (mState == EseSpiAdapter.STATE_ON) {
                 Log.i(TAG, "Inside 2nd try returning, Calling application PID :"+Binder.getCallingPid()+" Saved PID :"+mPid);
                 if(mPid != Binder.getCallingPid()){
@@ -408,7 +413,7 @@ public class EseSpiService implements DeviceHost{
                 Log.i(TAG, "Inside 1st try after thread creation");
                 mRoutingWakeLock.acquire();
                 try {
-                    if (!mSpiManager.doInitialize(timeout)) {
+                    if (!mSpiManager.doInitialize(timeout, schedClass)) {
                         Log.w(TAG, "Error enabling SPI");
                         /* One App at a time, second app comes here after doInitialize fail
                          * but shouldn't update the state to STATE_OFF, otherwise
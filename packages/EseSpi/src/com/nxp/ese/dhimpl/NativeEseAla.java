@@ -51,4 +51,7 @@ public class NativeEseAla {
     public native byte[] doLsGetStatus();
     public native byte[] doLsGetAppletStatus();
     public native int doGetLSConfigVersion();
+    /* of the last script: 1 if compiled, APDUs sent, CPU time reading the script in us,
+     * CPU time in us, wall-clock time in us, -1 when not known */
+    public native long[] doLsGetExecStats();
 }
@@ -17,6 +17,7 @@
 package com.nxp.ese.dhimpl;
 
 import java.lang.reflect.Method;
+import java.nio.ByteBuffer;
 import com.nxp.ese.EseSpiService;
 
 import android.content.SharedPreferences;
@@ -41,6 +42,16 @@ public class NativeEseManager{
     static final String PREF = "NativeSpiPrefs";
     private final EseSpiService mListener;
 
+    /* APDU scheduler classes, payment and transit go before the others */
+    public static final int SCHED_CLASS_PAYMENT = 0;
+    public static final int SCHED_CLASS_TRANSIT = 1;
+    public static final int SCHED_CLASS_DEFAULT = 2;
+    public static final int SCHED_CLASS_SYNC = 3;
+    public static final int SCHED_CLASS_OSU = 4;
+
+    /* Power policy hints, the eSE is about to be used or not expected soon */
+    public static final int POWER_HINT_ACTIVE = 0;
+    public static final int POWER_HINT_IDLE = 1;
 
     public NativeEseManager(Context context, EseSpiService listener) {
         mContext = context;
@@ -63,7 +74,8 @@ public class NativeEseManager{
     public native void doAbort();
 
 
-    public native boolean doInitialize(int timeout);
+    /* schedClass is one of SCHED_CLASS_*, it tells the power policy what kind of client opens */
+    public native boolean doInitialize(int timeout, int schedClass);
 
     public native boolean doDeinitialize();
 
@@ -75,6 +87,39 @@ public class NativeEseManager{
 
     public native byte[] doTransceive(byte[] data);
 
+    /* cmd and rsp are direct buffers used from their start, returns the response length or -1 */
+    public native int doTransceiveDirect(ByteBuffer cmd, int cmdLen, ByteBuffer rsp);
+
+    public native byte[] doLeaseChannel(byte[] aid);
+
+    public native boolean doReleaseChannel(int channel);
+
+    /* returns the client id, -1 on error */
+    public native int doRegisterSchedClient(int schedClass);
+
+    public native void doUnregisterSchedClient(int client);
+
+    /* timeout bounds the time in queue in ms, 0 for no limit */
+    public native byte[] doScheduledTransceive(int client, byte[] data, int timeout);
+
+    /* per class: APDUs sent, total and max time queued in us, APDUs queued */
+    public native long[] doGetSchedStats();
+
+    /* of the download engine: image size, image bytes done, APDU bytes sent, APDUs sent,
+     * elapsed time in us, KB/s, 1 while running, image bytes skipped by a resume,
+     * segments committed */
+    public native long[] doGetJcopDownloadProgress();
+
+    public native void doPowerHint(int hint);
+
+    /* cold and warm sessions, total open to first APDU time of each in us, max of it in us,
+     * speculative power ups and the ones used, estimated on time and idle on time in us */
+    public native long[] doGetPowerStats();
+
+    /* P61: normal sessions parked for a priority session, priority requests refused after
+     * NXP_ESE_PRIO_MAX_WAIT_MS, parked sessions resumed, total and max wait in us */
+    public native long[] doGetPrioStats();
+
     public native boolean doDisablePowerControl(boolean required);
 
     public native byte[] doGetSeTimer();